@@ -14,6 +14,24 @@
 #include "../source/constructors.h"
 #include "../source/casting.h"
 #include "../source/arrays.h"
+#include "../source/matchers.h"
+#include "../source/memory.h"
+#include "../source/strings.h"
+#include "../source/workers.h"
+
+static void planChunks(arrayjob*, array*, expression*);
+static int chunkStart(arrayjob*, int);
+static tap_fun* chunkFunction(arrayjob*, int, expression**);
+static void mapChunk(void*, int, int);
+static void filterChunk(void*, int, int);
+static void sortChunk(void*, int, int);
+static void mergeRuns(void*, int, int);
+static void mergeOrder(arrayjob*, tap_fun*, int, int, int);
+static string* joinArray(array*, string*, char*, int);
+static expression* applyFunction(tap_fun*, expression*[], int);
+static int elementBefore(tap_fun*, expression*, expression*);
+static int compareElements(expression*, expression*);
+static int sharesState(expression*);
 
 /*! Returns from the given array the element at the given index (arr, int)->*
     @param args         the list of arguments
@@ -64,7 +82,7 @@ void prim_aSet (expression* args[], int numargs, exprvals* returnval, datatype*
 */
 void prim_aSize (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
     *returntype = TYPE_INT;
-    returnval->intval = args[0]->ev.arrval->end - args[0]->ev.arrval->start;
+    returnval->intval = arrayUsedSize(args[0]->ev.arrval);
 }
 
 /*! Sets the size of the given array, reallocating memory if needed, returning 1 on success and 0 on failure (arr, [int], [int])->int
@@ -141,55 +159,194 @@ void prim_aConcat (expression* args[], int numargs, exprvals* returnval, datatyp
     returnval->arrval = result;
 }
 
-/*! Converts the given array into a string using the given delimiter or ', ' if none is given (arr, [str])->str
+/*! Sorts the given array by value, or with the given function, which is passed two elements and returns a true integer if the first belongs before the second; equal elements keep their order (arr, [fun])->arr
     @param args         the list of arguments
     @param numargs      the number of arguments
     @param returnval    the value the function returns after it ends
     @param returntype   the type of value the function returns after it ends
     @return             nothing
 */
-void prim_aStr (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+void prim_aSort (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    arrayjob job;
+    planChunks(&job, args[0]->ev.arrval, numargs == 2 ? args[1] : NULL);
+    job.order = allocate(sizeof(int) * (job.count + 1));
+    job.scratch = allocate(sizeof(int) * (job.count + 1));
+    job.bounds = allocate(sizeof(int) * (job.numchunks + 1));
+    int i;
+    for (i = 0; i < job.count; ++i) {
+        job.order[i] = i;
+    }
+    for (i = 0; i <= job.numchunks; ++i) {
+        job.bounds[i] = chunkStart(&job, i);
+    }
+    job.numruns = job.numchunks;
+    runParallel(&sortChunk, &job, job.numchunks); // sort each chunk on its own
+    while (job.numruns > 1) { // then merge neighboring runs until only one is left
+        runParallel(&mergeRuns, &job, job.numruns / 2);
+        for (i = 0; 2 * i < job.numruns; ++i) {
+            job.bounds[i] = job.bounds[2 * i];
+        }
+        job.bounds[i] = job.count;
+        job.numruns = i;
+    }
+    array* result = newArray(job.count);
+    for (i = 0; i < job.count; ++i) {
+        result->content[i] = copyExpression(job.source->content[job.source->start + job.order[i]]);
+    }
+    free(job.order);
+    free(job.scratch);
+    free(job.bounds);
+    *returntype = TYPE_ARR;
+    returnval->arrval = result;
+}
+
+/*! Returns a new array of the results of calling the given function on each element of the given array, which are handed out to the worker pool when the function only uses its arguments and built-ins (arr, fun)->arr
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_aMap (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    arrayjob job;
+    planChunks(&job, args[0]->ev.arrval, args[1]);
+    array* result = newArray(job.count);
+    job.results = result->content; // each task fills in its own chunk of the result
+    runParallel(&mapChunk, &job, job.numchunks);
+    *returntype = TYPE_ARR;
+    returnval->arrval = result;
+}
+
+/*! Returns a new array of the elements of the given array for which the given function returns a true integer, in their original order; the calls are handed out like map's (arr, fun)->arr
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_aFilter (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    arrayjob job;
+    planChunks(&job, args[0]->ev.arrval, args[1]);
+    job.keep = allocate(job.count + 1);
+    runParallel(&filterChunk, &job, job.numchunks);
+    int kept = 0;
+    int i;
+    for (i = 0; i < job.count; ++i) {
+        kept += job.keep[i];
+    }
+    array* result = newArray(kept);
+    kept = 0;
+    for (i = 0; i < job.count; ++i) {
+        if (job.keep[i]) {
+            result->content[kept++] = copyExpression(job.source->content[job.source->start + i]);
+        }
+    }
+    free(job.keep);
+    *returntype = TYPE_ARR;
+    returnval->arrval = result;
+}
+
+/*! Folds the given array from the first element to the last, passing the given function the result so far (starting with the given initial value) and the next element; each call depends on the last, so the calls are made in turn (arr, fun, *)->*
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_aAccum (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
     array* arr = args[0]->ev.arrval;
-    int arrsize = arr->end - arr->start;
-    char* delimiter;
-    if (numargs == 1) {
-        delimiter = ", ";
-    } else {
-        string* str = castToStr(args[1]);
-        delimiter = str->content;
-        free(str);
-    }
-    int demsize = strlen(delimiter);
-    int size = demsize * (arrsize - 1) + 3;
-    string* strings[arrsize];
-    int lengths[arrsize];
+    tap_fun* fun = args[1]->ev.funval;
+    expression* result = copyExpressionNR(args[2]);
     int i;
-    for (i = 0; i < arrsize; ++i) {
-        strings[i] = castToStr(arr->content[arr->start + i]);
-        lengths[i] = strings[i]->size;
-        size += strings[i]->size;
-    }
-    char* result = allocate(size);
-    result[0] = '{';
-    int index = 1;
-    for (i = 0; i < arrsize - 1; ++i) {
-        strcpy(result + index, strings[i]->content);
-        index += lengths[i];
-        strcpy(result + index, delimiter);
-        index += demsize;
-        free(strings[i]);
-    }
-    if (arrsize == 0) {
-        result[1] = '}';
-        result[2] = '\0';
-    } else {
-        strcpy(result + index, strings[arrsize - 1]->content);
-        result[index + 1] = '}';
-        result[index + 2] = '\0';
-        free(strings[arrsize - 1]);
+    for (i = arr->start; i <= arr->end; ++i) {
+        expression* funargs[2] = {result, arr->content[i]};
+        expression* next = applyFunction(fun, funargs, 2);
+        freeExpr(result);
+        result = next;
+    }
+    *returntype = result->type;
+    *returnval = result->ev;
+    free(result); // the result's contents now belong to the return value
+}
+
+/*! Returns a new array of the results of the given array's elements, forcing (and so waiting for any spawned) lazy expressions in turn and copying the other elements as is (arr)->arr
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_aAwait (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    array* arr = args[0]->ev.arrval;
+    array* result = newArray(arr->end - arr->start + 1);
+    int i;
+    for (i = arr->start; i <= arr->end; ++i) {
+        expression* element = arr->content[i];
+        result->content[i - arr->start] = element->type == TYPE_LAZ ? forceLaz(element) : copyExpressionNR(element);
+    }
+    *returntype = TYPE_ARR;
+    returnval->arrval = result;
+}
+
+/*! Returns a matcher that finds any of the given array's elements, cast to strings, in a single scan; an element that can't be a string or is
+    empty is reported as an invalid argument and never matches, since find would take an empty needle as found anywhere (arr)->mat
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_aMatcher (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    array* arr = args[0]->ev.arrval;
+    int numneedles = arr->end - arr->start + 1;
+    string** needles = allocate(sizeof(string*) * (numneedles > 0 ? numneedles : 1));
+    int i;
+    for (i = 0; i < numneedles; ++i) {
+        needles[i] = castToStr(arr->content[arr->start + i]);
+        if (needles[i] == NULL || needles[i]->size == 0) { // the needle is left empty, which matches nowhere
+            addError(newErrorlist(ERR_INVALID_ARG, newString(printExpression(arr->content[arr->start + i])), 0, 0));
+            if (needles[i] == NULL) {
+                needles[i] = newStringOfSize(0);
+            }
+        }
+    }
+    *returntype = TYPE_MAT;
+    returnval->matval = newMatcher(needles, numneedles);
+    for (i = 0; i < numneedles; ++i) {
+        freeStr(needles[i]);
+    }
+    free(needles);
+}
+
+/*! Converts the given array into a string using the given delimiter or ', ' if none is given (arr, [str])->str
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_aStr (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    string* delimiter = numargs == 2 ? castToStr(args[1]) : NULL;
+    if (delimiter == NULL) {
+        delimiter = newStringCopy(", ", 2);
     }
     *returntype = TYPE_STR;
-    returnval->strval = newString(result);
+    returnval->strval = joinArray(args[0]->ev.arrval, delimiter, "{}", 2);
+    freeStr(delimiter);
+}
+
+/*! Joins the given array's elements, cast to strings, into one string with the given delimiter, a character code, or nothing between them if none is given (arr, [str/int])->str
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_aJoin (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    string* delimiter = numargs == 2 ? castToNeedle(args[1]) : newStringOfSize(0); // an integer is a character code, as split takes it
+    *returntype = TYPE_STR;
+    returnval->strval = joinArray(args[0]->ev.arrval, delimiter, "", 0);
+    freeStr(delimiter);
 }
 
 /*! Returns a copy of the given array (arr)->arr
@@ -219,3 +376,280 @@ void prim_aTyp (expression* args[], int numargs, exprvals* returnval, datatype*
     *returntype = TYPE_TYP;
     returnval->intval = TYPE_ARR;
 }
+
+/*! Sets up a job over the given array, splitting it into one chunk per task; the array is only split when it's large and the given function can be evaluated by the workers without sharing anything with the calling context
+    @param job          the job to set up
+    @param arr          the array
+    @param function     the function expression applied to the elements (null if they're compared by value)
+    @return             nothing
+*/
+static void planChunks (arrayjob* job, array* arr, expression* function) {
+    job->source = arr;
+    job->count = arr->end - arr->start + 1;
+    job->function = function;
+    job->numchunks = 1;
+    int parallel = job->count >= PARALLEL_MIN_ELEMENTS;
+    if (parallel && function != NULL) {
+        parallel = parallelSafe(function->ev.funval);
+        int i;
+        for (i = 0; parallel && i < job->count; ++i) { // the workers pass the elements to the function as they are, so none can hold anything the copies would share
+            parallel = !sharesState(arr->content[arr->start + i]);
+        }
+    }
+    if (parallel) {
+        job->numchunks = parallelWorkers() * WORKER_CHUNKS_PER_THREAD;
+        if (job->numchunks > job->count) {
+            job->numchunks = job->count;
+        }
+    }
+}
+
+/*! Returns the index of the first element of the given chunk of the given job
+    @param job          the job
+    @param chunk        the chunk (the number of chunks for the end of the last one)
+    @return             the index of the element
+*/
+static int chunkStart (arrayjob* job, int chunk) {
+    return (int)((long)job->count * chunk / job->numchunks);
+}
+
+/*! Returns the function a chunk of the given job should call, which is a copy of the job's function when the chunk is being handled by a worker
+    @param job          the job
+    @param parallel     1 if the chunk is being handled by a worker, 0 otherwise
+    @param copy         set to the copy, which must be freed once the chunk is done, or null if no copy was needed
+    @return             the function or null if the job has no function
+*/
+static tap_fun* chunkFunction (arrayjob* job, int parallel, expression** copy) {
+    *copy = NULL;
+    if (job->function == NULL) {
+        return NULL;
+    } else if (parallel) { // the original's lazy expressions are shared with the calling context
+        *copy = copyExpressionUnsharedNR(job->function);
+        return (*copy)->ev.funval;
+    }
+    return job->function->ev.funval;
+}
+
+/*! Calls the job's function on each element of the given chunk (a workertask)
+    @param data         the arrayjob
+    @param chunk        the chunk
+    @param parallel     1 if the chunk is being handled by a worker, 0 otherwise
+    @return             nothing
+*/
+static void mapChunk (void* data, int chunk, int parallel) {
+    arrayjob* job = data;
+    expression* copy;
+    tap_fun* fun = chunkFunction(job, parallel, &copy);
+    int end = chunkStart(job, chunk + 1);
+    int i;
+    for (i = chunkStart(job, chunk); i < end; ++i) {
+        job->results[i] = applyFunction(fun, &job->source->content[job->source->start + i], 1);
+    }
+    freeExpr(copy);
+}
+
+/*! Marks which elements of the given chunk the job's function keeps (a workertask)
+    @param data         the arrayjob
+    @param chunk        the chunk
+    @param parallel     1 if the chunk is being handled by a worker, 0 otherwise
+    @return             nothing
+*/
+static void filterChunk (void* data, int chunk, int parallel) {
+    arrayjob* job = data;
+    expression* copy;
+    tap_fun* fun = chunkFunction(job, parallel, &copy);
+    int end = chunkStart(job, chunk + 1);
+    int i;
+    for (i = chunkStart(job, chunk); i < end; ++i) {
+        expression* result = applyFunction(fun, &job->source->content[job->source->start + i], 1);
+        job->keep[i] = result->type == TYPE_INT && result->ev.intval != 0;
+        freeExpr(result);
+    }
+    freeExpr(copy);
+}
+
+/*! Sorts the positions of the elements of the given chunk with a bottom-up merge sort (a workertask)
+    @param data         the arrayjob
+    @param chunk        the chunk
+    @param parallel     1 if the chunk is being handled by a worker, 0 otherwise
+    @return             nothing
+*/
+static void sortChunk (void* data, int chunk, int parallel) {
+    arrayjob* job = data;
+    expression* copy;
+    tap_fun* fun = chunkFunction(job, parallel, &copy);
+    int start = chunkStart(job, chunk);
+    int end = chunkStart(job, chunk + 1);
+    int width;
+    for (width = 1; width < end - start; width *= 2) {
+        int left;
+        for (left = start; left < end - width; left += 2 * width) {
+            mergeOrder(job, fun, left, left + width, left + 2 * width < end ? left + 2 * width : end);
+        }
+    }
+    freeExpr(copy);
+}
+
+/*! Merges the given pair of neighboring sorted runs (a workertask)
+    @param data         the arrayjob
+    @param pair         the pair, which merges runs 2 * pair and 2 * pair + 1
+    @param parallel     1 if the pair is being handled by a worker, 0 otherwise
+    @return             nothing
+*/
+static void mergeRuns (void* data, int pair, int parallel) {
+    arrayjob* job = data;
+    expression* copy;
+    tap_fun* fun = chunkFunction(job, parallel, &copy);
+    mergeOrder(job, fun, job->bounds[2 * pair], job->bounds[2 * pair + 1], job->bounds[2 * pair + 2]);
+    freeExpr(copy);
+}
+
+/*! Merges two neighboring sorted runs of the job's positions, taking from the second run only when its element belongs strictly before the first's so that the sort is stable
+    @param job          the job
+    @param fun          the function comparing the elements (null to compare them by value)
+    @param left         where the first run starts
+    @param middle       where the second run starts
+    @param right        where the second run ends
+    @return             nothing
+*/
+static void mergeOrder (arrayjob* job, tap_fun* fun, int left, int middle, int right) {
+    expression** elements = job->source->content + job->source->start;
+    int i = left;
+    int j = middle;
+    int k = left;
+    while (i < middle && j < right) {
+        if (elementBefore(fun, elements[job->order[j]], elements[job->order[i]])) {
+            job->scratch[k++] = job->order[j++];
+        } else {
+            job->scratch[k++] = job->order[i++];
+        }
+    }
+    while (i < middle) {
+        job->scratch[k++] = job->order[i++];
+    }
+    while (j < right) {
+        job->scratch[k++] = job->order[j++];
+    }
+    memcpy(job->order + left, job->scratch + left, sizeof(int) * (right - left));
+}
+
+/*! Calls the given function with the given arguments, checking them against its signature first
+    @param fun          the function
+    @param args         the arguments
+    @param numargs      the number of arguments
+    @return             the result or nil if the arguments don't suit the function
+*/
+static expression* applyFunction (tap_fun* fun, expression* args[], int numargs) {
+    expression* head = newExpressionFun(fun); // only used to describe the call if it's invalid
+    expression* result = validFunCall(fun, head, args, numargs) ? callTapFun(fun, args, numargs) : newExpressionNil();
+    free(head); // the function itself belongs to the caller
+    return result;
+}
+
+/*! Returns whether or not the first element belongs before the second
+    @param fun          the function comparing them or null to compare them by value
+    @param first        the first element
+    @param second       the second element
+    @return             1 if the first element belongs strictly before the second, 0 otherwise
+*/
+static int elementBefore (tap_fun* fun, expression* first, expression* second) {
+    if (fun == NULL) {
+        return compareElements(first, second) < 0;
+    }
+    expression* args[2] = {first, second};
+    expression* result = applyFunction(fun, args, 2);
+    int before = result->type == TYPE_INT && result->ev.intval != 0;
+    freeExpr(result);
+    return before;
+}
+
+/*! Compares the given elements by value: numbers numerically, strings by their characters and dates chronologically; elements of different types are ordered by type
+    @param first        the first element
+    @param second       the second element
+    @return             a negative integer if the first element is less, 0 if they're equal, and a positive integer if it's greater
+*/
+static int compareElements (expression* first, expression* second) {
+    int firstnumber = first->type == TYPE_INT || first->type == TYPE_FLO;
+    int secondnumber = second->type == TYPE_INT || second->type == TYPE_FLO;
+    if (firstnumber && secondnumber) {
+        if (first->type == TYPE_INT && second->type == TYPE_INT) {
+            return (first->ev.intval > second->ev.intval) - (first->ev.intval < second->ev.intval);
+        }
+        tap_flo x = first->type == TYPE_INT ? first->ev.intval : first->ev.floval;
+        tap_flo y = second->type == TYPE_INT ? second->ev.intval : second->ev.floval;
+        return (x > y) - (x < y);
+    } else if (first->type == TYPE_STR && second->type == TYPE_STR) {
+        string* x = first->ev.strval;
+        string* y = second->ev.strval;
+        int order = memcmp(x->content, y->content, x->size < y->size ? x->size : y->size); // compared by size since slices aren't null terminated
+        return order != 0 ? order : (x->size > y->size) - (x->size < y->size);
+    } else if (first->type == TYPE_DAT && second->type == TYPE_DAT) {
+        return (first->ev.datval > second->ev.datval) - (first->ev.datval < second->ev.datval);
+    }
+    return (firstnumber ? TYPE_INT : first->type) - (secondnumber ? TYPE_INT : second->type);
+}
+
+/*! Returns whether or not copying the given element would share something with it (a lazy expression, function or object), which would make handing it to a worker unsafe
+    @param expr         the element
+    @return             1 if a copy would share something with the element, 0 otherwise
+*/
+static int sharesState (expression* expr) {
+    if (expr->type == TYPE_LAZ || expr->type == TYPE_FUN || expr->type == TYPE_OBJ) {
+        return 1;
+    } else if (expr->type == TYPE_ARR) {
+        int i;
+        for (i = expr->ev.arrval->start; i <= expr->ev.arrval->end; ++i) {
+            if (sharesState(expr->ev.arrval->content[i])) {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/*! Joins the given array's elements, cast to strings, into one string, working out its exact size first so it's made in a single allocation
+    @param arr          the array
+    @param delimiter    the string put between each element
+    @param brackets     the characters put before and after the elements, if any
+    @param numbrackets  the number of bracket characters, 0 or 2
+    @return             the new string
+*/
+static string* joinArray (array* arr, string* delimiter, char* brackets, int numbrackets) {
+    int count = arrayUsedSize(arr);
+    string** pieces = allocate(sizeof(string*) * (count > 0 ? count : 1));
+    int size = numbrackets + (count > 0 ? delimiter->size * (count - 1) : 0);
+    int i;
+    for (i = 0; i < count; ++i) {
+        expression* element = arr->content[arr->start + i];
+        if (element->type == TYPE_STR && element->flag == EFLAG_NONE) { // string elements are used as they are rather than copied
+            pieces[i] = element->ev.strval;
+        } else {
+            pieces[i] = castToStr(element);
+            if (pieces[i] == NULL) { // an element that can't be cast is shown as it's printed
+                pieces[i] = newString(printExpression(element));
+            }
+        }
+        size += pieces[i]->size;
+    }
+    string* result = newStringOfSize(size);
+    char* dest = result->content;
+    if (numbrackets > 0) {
+        *dest++ = brackets[0];
+    }
+    for (i = 0; i < count; ++i) {
+        if (i > 0) {
+            memcpy(dest, delimiter->content, delimiter->size);
+            dest += delimiter->size;
+        }
+        memcpy(dest, pieces[i]->content, pieces[i]->size); // copied by size since slices aren't null terminated
+        dest += pieces[i]->size;
+        if (pieces[i] != arr->content[arr->start + i]->ev.strval) {
+            freeStr(pieces[i]);
+        }
+    }
+    if (numbrackets > 0) {
+        *dest = brackets[1];
+    }
+    free(pieces);
+    return result;
+}
@@ -10,18 +10,36 @@
 
 #include "../source/structs.h"
 
+typedef struct arrayjob_ arrayjob;
+
+struct arrayjob_ {
+    array* source;
+    int count; // the number of elements in the source array
+    int numchunks; // the number of pieces the elements are split into, each handled by one task
+    expression* function; // the function applied to the elements (null to compare them by value)
+    expression** results; // what the function returned for each element (map)
+    char* keep; // whether or not each element is kept (filter)
+    int* order; // the elements' positions in sorted order (sort)
+    int* scratch; // room to merge runs of positions into (sort)
+    int* bounds; // where each sorted run of positions starts, with the count at the end (sort)
+    int numruns;
+};
+
 void prim_aGet(expression*[], int, exprvals*, datatype*);
 void prim_aSet(expression*[], int, exprvals*, datatype*);
 void prim_aSize(expression*[], int, exprvals*, datatype*);
 void prim_aResize(expression*[], int, exprvals*, datatype*);
 void prim_aConcat(expression*[], int, exprvals*, datatype*);
 /*void prim_aRemove(expression*[], int, exprvals*, datatype*);
-void prim_aReverse(expression*[], int, exprvals*, datatype*);
+void prim_aReverse(expression*[], int, exprvals*, datatype*);*/
 void prim_aSort(expression*[], int, exprvals*, datatype*);
 void prim_aMap(expression*[], int, exprvals*, datatype*);
 void prim_aFilter(expression*[], int, exprvals*, datatype*);
-void prim_aAccum(expression*[], int, exprvals*, datatype*);*/
+void prim_aAccum(expression*[], int, exprvals*, datatype*);
+void prim_aAwait(expression*[], int, exprvals*, datatype*);
+void prim_aMatcher(expression*[], int, exprvals*, datatype*);
 void prim_aStr(expression*[], int, exprvals*, datatype*);
+void prim_aJoin(expression*[], int, exprvals*, datatype*);
 void prim_aArr(expression*[], int, exprvals*, datatype*);
 void prim_aTyp(expression*[], int, exprvals*, datatype*);
 
@@ -0,0 +1,136 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   prim_bld.c
+    @brief  All of the primitive functions for string builders used by the language
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "prim_bld.h"
+#include "../source/constants.h"
+#include "../source/engine.h"
+#include "../source/constructors.h"
+#include "../source/casting.h"
+#include "../source/memory.h"
+#include "../source/builders.h"
+
+/*! Appends each of the given values, cast to strings, to the end of the given string builder and returns the builder (bld, *...)->bld
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_bAppend (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    tap_bld* bld = args[0]->ev.bldval;
+    int i;
+    for (i = 1; i < numargs; ++i) {
+        if (args[i]->type == TYPE_STR && args[i]->flag != EFLAG_VAR) { // appended straight from the argument, without a copy
+            appendBuilder(bld, args[i]->ev.strval->content, args[i]->ev.strval->size);
+            continue;
+        }
+        string* str = castToStr(args[i]); // a builder (even this one) is put together first
+        if (str == NULL) {
+            addError(newErrorlist(ERR_INVALID_ARG, newString(printExpression(args[i])), 0, 0));
+            continue;
+        }
+        appendBuilder(bld, str->content, str->size);
+        freeStr(str);
+    }
+    *returntype = TYPE_BLD;
+    returnval->bldval = shareBuilder(bld);
+}
+
+/*! Returns the size of the string the given string builder has built (bld)->int
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_bSize (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    *returntype = TYPE_INT;
+    returnval->intval = args[0]->ev.bldval->size;
+}
+
+/*! Returns the integer value of the character at the given index of the string the given string builder has built (bld, int)->int
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_bChar (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    tap_bld* bld = args[0]->ev.bldval;
+    tap_int index = castToInt(args[1]);
+    *returntype = TYPE_INT;
+    if (index < 0 || index >= bld->size) {
+        addError(newErrorlist(ERR_OUT_OF_BOUNDS, newString(printExpression(args[1])), 0, 0));
+        returnval->intval = 0;
+        return;
+    }
+    returnval->intval = builderChar(bld, index);
+}
+
+/*! Returns the substring of the string the given string builder has built between the two given integers (or the integer and the end if only one is given), without putting the whole string together (bld, int, [int])->str
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_bSubstr (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    tap_bld* bld = args[0]->ev.bldval;
+    tap_int start = castToInt(args[1]);
+    tap_int end = numargs == 2 ? bld->size : castToInt(args[2]) + 1;
+    if (start < 0) {
+        start = 0;
+    }
+    if (end > bld->size) {
+        end = bld->size;
+    }
+    if (end < start) {
+        end = start;
+    }
+    *returntype = TYPE_STR;
+    returnval->strval = newStringOfSize(end - start);
+    readBuilder(bld, start, end - start, returnval->strval->content);
+}
+
+/*! Returns a new string builder holding a copy of the string the given one has built, which later appends to either one don't affect (bld)->bld
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_bCopy (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    *returntype = TYPE_BLD;
+    returnval->bldval = copyBuilder(args[0]->ev.bldval);
+}
+
+/*! Returns the string the given string builder has built, putting its pieces together in a single allocation (bld)->str
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_bStr (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    *returntype = TYPE_STR;
+    returnval->strval = flattenBuilder(args[0]->ev.bldval);
+}
+
+/*! Returns type string builder (bld)->typ
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_bTyp (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    *returntype = TYPE_TYP;
+    returnval->intval = TYPE_BLD;
+}
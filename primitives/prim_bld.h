@@ -0,0 +1,21 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   prim_bld.h
+    @brief  The header file for prim_bld.c
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#ifndef PRIM_BLD_H
+#define PRIM_BLD_H
+
+#include "../source/structs.h"
+
+void prim_bAppend(expression*[], int, exprvals*, datatype*);
+void prim_bSize(expression*[], int, exprvals*, datatype*);
+void prim_bChar(expression*[], int, exprvals*, datatype*);
+void prim_bSubstr(expression*[], int, exprvals*, datatype*);
+void prim_bCopy(expression*[], int, exprvals*, datatype*);
+void prim_bStr(expression*[], int, exprvals*, datatype*);
+void prim_bTyp(expression*[], int, exprvals*, datatype*);
+
+#endif
@@ -0,0 +1,130 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   prim_chn.c
+    @brief  All of the primitive functions for channels used by the language
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "prim_chn.h"
+#include "../source/constants.h"
+#include "../source/engine.h"
+#include "../source/constructors.h"
+#include "../source/strings.h"
+#include "../source/memory.h"
+#include "../source/channels.h"
+#include "../source/workers.h"
+
+static int movableValue(expression*);
+
+/*! Sends a copy of the given value through the given channel, waiting while the channel is full, and returns 1 if it was sent or 0 if the channel is closed; objects can't be sent since their copies would share properties (chn, *)->int
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_cSend (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    *returntype = TYPE_INT;
+    returnval->intval = 0;
+    if (!movableValue(args[1])) {
+        addError(newErrorlist(ERR_INVALID_ARG, newString(printExpression(args[1])), 0, 0));
+        return;
+    }
+    expression* value = detachedCopy(args[1]); // the receiver gets a value of its own, whatever context it's in
+    returnval->intval = sendChannel(args[0]->ev.chnval, value);
+    if (!returnval->intval) {
+        freeExprNR(value);
+    }
+}
+
+/*! Receives the next value from the given channel, waiting while the channel is empty, and returns it or, once the channel is closed and empty, the given default value or nil (chn, [*])->*
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_cReceive (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    expression* value = receiveChannel(args[0]->ev.chnval);
+    if (value == NULL && numargs == 2) {
+        value = copyExpressionNR(args[1]);
+    } else if (value == NULL) {
+        *returntype = TYPE_NIL;
+        returnval->intval = NIL;
+        return;
+    }
+    *returntype = value->type;
+    *returnval = value->ev;
+    free(value); // the value's contents now belong to the return value
+}
+
+/*! Closes the given channel, so that sending to it fails and receiving from it returns nil once the values already sent are received (chn)->nil
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_cClose (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    closeChannel(args[0]->ev.chnval);
+    *returntype = TYPE_NIL;
+    returnval->intval = NIL;
+}
+
+/*! Returns the number of values waiting in the given channel (chn)->int
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_cSize (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    *returntype = TYPE_INT;
+    returnval->intval = channelCount(args[0]->ev.chnval);
+}
+
+/*! Returns a description of the given channel (chn)->str
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_cStr (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    *returntype = TYPE_STR;
+    returnval->strval = newStringCopy("[channel]", 9);
+}
+
+/*! Returns the type of the given channel (chn)->typ
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_cTyp (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    *returntype = TYPE_TYP;
+    returnval->intval = TYPE_CHN;
+}
+
+/*! Returns whether or not a copy of the given value shares nothing with it
+    @param value        the value
+    @return             1 if it contains no objects, 0 otherwise
+*/
+static int movableValue (expression* value) {
+    if (value->type == TYPE_OBJ) {
+        return 0;
+    }
+    if (value->type == TYPE_ARR) {
+        int i;
+        for (i = value->ev.arrval->start; i <= value->ev.arrval->end; ++i) {
+            if (value->ev.arrval->content[i] != NULL && !movableValue(value->ev.arrval->content[i])) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
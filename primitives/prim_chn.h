@@ -0,0 +1,20 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   prim_chn.h
+    @brief  The header file for prim_chn.c
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#ifndef PRIM_CHN_H
+#define PRIM_CHN_H
+
+#include "../source/structs.h"
+
+void prim_cSend(expression*[], int, exprvals*, datatype*);
+void prim_cReceive(expression*[], int, exprvals*, datatype*);
+void prim_cClose(expression*[], int, exprvals*, datatype*);
+void prim_cSize(expression*[], int, exprvals*, datatype*);
+void prim_cStr(expression*[], int, exprvals*, datatype*);
+void prim_cTyp(expression*[], int, exprvals*, datatype*);
+
+#endif
@@ -11,9 +11,11 @@
 #include "../source/constants.h"
 #include "../source/casting.h"
 #include "../source/constructors.h"
+#include "../source/memory.h"
+#include "../source/strings.h"
 #include "../source/dates.h"
 
-extern int monthdays[];
+extern const int monthdays[];
 
 /*! Returns the year of the given date (dat)->int
     @param args         the list of arguments
@@ -389,14 +391,13 @@ void prim_dStr (expression* args[], int numargs, exprvals* returnval, datatype*
         if (formatstr == NIL) {
             format = defaultformat;
         } else {
-            format = formatstr->content;
+            format = stringContent(formatstr);
             freestr = args[1]->type != TYPE_STR;
         }
     }
     string* str = newString(printDate(args[0]->ev.datval, format));
     if (freestr) {
-        free(formatstr->content);
-        free(formatstr);
+        freeStr(formatstr);
     }
     *returntype = TYPE_STR;
     returnval->strval = str;
@@ -154,7 +154,7 @@ void prim_fAbs (expression* args[], int numargs, exprvals* returnval, datatype*
 void prim_fMax (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
     int i;
     double potential;
-    double result = args[0]->ev.intval;
+    double result = args[0]->ev.floval;
     for (i = 1; i < numargs; ++i) {
         potential = castToFlo(args[i]);
         if (potential > result) {
@@ -175,7 +175,7 @@ void prim_fMax (expression* args[], int numargs, exprvals* returnval, datatype*
 void prim_fMin (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
     int i;
     double potential;
-    double result = args[0]->ev.intval;
+    double result = args[0]->ev.floval;
     for (i = 1; i < numargs; ++i) {
         potential = castToFlo(args[i]);
         if (potential < result) {
@@ -207,6 +207,7 @@ void prim_fRound (expression* args[], int numargs, exprvals* returnval, datatype
     } else {
         returnval->floval = result->ev.floval;
     }
+    free(result);
 }
 
 /*! Returns the given float rounded up to the nearest digit of accuracy (returns an int if no accuracy specified) (flo, [int])->int/flo
@@ -689,3 +690,160 @@ void prim_fTyp (expression* args[], int numargs, exprvals* returnval, datatype*
     *returntype = TYPE_TYP;
     returnval->intval = TYPE_FLO;
 }
+
+/*! The fast-call form of prim_fAdd: adds together each float
+    @param operands     the array of float operands
+    @param count        the number of operands
+    @return             the result
+*/
+tap_flo fast_fAdd (tap_flo operands[], int count) {
+    tap_flo result = 0;
+    int i;
+    for (i = 0; i < count; ++i) {
+        result += operands[i];
+    }
+    return result;
+}
+
+/*! The fast-call form of prim_fSub: subtracts each float after the first from the first
+    @param operands     the array of float operands
+    @param count        the number of operands
+    @return             the result
+*/
+tap_flo fast_fSub (tap_flo operands[], int count) {
+    tap_flo result = operands[0];
+    int i;
+    for (i = 1; i < count; ++i) {
+        result -= operands[i];
+    }
+    return result;
+}
+
+/*! The fast-call form of prim_fMul: multiplies together each float
+    @param operands     the array of float operands
+    @param count        the number of operands
+    @return             the result
+*/
+tap_flo fast_fMul (tap_flo operands[], int count) {
+    tap_flo result = 1;
+    int i;
+    for (i = 0; i < count; ++i) {
+        result *= operands[i];
+    }
+    return result;
+}
+
+/*! The fast-call form of prim_fMax: returns the maximum float
+    @param operands     the array of float operands
+    @param count        the number of operands
+    @return             the result
+*/
+tap_flo fast_fMax (tap_flo operands[], int count) {
+    tap_flo result = operands[0];
+    int i;
+    for (i = 1; i < count; ++i) {
+        result = operands[i] > result ? operands[i] : result;
+    }
+    return result;
+}
+
+/*! The fast-call form of prim_fMin: returns the minimum float
+    @param operands     the array of float operands
+    @param count        the number of operands
+    @return             the result
+*/
+tap_flo fast_fMin (tap_flo operands[], int count) {
+    tap_flo result = operands[0];
+    int i;
+    for (i = 1; i < count; ++i) {
+        result = operands[i] < result ? operands[i] : result;
+    }
+    return result;
+}
+
+/* The fast-call comparisons below check every pair instead of stopping at the first that fails, so the compiler can evaluate the
+   comparisons in parallel */
+
+/*! The fast-call form of prim_fLess: returns whether each float is less than the next float
+    @param operands     the array of float operands
+    @param count        the number of operands
+    @return             the result
+*/
+tap_int fast_fLess (tap_flo operands[], int count) {
+    int result = 1;
+    int i;
+    for (i = 1; i < count; ++i) {
+        result &= operands[i - 1] < operands[i];
+    }
+    return result;
+}
+
+/*! The fast-call form of prim_fLequal: returns whether each float is less than or equal to the next float
+    @param operands     the array of float operands
+    @param count        the number of operands
+    @return             the result
+*/
+tap_int fast_fLequal (tap_flo operands[], int count) {
+    int result = 1;
+    int i;
+    for (i = 1; i < count; ++i) {
+        result &= operands[i - 1] <= operands[i];
+    }
+    return result;
+}
+
+/*! The fast-call form of prim_fEqual: returns whether each float is equal to the next float
+    @param operands     the array of float operands
+    @param count        the number of operands
+    @return             the result
+*/
+tap_int fast_fEqual (tap_flo operands[], int count) {
+    int result = 1;
+    int i;
+    for (i = 1; i < count; ++i) {
+        result &= operands[i - 1] == operands[i];
+    }
+    return result;
+}
+
+/*! The fast-call form of prim_fNequal: returns whether each float is not equal to the next float
+    @param operands     the array of float operands
+    @param count        the number of operands
+    @return             the result
+*/
+tap_int fast_fNequal (tap_flo operands[], int count) {
+    int result = 1;
+    int i;
+    for (i = 1; i < count; ++i) {
+        result &= operands[i - 1] != operands[i];
+    }
+    return result;
+}
+
+/*! The fast-call form of prim_fMequal: returns whether each float is more than or equal to the next float
+    @param operands     the array of float operands
+    @param count        the number of operands
+    @return             the result
+*/
+tap_int fast_fMequal (tap_flo operands[], int count) {
+    int result = 1;
+    int i;
+    for (i = 1; i < count; ++i) {
+        result &= operands[i - 1] >= operands[i];
+    }
+    return result;
+}
+
+/*! The fast-call form of prim_fMore: returns whether each float is more than the next float
+    @param operands     the array of float operands
+    @param count        the number of operands
+    @return             the result
+*/
+tap_int fast_fMore (tap_flo operands[], int count) {
+    int result = 1;
+    int i;
+    for (i = 1; i < count; ++i) {
+        result &= operands[i - 1] > operands[i];
+    }
+    return result;
+}
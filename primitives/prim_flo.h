@@ -50,4 +50,16 @@ void prim_fStr(expression*[], int, exprvals*, datatype*);
 void prim_fArr(expression*[], int, exprvals*, datatype*);
 void prim_fTyp(expression*[], int, exprvals*, datatype*);
 
+tap_flo fast_fAdd(tap_flo[], int);
+tap_flo fast_fSub(tap_flo[], int);
+tap_flo fast_fMul(tap_flo[], int);
+tap_flo fast_fMax(tap_flo[], int);
+tap_flo fast_fMin(tap_flo[], int);
+tap_int fast_fLess(tap_flo[], int);
+tap_int fast_fLequal(tap_flo[], int);
+tap_int fast_fEqual(tap_flo[], int);
+tap_int fast_fNequal(tap_flo[], int);
+tap_int fast_fMequal(tap_flo[], int);
+tap_int fast_fMore(tap_flo[], int);
+
 #endif
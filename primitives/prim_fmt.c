@@ -0,0 +1,38 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   prim_fmt.c
+    @brief  All of the primitive functions for formats used by the language
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "prim_fmt.h"
+#include "../source/constants.h"
+#include "../source/strings.h"
+#include "../source/formats.h"
+
+/*! Returns the template the given format was compiled from (fmt)->str
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_pStr (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    *returntype = TYPE_STR;
+    returnval->strval = copyString(args[0]->ev.fmtval->source);
+}
+
+/*! Returns type format (fmt)->typ
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_pTyp (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    *returntype = TYPE_TYP;
+    returnval->intval = TYPE_FMT;
+}
@@ -0,0 +1,16 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   prim_fmt.h
+    @brief  The header file for prim_fmt.c
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#ifndef PRIM_FMT_H
+#define PRIM_FMT_H
+
+#include "../source/structs.h"
+
+void prim_pStr(expression*[], int, exprvals*, datatype*);
+void prim_pTyp(expression*[], int, exprvals*, datatype*);
+
+#endif
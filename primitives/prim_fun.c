@@ -12,6 +12,7 @@
 #include "../source/constants.h"
 #include "../source/engine.h"
 #include "../source/constructors.h"
+#include "../source/memo.h"
 
 /*! Returns the given function's arguments as an array of strings (fun)->arr
     @param args         the list of arguments
@@ -98,6 +99,84 @@ void prim_uFun (expression* args[], int numargs, exprvals* returnval, datatype*
     memcpy(returnval->funval->args, uf->args, sizeof(uf->args));
 }
 
+/*! Returns a copy of the given function that caches its results, keeping at most the given number of them (or a default number) and evicting the least recently used result first (fun, [int])->fun
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_uMemoize (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    uint capacity = MEMO_DEFAULT_CAPACITY;
+    if (numargs == 2) {
+        if (args[1]->type != TYPE_INT || args[1]->ev.intval < 1) {
+            *returntype = TYPE_NIL;
+            return;
+        }
+        capacity = args[1]->ev.intval;
+    }
+    tap_fun* fun = copyTapFunction(args[0]->ev.funval);
+    releaseMemo(fun->memo); // memoizing an already memoized function starts it with a fresh cache
+    fun->memo = newMemo(capacity);
+    *returntype = TYPE_FUN;
+    returnval->funval = fun;
+}
+
+/*! Returns the number of calls to the given memoized function that were answered from its cache (fun)->int
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_uMemoHits (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    tap_memo* memo = args[0]->ev.funval->memo;
+    *returntype = TYPE_INT;
+    returnval->intval = memo == NULL ? 0 : memo->hits;
+}
+
+/*! Returns the number of calls to the given memoized function that had to be evaluated (fun)->int
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_uMemoMisses (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    tap_memo* memo = args[0]->ev.funval->memo;
+    *returntype = TYPE_INT;
+    returnval->intval = memo == NULL ? 0 : memo->misses;
+}
+
+/*! Returns the number of results the given memoized function currently has cached (fun)->int
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_uMemoSize (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    tap_memo* memo = args[0]->ev.funval->memo;
+    *returntype = TYPE_INT;
+    returnval->intval = memo == NULL ? 0 : memo->count;
+}
+
+/*! Empties the cache of the given memoized function and resets its counters, returning the function (fun)->fun
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_uMemoClear (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    tap_fun* fun = args[0]->ev.funval;
+    if (fun->memo != NULL) {
+        clearMemo(fun->memo);
+    }
+    *returntype = TYPE_FUN;
+    returnval->funval = copyTapFunction(fun);
+}
+
 /*! Returns type function (fun)->typ
     @param args         the list of arguments
     @param numargs      the number of arguments
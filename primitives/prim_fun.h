@@ -15,6 +15,11 @@ void prim_uMinargs(expression*[], int, exprvals*, datatype*);
 void prim_uMaxargs(expression*[], int, exprvals*, datatype*);
 void prim_uStr(expression*[], int, exprvals*, datatype*);
 void prim_uFun(expression*[], int, exprvals*, datatype*);
+void prim_uMemoize(expression*[], int, exprvals*, datatype*);
+void prim_uMemoHits(expression*[], int, exprvals*, datatype*);
+void prim_uMemoMisses(expression*[], int, exprvals*, datatype*);
+void prim_uMemoSize(expression*[], int, exprvals*, datatype*);
+void prim_uMemoClear(expression*[], int, exprvals*, datatype*);
 void prim_uTyp(expression*[], int, exprvals*, datatype*);
 
 #endif
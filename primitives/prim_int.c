@@ -16,6 +16,9 @@
 #include "../source/engine.h"
 #include "../source/constructors.h"
 #include "../source/casting.h"
+#include "../source/channels.h"
+#include "../source/scheduler.h"
+#include "../source/loops.h"
 
 /*! Throws an error with the given code and message (int, str)->nil
     @param args         the list of arguments
@@ -184,7 +187,7 @@ void prim_iAbs (expression* args[], int numargs, exprvals* returnval, datatype*
 */
 void prim_iMax (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
     int i;
-    int potential;
+    long potential;
     long result = args[0]->ev.intval;
     for (i = 1; i < numargs; ++i) {
         potential = castToInt(args[i]);
@@ -205,10 +208,10 @@ void prim_iMax (expression* args[], int numargs, exprvals* returnval, datatype*
 */
 void prim_iMin (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
     int i;
-    int potential;
+    long potential;
     long result = args[0]->ev.intval;
     for (i = 1; i < numargs; ++i) {
-        potential = castToInt(args[0]);
+        potential = castToInt(args[i]);
         if (potential < result) {
             result = potential;
         }
@@ -646,7 +649,7 @@ void prim_iLand (expression* args[], int numargs, exprvals* returnval, datatype*
     int i;
     int result = 1;
     for (i = 0; i < numargs; ++i) {
-        if (!castToBoo(args[i])) {
+        if (castToInt(args[i]) == 0) {
             result = 0;
             break;
         }
@@ -666,7 +669,7 @@ void prim_iLor (expression* args[], int numargs, exprvals* returnval, datatype*
     int i;
     int result = 0;
     for (i = 0; i < numargs; ++i) {
-        if (castToBoo(args[i])) {
+        if (castToInt(args[i]) != 0) {
             result = 1;
             break;
         }
@@ -686,7 +689,7 @@ void prim_iLxor (expression* args[], int numargs, exprvals* returnval, datatype*
     int i;
     int result = 0;
     for (i = 0; i < numargs; ++i) {
-        if (castToBoo(args[i])) {
+        if (castToInt(args[i]) != 0) {
             ++result;
         }
     }
@@ -704,8 +707,8 @@ void prim_iLxor (expression* args[], int numargs, exprvals* returnval, datatype*
 */
 void prim_iLess (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
     int i;
-    int last = args[0]->ev.intval;
-    int current;
+    long last = args[0]->ev.intval;
+    long current;
     int result = 1;
     for (i = 1; i < numargs; ++i) {
         current = castToInt(args[i]);
@@ -728,8 +731,8 @@ void prim_iLess (expression* args[], int numargs, exprvals* returnval, datatype*
 */
 void prim_iLequal (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
     int i;
-    int last = args[0]->ev.intval;
-    int current;
+    long last = args[0]->ev.intval;
+    long current;
     int result = 1;
     for (i = 1; i < numargs; ++i) {
         current = castToInt(args[i]);
@@ -752,8 +755,8 @@ void prim_iLequal (expression* args[], int numargs, exprvals* returnval, datatyp
 */
 void prim_iEqual (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
     int i;
-    int last = args[0]->ev.intval;
-    int current;
+    long last = args[0]->ev.intval;
+    long current;
     int result = 1;
     for (i = 1; i < numargs; ++i) {
         current = castToInt(args[i]);
@@ -776,8 +779,8 @@ void prim_iEqual (expression* args[], int numargs, exprvals* returnval, datatype
 */
 void prim_iNequal (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
     int i;
-    int last = args[0]->ev.intval;
-    int current;
+    long last = args[0]->ev.intval;
+    long current;
     int result = 1;
     for (i = 1; i < numargs; ++i) {
         current = castToInt(args[i]);
@@ -800,8 +803,8 @@ void prim_iNequal (expression* args[], int numargs, exprvals* returnval, datatyp
 */
 void prim_iMequal (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
     int i;
-    int last = args[0]->ev.intval;
-    int current;
+    long last = args[0]->ev.intval;
+    long current;
     int result = 1;
     for (i = 1; i < numargs; ++i) {
         current = castToInt(args[i]);
@@ -824,8 +827,8 @@ void prim_iMequal (expression* args[], int numargs, exprvals* returnval, datatyp
 */
 void prim_iMore (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
     int i;
-    int last = args[0]->ev.intval;
-    int current;
+    long last = args[0]->ev.intval;
+    long current;
     int result = 1;
     for (i = 1; i < numargs; ++i) {
         current = castToInt(args[i]);
@@ -849,27 +852,58 @@ void prim_iMore (expression* args[], int numargs, exprvals* returnval, datatype*
 void prim_iIf (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
     int i;
     expression* result;
-    for (i = 0; i < numargs - 1; i += 2) {
+    for (i = 0; i < numargs; i += 2) {
         if (i == numargs - 1) {
-            result = evaluateLaz(copyExpression(args[i]));
+            result = forceLaz(args[i]);
             *returntype = result->type;
-            returnval->intval = result->ev.intval;
-            freeExpr(result);
-        } else {
-            result = castToBoo(args[i]);
-            if (result->type != TYPE_INT) {
-                ///error
-            } else if (result->ev.intval) {
-                result = evaluateLaz(copyExpression(args[i + 1]));
-                *returntype = result->type;
-                returnval->intval = result->ev.intval;
-                freeExpr(result);
-                break;
-            }
+            *returnval = result->ev;
+            free(result); // the result's contents now belong to the return value
+        } else if (castToInt(args[i]) != 0) {
+            result = forceLaz(args[i + 1]);
+            *returntype = result->type;
+            *returnval = result->ev;
+            free(result); // the result's contents now belong to the return value
+            break;
         }
     }
 }
 
+/*! Evaluates the given lazy expression the given number of times, returning the last result; variables the expression sets are set where the loop was called (int, laz)->*
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_iRepeat (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    tap_int times = args[0]->ev.intval;
+    loopEnvironment();
+    loopbody* loop = newLoopBody(args[1]);
+    tap_int i;
+    for (i = 0; i < times; ++i) {
+        runLoopBody(loop);
+        safePoint(); // so a loop that calls nothing can't keep a green task from giving way
+    }
+    expression* result = loopBodyResult(loop);
+    freeLoopBody(loop);
+    *returntype = result->type;
+    *returnval = result->ev;
+    free(result); // the result's contents now belong to the return value
+}
+
+/*! Creates a new channel that buffers up to the given number of values (int)->chn
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_iChannel (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    tap_int capacity = args[0]->ev.intval;
+    *returntype = TYPE_CHN;
+    returnval->chnval = newChannel(capacity > 0 ? capacity : 1);
+}
+
 /*! Generates a random number from 0 (inclusive) to the given integer (exclusive) (int)->int
     @param args         the list of arguments
     @param numargs      the number of arguments
@@ -964,7 +998,7 @@ void prim_iFlo (expression* args[], int numargs, exprvals* returnval, datatype*
     returnval->floval = result;
 }
 
-/*! Converts the given integer to a string using the given base (10 if unspecified) (int, [int])->str
+/*! Converts the given integer to a string using the given base (10 if unspecified) (int, [int])->str/nil
     @param args         the list of arguments
     @param numargs      the number of arguments
     @param returnval    the value the function returns after it ends
@@ -978,7 +1012,7 @@ void prim_iStr (expression* args[], int numargs, exprvals* returnval, datatype*
     } else {
         result = castToStrWithBase(args[0]->ev.intval, castToInt(args[1]));
     }
-    *returntype = TYPE_STR;
+    *returntype = result == NULL ? TYPE_NIL : TYPE_STR; // there's no string in a base outside 2 to 36
     returnval->strval = result;
 }
 
@@ -1009,3 +1043,160 @@ void prim_iTyp (expression* args[], int numargs, exprvals* returnval, datatype*
     *returntype = TYPE_TYP;
     returnval->intval = TYPE_INT;
 }
+
+/*! The fast-call form of prim_iAdd: adds together each integer
+    @param operands     the array of integer operands
+    @param count        the number of operands
+    @return             the result
+*/
+tap_int fast_iAdd (tap_int operands[], int count) {
+    tap_int result = 0;
+    int i;
+    for (i = 0; i < count; ++i) {
+        result += operands[i];
+    }
+    return result;
+}
+
+/*! The fast-call form of prim_iSub: subtracts each integer after the first from the first
+    @param operands     the array of integer operands
+    @param count        the number of operands
+    @return             the result
+*/
+tap_int fast_iSub (tap_int operands[], int count) {
+    tap_int result = operands[0];
+    int i;
+    for (i = 1; i < count; ++i) {
+        result -= operands[i];
+    }
+    return result;
+}
+
+/*! The fast-call form of prim_iMul: multiplies together each integer
+    @param operands     the array of integer operands
+    @param count        the number of operands
+    @return             the result
+*/
+tap_int fast_iMul (tap_int operands[], int count) {
+    tap_int result = 1;
+    int i;
+    for (i = 0; i < count; ++i) {
+        result *= operands[i];
+    }
+    return result;
+}
+
+/*! The fast-call form of prim_iMax: returns the maximum integer
+    @param operands     the array of integer operands
+    @param count        the number of operands
+    @return             the result
+*/
+tap_int fast_iMax (tap_int operands[], int count) {
+    tap_int result = operands[0];
+    int i;
+    for (i = 1; i < count; ++i) {
+        result = operands[i] > result ? operands[i] : result;
+    }
+    return result;
+}
+
+/*! The fast-call form of prim_iMin: returns the minimum integer
+    @param operands     the array of integer operands
+    @param count        the number of operands
+    @return             the result
+*/
+tap_int fast_iMin (tap_int operands[], int count) {
+    tap_int result = operands[0];
+    int i;
+    for (i = 1; i < count; ++i) {
+        result = operands[i] < result ? operands[i] : result;
+    }
+    return result;
+}
+
+/* The fast-call comparisons below check every pair instead of stopping at the first that fails, so the compiler can evaluate the
+   comparisons in parallel */
+
+/*! The fast-call form of prim_iLess: returns whether each integer is less than the next integer
+    @param operands     the array of integer operands
+    @param count        the number of operands
+    @return             the result
+*/
+tap_int fast_iLess (tap_int operands[], int count) {
+    int result = 1;
+    int i;
+    for (i = 1; i < count; ++i) {
+        result &= operands[i - 1] < operands[i];
+    }
+    return result;
+}
+
+/*! The fast-call form of prim_iLequal: returns whether each integer is less than or equal to the next integer
+    @param operands     the array of integer operands
+    @param count        the number of operands
+    @return             the result
+*/
+tap_int fast_iLequal (tap_int operands[], int count) {
+    int result = 1;
+    int i;
+    for (i = 1; i < count; ++i) {
+        result &= operands[i - 1] <= operands[i];
+    }
+    return result;
+}
+
+/*! The fast-call form of prim_iEqual: returns whether each integer is equal to the next integer
+    @param operands     the array of integer operands
+    @param count        the number of operands
+    @return             the result
+*/
+tap_int fast_iEqual (tap_int operands[], int count) {
+    int result = 1;
+    int i;
+    for (i = 1; i < count; ++i) {
+        result &= operands[i - 1] == operands[i];
+    }
+    return result;
+}
+
+/*! The fast-call form of prim_iNequal: returns whether each integer is not equal to the next integer
+    @param operands     the array of integer operands
+    @param count        the number of operands
+    @return             the result
+*/
+tap_int fast_iNequal (tap_int operands[], int count) {
+    int result = 1;
+    int i;
+    for (i = 1; i < count; ++i) {
+        result &= operands[i - 1] != operands[i];
+    }
+    return result;
+}
+
+/*! The fast-call form of prim_iMequal: returns whether each integer is more than or equal to the next integer
+    @param operands     the array of integer operands
+    @param count        the number of operands
+    @return             the result
+*/
+tap_int fast_iMequal (tap_int operands[], int count) {
+    int result = 1;
+    int i;
+    for (i = 1; i < count; ++i) {
+        result &= operands[i - 1] >= operands[i];
+    }
+    return result;
+}
+
+/*! The fast-call form of prim_iMore: returns whether each integer is more than the next integer
+    @param operands     the array of integer operands
+    @param count        the number of operands
+    @return             the result
+*/
+tap_int fast_iMore (tap_int operands[], int count) {
+    int result = 1;
+    int i;
+    for (i = 1; i < count; ++i) {
+        result &= operands[i - 1] > operands[i];
+    }
+    return result;
+}
@@ -57,6 +57,8 @@ void prim_iEqual(expression*[], int, exprvals*, datatype*);
 void prim_iNequal(expression*[], int, exprvals*, datatype*);
 void prim_iMequal(expression*[], int, exprvals*, datatype*);
 void prim_iMore(expression*[], int, exprvals*, datatype*);
+void prim_iRepeat(expression*[], int, exprvals*, datatype*);
+void prim_iChannel(expression*[], int, exprvals*, datatype*);
 void prim_iIf(expression*[], int, exprvals*, datatype*);
 void prim_iRand(expression*[], int, exprvals*, datatype*);
 void prim_iSrand(expression*[], int, exprvals*, datatype*);
@@ -69,4 +71,16 @@ void prim_iStr(expression*[], int, exprvals*, datatype*);
 void prim_iArr(expression*[], int, exprvals*, datatype*);
 void prim_iTyp(expression*[], int, exprvals*, datatype*);
 
+tap_int fast_iAdd(tap_int[], int);
+tap_int fast_iSub(tap_int[], int);
+tap_int fast_iMul(tap_int[], int);
+tap_int fast_iMax(tap_int[], int);
+tap_int fast_iMin(tap_int[], int);
+tap_int fast_iLess(tap_int[], int);
+tap_int fast_iLequal(tap_int[], int);
+tap_int fast_iEqual(tap_int[], int);
+tap_int fast_iNequal(tap_int[], int);
+tap_int fast_iMequal(tap_int[], int);
+tap_int fast_iMore(tap_int[], int);
+
 #endif
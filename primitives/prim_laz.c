@@ -14,8 +14,13 @@
 #include "../source/engine.h"
 #include "../source/constructors.h"
 #include "../source/strings.h"
+#include "../source/casting.h"
+#include "../source/memory.h"
+#include "../source/workers.h"
+#include "../source/scheduler.h"
+#include "../source/loops.h"
 
-/*! Evaluates the given lazy expression and returns the result (laz)->*
+/*! Forces the given lazy expression and returns the result, only evaluating it the first time it's forced (laz)->*
     @param args         the list of arguments
     @param numargs      the number of arguments
     @param returnval    the value the function returns after it ends
@@ -23,10 +28,71 @@
     @return             nothing
 */
 void prim_lEval (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
-    expression* result = evaluateLaz(copyExpression(args[0]));
+    expression* result = forceLaz(args[0]);
     *returntype = result->type;
-    returnval->intval = result->ev.intval;
-    freeExpr(result);
+    *returnval = result->ev;
+    free(result); // the result's contents now belong to the return value
+}
+
+/*! Evaluates the given lazy expression again even if it was already forced, replacing its cached result (laz)->*
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_lReeval (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    tap_laz* lazy = args[0]->ev.lazval;
+    if (lazy->future != NULL) { // a spawned evaluation must finish before its result can be forgotten
+        awaitFuture(lazy);
+    }
+    freeExprNR(lazy->value); // forget the previous result
+    lazy->value = NULL;
+    expression* result = forceLaz(args[0]);
+    *returntype = result->type;
+    *returnval = result->ev;
+    free(result); // the result's contents now belong to the return value
+}
+
+/*! Starts evaluating the given lazy expression on a worker thread and returns a lazy expression that waits for the result when it's forced (with await, for instance); the expression sees copies of the variables it refers to, so whatever it sets isn't visible to the caller (laz)->laz
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_lSpawn (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    expression* future = spawnLazy(args[0]);
+    *returntype = TYPE_LAZ;
+    *returnval = future->ev;
+    free(future); // the lazy expression now belongs to the return value
+}
+
+/*! Evaluates the second lazy expression for as long as the first one is true, returning the last result; variables the expressions set are set where the loop was called (laz, laz)->*
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_lWhile (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    loopEnvironment();
+    loopbody* condition = newLoopBody(args[0]);
+    loopbody* loop = newLoopBody(args[1]);
+    while (1) {
+        runLoopBody(condition);
+        if (!loopBodyTruth(condition)) {
+            break;
+        }
+        runLoopBody(loop);
+        safePoint(); // so a loop that calls nothing can't keep a green task from giving way
+    }
+    expression* result = loopBodyResult(loop);
+    freeLoopBody(loop);
+    freeLoopBody(condition);
+    *returntype = result->type;
+    *returnval = result->ev;
+    free(result); // the result's contents now belong to the return value
 }
 
 /*! Creates and returns a function using the given arguments and body (laz, exp)->fun
@@ -65,7 +131,7 @@ void prim_lFunction (expression* args[], int numargs, exprvals* returnval, datat
                 tempexpr2 = tempexpr1->ev.lazval->expval;
             }
             if (tempexpr2->type == TYPE_STR) {
-                types = newTypelist(typeFromString(tempexpr2->ev.strval->content));
+                types = newTypelist(typeFromString(stringContent(tempexpr2->ev.strval)));
             } else if (tempexpr2->type == TYPE_EXP && tempexpr2->flag == EFLAG_ARR) {
                 expression* typearr = tempexpr2->ev.expval;
                 if (typearr == NULL) {
@@ -74,7 +140,7 @@ void prim_lFunction (expression* args[], int numargs, exprvals* returnval, datat
                     typelist* tempat = types;
                     while (typearr != NULL) {
                         if (typearr->type == TYPE_STR) {
-                            typelist* newat = newTypelist(typeFromString(typearr->ev.strval->content));
+                            typelist* newat = newTypelist(typeFromString(stringContent(typearr->ev.strval)));
                             if (tempat == NULL) {
                                 types = newat;
                                 tempat = types;
@@ -109,7 +175,7 @@ void prim_lFunction (expression* args[], int numargs, exprvals* returnval, datat
                 // error, there cannot be more than two expressions in an argument definition
             }
         } else if (tempexpr1->type == TYPE_STR) {
-            if (strcmp(tempexpr1->ev.strval->content, UFUNC_MORE_ARGS) == 0) {
+            if (strcmp(stringContent(tempexpr1->ev.strval), UFUNC_MORE_ARGS) == 0) {
                 maxargs = ARGLEN_INF;
             } else {
                 fargs[i] = newArgument(copyString(tempexpr1->ev.strval), newTypelist(TYPE_UNK), NULL);
@@ -176,16 +242,7 @@ void prim_lIf (expression* args[], int numargs, exprvals* returnval, datatype* r
 */
 void prim_lLaz (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
     *returntype = TYPE_LAZ;
-    returnval->lazval = newLazyExpression();
-    tap_laz* le = args[0]->ev.lazval;
-    returnval->lazval->expval = copyExpression(le->expval);
-    exprstack* oldref = le->refs;
-    exprstack** newref = &(returnval->lazval->refs);
-    while (oldref != NULL) {
-        memcpy(*newref, oldref, sizeof(oldref));
-        (*newref)->next = oldref->next;
-        newref = &(*newref)->next;
-    }
+    returnval->lazval = copyLazyExpression(args[0]->ev.lazval); // the copy is unforced, so forcing it evaluates it again
 }
 
 /*! Returns type lazy expression (laz)->typ
@@ -11,6 +11,9 @@
 #include "../source/structs.h"
 
 void prim_lEval(expression*[], int, exprvals*, datatype*);
+void prim_lSpawn(expression*[], int, exprvals*, datatype*);
+void prim_lReeval(expression*[], int, exprvals*, datatype*);
+void prim_lWhile(expression*[], int, exprvals*, datatype*);
 void prim_lFunction(expression*[], int, exprvals*, datatype*);
 void prim_lAnd(expression*[], int, exprvals*, datatype*);
 void prim_lOr(expression*[], int, exprvals*, datatype*);
@@ -0,0 +1,50 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   prim_mat.c
+    @brief  All of the primitive functions for matchers used by the language
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "prim_mat.h"
+#include "../source/constants.h"
+#include "../source/constructors.h"
+#include "../source/matchers.h"
+
+/*! Returns the number of needles the given matcher finds (mat)->int
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_mSize (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    *returntype = TYPE_INT;
+    returnval->intval = args[0]->ev.matval->numneedles;
+}
+
+/*! Returns the string representation of the given matcher (mat)->str
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_mStr (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    *returntype = TYPE_STR;
+    returnval->strval = newStringCopy("[matcher]", 9);
+}
+
+/*! Returns type matcher (mat)->typ
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_mTyp (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    *returntype = TYPE_TYP;
+    returnval->intval = TYPE_MAT;
+}
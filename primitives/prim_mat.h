@@ -0,0 +1,17 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   prim_mat.h
+    @brief  The header file for prim_mat.c
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#ifndef PRIM_MAT_H
+#define PRIM_MAT_H
+
+#include "../source/structs.h"
+
+void prim_mSize(expression*[], int, exprvals*, datatype*);
+void prim_mStr(expression*[], int, exprvals*, datatype*);
+void prim_mTyp(expression*[], int, exprvals*, datatype*);
+
+#endif
@@ -34,7 +34,7 @@ void prim_nInt (expression* args[], int numargs, exprvals* returnval, datatype*
 */
 void prim_nStr (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
     *returntype = TYPE_STR;
-    returnval->strval = newString(strDup("[nil]"));
+    returnval->strval = newStringCopy("[nil]", 5);
 }
 
 /*! Returns type nil (nil)->typ
@@ -0,0 +1,38 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   prim_reg.c
+    @brief  All of the primitive functions for regular expressions used by the language
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "prim_reg.h"
+#include "../source/constants.h"
+#include "../source/strings.h"
+#include "../source/regexes.h"
+
+/*! Returns the pattern the given regular expression was compiled from (reg)->str
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_rStr (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    *returntype = TYPE_STR;
+    returnval->strval = copyString(args[0]->ev.regval->source);
+}
+
+/*! Returns type regular expression (reg)->typ
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_rTyp (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    *returntype = TYPE_TYP;
+    returnval->intval = TYPE_REG;
+}
@@ -0,0 +1,16 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   prim_reg.h
+    @brief  The header file for prim_reg.c
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#ifndef PRIM_REG_H
+#define PRIM_REG_H
+
+#include "../source/structs.h"
+
+void prim_rStr(expression*[], int, exprvals*, datatype*);
+void prim_rTyp(expression*[], int, exprvals*, datatype*);
+
+#endif
@@ -10,6 +10,7 @@
 #include <math.h>
 #include <string.h>
 #include <limits.h>
+#include <ctype.h>
 
 #include "prim_flo.h"
 #include "prim_str.h"
@@ -23,10 +24,25 @@
 #include "../source/arrays.h"
 #include "../source/dates.h"
 #include "../source/hashtable.h"
+#include "../source/packages.h"
+#include "../source/builders.h"
+#include "../source/matchers.h"
+#include "../source/memory.h"
+#include "../source/numbers.h"
+#include "../source/regexes.h"
+#include "../source/formats.h"
+#include "../source/search.h"
+#include "../source/scheduler.h"
+#include "../source/loops.h"
 
-extern environment* environments[];
-extern uint cenvironment;
-extern datatype ctypeid;
+static string* spliceMatches(string*, string*, string*, int);
+static tap_reg* castToRegex(expression*);
+static array* matchedGroups(string*, tap_reg*, int*);
+static array* splitString(string*, string*);
+static string* writableCopy(string*, char**);
+static void classTest(expression*, int, exprvals*, datatype*);
+static tap_fmt* castToFormat(expression*);
+static void formatError(char*, string*);
 
 /*! Maps the given string to the given variable value for the duration of the current scope, returning 1 on success and 0 on failure (str, *)->int
     @param args         the list of arguments
@@ -36,11 +52,59 @@ extern datatype ctypeid;
     @return             nothing
 */
 void prim_sSet (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
-    addToEnvironment(args[0]->ev.strval->content, args[1]);
+    addToEnvironment(stringContent(args[0]->ev.strval), copyExpressionNR(args[1]));
     *returntype = TYPE_INT;
     returnval->intval = 1;
 }
 
+/*! Evaluates the given lazy expression once for each integer from the start (inclusive) to the end (exclusive), optionally stepping by the given amount, with the named variable holding the current integer; the variable is updated in place and anything else the body sets is set where the loop was called (str, int, int, [int], laz)->*
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_sForRange (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    char* name = stringContent(args[0]->ev.strval);
+    tap_int i = args[1]->ev.intval;
+    tap_int end = args[2]->ev.intval;
+    tap_int step = numargs == 5 ? args[3]->ev.intval : 1;
+    expression* body = args[numargs - 1];
+    expression* result = newExpressionNil();
+    if (step == 0) {
+        addError(newErrorlist(ERR_INVALID_ARG, newString(strDup("for-range step can't be 0")), 0, 0));
+    } else {
+        loopEnvironment();
+        environment* env = ccontext->environments[ccontext->cenvironment]; // the environment of this call, which the loop's body is evaluated in
+        insertUserHash(env->variables, name, newExpressionInt(i));
+        ++env->numvars;
+        hashelement* var = lookupHashList(env->variables, name); // the loop variable is bound once, and the body's plan keeps the same element
+        loopbody* loop = newLoopBody(body);
+        while (step > 0 ? i < end : i > end) {
+            expression* value = var->value;
+            if (value->type == TYPE_INT) { // update the loop variable in place
+                value->ev.intval = i;
+            } else { // if the body replaced it with something else then restore it
+                freeExpr(value);
+                var->value = newExpressionInt(i);
+            }
+            runLoopBody(loop);
+            value = var->value;
+            if (value->type == TYPE_INT) { // the body may change the loop variable to skip ahead
+                i = value->ev.intval;
+            }
+            i += step;
+            safePoint(); // so a loop that calls nothing can't keep a green task from giving way
+        }
+        freeExpr(result);
+        result = loopBodyResult(loop);
+        freeLoopBody(loop);
+    }
+    *returntype = result->type;
+    *returnval = result->ev;
+    free(result); // the result's contents now belong to the return value
+}
+
 /*! Defines a new type with the given name and properties (str, laz)->nil
     @param args         the list of arguments
     @param numargs      the number of arguments
@@ -49,13 +113,14 @@ void prim_sSet (expression* args[], int numargs, exprvals* returnval, datatype*
     @return             nothing
 */
 void prim_sNewtype (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
-    environment* env = environments[cenvironment];
-    char* name = args[0]->ev.strval->content;
+    environment* env = ccontext->environments[ccontext->environments[ccontext->cenvironment]->parent]; // define the type where it was called rather than in this call's own environment
+    char* name = stringContent(args[0]->ev.strval);
     datatype tid = TYPE_UNK;
     if (lookupHash(env->variables, name) == NULL) {
         expression* expr = newExpressionOfType(TYPE_TYP);
-        expr->ev.intval = ctypeid;
-        insertUserHash(env->variables, name, (void*)expr);
+        expr->ev.intval = ccontext->ctypeid;
+        insertUserHash(env->variables, name, (void*)expr); // define the name first so that the properties can refer to the type
+        ++env->numvars;
         stringlist* required = NULL;
         typelist* inherits = NULL;
         property* properties = NULL;
@@ -64,7 +129,7 @@ void prim_sNewtype (expression* args[], int numargs, exprvals* returnval, dataty
             if (definitions->type == TYPE_EXP) {
                 expression* def = copyExpression(definitions->ev.expval);
                 if (def->type == TYPE_STR) {
-                    char* str = def->ev.strval->content;
+                    char* str = stringContent(def->ev.strval);
                     if (strcmp(str, "required") == 0) {
                         expression* req = def->next;
                         while (req != NULL) {
@@ -80,7 +145,7 @@ void prim_sNewtype (expression* args[], int numargs, exprvals* returnval, dataty
                         expression* inh = def->next;
                         while (inh != NULL) {
                             if (inh->type == TYPE_STR) {
-                                datatype inhtype = typeFromString(inh->ev.strval->content);
+                                datatype inhtype = typeFromString(stringContent(inh->ev.strval));
                                 if (inhtype == TYPE_UNK) {
                                     ///error
                                 } else {
@@ -104,7 +169,7 @@ void prim_sNewtype (expression* args[], int numargs, exprvals* returnval, dataty
                             int i;
                             for (i = 0; i < 2; ++i) {
                                 if (propattr->type == TYPE_STR) {
-                                    char* attr = propattr->ev.strval->content;
+                                    char* attr = stringContent(propattr->ev.strval);
                                     if (strcmp(attr, "public") == 0) {
                                         privacy = PROP_PRIVACY_PUBLIC;
                                     } else if (strcmp(attr, "private") == 0) {
@@ -157,7 +222,7 @@ void prim_sNewtype (expression* args[], int numargs, exprvals* returnval, dataty
                                             if (propname->type == TYPE_STR) {
                                                 next = next->next;
                                                 expression* propvalue = evaluateArgument(next);
-                                                property* prop = newProperty(propname->ev.strval->content, proptypes, privacy, range, propvalue);
+                                                property* prop = newProperty(stringContent(propname->ev.strval), proptypes, privacy, range, propvalue);
                                                 prop->next = properties;
                                                 properties = prop;
                                             } else {
@@ -182,15 +247,12 @@ void prim_sNewtype (expression* args[], int numargs, exprvals* returnval, dataty
             }
             definitions = definitions->next;
         }
-        tid = ctypeid;
-        char* name = args[0]->ev.strval->content;
-        type* typ = newType(ctypeid++, name, required, inherits, properties);
+        tid = ccontext->ctypeid;
+        char* name = stringContent(args[0]->ev.strval);
+        type* typ = newType(ccontext->ctypeid++, name, required, inherits, properties);
         typedefs* td = newTypedefs(typ);
         td->next = env->types;
         env->types = td;
-        expression* typexpr = newExpressionOfType(TYPE_TYP);
-        typexpr->ev.intval = tid;
-        addToEnvironment(name, typexpr);
     } else {
         ///error
     }
@@ -198,6 +260,24 @@ void prim_sNewtype (expression* args[], int numargs, exprvals* returnval, dataty
     returnval->intval = tid;
 }
 
+/*! Imports the package with the given name, whose definitions are then evaluated in the root environment the first time they're referenced; returns the number of definitions or nil if the package couldn't be read (str)->int
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_sImport (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    int numdefs = importPackage(stringContent(args[0]->ev.strval));
+    if (numdefs < 0) {
+        *returntype = TYPE_NIL;
+        returnval->intval = 0;
+    } else {
+        *returntype = TYPE_INT;
+        returnval->intval = numdefs;
+    }
+}
+
 /*! Prints the given string to the output buffer (str)->nil
     @param args         the list of arguments
     @param numargs      the number of arguments
@@ -206,7 +286,7 @@ void prim_sNewtype (expression* args[], int numargs, exprvals* returnval, dataty
     @return             nothing
 */
 void prim_sPrint (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
-    printf("%s", args[0]->ev.strval->content);
+    printf("%.*s", args[0]->ev.strval->size, args[0]->ev.strval->content);
     *returntype = TYPE_NIL;
 }
 
@@ -219,7 +299,20 @@ void prim_sPrint (expression* args[], int numargs, exprvals* returnval, datatype
 */
 void prim_sCopy (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
     *returntype = TYPE_STR;
-    returnval->strval = newString(strDup(args[0]->ev.strval->content));
+    returnval->strval = copyString(args[0]->ev.strval);
+}
+
+/*! Returns a new string builder holding a copy of the given string, to which strings can be appended without copying what was appended before (str)->bld
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_sBuilder (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    *returntype = TYPE_BLD;
+    returnval->bldval = newBuilder();
+    appendBuilder(returnval->bldval, args[0]->ev.strval->content, args[0]->ev.strval->size);
 }
 
 /*! Returns the size of the given string (str)->int
@@ -261,7 +354,11 @@ void prim_sSubstr (expression* args[], int numargs, exprvals* returnval, datatyp
         end = castToInt(args[2]) + 1;
     }
     *returntype = TYPE_STR;
-    returnval->strval = newString(substr(args[0]->ev.strval->content, castToInt(args[1]), end));
+    int size = args[0]->ev.strval->size;
+    int start = castToInt(args[1]);
+    start = start < 0 ? 0 : (start > size ? size : start); // clamp the range to the string so a slice never reads past it
+    end = end < start ? start : (end > size ? size : end);
+    returnval->strval = newStringSlice(args[0]->ev.strval, start, end - start);
 }
 
 /*! Returns the first index of the given substring/character in the given string or -1 if nothing is found (str, str/int)->int
@@ -273,22 +370,10 @@ void prim_sSubstr (expression* args[], int numargs, exprvals* returnval, datatyp
 */
 void prim_sFind (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
     string* str = args[0]->ev.strval;
-    char* result;
-    if (args[1]->type == TYPE_INT) {
-        result = strchr(str->content, castToInt(args[1]));
-    } else {
-        string* tempstr = castToStr(args[1]);
-        result = strstr(str->content, tempstr->content);
-        if (args[1]->type != TYPE_STR) {
-            free(tempstr);
-        }
-    }
+    string* needle = castToNeedle(args[1]);
     *returntype = TYPE_INT;
-    if (result == NULL) {
-        returnval->intval = -1;
-    } else {
-        returnval->intval = result - str->content;
-    }
+    returnval->intval = searchFirst(str->content, str->size, needle->content, needle->size, 0);
+    freeStr(needle);
 }
 
 /*! Returns the last index of the given substring/character in the given string or -1 if nothing is found (str, str/int)->int
@@ -300,33 +385,10 @@ void prim_sFind (expression* args[], int numargs, exprvals* returnval, datatype*
 */
 void prim_sFindlast (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
     string* haystack = args[0]->ev.strval;
-    char* result = NULL;
-    if (args[1]->type == TYPE_INT) {
-        result = strrchr(haystack->content, castToInt(args[1]));
-    } else {
-        string* needle = castToStr(args[1]);
-        int i;
-        int j;
-        for (i = haystack->size - needle->size; i >= 0; --i) {
-            j = 0;
-            while (haystack->content[i + j] == needle->content[j]) {
-                ++j;
-            }
-            if (j == needle->size) {
-                result = haystack->content + i;
-                break;
-            }
-        }
-        if (args[1]->type != TYPE_STR) {
-            free(needle);
-        }
-    }
+    string* needle = castToNeedle(args[1]);
     *returntype = TYPE_INT;
-    if (result == NULL) {
-        returnval->intval = -1;
-    } else {
-        returnval->intval = result - haystack->content;
-    }
+    returnval->intval = searchLast(haystack->content, haystack->size, needle->content, needle->size);
+    freeStr(needle);
 }
 
 /*! Returns the every index of the given substring/character in the given string or an empty list if nothing is found (str, str/int)->arr
@@ -337,58 +399,242 @@ void prim_sFindlast (expression* args[], int numargs, exprvals* returnval, datat
     @return             nothing
 */
 void prim_sFindall (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
-    static int proportion = 10;
-    static int increaseby = 2;
     string* haystack = args[0]->ev.strval;
-    int size;
-    if (haystack->size < proportion) {
-        size = 2;
-    } else {
-        size = haystack->size / proportion;
+    string* needle = castToNeedle(args[1]);
+    int count;
+    int* positions = searchAll(haystack->content, haystack->size, needle->content, needle->size, &count);
+    array* result = newArray(count);
+    int i;
+    for (i = 0; i < count; ++i) {
+        result->content[i] = newExpressionInt(positions[i]);
     }
-    array* result = newArray(size);
-    int csize = 0;
-    int realsize = 0;
+    free(positions);
+    freeStr(needle);
+    *returntype = TYPE_ARR;
+    returnval->arrval = result;
+}
+
+/*! Returns whether or not any of the given matcher's needles is in the given string (str, mat)->int
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_sMatchany (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    string* haystack = args[0]->ev.strval;
+    *returntype = TYPE_INT;
+    returnval->intval = matchAny(args[1]->ev.matval, haystack->content, haystack->size);
+}
+
+/*! Returns every occurrence of any of the given matcher's needles in the given string, including ones that overlap, as {index needle} pairs in the order they end, where needle is the needle's index in the array the matcher was made from (str, mat)->arr
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_sFindallany (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    string* haystack = args[0]->ev.strval;
+    int count;
+    int* matches = matchAll(args[1]->ev.matval, haystack->content, haystack->size, &count);
+    array* result = newArray(count);
     int i;
-    if (args[1]->type == TYPE_INT) {
-        int needle = castToInt(args[1]);
-        for (i = 0; i < haystack->size; ++i) {
-            if (haystack->content[i] == needle) {
-                if (csize >= size) {
-                    result = resizeArray(result, 0, result->size * increaseby);
-                }
-                expression* expr = newExpressionOfType(TYPE_INT);
-                expr->ev.intval = i;
-                result->content[csize++] = expr;
-                ++realsize;
+    for (i = 0; i < count; ++i) {
+        array* pair = newArray(2);
+        pair->content[0] = newExpressionInt(matches[2 * i]);
+        pair->content[1] = newExpressionInt(matches[2 * i + 1]);
+        result->content[i] = newExpressionArr(pair);
+    }
+    free(matches);
+    *returntype = TYPE_ARR;
+    returnval->arrval = result;
+}
+
+/*! Compiles the given string into a regular expression that can be matched as many times as needed, returning nil if it isn't a valid pattern (str)->reg
+    Patterns have literal bytes, . (any byte but a new line), classes in brackets, the escapes \d \w \s (and \D \W \S for their complements), ^ and $ for the start and end of the string,
+    groups in parentheses (which aren't captured if they start with ?:), | for alternatives, and the quantifiers * + ? {n} {n,} and {n,m}, which take as few repetitions as possible if followed by ?
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_sRegex (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    tap_reg* reg = castToRegex(args[0]);
+    if (reg == NULL) {
+        *returntype = TYPE_NIL;
+        returnval->intval = 0;
+        return;
+    }
+    *returntype = TYPE_REG;
+    returnval->regval = reg;
+}
+
+/*! Returns the first match of the given regular expression (or pattern) in the given string as an array of the whole match followed by each group, which is nil if it didn't take part; returns an empty array if nothing matches (str, reg/str)->arr
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_sMatch (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    string* haystack = args[0]->ev.strval;
+    tap_reg* reg = castToRegex(args[1]);
+    *returntype = TYPE_ARR;
+    if (reg == NULL) {
+        returnval->arrval = newArray(0);
+        return;
+    }
+    int groups[reg->numgroups * 2];
+    returnval->arrval = regexSearch(reg, haystack->content, haystack->size, 0, groups) ? matchedGroups(haystack, reg, groups) : newArray(0);
+    freeRegex(reg);
+}
+
+/*! Returns every match of the given regular expression (or pattern) in the given string that doesn't overlap an earlier one, each as an array like match returns (str, reg/str)->arr
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_sMatchall (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    string* haystack = args[0]->ev.strval;
+    tap_reg* reg = castToRegex(args[1]);
+    *returntype = TYPE_ARR;
+    if (reg == NULL) {
+        returnval->arrval = newArray(0);
+        return;
+    }
+    int groups[reg->numgroups * 2];
+    int capacity = SEARCH_INITIAL_MATCHES;
+    int count = 0;
+    expression** matches = allocate(sizeof(expression*) * capacity);
+    int from = 0;
+    while (regexSearch(reg, haystack->content, haystack->size, from, groups)) {
+        if (count == capacity) {
+            capacity *= 2;
+            matches = realloc(matches, sizeof(expression*) * capacity);
+            if (matches == NULL) {
+                exit(EXIT_OUT_OF_MEMORY);
             }
         }
-    } else {
-        string* needle = castToStr(args[1]);
-        int j;
-        for (i = 0; i < haystack->size; ++i) {
-            j = 0;
-            while (haystack->content[i + j] != 0 && haystack->content[i + j] == needle->content[j]) {
-                ++j;
-            }
-            if (j == needle->size) {
-                if (csize >= size) {
-                    result = resizeArray(result, 0, result->size * increaseby);
+        matches[count++] = newExpressionArr(matchedGroups(haystack, reg, groups));
+        from = groups[1] > groups[0] ? groups[1] : groups[1] + 1; // an empty match moves on a byte so it isn't found again
+    }
+    array* result = newArray(count);
+    memcpy(result->content, matches, sizeof(expression*) * count);
+    free(matches);
+    freeRegex(reg);
+    returnval->arrval = result;
+}
+
+/*! Replaces every match of the given regular expression (or pattern) in the given string that doesn't overlap an earlier one with the given replacement, in which $0 to $9 stand for the whole match and its groups and $$ stands for $ (str, reg/str, str)->str
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_sRegexreplace (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    string* haystack = args[0]->ev.strval;
+    tap_reg* reg = castToRegex(args[1]);
+    *returntype = TYPE_STR;
+    if (reg == NULL) {
+        returnval->strval = copyString(haystack);
+        return;
+    }
+    string* replacement = castToStr(args[2]);
+    if (replacement == NULL) {
+        addError(newErrorlist(ERR_INVALID_ARG, newString(printExpression(args[2])), 0, 0));
+        replacement = newStringOfSize(0);
+    }
+    int groups[reg->numgroups * 2];
+    tap_bld* bld = newBuilder();
+    int copied = 0; // the end of what has been copied from the string
+    int from = 0;
+    while (regexSearch(reg, haystack->content, haystack->size, from, groups)) {
+        appendBuilder(bld, haystack->content + copied, groups[0] - copied);
+        int i;
+        for (i = 0; i < replacement->size; ++i) {
+            char c = replacement->content[i];
+            if (c != '$' || i + 1 == replacement->size) {
+                appendBuilder(bld, &c, 1);
+            } else if (replacement->content[i + 1] == '$') {
+                appendBuilder(bld, "$", 1);
+                ++i;
+            } else if (replacement->content[i + 1] >= '0' && replacement->content[i + 1] <= '9') {
+                uint group = replacement->content[++i] - '0';
+                if (group < reg->numgroups && groups[2 * group] >= 0) { // a group that didn't take part stands for nothing
+                    appendBuilder(bld, haystack->content + groups[2 * group], groups[2 * group + 1] - groups[2 * group]);
                 }
-                expression* expr = newExpressionOfType(TYPE_INT);
-                expr->ev.intval = i;
-                result->content[csize++] = expr;
-                ++realsize;
-                i += j - 1;
+            } else {
+                appendBuilder(bld, &c, 1);
             }
         }
-        if (args[1]->type != TYPE_STR) {
-            free(needle);
+        copied = groups[1];
+        if (groups[1] > groups[0]) {
+            from = groups[1];
+        } else if (groups[1] < haystack->size) { // an empty match keeps the byte after it and moves on past it
+            appendBuilder(bld, haystack->content + groups[1], 1);
+            copied = from = groups[1] + 1;
+        } else {
+            break;
         }
     }
-    resizeArray(result, 0, realsize);
-    *returntype = TYPE_ARR;
-    returnval->arrval = result;
+    appendBuilder(bld, haystack->content + copied, haystack->size - copied);
+    returnval->strval = flattenBuilder(bld);
+    freeBuilder(bld);
+    freeStr(replacement);
+    freeRegex(reg);
+}
+
+/*! Compiles the given template into a format that can fill in its fields as many times as needed, returning nil if it isn't a valid template (str)->fmt
+    Fields are written in braces as {[argument][:[[fill]align][0][width][.precision][conversion]]}, where the argument is the number of the one the field writes (the
+    one after the previous field's if none is given), align is < (left), > (right), ^ (centered) or = (right, but after a number's sign), 0 pads a number with zeros,
+    the precision is the digits after a float's point or the most of a string written, and the conversion is d (an integer), x or X (in hexadecimal), o (in octal),
+    b (in binary), f (a float with a fixed number of digits after its point), s (a string, or anything else as one) or t followed by the format of a date (as str takes it); {{ and }}
+    stand for { and }
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_sFormatter (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    tap_fmt* fmt = castToFormat(args[0]);
+    if (fmt == NULL) {
+        *returntype = TYPE_NIL;
+        returnval->intval = 0;
+        return;
+    }
+    *returntype = TYPE_FMT;
+    returnval->fmtval = fmt;
+}
+
+/*! Fills in the fields of the given format (or template) with the given values, working out the size of the result first so that it's written in one pass (fmt/str, ...)->str/nil
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_sFormat (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    tap_fmt* fmt = castToFormat(args[0]);
+    *returntype = TYPE_NIL;
+    returnval->intval = 0;
+    if (fmt == NULL) {
+        return;
+    }
+    char* error;
+    string* result = applyFormat(fmt, args + 1, numargs - 1, &error);
+    if (result == NULL) {
+        formatError(error, fmt->source);
+    } else {
+        *returntype = TYPE_STR;
+        returnval->strval = result;
+    }
+    freeFormat(fmt);
 }
 
 /*! Returns whether or not the given substring/character is in the given string (str, [int])->int
@@ -401,7 +647,7 @@ void prim_sFindall (expression* args[], int numargs, exprvals* returnval, dataty
 void prim_sContains (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
     prim_sFind(args, numargs, returnval, returntype);
     *returntype = TYPE_INT;
-    returnval->intval = returnval->intval > 0;
+    returnval->intval = returnval->intval >= 0;
 }
 
 /*! Concats each given string together (str...)->str
@@ -417,10 +663,7 @@ void prim_sConcat (expression* args[], int numargs, exprvals* returnval, datatyp
     for (i = 0; i < numargs; ++i) {
         size += args[i]->ev.strval->size;
     }
-    char* filler = allocate(size + 1);
-    memset(filler, '0', size);
-    filler[size] = '\0';
-    string* result = newString(filler);
+    string* result = newStringOfSize(size);
     int start = 0;
     int j;
     for (i = 0; i < numargs; ++i) {
@@ -441,40 +684,12 @@ void prim_sConcat (expression* args[], int numargs, exprvals* returnval, datatyp
     @return             nothing
 */
 void prim_sReplace (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
-    prim_sFindall(args, numargs, returnval, returntype);
-    array* indices = returnval->arrval;
-    string* origstr = args[0]->ev.strval;
-    string* oldstr = castToStr(args[1]);
-    string* newstr = castToStr(args[2]);
-    int size = origstr->size + (newstr->size - oldstr->size) * indices->end;
-    char* filler = allocate(size + 1);
-    filler[size] = '\0';
-    string* result = newString(filler);
-    result->size = size;
-    int arrindex = indices->start;
-    int origindex = 0;
-    int i;
-    int j;
-    for (i = 0; i < size; ++i) {
-        if (arrindex < indices->end && i == indices->content[arrindex]->ev.intval) {
-            for (j = 0; j < newstr->size; ++j) {
-                result->content[i + j] = newstr->content[j];
-            }
-            i += j - 1;
-            origindex += oldstr->size;
-            ++arrindex;
-        } else {
-            result->content[i] = origstr->content[origindex++];
-        }
-    }
-    if (args[1]->type != TYPE_STR) {
-        free(oldstr);
-    }
-    if (args[2]->type != TYPE_STR) {
-        free(newstr);
-    }
+    string* oldstr = castToNeedle(args[1]);
+    string* newstr = castToNeedle(args[2]);
     *returntype = TYPE_STR;
-    returnval->strval = result;
+    returnval->strval = spliceMatches(args[0]->ev.strval, oldstr, newstr, 0);
+    freeStr(oldstr);
+    freeStr(newstr);
 }
 
 /*! Returns the given string after inserting the second given substring after each index of the first (str, str, str)->str
@@ -485,39 +700,12 @@ void prim_sReplace (expression* args[], int numargs, exprvals* returnval, dataty
     @return             nothing
 */
 void prim_sInsert (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
-    prim_sFindall(args, numargs, returnval, returntype);
-    array* indices = returnval->arrval;
-    string* origstr = args[0]->ev.strval;
-    string* oldstr = castToStr(args[1]);
-    string* newstr = castToStr(args[2]);
-    int size = origstr->size + newstr->size * indices->end;
-    char* filler = allocate(size + 1);
-    filler[size] = '\0';
-    string* result = newString(filler);
-    result->size = size;
-    int arrindex = indices->start;
-    int origindex = 0;
-    int i;
-    int j;
-    for (i = 0; i < size; ++i) {
-        if (arrindex < indices->end && origindex == indices->content[arrindex]->ev.intval + oldstr->size) {
-            for (j = 0; j < newstr->size; ++j) {
-                result->content[i + j] = newstr->content[j];
-            }
-            i += j - 1;
-            ++arrindex;
-        } else {
-            result->content[i] = origstr->content[origindex++];
-        }
-    }
-    if (args[1]->type != TYPE_STR) {
-        free(oldstr);
-    }
-    if (args[2]->type != TYPE_STR) {
-        free(newstr);
-    }
+    string* oldstr = castToNeedle(args[1]);
+    string* newstr = castToNeedle(args[2]);
     *returntype = TYPE_STR;
-    returnval->strval = result;
+    returnval->strval = spliceMatches(args[0]->ev.strval, oldstr, newstr, 1);
+    freeStr(oldstr);
+    freeStr(newstr);
 }
 
 /*! Returns the given string after replacing each instance of one given substring/character for another (str, str/int, str/int)->str
@@ -528,25 +716,19 @@ void prim_sInsert (expression* args[], int numargs, exprvals* returnval, datatyp
     @return             nothing
 */
 void prim_sRemove (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
-    expression* result = newExpressionOfType(TYPE_STR);
-    result->ev.strval = newString(strDup(args[0]->ev.strval->content));
-    expression* empty = newExpressionOfType(TYPE_STR);
-    empty->ev.strval = newString("");
-    expression* newargs[3];
-    newargs[0] = result;
-    newargs[2] = empty;
+    string* result = copyString(args[0]->ev.strval);
+    string* empty = newStringOfSize(0);
     int i;
     for (i = 1; i < numargs; ++i) {
-        newargs[1] = args[i];
-        prim_sReplace(newargs, 3, returnval, returntype);
-        free(result->ev.strval->content);
-        free(result->ev.strval);
-        result->ev.strval = returnval->strval;
+        string* oldstr = castToNeedle(args[i]);
+        string* removed = spliceMatches(result, oldstr, empty, 0);
+        freeStr(oldstr);
+        freeStr(result);
+        result = removed;
     }
-    free(empty->ev.strval);
-    free(empty);
+    freeStr(empty);
     *returntype = TYPE_STR;
-    returnval->strval = result->ev.strval;
+    returnval->strval = result;
 }
 
 /*! Returns a reversed copy of the given string (str)->str
@@ -557,12 +739,9 @@ void prim_sRemove (expression* args[], int numargs, exprvals* returnval, datatyp
     @return             nothing
 */
 void prim_sReverse (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
-    string* origstr = args[0]->ev.strval;
-    string* result = newString(strDup(origstr->content));
-    int i;
-    for (i = 0; i < result->size; ++i) {
-        result->content[i] = origstr->content[result->size - i - 1];
-    }
+    char* src;
+    string* result = writableCopy(args[0]->ev.strval, &src);
+    reverseBytes(result->content, src, result->size);
     *returntype = TYPE_STR;
     returnval->strval = result;
 }
@@ -575,8 +754,11 @@ void prim_sReverse (expression* args[], int numargs, exprvals* returnval, dataty
     @return             nothing
 */
 void prim_sUpper (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    char* src;
+    string* result = writableCopy(args[0]->ev.strval, &src);
+    convertCase(result->content, src, result->size, CASE_UPPER);
     *returntype = TYPE_STR;
-    returnval->strval = changeCase(args[0]->ev.strval, CASE_UPPER);
+    returnval->strval = result;
 }
 
 /*! Returns an all lower-case copy of the given string (str)->str
@@ -587,8 +769,11 @@ void prim_sUpper (expression* args[], int numargs, exprvals* returnval, datatype
     @return             nothing
 */
 void prim_sLower (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    char* src;
+    string* result = writableCopy(args[0]->ev.strval, &src);
+    convertCase(result->content, src, result->size, CASE_LOWER);
     *returntype = TYPE_STR;
-    returnval->strval = changeCase(args[0]->ev.strval, CASE_LOWER);
+    returnval->strval = result;
 }
 
 /*! Returns an all sentence-case copy of the given string (str)->str
@@ -599,8 +784,11 @@ void prim_sLower (expression* args[], int numargs, exprvals* returnval, datatype
     @return             nothing
 */
 void prim_sSentence (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    char* src;
+    string* result = writableCopy(args[0]->ev.strval, &src);
+    convertCase(result->content, src, result->size, CASE_SENTENCE);
     *returntype = TYPE_STR;
-    returnval->strval = changeCase(args[0]->ev.strval, CASE_SENTENCE);
+    returnval->strval = result;
 }
 
 /*! Returns an all title-case copy of the given string (str)->str
@@ -611,11 +799,123 @@ void prim_sSentence (expression* args[], int numargs, exprvals* returnval, datat
     @return             nothing
 */
 void prim_sTitle (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    char* src;
+    string* result = writableCopy(args[0]->ev.strval, &src);
+    convertCase(result->content, src, result->size, CASE_TITLE);
     *returntype = TYPE_STR;
-    returnval->strval = changeCase(args[0]->ev.strval, CASE_TITLE);
+    returnval->strval = result;
 }
 
-/*! Tries to convert the given string to an integer using the given base or 10 if none is given, returning nil on failure (str, [int])->int/nil
+/*! Returns the given string without the whitespace at both ends (str)->str
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_sTrim (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    string* str = args[0]->ev.strval;
+    int start = spanClass(str->content, str->size, CLASS_SPACE);
+    int end = str->size - (start < str->size ? spanClassBack(str->content, str->size, CLASS_SPACE) : 0);
+    *returntype = TYPE_STR;
+    returnval->strval = newStringSlice(str, start, end - start);
+}
+
+/*! Returns the given string without the whitespace at the start (str)->str
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_sTriml (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    string* str = args[0]->ev.strval;
+    int start = spanClass(str->content, str->size, CLASS_SPACE);
+    *returntype = TYPE_STR;
+    returnval->strval = newStringSlice(str, start, str->size - start);
+}
+
+/*! Returns the given string without the whitespace at the end (str)->str
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_sTrimr (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    string* str = args[0]->ev.strval;
+    *returntype = TYPE_STR;
+    returnval->strval = newStringSlice(str, 0, str->size - spanClassBack(str->content, str->size, CLASS_SPACE));
+}
+
+/*! Returns whether or not the given string is non-empty and every character of it is a letter (str)->int
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_sIsalpha (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    classTest(args[0], CLASS_ALPHA, returnval, returntype);
+}
+
+/*! Returns whether or not the given string is non-empty and every character of it is a digit (str)->int
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_sIsdigit (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    classTest(args[0], CLASS_DIGIT, returnval, returntype);
+}
+
+/*! Returns whether or not the given string is non-empty and every character of it is a letter or digit (str)->int
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_sIsalnum (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    classTest(args[0], CLASS_ALNUM, returnval, returntype);
+}
+
+/*! Returns whether or not the given string is non-empty and every character of it is whitespace (str)->int
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_sIsspace (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    classTest(args[0], CLASS_SPACE, returnval, returntype);
+}
+
+/*! Returns whether or not the given string is non-empty and every character of it is an upper-case letter (str)->int
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_sIsupper (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    classTest(args[0], CLASS_UPPER, returnval, returntype);
+}
+
+/*! Returns whether or not the given string is non-empty and every character of it is a lower-case letter (str)->int
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_sIslower (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    classTest(args[0], CLASS_LOWER, returnval, returntype);
+}
+
+/*! Tries to convert the given string to an integer using the given base or 10 if none is given, rounding a fraction to the nearest
+    integer and returning nil on failure or if the number is too big for an integer (str, [int])->int/nil
     @param args         the list of arguments
     @param numargs      the number of arguments
     @param returnval    the value the function returns after it ends
@@ -623,17 +923,24 @@ void prim_sTitle (expression* args[], int numargs, exprvals* returnval, datatype
     @return             nothing
 */
 void prim_sInt (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
-    prim_sFlo(args, numargs, returnval, returntype);
-    if (*returntype != TYPE_NIL){
-        expression* newargs[1];
-        newargs[0] = newExpressionOfType(TYPE_FLO);
-        newargs[0]->ev.floval = returnval->floval;
-        prim_fRound(newargs, 1, returnval, returntype);
-        free(newargs[0]);
+    int base = numargs == 1 ? BASE : castToInt(args[1]);
+    tap_int intval;
+    tap_flo floval;
+    *returntype = parseNumber(args[0]->ev.strval->content, args[0]->ev.strval->size, base, &intval, &floval); // read exactly so integers past 2^53 keep every digit
+    if (*returntype == TYPE_INT) {
+        returnval->intval = intval;
+    } else if (*returntype == TYPE_FLO) {
+        floval = rint(floval); // bankers' rounding, as round does, but without round's digit loop that can't hold numbers this big
+        if (floval >= (tap_flo)LONG_MIN && floval < -(tap_flo)LONG_MIN) { // also false for nan
+            returnval->intval = (tap_int)floval;
+            *returntype = TYPE_INT;
+        } else {
+            *returntype = TYPE_NIL;
+        }
     }
 }
 
-/*! Tries to convert the given string to a float, returning nil on failure (str)->flt/nil
+/*! Tries to convert the given string to a float, returning nil on failure (str, [int])->flt/nil
     @param args         the list of arguments
     @param numargs      the number of arguments
     @param returnval    the value the function returns after it ends
@@ -654,6 +961,7 @@ void prim_sFlo (expression* args[], int numargs, exprvals* returnval, datatype*
     expression* result = castToNum(args[0]->ev.strval, base);
     *returntype = result->type;
     returnval->floval = result->ev.floval;
+    free(result);
 }
 
 /*! Returns a copy of the given string (str)->str
@@ -665,10 +973,10 @@ void prim_sFlo (expression* args[], int numargs, exprvals* returnval, datatype*
 */
 void prim_sStr (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
     *returntype = TYPE_STR;
-    returnval->strval = newString(strDup(args[0]->ev.strval->content));
+    returnval->strval = copyString(args[0]->ev.strval);
 }
 
-/*! Converts the given string to an array, splitting the string by the given delimiter or each character if none is given (str, [str])->arr
+/*! Converts the given string to an array, splitting the string by the given delimiter or into each character if none is given (str, [str/int])->arr
     @param args         the list of arguments
     @param numargs      the number of arguments
     @param returnval    the value the function returns after it ends
@@ -676,32 +984,26 @@ void prim_sStr (expression* args[], int numargs, exprvals* returnval, datatype*
     @return             nothing
 */
 void prim_sArr (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
-    string* str = args[0]->ev.strval;
-    string* delimeter = NULL;
-    array* arrval;
-    int dsize;
-    int i;
-    if (numargs == 2) {
-        delimeter = castToStr(args[1]);
-        dsize = delimeter->size;
-        arrval = newArray(str->size + dsize);
-        for (i = 1; i < arrval->size; i += dsize + 1) {
-            memcpy(arrval->content + i, delimeter->content, dsize);
-        }
-    } else {
-        dsize = 0;
-        arrval = newArray(str->size);
-    }
-    //int j = 0;
-    for (i = 0; i < arrval->size; i += dsize + 1) {
-        //arrval->content[i] = str->content[j++]; !!!
-    }
-    if (numargs == 2 && args[1]->type != TYPE_STR) {
-        free(delimeter->content);
-        free(delimeter);
+    string* delimiter = numargs == 2 ? castToNeedle(args[1]) : newStringOfSize(0);
+    *returntype = TYPE_ARR;
+    returnval->arrval = splitString(args[0]->ev.strval, delimiter);
+    freeStr(delimiter);
+}
+
+/*! Splits the given string into an array of the pieces between each instance of the given delimiter, a character code, or runs of whitespace if none is given; pieces between runs of whitespace are never empty (str, [str/int])->arr
+    @param args         the list of arguments
+    @param numargs      the number of arguments
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+void prim_sSplit (expression* args[], int numargs, exprvals* returnval, datatype* returntype) {
+    string* delimiter = numargs == 2 ? castToNeedle(args[1]) : NULL;
+    *returntype = TYPE_ARR;
+    returnval->arrval = splitString(args[0]->ev.strval, delimiter);
+    if (delimiter != NULL) {
+        freeStr(delimiter);
     }
-    *returntype = TYPE_STR;
-    returnval->arrval = arrval;
 }
 
 /*! Converts the given string to a date if in the correct format or returns nil (str)->dat/nil
@@ -733,3 +1035,176 @@ void prim_sTyp (expression* args[], int numargs, exprvals* returnval, datatype*
     returnval->intval = TYPE_STR;
 }
 
+/*! Returns a copy of the given string with the given replacement put in at each instance of the given substring, sizing the copy exactly and building it in a single pass
+    @param str          the string
+    @param oldstr       the substring to find
+    @param newstr       the replacement
+    @param keep         1 to put the replacement after each instance, 0 to put it in place of each instance
+    @return             the new string
+*/
+static string* spliceMatches (string* str, string* oldstr, string* newstr, int keep) {
+    int count;
+    int* positions = searchAll(str->content, str->size, oldstr->content, oldstr->size, &count);
+    string* result = newStringOfSize(str->size + (newstr->size - (keep ? 0 : oldstr->size)) * count);
+    char* dest = result->content;
+    int from = 0; // the start of the text not yet copied
+    int i;
+    for (i = 0; i < count; ++i) {
+        int end = keep ? positions[i] + oldstr->size : positions[i]; // the end of the text copied before the replacement
+        memcpy(dest, str->content + from, end - from);
+        dest += end - from;
+        memcpy(dest, newstr->content, newstr->size);
+        dest += newstr->size;
+        from = positions[i] + oldstr->size;
+    }
+    memcpy(dest, str->content + from, str->size - from);
+    free(positions);
+    return result;
+}
+
+/*! Returns the regular expression the given argument is or, for a string, compiles into
+    @param arg          the argument
+    @return             the regular expression, which must be freed by the caller, or null if the pattern can't be compiled
+*/
+static tap_reg* castToRegex (expression* arg) {
+    if (arg->type == TYPE_REG) {
+        return shareRegex(arg->ev.regval);
+    }
+    string* pattern = arg->ev.strval;
+    char* error;
+    tap_reg* reg = newRegex(pattern->content, pattern->size, &error);
+    if (reg == NULL) {
+        int size = strlen(error) + pattern->size + 3;
+        char* message = allocate(size);
+        snprintf(message, size, "%s: %.*s", error, pattern->size, pattern->content);
+        addError(newErrorlist(ERR_INVALID_REGEX, newString(message), 0, 0));
+    }
+    return reg;
+}
+
+/*! Returns the whole match and each group of the given regular expression as an array of substrings of the given string
+    @param str          the string that was matched
+    @param reg          the regular expression
+    @param groups       where each group starts and ends, or -1 for a group that didn't take part
+    @return             the array, whose substrings share the string's content
+*/
+static array* matchedGroups (string* str, tap_reg* reg, int* groups) {
+    array* result = newArray(reg->numgroups);
+    uint i;
+    for (i = 0; i < reg->numgroups; ++i) {
+        if (groups[2 * i] < 0) {
+            result->content[i] = newExpressionNil();
+        } else {
+            result->content[i] = newExpressionStr(newStringSlice(str, groups[2 * i], groups[2 * i + 1] - groups[2 * i]));
+        }
+    }
+    return result;
+}
+
+/*! Splits the given string by the given delimiter, counting the pieces in one pass so the array can be made at its final size and filling it in a second
+    @param str          the string
+    @param delimiter    the delimiter, an empty string to split the string into each character, or NULL to split it by runs of whitespace
+    @return             the new array of the pieces, each of which shares the string's content
+*/
+static array* splitString (string* str, string* delimiter) {
+    char* text = str->content;
+    int size = str->size;
+    array* result;
+    int count = 0;
+    int i;
+    if (delimiter == NULL) {
+        for (i = 0; i < size; ++i) { // count the starts of pieces
+            count += !isspace((unsigned char)text[i]) && (i == 0 || isspace((unsigned char)text[i - 1]));
+        }
+        result = newArray(count);
+        count = 0;
+        i = 0;
+        while (i < size) {
+            while (i < size && isspace((unsigned char)text[i])) {
+                ++i;
+            }
+            int start = i;
+            while (i < size && !isspace((unsigned char)text[i])) {
+                ++i;
+            }
+            if (i > start) {
+                result->content[count++] = newExpressionStr(newStringSlice(str, start, i - start));
+            }
+        }
+    } else if (delimiter->size == 0) {
+        result = newArray(size);
+        for (i = 0; i < size; ++i) {
+            result->content[i] = newExpressionStr(newStringSlice(str, i, 1));
+        }
+    } else {
+        count = 1;
+        for (i = searchFirst(text, size, delimiter->content, delimiter->size, 0); i >= 0; i = searchFirst(text, size, delimiter->content, delimiter->size, i + delimiter->size)) {
+            ++count;
+        }
+        result = newArray(count);
+        int from = 0; // the start of the piece not yet added
+        count = 0;
+        for (i = searchFirst(text, size, delimiter->content, delimiter->size, 0); i >= 0; i = searchFirst(text, size, delimiter->content, delimiter->size, i + delimiter->size)) {
+            result->content[count++] = newExpressionStr(newStringSlice(str, from, i - from));
+            from = i + delimiter->size;
+        }
+        result->content[count] = newExpressionStr(newStringSlice(str, from, size - from));
+    }
+    return result;
+}
+
+/*! Returns a string the same size as the given one to write a transformed copy of it into, along with where to read the original from; when nothing else uses the given string's content (e.g. it's the result of another call), the copy shares it and is written in place rather than given content of its own
+    @param str          the string, which is an argument about to be freed
+    @param src          set to where the original content is read from, which is the copy's own content when it's written in place
+    @return             the new string
+*/
+static string* writableCopy (string* str, char** src) {
+    if (str->parent == NULL && __atomic_load_n(&str->owners, __ATOMIC_ACQUIRE) == 1) {
+        string* result = copyString(str); // once the argument is freed the copy is the content's only owner
+        *src = result->content;
+        return result;
+    }
+    *src = str->content;
+    return newStringOfSize(str->size);
+}
+
+/*! Sets the return value to whether or not the given string is non-empty and every character of it is in the given character class
+    @param arg          the string expression
+    @param class        the class, one of the CLASS constants
+    @param returnval    the value the function returns after it ends
+    @param returntype   the type of value the function returns after it ends
+    @return             nothing
+*/
+static void classTest (expression* arg, int class, exprvals* returnval, datatype* returntype) {
+    string* str = arg->ev.strval;
+    *returntype = TYPE_INT;
+    returnval->intval = str->size > 0 && spanClass(str->content, str->size, class) == str->size;
+}
+
+/*! Returns the format the given argument is or, for a string, compiles into
+    @param arg          the argument
+    @return             the format, which must be freed by the caller, or null if the template can't be compiled
+*/
+static tap_fmt* castToFormat (expression* arg) {
+    if (arg->type == TYPE_FMT) {
+        return shareFormat(arg->ev.fmtval);
+    }
+    char* error;
+    tap_fmt* fmt = newFormat(arg->ev.strval->content, arg->ev.strval->size, &error);
+    if (fmt == NULL) {
+        formatError(error, arg->ev.strval);
+    }
+    return fmt;
+}
+
+/*! Adds an error saying what's wrong with the given template
+    @param error        what's wrong
+    @param template     the template
+    @return             nothing
+*/
+static void formatError (char* error, string* template) {
+    int size = strlen(error) + template->size + 3;
+    char* message = allocate(size);
+    snprintf(message, size, "%s: %.*s", error, template->size, template->content);
+    addError(newErrorlist(ERR_INVALID_FORMAT, newString(message), 0, 0));
+}
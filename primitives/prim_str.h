@@ -10,16 +10,27 @@
 
 #include "../source/structs.h"
 
+void prim_sForRange(expression*[], int, exprvals*, datatype*);
 void prim_sSet(expression*[], int, exprvals*, datatype*);
 void prim_sNewtype(expression*[], int, exprvals*, datatype*);
+void prim_sImport(expression*[], int, exprvals*, datatype*);
 void prim_sPrint(expression*[], int, exprvals*, datatype*);
 void prim_sCopy(expression*[], int, exprvals*, datatype*);
+void prim_sBuilder(expression*[], int, exprvals*, datatype*);
 void prim_sSize(expression*[], int, exprvals*, datatype*);
 void prim_sChar(expression*[], int, exprvals*, datatype*);
 void prim_sSubstr(expression*[], int, exprvals*, datatype*);
 void prim_sFind(expression*[], int, exprvals*, datatype*);
 void prim_sFindlast(expression*[], int, exprvals*, datatype*);
 void prim_sFindall(expression*[], int, exprvals*, datatype*);
+void prim_sMatchany(expression*[], int, exprvals*, datatype*);
+void prim_sFindallany(expression*[], int, exprvals*, datatype*);
+void prim_sRegex(expression*[], int, exprvals*, datatype*);
+void prim_sMatch(expression*[], int, exprvals*, datatype*);
+void prim_sMatchall(expression*[], int, exprvals*, datatype*);
+void prim_sRegexreplace(expression*[], int, exprvals*, datatype*);
+void prim_sFormatter(expression*[], int, exprvals*, datatype*);
+void prim_sFormat(expression*[], int, exprvals*, datatype*);
 void prim_sContains(expression*[], int, exprvals*, datatype*);
 void prim_sConcat(expression*[], int, exprvals*, datatype*);
 void prim_sReplace(expression*[], int, exprvals*, datatype*);
@@ -33,6 +44,15 @@ void prim_sUpper(expression*[], int, exprvals*, datatype*);
 void prim_sLower(expression*[], int, exprvals*, datatype*);
 void prim_sSentence(expression*[], int, exprvals*, datatype*);
 void prim_sTitle(expression*[], int, exprvals*, datatype*);
+void prim_sTrim(expression*[], int, exprvals*, datatype*);
+void prim_sTriml(expression*[], int, exprvals*, datatype*);
+void prim_sTrimr(expression*[], int, exprvals*, datatype*);
+void prim_sIsalpha(expression*[], int, exprvals*, datatype*);
+void prim_sIsdigit(expression*[], int, exprvals*, datatype*);
+void prim_sIsalnum(expression*[], int, exprvals*, datatype*);
+void prim_sIsspace(expression*[], int, exprvals*, datatype*);
+void prim_sIsupper(expression*[], int, exprvals*, datatype*);
+void prim_sIslower(expression*[], int, exprvals*, datatype*);
 void prim_sLess(expression*[], int, exprvals*, datatype*);
 void prim_sLequal(expression*[], int, exprvals*, datatype*);
 void prim_sEqual(expression*[], int, exprvals*, datatype*);
@@ -44,6 +64,7 @@ void prim_sInt(expression*[], int, exprvals*, datatype*);
 void prim_sFlo(expression*[], int, exprvals*, datatype*);
 void prim_sStr(expression*[], int, exprvals*, datatype*);
 void prim_sArr(expression*[], int, exprvals*, datatype*);
+void prim_sSplit(expression*[], int, exprvals*, datatype*);
 void prim_sDat(expression*[], int, exprvals*, datatype*);
 void prim_sTyp(expression*[], int, exprvals*, datatype*);
 
@@ -16,8 +16,6 @@
 #include "../source/types.h"
 #include "../source/strings.h"
 
-extern environment* environments[];
-extern uint cenvironment;
 
 /*! Creates a new object of the given type and properties or nil if the type if something fails (typ, [laz])->obj/nil
     @param args         the list of arguments
@@ -31,9 +29,9 @@ void prim_tNew (expression* args[], int numargs, exprvals* returnval, datatype*
     property* curprop;
     datatype tid = (datatype)(args[0]->ev.intval);
     type* typ = NULL;
-    int cenv = cenvironment;
+    int cenv = ccontext->cenvironment;
     while (cenv >= 0) {
-        typedefs* td = environments[cenv]->types;
+        typedefs* td = ccontext->environments[cenv]->types;
         while (td != NULL) {
             if (tid == td->type->id) {
                 typ = td->type;
@@ -48,7 +46,7 @@ void prim_tNew (expression* args[], int numargs, exprvals* returnval, datatype*
             expression* prop = args[1]->ev.lazval->expval;
             while (prop != NULL) {
                 if (prop->type == TYPE_EXP && prop->ev.expval->type == TYPE_STR && prop->ev.expval->next != NULL) {
-                    char* propname = prop->ev.expval->ev.strval->content;
+                    char* propname = stringContent(prop->ev.expval->ev.strval);
                     expression* propval = copyExpression(evaluateArgument(prop->ev.expval->next));
                     property* newprop = NULL;
                     property* proplist = typ->properties;
@@ -91,9 +89,9 @@ void prim_tNew (expression* args[], int numargs, exprvals* returnval, datatype*
             typelist* tl = typ->inherits;
             while (valid && tl != NULL) {
                 type* ptyp = NULL;
-                uint cenv = cenvironment;
+                uint cenv = ccontext->cenvironment;
                 while (cenv >= 0) {
-                    typedefs* td = environments[cenv]->types;
+                    typedefs* td = ccontext->environments[cenv]->types;
                     while (td != NULL) {
                         if (tl->type == td->type->id) {
                             ptyp = td->type;
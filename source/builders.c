@@ -0,0 +1,187 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   builders.c
+    @brief  String builders, which build a string out of pieces so that appending doesn't copy what was appended before
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "builders.h"
+#include "constants.h"
+#include "constructors.h"
+#include "memory.h"
+
+/* A builder keeps its string as a list of pieces, each with room to spare. An append fills the last piece and only starts a new
+   one when it runs out of room; a new piece reserves about as much as the whole string holds so far (within limits), so the
+   number of pieces stays small and appending is amortized constant time. Each piece knows where it starts in the whole string,
+   so finding the piece an index falls in is a binary search. The string is only put together when it's asked for, with a
+   single allocation. */
+
+static uint findPiece(tap_bld*, uint);
+
+/*! Creates a new, empty string builder
+    @return             the new builder
+*/
+tap_bld* newBuilder () {
+    tap_bld* bld = allocate(sizeof(tap_bld));
+    bld->pieces = allocate(sizeof(builderpiece) * BUILDER_INITIAL_PIECES);
+    bld->numpieces = 0;
+    bld->capacity = BUILDER_INITIAL_PIECES;
+    bld->size = 0;
+    bld->owners = 1;
+    return bld;
+}
+
+/*! Adds an owner to the given builder
+    @param bld          the builder
+    @return             the builder
+*/
+tap_bld* shareBuilder (tap_bld* bld) {
+    ++bld->owners;
+    return bld;
+}
+
+/*! Copies the given builder into a new builder that shares nothing with it, holding its string in a single piece
+    @param bld          the builder to copy
+    @return             the new builder
+*/
+tap_bld* copyBuilder (tap_bld* bld) {
+    tap_bld* copy = newBuilder();
+    if (bld->size > 0) {
+        builderpiece* piece = &copy->pieces[0];
+        piece->text = allocate(bld->size);
+        piece->size = bld->size;
+        piece->capacity = bld->size;
+        piece->start = 0;
+        readBuilder(bld, 0, bld->size, piece->text);
+        copy->numpieces = 1;
+        copy->size = bld->size;
+    }
+    return copy;
+}
+
+/*! Removes an owner from the given builder, freeing it once it has none left
+    @param bld          the builder
+    @return             0
+*/
+bool freeBuilder (tap_bld* bld) {
+    if (--bld->owners > 0) {
+        return 0;
+    }
+    uint i;
+    for (i = 0; i < bld->numpieces; ++i) {
+        free(bld->pieces[i].text);
+    }
+    free(bld->pieces);
+    free(bld);
+    return 0;
+}
+
+/*! Appends the given text to the end of the given builder's string
+    @param bld          the builder
+    @param text         the text, which is copied
+    @param size         the number of bytes of the text
+    @return             nothing
+*/
+void appendBuilder (tap_bld* bld, char* text, uint size) {
+    if (size == 0) {
+        return;
+    }
+    builderpiece* last = bld->numpieces > 0 ? &bld->pieces[bld->numpieces - 1] : NULL;
+    uint room = last != NULL ? last->capacity - last->size : 0;
+    if (room > size) {
+        room = size;
+    }
+    if (room > 0) { // fill what's left of the last piece first
+        memcpy(last->text + last->size, text, room);
+        last->size += room;
+        bld->size += room;
+        text += room;
+        size -= room;
+    }
+    if (size == 0) {
+        return;
+    }
+    if (bld->numpieces == bld->capacity) {
+        bld->capacity *= 2;
+        bld->pieces = realloc(bld->pieces, sizeof(builderpiece) * bld->capacity);
+        if (bld->pieces == NULL) {
+            exit(EXIT_OUT_OF_MEMORY);
+        }
+    }
+    uint spare = bld->size < BUILDER_MIN_PIECE ? BUILDER_MIN_PIECE : (bld->size > BUILDER_MAX_PIECE ? BUILDER_MAX_PIECE : bld->size); // grows with the string so there are only logarithmically many pieces
+    builderpiece* piece = &bld->pieces[bld->numpieces++];
+    piece->capacity = size > spare ? size : spare;
+    piece->text = allocate(piece->capacity);
+    memcpy(piece->text, text, size);
+    piece->size = size;
+    piece->start = bld->size;
+    bld->size += size;
+}
+
+/*! Returns the character at the given index of the given builder's string
+    @param bld          the builder
+    @param index        the index, which must be less than the builder's size
+    @return             the character
+*/
+char builderChar (tap_bld* bld, uint index) {
+    builderpiece* piece = &bld->pieces[findPiece(bld, index)];
+    return piece->text[index - piece->start];
+}
+
+/*! Copies the given range of the given builder's string into the given buffer
+    @param bld          the builder
+    @param start        the index of the first character to copy
+    @param size         the number of characters to copy, which must all be in the builder
+    @param dest         the buffer, which must have room for the characters
+    @return             nothing
+*/
+void readBuilder (tap_bld* bld, uint start, uint size, char* dest) {
+    if (size == 0) {
+        return;
+    }
+    uint i = findPiece(bld, start);
+    uint offset = start - bld->pieces[i].start;
+    while (size > 0) {
+        builderpiece* piece = &bld->pieces[i++];
+        uint count = piece->size - offset;
+        if (count > size) {
+            count = size;
+        }
+        memcpy(dest, piece->text + offset, count);
+        dest += count;
+        size -= count;
+        offset = 0;
+    }
+}
+
+/*! Puts the given builder's string together into a new string, which the builder doesn't keep
+    @param bld          the builder
+    @return             the new string
+*/
+string* flattenBuilder (tap_bld* bld) {
+    string* str = newStringOfSize(bld->size); // the pieces may contain null characters, so the size isn't measured
+    readBuilder(bld, 0, bld->size, str->content);
+    return str;
+}
+
+/*! Returns the index of the piece of the given builder that the given index of its string falls in
+    @param bld          the builder
+    @param index        the index in the string, which must be less than the builder's size
+    @return             the index of the piece
+*/
+static uint findPiece (tap_bld* bld, uint index) {
+    uint low = 0;
+    uint high = bld->numpieces - 1;
+    while (low < high) { // find the last piece that starts at or before the index
+        uint middle = low + (high - low + 1) / 2;
+        if (bld->pieces[middle].start <= index) {
+            low = middle;
+        } else {
+            high = middle - 1;
+        }
+    }
+    return low;
+}
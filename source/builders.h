@@ -0,0 +1,39 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   builders.h
+    @brief  The header file for builders.c
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#ifndef BUILDERS_H
+#define BUILDERS_H
+
+#include "structs.h"
+
+typedef struct builderpiece_ builderpiece;
+
+struct builderpiece_ {
+    char* text;
+    uint size; // the number of bytes of the piece in use
+    uint capacity; // the number of bytes reserved for the piece
+    uint start; // the index in the whole string of the piece's first byte
+};
+
+struct tap_bld_ {
+    builderpiece* pieces; // the pieces of the string in order
+    uint numpieces;
+    uint capacity; // the number of pieces there is room for
+    uint size; // the combined size of the pieces
+    uint owners; // the number of expressions that refer to the builder, all of which see what is appended through any of them
+};
+
+tap_bld* newBuilder();
+tap_bld* shareBuilder(tap_bld*);
+tap_bld* copyBuilder(tap_bld*);
+bool freeBuilder(tap_bld*);
+void appendBuilder(tap_bld*, char*, uint);
+char builderChar(tap_bld*, uint);
+void readBuilder(tap_bld*, uint, uint, char*);
+string* flattenBuilder(tap_bld*);
+
+#endif
@@ -0,0 +1,275 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   builtins.c
+    @brief  The static tables of primitive functions and built-in constants listed in builtins.def and the perfect hash index used to look them up
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "builtins.h"
+#include "constants.h"
+#include "constructors.h"
+#include "../primitives/prim_nil.h"
+#include "../primitives/prim_exp.h"
+#include "../primitives/prim_laz.h"
+#include "../primitives/prim_int.h"
+#include "../primitives/prim_flo.h"
+#include "../primitives/prim_str.h"
+#include "../primitives/prim_arr.h"
+#include "../primitives/prim_dat.h"
+#include "../primitives/prim_obj.h"
+#include "../primitives/prim_fun.h"
+#include "../primitives/prim_typ.h"
+#include "../primitives/prim_chn.h"
+#include "../primitives/prim_bld.h"
+#include "../primitives/prim_mat.h"
+#include "../primitives/prim_reg.h"
+#include "../primitives/prim_fmt.h"
+
+#define BUILTIN_HASH_SEED 2166136261u // FNV-1a offset basis
+#define BUILTIN_HASH_PRIME 16777619u // FNV-1a prime
+#define BUILTIN_HASH_MIX 2654435769u // the golden ratio, used to scatter the displaced hashsums
+
+// the pieces of a PRIM entry
+#define ARG(type) TYPE_MASK(TYPE_##type)
+#define NO_KERNEL .kernel = KERNEL_NONE
+#define INT_KERNEL(function) .kernel = KERNEL_INT, .fast = {.ints = &function}
+#define FLO_KERNEL(function) .kernel = KERNEL_FLO, .fast = {.flos = &function}
+#define FLO_INT_KERNEL(function) .kernel = KERNEL_FLO_INT, .fast = {.flotests = &function}
+
+// the value of a CONSTANT entry of each type
+#define NIL_VALUE(value) {.intval = value}
+#define INT_VALUE(value) {.intval = value}
+#define FLO_VALUE(value) {.floval = value}
+#define TYP_VALUE(value) {.intval = value}
+
+static const tap_prim_fun primitives[] = {
+#define PRIM(pname, function, min, max, kern, ...) {.name = pname, .address = &function, .minargs = min, .maxargs = max, .types = {__VA_ARGS__}, kern},
+#include "builtins.def"
+};
+
+static const builtinconst constants[] = {
+#define CONSTANT(cname, ctype, cvalue) {.name = cname, .type = TYPE_##ctype, .value = ctype##_VALUE(cvalue)},
+#include "builtins.def"
+};
+
+static const char* const impures[] = {
+#define IMPURE(iname) iname,
+#include "builtins.def"
+};
+
+#define NUM_PRIMITIVES (sizeof(primitives) / sizeof(primitives[0]))
+#define NUM_CONSTANTS (sizeof(constants) / sizeof(constants[0]))
+#define NUM_BUILTINS (NUM_PRIMITIVES + NUM_CONSTANTS)
+#define NUM_SLOTS (NUM_BUILTINS * 2) // keep the index at most half full so that a displacement is found for every bucket quickly
+
+static const tap_prim_fun* orderedprims[NUM_PRIMITIVES]; // the primitives grouped by name, each group in the order it is tried
+static builtinslot slots[NUM_SLOTS];
+static uint displacements[NUM_BUILTINS]; // the displacement of each bucket of names, which sends every name in it to an empty slot
+static uint numbuckets;
+static pthread_once_t indexonce = PTHREAD_ONCE_INIT;
+
+static void buildIndex();
+static uint hashName(char*);
+static uint displaceHash(uint, uint);
+static builtinslot* findSlot(char*);
+
+/*! Returns the primitive functions with the given name in the order they should be tried
+    @param name         the name of the primitive functions
+    @param count        set to the number of primitive functions returned
+    @return             the array of primitive functions or null if no primitive function has the name
+*/
+const tap_prim_fun* const* lookupPrimitives (char* name, int* count) {
+    builtinslot* slot = findSlot(name);
+    if (slot == NULL || slot->numprims == 0) {
+        *count = 0;
+        return NULL;
+    }
+    *count = slot->numprims;
+    return slot->prims;
+}
+
+/*! Returns the value of the built-in constant with the given name
+    @param name         the name of the constant
+    @return             a new expression holding the constant's value or null if there is no such constant
+*/
+expression* builtinConstant (char* name) {
+    builtinslot* slot = findSlot(name);
+    if (slot == NULL || slot->constant == NULL) {
+        return NULL;
+    }
+    expression* expr = newExpressionOfType(slot->constant->type);
+    expr->ev = slot->constant->value;
+    return expr;
+}
+
+/*! Returns the built-in type with the given name
+    @param name         the name of the type (e.g. 'int')
+    @return             the type or TYPE_UNK if no built-in type has the name
+*/
+datatype builtinType (char* name) {
+    builtinslot* slot = findSlot(name);
+    if (slot == NULL || slot->typeconstant == NULL) {
+        return TYPE_UNK;
+    }
+    return slot->typeconstant->value.intval;
+}
+
+/*! Returns whether or not the primitive functions with the given name are listed as impure
+    @param name         the name of the primitive functions
+    @return             1 if they are impure, 0 otherwise (including for names that aren't primitive functions)
+*/
+int primitiveImpure (char* name) {
+    builtinslot* slot = findSlot(name);
+    return slot != NULL && slot->impure;
+}
+
+/*! Returns whether or not the given arguments suit the given primitive function's signature
+    @param prim_fun     the primitive function
+    @param args         the array of arguments
+    @param numargs      the number of arguments in the array
+    @return             1 if the primitive function accepts the arguments, 0 otherwise
+*/
+int primitiveAccepts (const tap_prim_fun* prim_fun, expression* args[], int numargs) {
+    if (prim_fun->minargs > numargs || (prim_fun->maxargs != ARGLEN_INF && prim_fun->maxargs < numargs)) {
+        return 0;
+    }
+    int checked = prim_fun->minargs < PRIM_MAX_ARGTYPES ? prim_fun->minargs : PRIM_MAX_ARGTYPES; // only the required arguments are checked
+    int i;
+    for (i = 0; i < checked; ++i) {
+        uint mask = prim_fun->types[i];
+        if (mask != 0 && mask != TYPE_MASK_ANY && (args[i]->type >= 32 || !(mask & (1u << args[i]->type)))) { // composite types only match a position that accepts any type
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*! Fills the index from the static tables; this runs once per process and allocates nothing
+    @return             nothing
+*/
+static void buildIndex () {
+    static char* names[NUM_BUILTINS];
+    static uint hashsums[NUM_BUILTINS];
+    static uint namebuckets[NUM_BUILTINS];
+    static uint bucketsizes[NUM_BUILTINS];
+    static uint bucketorder[NUM_BUILTINS];
+    static builtinslot namedata[NUM_BUILTINS];
+    uint numnames = 0;
+    uint i, j;
+    for (i = 0; i < NUM_BUILTINS; ++i) { // collect the distinct names
+        const char* name = i < NUM_PRIMITIVES ? primitives[i].name : constants[i - NUM_PRIMITIVES].name;
+        for (j = 0; j < numnames && strcmp(names[j], name) != 0; ++j);
+        if (j == numnames) {
+            names[numnames] = (char*)name;
+            hashsums[numnames] = hashName(names[numnames]);
+            namedata[numnames].name = name;
+            ++numnames;
+        }
+    }
+    uint numordered = 0;
+    for (j = 0; j < numnames; ++j) { // group the primitives by name, the ones listed later first since they were registered last
+        namedata[j].prims = &orderedprims[numordered];
+        for (i = NUM_PRIMITIVES; i-- > 0;) {
+            if (strcmp(primitives[i].name, names[j]) == 0) {
+                orderedprims[numordered++] = &primitives[i];
+                ++namedata[j].numprims;
+            }
+        }
+        for (i = NUM_CONSTANTS; i-- > 0;) { // the last constant listed with a name is the one it refers to
+            if (strcmp(constants[i].name, names[j]) == 0) {
+                if (namedata[j].constant == NULL) {
+                    namedata[j].constant = &constants[i];
+                }
+                if (namedata[j].typeconstant == NULL && constants[i].type == TYPE_TYP) {
+                    namedata[j].typeconstant = &constants[i];
+                }
+            }
+        }
+        for (i = 0; i < sizeof(impures) / sizeof(impures[0]); ++i) {
+            if (strcmp(impures[i], names[j]) == 0) {
+                namedata[j].impure = 1;
+            }
+        }
+    }
+    numbuckets = numnames / 2 + 1;
+    for (j = 0; j < numnames; ++j) {
+        namebuckets[j] = hashsums[j] % numbuckets;
+        ++bucketsizes[namebuckets[j]];
+    }
+    for (i = 0; i < numbuckets; ++i) { // place the largest buckets first while the index is emptiest
+        for (j = i; j > 0 && bucketsizes[bucketorder[j - 1]] < bucketsizes[i]; --j) {
+            bucketorder[j] = bucketorder[j - 1];
+        }
+        bucketorder[j] = i;
+    }
+    for (i = 0; i < numbuckets && bucketsizes[bucketorder[i]] > 0; ++i) {
+        uint bucket = bucketorder[i];
+        uint displacement;
+        for (displacement = 0; ; ++displacement) { // try displacements until every name in the bucket lands in its own empty slot
+            int placed = 1;
+            for (j = 0; j < numnames && placed; ++j) {
+                if (namebuckets[j] == bucket) {
+                    builtinslot* slot = &slots[displaceHash(hashsums[j], displacement) % NUM_SLOTS];
+                    if (slot->name != NULL) {
+                        placed = 0;
+                    } else {
+                        *slot = namedata[j]; // claim the slot for now so that two names in the bucket can't share it
+                    }
+                }
+            }
+            if (placed) {
+                break;
+            }
+            for (j = 0; j < numnames; ++j) { // give back the slots this displacement claimed
+                if (namebuckets[j] == bucket) {
+                    builtinslot* slot = &slots[displaceHash(hashsums[j], displacement) % NUM_SLOTS];
+                    if (slot->name == namedata[j].name) {
+                        slot->name = NULL;
+                    }
+                }
+            }
+        }
+        displacements[bucket] = displacement;
+    }
+}
+
+/*! Hashes the given name with FNV-1a
+    @param name         the name to hash
+    @return             the hashsum
+*/
+static uint hashName (char* name) {
+    uint hashsum = BUILTIN_HASH_SEED;
+    while (*name != '\0') {
+        hashsum ^= (unsigned char)*name++;
+        hashsum *= BUILTIN_HASH_PRIME;
+    }
+    return hashsum;
+}
+
+/*! Combines the given hashsum with the given displacement, scattering the result across the whole range of hashsums
+    @param hashsum      the name's hashsum
+    @param displacement the displacement of the name's bucket
+    @return             the displaced hashsum
+*/
+static uint displaceHash (uint hashsum, uint displacement) {
+    hashsum = (hashsum ^ displacement * BUILTIN_HASH_MIX) * BUILTIN_HASH_PRIME;
+    return hashsum ^ (hashsum >> 15);
+}
+
+/*! Finds the slot of the index holding the built-ins with the given name
+    @param name         the name to look up
+    @return             the slot or null if nothing built in has the name
+*/
+static builtinslot* findSlot (char* name) {
+    pthread_once(&indexonce, &buildIndex);
+    uint hashsum = hashName(name);
+    builtinslot* slot = &slots[displaceHash(hashsum, displacements[hashsum % numbuckets]) % NUM_SLOTS];
+    if (slot->name == NULL || strcmp(slot->name, name) != 0) {
+        return NULL;
+    }
+    return slot;
+}
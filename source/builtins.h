@@ -0,0 +1,19 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   builtins.h
+    @brief  The header file for builtins.c
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#ifndef BUILTINS_H
+#define BUILTINS_H
+
+#include "structs.h"
+
+const tap_prim_fun* const* lookupPrimitives(char*, int*);
+expression* builtinConstant(char*);
+datatype builtinType(char*);
+int primitiveImpure(char*);
+int primitiveAccepts(const tap_prim_fun*, expression*[], int);
+
+#endif
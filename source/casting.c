@@ -14,71 +14,23 @@
 #include "engine.h"
 #include "constructors.h"
 #include "strings.h"
+#include "builders.h"
+#include "numbers.h"
 
-/*! Tries to cast the given expression to a number
-    @param expr     the expression to cast
-    @param base     the base to use when casting
-    @return         the integer value of the given expression
+/*! Tries to cast the given string to a number
+    @param string   the string to cast
+    @param base     the base to use when casting, or 0 for base 10
+    @return         a float expression holding the number, or a nil expression if the string isn't a number in the given base
 */
 expression* castToNum (string* string, int base) {
     expression* numexpr = newExpressionOfType(TYPE_NIL);
-    char* content = string->content;
-    if (base == 0) {
-        base = BASE;
+    tap_int intval;
+    tap_flo floval;
+    datatype typ = parseNumber(string->content, string->size, base == 0 ? BASE : base, &intval, &floval);
+    if (typ != TYPE_NIL) {
+        numexpr->type = TYPE_FLO;
+        numexpr->ev.floval = typ == TYPE_INT ? intval : floval;
     }
-    int ucharmin = 'A';
-    int ucharmax = (base - 10) + 'A';
-    int lcharmin = 'a';
-    int lcharmax = (base - 10) + 'a';
-    double result = 0;
-    int digit = 1;
-    int situation = 0;
-    int dot = 0;
-    int divideby = 1;
-    int tempint;
-    int i;
-    for (i = string->size - 1; i >= 0; --i) {
-        if ((content[i] >= '0' && content[i] <= '9')
-            || (content[i] >= ucharmin && content[i] < ucharmax)
-            || (content[i] >= lcharmin && content[i] < lcharmax)) {
-                if (situation == 2) {
-                    return numexpr;
-                }
-                if (content[i] >= lcharmin) {
-                    tempint = 'a' - BASE;
-                } else if (content[i] >= ucharmin) {
-                    tempint = 'A' - BASE;
-                } else {
-                    tempint = '0';
-                }
-                if (content[i] - tempint > base) {
-                    return numexpr;
-                }
-                tempint = content[i] - tempint;
-                result += tempint * digit;
-                digit *= base;
-                situation = 1;
-        } else if (content[i] == ' ') {
-            if (situation == 1) {
-                situation = 2;
-            }
-        } else if (situation == 1 && content[i] == '-') {
-            situation = 2;
-            result *= -1;
-        } else if (situation == 1 && content[i] == '+') {
-            situation = 2;
-        } else if (situation == 1 && content[i] == '.') {
-            if (dot == 0) {
-                divideby = digit;
-            } else {
-                return numexpr;
-            }
-        } else {
-            return numexpr;
-        }
-    }
-    numexpr->type = TYPE_FLO;
-    numexpr->ev.floval = result / divideby;
     return numexpr;
 }
 
@@ -101,11 +53,17 @@ long castToInt (expression* expr) {
             if (value != NULL) { // if the value was found then try to cast it to an integer
                 return castToInt(value);
             }
-        } else if (expr->flag == EFLAG_NONE) { // if the expression is a string literal
-            return atoi(expr->ev.strval->content);
+        } else if (expr->flag == EFLAG_NONE) { // if the expression is a string literal then read it as a number, rounding a float
+            tap_int intval;
+            tap_flo floval;
+            datatype typ = parseNumber(expr->ev.strval->content, expr->ev.strval->size, BASE, &intval, &floval);
+            if (typ == TYPE_FLO) {
+                return floval < 0 ? (long)(floval - 0.5) : (long)(floval + 0.5);
+            }
+            return typ == TYPE_INT ? intval : NIL;
         }
     } else if (expr->type == TYPE_LAZ) { // if the expression is a lazy expression then evaluate it and try to cast it again
-    	expression* lazy = evaluateLaz(copyExpression(expr));
+    	expression* lazy = forceLaz(expr);
         long result = castToInt(lazy);
         freeExpr(lazy);
         return result;
@@ -178,10 +136,13 @@ double castToFlo (expression* expr) {
                 return castToFlo(value);
             }
         } else if (expr->flag == EFLAG_NONE) { // if the expression is a string literal
-            return atof(expr->ev.strval->content);
+            tap_int intval;
+            tap_flo floval;
+            datatype typ = parseNumber(expr->ev.strval->content, expr->ev.strval->size, BASE, &intval, &floval);
+            return typ == TYPE_FLO ? floval : typ == TYPE_INT ? intval : NIL;
         }
     } else if (expr->type == TYPE_LAZ) { // if the expression is a lazy expression then evaluate it and try to cast it again
-    	expression* lazy = evaluateLaz(copyExpression(expr));
+    	expression* lazy = forceLaz(expr);
         double result = castToFlo(lazy);
         freeExpr(lazy);
         return result;
@@ -204,17 +165,15 @@ string* castToStr (expression* expr) {
             return copyString(expr->ev.strval);
         }
     } else if (expr->type == TYPE_INT) { // if the expression is an integer then return its string equivalent
-        int size = snprintf(NULL, 0, "%ld", expr->ev.intval);
-        char* result = allocate(size + 1);
-        sprintf(result, "%ld", expr->ev.intval);
-        return newString(result);
-    } else if (expr->type == TYPE_FLO) { // if the expression is a flot then return its string equivalent
-        int size = snprintf(NULL, 0, "%f", expr->ev.floval);
-        char* result = allocate(size + 1);
-        sprintf(result, "%f", expr->ev.floval);
-        return newString(result);
+        char digits[NUMBER_MAX_SIZE];
+        return newStringCopy(digits, formatInt(digits, expr->ev.intval, BASE));
+    } else if (expr->type == TYPE_FLO) { // if the expression is a float then return the shortest string that reads back as it
+        char digits[NUMBER_MAX_SIZE];
+        return newStringCopy(digits, formatFlo(digits, expr->ev.floval));
+    } else if (expr->type == TYPE_BLD) { // if the expression is a string builder then put its string together
+        return flattenBuilder(expr->ev.bldval);
     } else if (expr->type == TYPE_LAZ) { // if the expression is a lazy expression then evaluate it and try to cast it again
-    	expression* lazy = evaluateLaz(copyExpression(expr));
+    	expression* lazy = forceLaz(expr);
         string* result = castToStr(lazy);
         freeExpr(lazy);
         return result;
@@ -222,64 +181,31 @@ string* castToStr (expression* expr) {
     return NIL; // if the expression can't be cast as a string then return nil
 }
 
-/*! Casts the given integer to a string, converting the integer to the given base in the process
+/*! Casts the given expression to a string to search for or put between pieces, taking an integer as a character code
     @param expr     the expression to cast
-    @return         the floating point value of the given expression
+    @return         the new string, which must be freed by the caller and is empty if the expression can't be cast
 */
-string* castToStrWithBase (int intval, uint base) {
-    char* result; // the resulting string
-    uint size; // the size of the string (minus the null terminator)
-    bool sign = intval < 0; // 1 if the integer is negative, 0 if it's not
-    intval = abs(intval); // make the integer positive if it's not already
-    if (intval < base) { // if the given integer is less than the given base
-        size = log10(intval) + 1 + sign; // calculate the size of the result string
-        result = allocate(size + 1); // allocate the appropriate memory
-        intval += '0'; // convert the integer to its ascii value
-        sprintf(result + sign, "%c", alphaNumeric(intval)); // print the ascii value
-        result[size] = '\0'; // null terminate the string
-    } else { // if the given integer is more than or equal to the given base
-        size = (log(intval) / log(base)) + 1 + sign; // calculate the size of the result string
-        result = allocate(size + 1); // allocate the appropriate memory
-        result[size] = '\0'; // null terminate the string
-        int index = size - 1; // set the index to the end of the string (this algorithm creates the string backwords)
-        result[index] = '0'; // initialize the current (last in this case) digit to 0
-        uint cbase = base; // the current base
-        uint asciibase = '0' + base; // the ascii equivalent to the given base
-        uint calc = 0; // temporary variable for intermediate calculations
-        int flag = 1; // a flag that determins what to do with the current digit that is reset after each digit calculation
-        while (cbase <= intval) { // while the current base is less than the given integer
-            calc = intval % cbase; // calculate the remainder of the integer divided by the current base
-            if (calc >= base) { // add the appropriate value depending on whether or not the remainder is less than the base
-                result[index] += calc / base;
-            } else {
-                result[index] += calc;
-            }
-            while (result[index] >= asciibase) { // while the current digit is more than the current base (and therefore needs to be reduced)
-                result[index] = alphaNumeric('0' + (result[index] - '0') / base); // reduce the current digit
-                flag = 0; // indicate that the digit doesn't need more processing
-            }
-            if (flag) { // if the digit needs more processing (because it never entered the previous while loop)
-                result[index] = alphaNumeric(result[index]); // adjust the value to fit in one digit if it's more than 9
-            } else { // reset the flag if it was set
-                flag = 1;
-            }
-            result[index - 1] = '0'; // initialize the next digit to 0
-            --index; // advance to the next digit
-            intval -= calc; // reduce the integer to erase the remainder
-            cbase *= base; // advance to the next base
-        }
-        if (intval >= cbase / base) { // if the first digit needs processing
-            if (result[index] == 0) { // if the first digit hasn't been processed
-                result[index] = alphaNumeric(asciibase - 1); // set it to the highest value allowed by the base
-            } else { // if the first digit has been processed
-                result[index] += alphaNumeric(intval / (cbase / base)); // adjust the digit to keep it below the base and to one digit
-            }
-        }
+string* castToNeedle (expression* expr) {
+    if (expr->type == TYPE_INT) {
+        string* needle = newStringOfSize(1);
+        needle->content[0] = expr->ev.intval;
+        return needle;
     }
-    if (sign) { // if the given integer is negative add a negative sign
-        result[0] = '-';
+    string* needle = castToStr(expr);
+    return needle != NULL ? needle : newStringOfSize(0); // a needle that isn't a string is empty, which matches nowhere
+}
+
+/*! Casts the given integer to a string, converting the integer to the given base in the process
+    @param intval   the integer to cast
+    @param base     the base, from 2 to 36
+    @return         the string, or nil if the base is out of range
+*/
+string* castToStrWithBase (tap_int intval, uint base) {
+    if (base < 2 || base > 36) {
+        return NIL;
     }
-    return newString(result);
+    char digits[NUMBER_MAX_SIZE];
+    return newStringCopy(digits, formatInt(digits, intval, base));
 }
 
 /*! Converts a number to the appropriate letter needed to restrict the number to one digit
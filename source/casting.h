@@ -16,7 +16,8 @@ expression* castToBoo(expression*);
 expression* fRound(double, int);
 double castToFlo(expression*);
 string* castToStr(expression*);
-string* castToStrWithBase(int, uint);
+string* castToStrWithBase(tap_int, uint);
+string* castToNeedle(expression*);
 uint alphaNumeric(uint);
 array* castToArr(expression*);
 
@@ -0,0 +1,212 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   channels.c
+    @brief  Bounded channels that pass values between contexts, which may be running in different threads
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#include <stdlib.h>
+
+#include "channels.h"
+#include "memory.h"
+#include "workers.h"
+
+/* A channel is a ring buffer that any number of threads send to and receive from without locking. Each slot holds a sequence
+   saying what it's ready for: a sender may fill the slot at position p once its sequence is 2p, and marks it 2p + 1 when the
+   value is in; a receiver may empty it once its sequence is 2p + 1, and marks it 2(p + capacity), since that's the position the
+   slot is reused for. (Doubling keeps a full slot from looking free for the next position when the capacity is 1.) Senders
+   and receivers claim positions by advancing the head and tail with compare-and-swap, so they only contend with their own kind.
+   A thread only takes the lock when the channel is full (or empty) and it has to wait; whoever then changes the channel wakes
+   it if any thread is waiting. */
+
+static int trySend(tap_chn*, expression*);
+static expression* tryReceive(tap_chn*);
+static void wakeChannel(tap_chn*);
+
+/*! Creates a new open, empty channel
+    @param capacity     the most values the channel buffers before sending waits (at least 1)
+    @return             the new channel
+*/
+tap_chn* newChannel (uint capacity) {
+    if (capacity < 1) {
+        capacity = 1;
+    }
+    tap_chn* chn = allocate(sizeof(tap_chn));
+    chn->slots = allocate(sizeof(channelslot) * capacity);
+    uint i;
+    for (i = 0; i < capacity; ++i) {
+        chn->slots[i].sequence = 2 * i;
+        chn->slots[i].value = NULL;
+    }
+    chn->capacity = capacity;
+    chn->head = 0;
+    chn->tail = 0;
+    chn->closed = 0;
+    chn->sleepers = 0;
+    chn->owners = 1;
+    pthread_mutex_init(&chn->lock, NULL);
+    pthread_cond_init(&chn->changed, NULL);
+    chn->parked.first = NULL;
+    return chn;
+}
+
+/*! Adds an owner to the given channel, which every copy of a channel expression shares whatever context it's in
+    @param chn          the channel
+    @return             the channel
+*/
+tap_chn* shareChannel (tap_chn* chn) {
+    __atomic_add_fetch(&chn->owners, 1, __ATOMIC_RELAXED);
+    return chn;
+}
+
+/*! Removes an owner from the given channel, freeing it along with the values still in it once it has none left
+    @param chn          the channel
+    @return             0
+*/
+bool freeChannel (tap_chn* chn) {
+    if (__atomic_sub_fetch(&chn->owners, 1, __ATOMIC_ACQ_REL) > 0) {
+        return 0;
+    }
+    expression* value;
+    while ((value = tryReceive(chn)) != NULL) {
+        freeExprNR(value);
+    }
+    free(chn->slots);
+    pthread_mutex_destroy(&chn->lock);
+    pthread_cond_destroy(&chn->changed);
+    free(chn);
+    return 0;
+}
+
+/*! Sends the given value through the given channel, waiting for room if it's full
+    @param chn          the channel
+    @param value        the value, which the channel takes over if it's sent
+    @return             1 if the value was sent, 0 if the channel is closed
+*/
+int sendChannel (tap_chn* chn, expression* value) {
+    if (__atomic_load_n(&chn->closed, __ATOMIC_ACQUIRE)) {
+        return 0;
+    }
+    int sent = trySend(chn, value);
+    if (!sent) { // the channel is full
+        pthread_mutex_lock(&chn->lock);
+        __atomic_add_fetch(&chn->sleepers, 1, __ATOMIC_SEQ_CST); // counted before trying again so no change goes unnoticed
+        blockWorker();
+        while (!(sent = trySend(chn, value)) && !__atomic_load_n(&chn->closed, __ATOMIC_ACQUIRE)) {
+            parkTask(&chn->parked, &chn->changed, &chn->lock);
+        }
+        unblockWorker();
+        __atomic_sub_fetch(&chn->sleepers, 1, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&chn->lock);
+    }
+    if (sent) {
+        wakeChannel(chn);
+    }
+    return sent;
+}
+
+/*! Receives the next value from the given channel, waiting for one if it's empty
+    @param chn          the channel
+    @return             the value, or null if the channel is closed and every value sent through it has been received
+*/
+expression* receiveChannel (tap_chn* chn) {
+    expression* value = tryReceive(chn);
+    if (value == NULL && !__atomic_load_n(&chn->closed, __ATOMIC_ACQUIRE)) { // the channel is empty
+        pthread_mutex_lock(&chn->lock);
+        __atomic_add_fetch(&chn->sleepers, 1, __ATOMIC_SEQ_CST);
+        blockWorker();
+        while ((value = tryReceive(chn)) == NULL && !__atomic_load_n(&chn->closed, __ATOMIC_ACQUIRE)) {
+            parkTask(&chn->parked, &chn->changed, &chn->lock);
+        }
+        unblockWorker();
+        __atomic_sub_fetch(&chn->sleepers, 1, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&chn->lock);
+    }
+    if (value == NULL) { // closed, but a value sent just before closing may still be on its way into its slot
+        value = tryReceive(chn);
+    }
+    if (value != NULL) {
+        wakeChannel(chn);
+    }
+    return value;
+}
+
+/*! Closes the given channel, after which nothing more can be sent through it but the values already in it can still be received
+    @param chn          the channel
+    @return             nothing
+*/
+void closeChannel (tap_chn* chn) {
+    __atomic_store_n(&chn->closed, 1, __ATOMIC_RELEASE);
+    wakeChannel(chn);
+}
+
+/*! Returns the number of values waiting in the given channel, which other threads may change at any moment
+    @param chn          the channel
+    @return             the number of values
+*/
+uint channelCount (tap_chn* chn) {
+    unsigned long tail = __atomic_load_n(&chn->tail, __ATOMIC_ACQUIRE);
+    unsigned long head = __atomic_load_n(&chn->head, __ATOMIC_ACQUIRE);
+    return head > tail ? head - tail : 0;
+}
+
+/*! Sends the given value through the given channel if it has room
+    @param chn          the channel
+    @param value        the value
+    @return             1 if the value was sent, 0 if the channel is full
+*/
+static int trySend (tap_chn* chn, expression* value) {
+    unsigned long pos = __atomic_load_n(&chn->head, __ATOMIC_RELAXED);
+    while (1) {
+        channelslot* slot = &chn->slots[pos % chn->capacity];
+        long turn = (long)(__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) - 2 * pos);
+        if (turn == 0) { // the slot is free for this position, so claim the position
+            if (__atomic_compare_exchange_n(&chn->head, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                slot->value = value;
+                __atomic_store_n(&slot->sequence, 2 * pos + 1, __ATOMIC_RELEASE);
+                return 1;
+            }
+        } else if (turn < 0) { // the slot still holds the value from the last time around
+            return 0;
+        } else { // another sender claimed the position first
+            pos = __atomic_load_n(&chn->head, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/*! Receives the next value from the given channel if there is one
+    @param chn          the channel
+    @return             the value, or null if the channel is empty
+*/
+static expression* tryReceive (tap_chn* chn) {
+    unsigned long pos = __atomic_load_n(&chn->tail, __ATOMIC_RELAXED);
+    while (1) {
+        channelslot* slot = &chn->slots[pos % chn->capacity];
+        long turn = (long)(__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) - (2 * pos + 1));
+        if (turn == 0) { // the slot holds the value for this position
+            if (__atomic_compare_exchange_n(&chn->tail, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                expression* value = slot->value;
+                slot->value = NULL;
+                __atomic_store_n(&slot->sequence, 2 * (pos + chn->capacity), __ATOMIC_RELEASE);
+                return value;
+            }
+        } else if (turn < 0) { // nothing has been sent to the position yet
+            return NULL;
+        } else { // another receiver claimed the position first
+            pos = __atomic_load_n(&chn->tail, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/*! Wakes the threads and tasks waiting on the given channel, if there are any, so they see that it changed
+    @param chn          the channel
+    @return             nothing
+*/
+static void wakeChannel (tap_chn* chn) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST); // the change must be visible before the count of waiting threads is read
+    if (__atomic_load_n(&chn->sleepers, __ATOMIC_SEQ_CST) > 0) {
+        pthread_mutex_lock(&chn->lock);
+        unparkTasks(&chn->parked, &chn->changed);
+        pthread_mutex_unlock(&chn->lock);
+    }
+}
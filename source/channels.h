@@ -0,0 +1,44 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   channels.h
+    @brief  The header file for channels.c
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#ifndef CHANNELS_H
+#define CHANNELS_H
+
+#include <pthread.h>
+
+#include "structs.h"
+#include "scheduler.h"
+
+typedef struct channelslot_ channelslot;
+
+struct channelslot_ {
+    unsigned long sequence; // which position the slot is ready to be filled or emptied for; see channels.c
+    expression* value;
+};
+
+struct tap_chn_ {
+    channelslot* slots; // a ring buffer of capacity slots
+    uint capacity;
+    unsigned long head; // the position the next value is sent to
+    unsigned long tail; // the position the next value is received from
+    int closed;
+    int sleepers; // the number of threads waiting for the channel to change
+    uint owners; // the number of expressions, in any context, that refer to the channel
+    pthread_mutex_t lock; // only taken by threads that have to wait
+    pthread_cond_t changed;
+    tasklist parked; // the green tasks waiting for the channel to change, which wait on it without holding up their threads
+};
+
+tap_chn* newChannel(uint);
+tap_chn* shareChannel(tap_chn*);
+bool freeChannel(tap_chn*);
+int sendChannel(tap_chn*, expression*);
+expression* receiveChannel(tap_chn*);
+void closeChannel(tap_chn*);
+uint channelCount(tap_chn*);
+
+#endif
@@ -37,7 +37,17 @@
 #define TYPE_OBJ 9 // object
 #define TYPE_FUN 10 // function
 #define TYPE_TYP 11 // type
-#define TYPE_COMP_START 12 // the first available type ID for composite (i.e. user defined) types
+#define TYPE_CHN 12 // channel
+#define TYPE_BLD 13 // string builder
+#define TYPE_MAT 14 // matcher
+#define TYPE_REG 15 // regular expression
+#define TYPE_FMT 16 // format
+#define TYPE_COMP_START 17 // the first available type ID for composite (i.e. user defined) types
+
+// type masks (the set of types a primitive function accepts at one argument position)
+#define TYPE_MASK_ANY 0xffffffffu // accepts every type, including composite types
+#define TYPE_MASK(type) ((type) == TYPE_UNK ? TYPE_MASK_ANY : 1u << (type))
+#define PRIM_MAX_ARGTYPES 5 // the most argument positions a primitive function's signature can list
 
 // expression flags
 #define EFLAG_NONE -1 // the default flag
@@ -47,6 +57,27 @@
 #define EFLAG_ARR 0 // marks the expression as an array expression
 #define EFLAG_DEL 1 // marks the expression for deletion
 
+// special forms, which the evaluator handles itself so that untaken arguments are never evaluated
+#define SFORM_NONE 0 // not a special form
+#define SFORM_IF 1 // if
+#define SFORM_AND 2 // &&
+#define SFORM_OR 3 // ||
+
+// fast-call kernels, which primitives can provide for when every argument already has the operand type
+#define KERNEL_NONE 0 // the primitive only has its regular form
+#define KERNEL_INT 1 // integer operands and an integer result
+#define KERNEL_FLO 2 // float operands and a float result
+#define KERNEL_FLO_INT 3 // float operands and an integer result
+
+// loop plan nodes, which say how each piece of a loop's body is evaluated without looking up its names again
+#define LOOP_GENERIC 0 // evaluated the usual way
+#define LOOP_LITERAL 1 // an integer or float literal
+#define LOOP_CONSTANT 2 // a built-in constant that nothing shadowed when the body was planned
+#define LOOP_VARIABLE 3 // a variable whose binding was found when the body was planned
+#define LOOP_CALL 4 // a call of a built-in primitive that nothing shadowed when the body was planned
+#define LOOP_SET 5 // a set of a variable whose binding was found when the body was planned
+#define LOOP_MAX_ARGS 8 // a call with more arguments than this is evaluated the usual way
+
 // hash element flags
 #define HFLAG_PRIM 0 // primitive function
 #define HFLAG_USER 1 // user defined variable
@@ -65,13 +96,22 @@
 #define ERR_UNDEFINED_TYP 9 // the given type is undefined
 #define ERR_UNDEFINED_PROP 10 // the given property is undefined
 #define ERR_OUT_OF_BOUNDS 11 // the index being accessed is out of the bounds of the given array
+#define ERR_UNREADABLE_FILE 12 // the given file couldn't be read
+#define ERR_UNWRITABLE_FILE 13 // the given file couldn't be written
+#define ERR_INVALID_SNAPSHOT 14 // the given snapshot is corrupt, was made by a different build, or can't be restored into the given context
+#define ERR_INVALID_REGEX 15 // the given regular expression can't be compiled
+#define ERR_INVALID_FORMAT 16 // the given format can't be compiled or doesn't suit the given arguments
+#define ERR_TOO_DEEP 17 // a function was called with too little of the task's stack left to evaluate it
 
 // environment defaults
 #define INITIAL_VAR_COUNT 100
 #define INITIAL_VAR_SIZE 100
 #define INITIAL_ENV_COUNT 100
 #define INITIAL_ENV_SIZE 89
-#define INITIAL_ROOT_ENV_SIZE 11519
+#define INITIAL_ROOT_ENV_SIZE 1021 // the root environment only holds what packages define since the built-ins are static
+
+// memory defaults
+#define EXPR_MAX_SPARE 4096 // the most freed expressions each thread keeps to reuse for new ones
 
 // symbols defaults
 #define INITIAL_SYMBOL_COUNT 737279
@@ -79,6 +119,88 @@
 // types array defaults
 #define INITIAL_TYPES_SIZE 100
 
+// memoization defaults
+#define MEMO_DEFAULT_CAPACITY 1024 // the number of results a memoized function keeps when no size is given
+#define MEMO_MIN_TABLE_SIZE 16 // the fewest hash buckets a memoization cache allocates
+
+// server defaults
+#define SERVER_BACKLOG 128 // the number of connections that can wait to be accepted
+#define SERVER_MAX_REQUEST 16777216 // the largest request (in bytes) a server accepts before dropping the connection
+#define SERVER_STATUS_OK 0 // the reply contains the printed result
+#define SERVER_STATUS_ERROR 1 // the reply contains the printed errors
+#define SERVER_IDLE_TIMEOUT 60000 // the milliseconds a connection may wait between requests before it's closed
+#define SERVER_IDLE_GRACE 10 // the milliseconds an idle connection keeps its worker after another connection finds every worker busy
+
+// worker pool defaults
+#define WORKER_COUNT_VARIABLE "TAP_WORKERS" // the environment variable that overrides the number of workers, which is otherwise the number of online processors
+#define WORKER_MAX_THREADS 64 // the most threads the worker pool starts
+#define WORKER_CHUNKS_PER_THREAD 4 // how many chunks parallel array functions split their work into per worker, so idle workers have something to steal
+#define WORKER_INITIAL_DEQUE_SIZE 64 // the number of tasks each worker's deque initially has room for
+#define PARALLEL_MIN_ELEMENTS 64 // arrays smaller than this are always processed by the calling thread
+#define FUTURE_MAX_PENDING 256 // the most spawned expressions that can be queued or running at once; spawn evaluates any more in the calling thread
+#define INITIAL_FUTURE_CAPTURES 8 // the number of variables initially reserved for a spawned expression
+
+// channel defaults
+#define CHANNEL_DEFAULT_CAPACITY 64 // the number of values a channel buffers when no capacity is given
+
+// string defaults
+#define STRING_INLINE_SIZE 16 // strings shorter than this are kept in the same allocation as their string struct
+
+// number defaults
+#define NUMBER_MAX_SIZE 66 // the most bytes a number is printed in, including the terminating null: a sign and 64 binary digits
+
+// substring search defaults
+#define SEARCH_MAX_WORK 4 // the most bytes a search's vector filter may compare per byte it scans before Two-Way takes over
+#define SEARCH_WORK_SLACK 256 // the bytes a search's vector filter may compare before it's held to SEARCH_MAX_WORK
+#define SEARCH_INITIAL_MATCHES 16 // the number of positions initially reserved when finding every match
+
+// matcher defaults
+#define MATCHER_INITIAL_STATES 64 // the number of states initially reserved for a matcher's automaton
+#define MATCHER_INITIAL_MATCHES 16 // the number of occurrences initially reserved when finding every occurrence
+
+// regular expression defaults
+#define REGEX_MAX_INSTRUCTIONS 65536 // the most instructions a compiled regular expression can have, which bounds what counted repetition expands to
+#define REGEX_MAX_REPEAT 1000 // the largest count a counted repetition can have
+#define REGEX_MAX_DEPTH 1000 // the deepest groups and repetitions can be nested, since they're parsed and compiled recursively
+#define REGEX_INITIAL_STATES 16 // the number of automaton states initially reserved for a regular expression
+#define REGEX_MAX_STATES 1024 // the most automaton states a regular expression keeps; once there are more they're all dropped and worked out again as needed
+#define REGEX_MAX_POOL 1048576 // the most instructions the automaton states of a regular expression can have between them before they're dropped
+#define REGEX_ESCAPE_CLASS 256 // what an escape that stands for more than one byte (e.g. \d) is parsed as
+
+// format defaults
+#define FORMAT_MAX_ARG 4095 // the highest argument number a field can name
+#define FORMAT_MAX_WIDTH 65536 // the widest a field can be padded to
+#define FORMAT_MAX_PRECISION 64 // the most digits a float can be written with after its point
+#define FORMAT_STACK_FIELDS 32 // the number of fields a format fills in without allocating room to keep track of them
+#define FORMAT_SCRATCH_SIZE 1024 // the bytes of number text a format writes out without allocating room for it
+
+// string builder defaults
+#define BUILDER_MIN_PIECE 256 // the fewest bytes a string builder reserves for a new piece, so that short appends share pieces
+#define BUILDER_MAX_PIECE 1048576 // the most bytes a string builder reserves for a piece beyond what the appended string needs
+#define BUILDER_INITIAL_PIECES 8 // the number of pieces a string builder initially has room for
+
+// scheduler defaults
+#define TASK_STACK_SIZE 524288 // the bytes of stack each green task evaluates on, not counting the guard page below it
+#define TASK_STACK_MARGIN 65536 // the bytes of a task's stack a function call must leave free, so that deep recursion is reported rather than overflowing
+#define TASK_DEFAULT_QUANTUM 1000 // the number of safe points (function calls and loop iterations) a task passes before it gives way to the other tasks of its thread
+#define TASK_RUNNING 0 // the task hasn't finished yet
+#define TASK_YIELDED 1 // the task used up its quantum and goes to the back of the queue
+#define TASK_PARKED 2 // the task is waiting for something another thread will wake it for
+#define TASK_FINISHED 3 // the task's result is ready
+
+// snapshot defaults
+#define SNAPSHOT_MAGIC "TAPSNAP" // the first bytes of every snapshot (including the terminating null)
+#define SNAPSHOT_VERSION 6 // incremented whenever the snapshot layout changes
+#define SNAPSHOT_BYTE_ORDER 0x01020304u // written natively so that snapshots made on a machine with another byte order are rejected
+#define SNAPSHOT_INITIAL_SIZE 65536 // the number of bytes initially reserved for a snapshot being written
+
+// package defaults
+#define PACKAGE_PATH_VARIABLE "TAP_PATH" // the environment variable listing the directories import searches, separated by colons
+#define PACKAGE_DEFAULT_PATH "packages" // the directory import searches if the variable isn't set
+#define PACKAGE_EXTENSION ".tap"
+#define INITIAL_PACKAGE_DEF_COUNT 64 // the number of top-level expressions initially reserved for a package being indexed
+#define INITIAL_PACKAGE_INDEX_SIZE 257
+
 // indicates a potentially infinite number of arguments (for primitive functions)
 #define ARGLEN_INF -1
 // 'more arguments' indicator (for user functions)
@@ -95,6 +217,8 @@
 #define EXIT_SUCCESS 0
 #define EXIT_NO_ARGS 1
 #define EXIT_OUT_OF_MEMORY 2
+#define EXIT_NO_SERVER 3
+#define EXIT_NO_SNAPSHOT 4
 
 #endif
 
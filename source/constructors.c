@@ -14,8 +14,15 @@
 #include "strings.h"
 #include "arrays.h"
 #include "dates.h"
-
-static expression* copyExpression_(expression*, int);
+#include "memo.h"
+#include "channels.h"
+#include "builders.h"
+#include "matchers.h"
+#include "regexes.h"
+#include "formats.h"
+
+static expression* copyExpression_(expression*, int, int);
+static tap_fun* copyTapFunction_(tap_fun*, int);
 static array* copyArray_(array*, int);
 
 /*! Creates a new expression struct with the default properties (i.e. a nil expression)
@@ -47,7 +54,7 @@ inline expression* newExpressionOfType (datatype type) {
 			ev.floval = 0;
 			break;
 		case TYPE_STR:
-			ev.strval = newString(strDup(""));
+			ev.strval = newStringOfSize(0);
 			break;
 		case TYPE_ARR:
 			ev.arrval = newArray(0);
@@ -64,6 +71,21 @@ inline expression* newExpressionOfType (datatype type) {
 		case TYPE_TYP:
 			ev.intval = TYPE_UNK;
 			break;
+		case TYPE_CHN:
+			ev.chnval = newChannel(CHANNEL_DEFAULT_CAPACITY);
+			break;
+		case TYPE_BLD:
+			ev.bldval = newBuilder();
+			break;
+		case TYPE_MAT:
+			ev.matval = newMatcher(NULL, 0);
+			break;
+		case TYPE_REG:
+			ev.regval = newRegex("", 0, NULL);
+			break;
+		case TYPE_FMT:
+			ev.fmtval = newFormat("", 0, NULL);
+			break;
 	}
     return newExpressionAll(type, &ev, NULL, 0); // set the value to null until a real value is given and set the next expression to null
 }
@@ -154,7 +176,7 @@ inline expression* newExpressionTyp (datatype value) {
     @return         the new expression struct
 */
 expression* newExpressionAll (datatype type, exprvals* ev, expression* next, linenum line) {
-    expression* expr = allocate(sizeof(expression)); // allocate the needed memory
+    expression* expr = allocateExpression(); // allocate the needed memory
     expr->type = type; // set the type to the given type
     if (ev == NULL) { // initialize the expression's value to NIL if one isn't given
     	expr->ev.intval = NIL;
@@ -173,7 +195,7 @@ expression* newExpressionAll (datatype type, exprvals* ev, expression* next, lin
 	@return			the new, duplicate expressions
 */
 inline expression* copyExpression (expression* expr) {
-	return copyExpression_(expr, 1);
+	return copyExpression_(expr, 1, 1);
 }
 
 /* Copies the given expression
@@ -181,21 +203,38 @@ inline expression* copyExpression (expression* expr) {
 	@return			the new, duplicate expression
 */
 inline expression* copyExpressionNR (expression* expr) {
-	return copyExpression_(expr, 0);
+	return copyExpression_(expr, 0, 1);
+}
+
+/* Copies the given list of expressions without sharing any lazy expressions or memo caches with the original, so the copy can be used by another thread
+	@param expr		the expressions to copy
+	@return			the new, duplicate expressions
+*/
+expression* copyExpressionUnshared (expression* expr) {
+	return copyExpression_(expr, 1, 0);
+}
+
+/* Copies the given expression without sharing any lazy expressions or memo caches with the original, so the copy can be used by another thread
+	@param expr		the expression to copy
+	@return			the new, duplicate expression
+*/
+expression* copyExpressionUnsharedNR (expression* expr) {
+	return copyExpression_(expr, 0, 0);
 }
 
 /*! Copies the given expression or list of expressions, depending on the next flag
     @param expr     the expression(s) to copy
     @param next		whether or not to copy the next expression in the list
+    @param shared   whether or not the copy shares lazy expressions with the original
     @return         the new, duplicate expression(s)
 */
-static expression* copyExpression_ (expression* expr, int next) {
+static expression* copyExpression_ (expression* expr, int next, int shared) {
     if (expr == NULL) { // if the expression is null then just return null
         return NULL;
     } else {
     	expression* nextexpr;
     	if (next) {
-    		nextexpr = copyExpression(expr->next);
+    		nextexpr = copyExpression_(expr->next, 1, shared);
     	} else {
     		nextexpr = NULL;
     	}
@@ -210,12 +249,26 @@ static expression* copyExpression_ (expression* expr, int next) {
             case TYPE_ARR:
                 ev1->arrval = newArray(ev2->arrval->size);
                 for (i = 0; i < ev1->arrval->size; ++i) { // copy each of the array's elements
-                    ev1->arrval->content[i] = copyExpression(ev2->arrval->content[i]);
+                    ev1->arrval->content[i] = copyExpression_(ev2->arrval->content[i], 1, shared);
                 }
                 break;
             case TYPE_FUN:
-                // copy the function's properties, arguments, and body
-                ev1->funval = newTapFunction(ev2->funval->args, ev2->funval->minargs, ev2->funval->maxargs, copyExpression(ev2->funval->body));
+                ev1->funval = copyTapFunction_(ev2->funval, shared); // copy the function's properties, arguments, and body
+                break;
+            case TYPE_CHN: // every copy refers to the same channel, even in another context, since that's how contexts talk to each other
+                ev1->chnval = shareChannel(ev2->chnval);
+                break;
+            case TYPE_BLD: // copies in the same context append to the same string, like properties of an object
+                ev1->bldval = shared ? shareBuilder(ev2->bldval) : copyBuilder(ev2->bldval);
+                break;
+            case TYPE_MAT: // a matcher never changes, so every copy, even in another context, refers to the same one
+                ev1->matval = shareMatcher(ev2->matval);
+                break;
+            case TYPE_REG: // nor does a regular expression, whose automaton is only ever used by one thread at a time
+                ev1->regval = shareRegex(ev2->regval);
+                break;
+            case TYPE_FMT: // nor does a format
+                ev1->fmtval = shareFormat(ev2->fmtval);
                 break;
             default: // if the original expression value is a primitive then copy it to the new expression value
                 ev1->intval = ev2->intval;
@@ -225,26 +278,13 @@ static expression* copyExpression_ (expression* expr, int next) {
         duplicate->isref = expr->isref;
         duplicate->refs = expr->refs;
         if (expr->type == TYPE_EXP) { // copy the child expressions if the expression is a container expression
-            ev1->expval = copyExpression(ev2->expval);
-        } else if (expr->type == TYPE_LAZ) { // copy the lazy expression content if the expression is lazy
-            tap_laz* lazy = newLazyExpression();
-            lazy->expval = copyExpression(ev2->lazval->expval);
-            exprstack* es2 = ev2->lazval->refs;
-            if (es2 == NULL) {
-                lazy->refs = NULL;
-            } else {
-                lazy->refs = allocate(sizeof(exprstack));
-                exprstack* es1 = lazy->refs;
-                while (es2 != NULL) {
-                    es1->expr = es2->expr;
-                    if (es2->next != NULL) {
-                        es1->next = allocate(sizeof(exprstack));
-                        es1 = es1->next;
-                    }
-                    es2 = es2->next;
-                }
-            }
-            ev1->lazval = lazy;
+            ev1->expval = copyExpression_(ev2->expval, 1, shared);
+        } else if (expr->type == TYPE_LAZ && shared) { // share the lazy expression so that forcing any copy caches the result for all of them
+            ev1->lazval = ev2->lazval;
+            ++ev1->lazval->owners;
+        } else if (expr->type == TYPE_LAZ) {
+            ev1->lazval = newLazyExpression();
+            ev1->lazval->expval = copyExpression_(ev2->lazval->expval, 1, 0);
         }
         return duplicate;
     }
@@ -258,6 +298,34 @@ tap_laz* newLazyExpression () {
     tap_laz* le = allocate(sizeof(tap_laz)); // allocate the needed memory
     le->expval = NULL;
     le->refs = NULL;
+    le->value = NULL; // the lazy expression hasn't been forced yet
+    le->owners = 1;
+    le->future = NULL;
+    return le;
+}
+
+/*! Copies the given lazy expression into a new, unforced lazy expression that doesn't share its cached result
+    @param lazy     the lazy expression to copy
+    @return         the new lazy expression
+*/
+tap_laz* copyLazyExpression (tap_laz* lazy) {
+    tap_laz* le = newLazyExpression();
+    le->expval = copyExpression(lazy->expval);
+    exprstack* es2 = lazy->refs;
+    if (es2 != NULL) {
+        le->refs = allocate(sizeof(exprstack));
+        exprstack* es1 = le->refs;
+        while (es2 != NULL) {
+            es1->expr = es2->expr;
+            if (es2->next != NULL) {
+                es1->next = allocate(sizeof(exprstack));
+                es1 = es1->next;
+            } else {
+                es1->next = NULL;
+            }
+            es2 = es2->next;
+        }
+    }
     return le;
 }
 
@@ -269,9 +337,62 @@ string* newString (char* content) {
     string* str = allocate(sizeof(string)); // allocate the needed memory
     str->content = content;
     str->size = strlen(content); // store the length of the string
+    str->owners = 1;
+    str->parent = NULL;
+    return str;
+}
+
+/*! Creates a new string struct with room for a string of the given size; a short string is kept in the same allocation as the struct
+    @param size     the size of the string (minus the null terminator)
+    @return         the new string struct, whose content is null terminated but otherwise left for the caller to fill in
+*/
+string* newStringOfSize (int size) {
+    string* str;
+    if (size < STRING_INLINE_SIZE) { // if the string is short then store it right after the struct
+        str = allocate(sizeof(string) + size + 1);
+        str->content = str->text;
+    } else {
+        str = allocate(sizeof(string));
+        str->content = allocate(size + 1);
+    }
+    str->content[size] = '\0';
+    str->size = size;
+    str->owners = 1;
+    str->parent = NULL;
     return str;
 }
 
+/*! Creates a new string struct with a copy of the given text
+    @param content  the text to copy, which may contain null characters
+    @param size     the number of characters of the text to copy
+    @return         the new string struct
+*/
+string* newStringCopy (char* content, int size) {
+    string* str = newStringOfSize(size);
+    memcpy(str->content, content, size);
+    return str;
+}
+
+/*! Creates a new string struct for the given range of the given string that shares its content rather than copying it; a short range is copied instead
+    @param str      the string to take the range of
+    @param start    the index of the range's first character
+    @param size     the number of characters in the range, which must all be in the string
+    @return         the new string struct, whose content (unless it was copied) must not be written to and isn't null terminated unless the range reaches the end of the string
+*/
+string* newStringSlice (string* str, int start, int size) {
+    if (size < STRING_INLINE_SIZE) { // a short string costs no more to copy than to share
+        return newStringCopy(str->content + start, size);
+    }
+    string* parent = str->parent != NULL ? str->parent : str; // slices always refer to the string that has the content so that they never chain
+    __atomic_add_fetch(&parent->owners, 1, __ATOMIC_RELAXED);
+    string* slice = allocate(sizeof(string));
+    slice->content = str->content + start;
+    slice->size = size;
+    slice->owners = 1;
+    slice->parent = parent;
+    return slice;
+}
+
 /*! Creates a new array struct with the given size
     @param size     the number of elements that initially can be stored in the array
     @return         the new array struct
@@ -328,7 +449,7 @@ static array* copyArray_ (array* arr, int deep) {
     @return         the new date or NIL if the date parsing failed
 */
 date newDate (string* str) {
-	char* sdate = str->content;
+	char* sdate = stringContent(str);
     if (strcmp(sdate, "now") == 0) {
         return time(NULL);
     } else {
@@ -614,6 +735,7 @@ tap_fun* newTapFunction (argument* args[], int minargs, int maxargs, expression*
     }
     tap_fun* fun = allocate(sizeof(tap_fun) + sizeof(argument*) * numargs); // allocate the needed memory
     fun->body = body; // set the function's body to the given body
+    fun->memo = NULL; // functions aren't memoized until explicitly requested
     fun->minargs = minargs;
     fun->maxargs = maxargs;
     int i;
@@ -628,6 +750,15 @@ tap_fun* newTapFunction (argument* args[], int minargs, int maxargs, expression*
     @return     	the new tap function
 */
 tap_fun* copyTapFunction (tap_fun* fun) {
+    return copyTapFunction_(fun, 1);
+}
+
+/*! Copies the given user function
+    @param fun      the function to copy
+    @param shared   whether or not the copy shares lazy expressions and the memo cache with the original
+    @return         the new user function
+*/
+static tap_fun* copyTapFunction_ (tap_fun* fun, int shared) {
     if (fun == NULL) {
         return NULL;
     } else {
@@ -640,9 +771,18 @@ tap_fun* copyTapFunction (tap_fun* fun) {
         argument** args = allocate(sizeof(argument*) * numargs);
         int i;
         for (i = 0; i < numargs; ++i) {
-            args[i] = copyArgument(fun->args[i]);
+            if (shared || fun->args[i] == NULL) {
+                args[i] = copyArgument(fun->args[i]);
+            } else {
+                args[i] = newArgument(copyString(fun->args[i]->name), copyTypelistDeep(fun->args[i]->types), copyExpression_(fun->args[i]->initial, 1, 0));
+            }
+        }
+        tap_fun* newfun = newTapFunction(args, fun->minargs, fun->maxargs, copyExpression_(fun->body, 1, shared));
+        free(args); // the argument pointers now live in the new function
+        if (shared) {
+            newfun->memo = shareMemo(fun->memo); // copies of a memoized function share the same result cache
         }
-        return newTapFunction(args, fun->minargs, fun->maxargs, copyExpression(fun->body));
+        return newfun;
     }
 }
 
@@ -744,15 +884,60 @@ inline exprstack* newExprstack (exprstack* current) {
     return es;
 }
 
-/*! Creates a function structure, which contains a reference to the primitive function and its return type
+/*! Creates a function structure, which contains a reference to the primitive function and its return type; the built-in primitives are static (see builtins.c) so this is only needed for primitives added at runtime
+    @param types    the type of each argument position, which is converted to type masks and freed
     @return     the new function structure
 */
 tap_prim_fun* newPrimFunction (void(*address)(expression*[], int, exprvals*, datatype*), int minargs, int maxargs, typelist* types) {
     tap_prim_fun* func = allocate(sizeof(tap_prim_fun));
+    func->name = NULL;
     func->address = address;
     func->minargs = minargs;
     func->maxargs = maxargs;
-    func->types = types;
+    int i;
+    for (i = 0; i < PRIM_MAX_ARGTYPES; ++i) {
+        func->types[i] = types != NULL ? TYPE_MASK(types->type) : 0;
+        if (types != NULL) {
+            typelist* next = types->next;
+            free(types);
+            types = next;
+        }
+    }
+    freeTypelist(types); // any positions past the ones a signature can hold
+    func->kernel = KERNEL_NONE;
+    return func;
+}
+
+/*! Gives the given primitive function a fast-call kernel that takes integer operands and returns an integer
+    @param func     the primitive function
+    @param kernel   the kernel to call when every argument is an integer
+    @return         the primitive function
+*/
+tap_prim_fun* setIntKernel (tap_prim_fun* func, tap_int(*kernel)(tap_int[], int)) {
+    func->kernel = KERNEL_INT;
+    func->fast.ints = kernel;
+    return func;
+}
+
+/*! Gives the given primitive function a fast-call kernel that takes float operands and returns a float
+    @param func     the primitive function
+    @param kernel   the kernel to call when every argument is a float
+    @return         the primitive function
+*/
+tap_prim_fun* setFloKernel (tap_prim_fun* func, tap_flo(*kernel)(tap_flo[], int)) {
+    func->kernel = KERNEL_FLO;
+    func->fast.flos = kernel;
+    return func;
+}
+
+/*! Gives the given primitive function a fast-call kernel that takes float operands and returns an integer
+    @param func     the primitive function
+    @param kernel   the kernel to call when every argument is a float
+    @return         the primitive function
+*/
+tap_prim_fun* setFloTestKernel (tap_prim_fun* func, tap_int(*kernel)(tap_flo[], int)) {
+    func->kernel = KERNEL_FLO_INT;
+    func->fast.flotests = kernel;
     return func;
 }
 
@@ -765,9 +950,32 @@ inline environment* newEnvironment (hashtable* variables, int parent) {
     env->types = NULL;
     env->numvars = 0;
     env->parent = parent;
+    env->loop = 0;
     return env;
 }
 
+/*! Creates an interpreter context, which holds all of the state needed to interpret code independently of any other context
+    @return         the new context, whose root environment starts out empty since the built-ins are static (see builtins.c)
+*/
+tap_context* newContext () {
+    tap_context* context = allocate(sizeof(tap_context));
+    context->environments = allocate(sizeof(environment*) * INITIAL_ENV_COUNT);
+    context->numenvironments = INITIAL_ENV_COUNT;
+    context->environments[0] = newEnvironment(newHashtable(INITIAL_ROOT_ENV_SIZE), -1);
+    int i;
+    for (i = 1; i < INITIAL_ENV_COUNT; ++i) { // for each environment
+        context->environments[i] = newEnvironment(newHashtable(INITIAL_ENV_SIZE), -1); // initialize the environment and set its parent to -1, indicating no parent
+    }
+    context->cenvironment = 0; // set the current environment to 0, the top-most environment
+    context->ctypeid = TYPE_COMP_START; // the first ID composite types can be assigned to
+    context->errors = NULL;
+    context->cerror = NULL;
+    context->imports = NULL;
+    context->rebinds = 0;
+    context->watchenv = -1; // no loop is running yet
+    return context;
+}
+
 /*! Creates a string list structure
     @param str      the string to be stored
     @param next     the next string in the list
@@ -24,8 +24,14 @@ expression* newExpressionTyp(datatype);
 expression* newExpressionAll(datatype, exprvals*, expression*, linenum);
 expression* copyExpression(expression*);
 expression* copyExpressionNR(expression*);
+expression* copyExpressionUnshared(expression*);
+expression* copyExpressionUnsharedNR(expression*);
 tap_laz* newLazyExpression();
+tap_laz* copyLazyExpression(tap_laz*);
 string* newString(char*);
+string* newStringOfSize(int);
+string* newStringCopy(char*, int);
+string* newStringSlice(string*, int, int);
 array* newArray(int);
 array* copyArray(array*);
 array* copyArrayDeep(array*);
@@ -46,9 +52,13 @@ typelist* copyTypelistDeep(typelist*);
 typedefs* newTypedefs(type*);
 exprstack* newExprstack(exprstack*);
 tap_prim_fun* newPrimFunction(void(*address)(expression*[], int, exprvals*, datatype*), int, int, typelist*);
+tap_prim_fun* setIntKernel(tap_prim_fun*, tap_int(*)(tap_int[], int));
+tap_prim_fun* setFloKernel(tap_prim_fun*, tap_flo(*)(tap_flo[], int));
+tap_prim_fun* setFloTestKernel(tap_prim_fun*, tap_int(*)(tap_flo[], int));
 environment* newEnvironment(hashtable*, int);
 stringlist* newStringlist(string*, stringlist*);
 errorlist* newErrorlist(uint, string*, linenum, uint);
+tap_context* newContext();
 
 #endif
 
@@ -12,7 +12,8 @@
 #include "constants.h"
 #include "memory.h"
 
-extern int monthdays[];
+/* the number of days elapsed in a (non-leap) year by the end of each month; this never changes so every context shares it */
+const int monthdays[MON_IN_YEAR] = {31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334, 365};
 
 /*! Prints the given date according to the given format
     @param dat      the date (UNIX timestamp) to print
@@ -48,7 +48,7 @@ static void printExprTree_ (expression* expr, int level) {
                     printf("%f", expr->ev.floval);
                     break;
                 case TYPE_STR:
-                    printf("%s", expr->ev.strval->content);
+                    printf("%.*s", expr->ev.strval->size, expr->ev.strval->content);
                     break;
             }
             if (expr->flag != EFLAG_NONE) {
@@ -90,7 +90,7 @@ static void printExprList_ (expression* expr, int parent, int* id) {
             printf("[#%d->%d: %d, NIL], ", parent, *id, expr->type);
         } else if (expr->type == TYPE_STR) {
             // print the expression's parent, id, type, and content
-            printf("[#%d->%d: %d, %s], ", parent, *id, expr->type, expr->ev.strval->content);
+            printf("[#%d->%d: %d, %.*s], ", parent, *id, expr->type, expr->ev.strval->size, expr->ev.strval->content);
         } else {
             // print the expression's parent, id, type, and content
             printf("[#%d->%d: %d], ", parent, *id, expr->type);
@@ -139,7 +139,7 @@ static void printExprListFlags_ (expression* expr, int parent, int* id) {
             printf("[#%d->%d: %d, NIL], ", parent, *id, expr->type);
         } else if (expr->type == TYPE_STR) {
             // print the expression's parent, id, type, content, and flag
-            printf("[#%d->%d: %d, %s; %d], ", parent, *id, expr->type, expr->ev.strval->content, expr->flag);
+            printf("[#%d->%d: %d, %.*s; %d], ", parent, *id, expr->type, expr->ev.strval->size, expr->ev.strval->content, expr->flag);
         } else {
             // print the expression's parent, id, type, content, and flag
             printf("[#%d->%d: %d; %d], ", parent, *id, expr->type, expr->flag);
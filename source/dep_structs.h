@@ -9,6 +9,7 @@
 #define DEP_STRUCTS_H
 
 #include "hashtable.h"
+#include "constants.h"
 
 typedef struct environment_ environment;
 
@@ -17,6 +18,46 @@ struct environment_ {
     typedefs* types;
     int numvars;
     int parent;
+    int loop; // whether the environment belongs to a loop, whose body sets anything but the loop's own variables in the caller's environment
+};
+
+typedef struct packagedef_ packagedef;
+typedef struct tap_package_ tap_package;
+typedef struct importlist_ importlist;
+
+struct packagedef_ {
+    char* name; // the name the definition sets (null for top-level expressions that aren't definitions)
+    uint start; // where the definition's text starts in the package
+    uint end; // where the definition's text ends (exclusive)
+    int next; // the index of the package's next definition with the same name (-1 if there isn't one)
+    expression* parsed; // the parsed definition, shared by every context in the process (null until the definition is first needed)
+};
+
+struct tap_package_ {
+    char* path; // the canonical path of the package file
+    char* text; // the package's text, which the definitions are parsed from when they are first needed
+    packagedef* defs;
+    int numdefs;
+    hashtable* index; // the first definition of each name
+    tap_package* next;
+};
+
+struct importlist_ {
+    tap_package* package;
+    char* defined; // a flag for each of the package's definitions, set once it has been evaluated in the context
+    importlist* next;
+};
+
+struct tap_context_ {
+    environment** environments; // the stack of environments, which grows as calls nest deeper
+    uint numenvironments; // the number of environments allocated for the stack
+    uint cenvironment; // the index of the current environment
+    datatype ctypeid; // the next ID a composite type can be assigned
+    errorlist* errors; // the head of the list of errors generated thus far
+    errorlist* cerror; // the tail of the list of errors
+    importlist* imports; // the packages imported into the context, whose definitions are evaluated when they are first referenced
+    uint rebinds; // the number of names bound anew in a watched environment, which tells running loops their plans are stale
+    int watchenv; // the innermost environment a running loop resolves names from, at or below which new names are counted (-1 if no loop is running)
 };
 
 #endif
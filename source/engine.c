@@ -19,6 +19,17 @@
 #include "memory.h"
 #include "strings.h"
 #include "dates.h"
+#include "casting.h"
+#include "numbers.h"
+#include "memo.h"
+#include "builtins.h"
+#include "packages.h"
+#include "workers.h"
+#include "builders.h"
+#include "matchers.h"
+#include "regexes.h"
+#include "formats.h"
+#include "scheduler.h"
 #include "../primitives/prim_nil.h"
 #include "../primitives/prim_exp.h"
 #include "../primitives/prim_laz.h"
@@ -32,13 +43,7 @@
 #include "../primitives/prim_typ.h"
 #include "debug.h"
 
-extern environment* environments[];
-extern uint cenvironment;
-extern expression* cfunction;
-extern expression* cobject;
-extern datatype ctypeid;
-extern errorlist* errors;
-extern errorlist* cerror;
+__thread tap_context* ccontext = NULL; // each thread interprets code in its own context
 
 static expression* parse_(char*, uint, linenum);
 
@@ -290,13 +295,13 @@ expression* parsePiece (char* text, expression** tail, linenum startline, uint s
                     expr->type = TYPE_FLO;
                     break;
                 }
-                // if the expression is currently assumed to be an integer, mark it as needing a base conversion by storing the index of the colon
+                // if the expression is currently assumed to be an integer, mark it as needing a base conversion (the colon is found again when it's stored)
                 if (text[i] == ':') {
                     if (expr->type == TYPE_NIL) {
                         expr->type = TYPE_STR;
                         expr->flag = EFLAG_VAR;
                     } else if (expr->type == TYPE_INT || expr->type == TYPE_FLO) {
-                        expr->flag = i;
+                        expr->flag = EFLAG_CONVBASE;
                     }
                     break;
                 }
@@ -469,6 +474,47 @@ expression* evaluateLaz (expression* head) {
     }
 }
 
+/*! Evaluates each expression in the given lazy expression's body in the current environment, without pushing a new one, and returns the last result
+    @param head     the lazy expression whose body is evaluated
+    @return         the expression representing the result of the evaluation
+*/
+expression* evaluateBody (expression* head) {
+    expression* expr = head->ev.lazval->expval;
+    expression* result = NULL;
+    while (expr != NULL) {
+        freeExpr(result);
+        result = evaluateArgument(expr); // variables set by the body stay in the current environment
+        expr = expr->next;
+    }
+    if (result == NULL) { // an empty body evaluates to nil
+        result = newExpressionNil();
+    }
+    return result;
+}
+
+/*! Forces the given lazy expression, evaluating it the first time and returning a copy of its cached result every time after
+    @param head     the expression to be forced
+    @return         the expression representing the result of the evaluation
+*/
+expression* forceLaz (expression* head) {
+    if (head->type == TYPE_LAZ) { // if the expression is a lazy expression
+        tap_laz* lazy = head->ev.lazval;
+        if (lazy->future != NULL) { // if the lazy expression was spawned then its result comes from the worker pool
+            awaitFuture(lazy);
+        }
+        if (lazy->value != NULL) { // if the lazy expression was already forced then reuse its result
+            return copyExpressionNR(lazy->value);
+        }
+        expression* result = evaluateLaz(head);
+        if (result != NULL) {
+            lazy->value = copyExpressionNR(result); // cache the result for the next time the expression is forced
+        }
+        return result;
+    } else { // if the expression isn't a lazy expression then just evaluate it
+        return evaluate(head);
+    }
+}
+
 /* Evaluates the given integer expression and returns the result
 	@param head	the expression to be evaluated
 	@return		the expression representing the result of the evaluation
@@ -490,6 +536,10 @@ expression* evaluateFlo (expression* head) {
 	@return		the expression representing the result of the evaluation
 */
 expression* evaluateFun (expression* head) {
+	int form = specialForm(head);
+	if (form != SFORM_NONE) { // if the function is a special form then only the arguments it needs are evaluated
+		return evaluateSpecialForm(form, head);
+	}
 	int numargs = numArgs(head);
 	expression* args[numargs];
 	fillArgs(head, args, numargs);
@@ -499,6 +549,107 @@ expression* evaluateFun (expression* head) {
     return result;
 }
 
+/* Returns which special form the given expression head names, if any; a user variable with the same name takes precedence
+	@param head	the expression containing the function name
+	@return		the SFORM_ constant of the special form or SFORM_NONE
+*/
+int specialForm (expression* head) {
+	if (head->type != TYPE_STR) {
+		return SFORM_NONE;
+	}
+	char* name = head->ev.strval->content;
+	if (name[0] != 'i' && name[0] != '&' && name[0] != '|') { // most calls are ruled out by their first character
+		return SFORM_NONE;
+	}
+	int form;
+	if (strcmp(name, "if") == 0) {
+		form = SFORM_IF;
+	} else if (strcmp(name, "&&") == 0) {
+		form = SFORM_AND;
+	} else if (strcmp(name, "||") == 0) {
+		form = SFORM_OR;
+	} else {
+		return SFORM_NONE;
+	}
+	int cenv = ccontext->cenvironment;
+	while (cenv >= 0) { // search every environment down to the root one, which holds the definitions of imported packages
+		if (ccontext->environments[cenv]->numvars > 0 && lookupHash(ccontext->environments[cenv]->variables, name) != NULL) {
+			return SFORM_NONE;
+		}
+		cenv = ccontext->environments[cenv]->parent;
+	}
+	return importsDefine(name) ? SFORM_NONE : form; // a definition that hasn't been imported yet takes precedence too
+}
+
+/* Evaluates the given special form, evaluating each argument only when it's needed
+	@param form	the SFORM_ constant of the special form
+	@param head	the expression containing the special form and its arguments
+	@return		the expression representing the result of the evaluation
+*/
+expression* evaluateSpecialForm (int form, expression* head) {
+	expression* arg = head->next;
+	int minargs = form == SFORM_IF ? 2 : 1;
+	if (numArgs(head) < minargs) {
+		addError(newErrorlist(ERR_INVALID_NUM_ARGS, copyString(head->ev.strval), head->line, 0));
+		return newExpressionNil();
+	}
+	if (form == SFORM_IF) {
+		while (arg != NULL) {
+			if (arg->next == NULL) { // if only the else branch is left
+				return evaluateBranch(arg);
+			}
+			if (evaluateCondition(arg)) {
+				return evaluateBranch(arg->next);
+			}
+			arg = arg->next->next;
+		}
+		return newExpressionNil();
+	} else {
+		int stopon = form == SFORM_OR; // && stops at the first false argument and || at the first true one
+		while (arg != NULL) {
+			if (evaluateCondition(arg) == stopon) {
+				return newExpressionInt(stopon);
+			}
+			arg = arg->next;
+		}
+		return newExpressionInt(!stopon);
+	}
+}
+
+/* Evaluates the given special form argument as a boolean, forcing it if it's lazy
+	@param arg	the argument to evaluate
+	@return		1 if the argument is true, 0 otherwise
+*/
+int evaluateCondition (expression* arg) {
+	expression* value = evaluateBranch(arg);
+	int result = castToInt(value) != 0;
+	freeExpr(value);
+	return result;
+}
+
+/* Evaluates the given special form argument, forcing it if it's lazy; a lazy literal's body is evaluated in place rather than copied first
+	@param arg	the argument to evaluate
+	@return		the expression representing the result of the evaluation
+*/
+expression* evaluateBranch (expression* arg) {
+	expression* result;
+	if (arg->type == TYPE_LAZ) { // if the argument is a lazy literal then evaluate its body directly, so a variable in it gives its value
+		result = evaluateBody(arg);
+	} else {
+		expression* value = evaluateArgument(arg);
+		if (value->type == TYPE_LAZ) { // if the argument evaluated to a lazy value then force it
+			result = forceLaz(value);
+			freeExpr(value);
+		} else {
+			result = value;
+		}
+	}
+	if (result == NULL) { // an empty lazy expression evaluates to nil
+		result = newExpressionNil();
+	}
+	return result;
+}
+
 /* Returns the number of expression arguments in the given list
 	@param head	the list of expressions to count
 	@return		the number of arguments found
@@ -550,79 +701,55 @@ int freeArgs (expression* args[], int numargs) {
 	@return			the tap_fun_search data associated with the found function
 */
 tap_fun_search findFunction (expression* head, expression* args[], int numargs) {
-	int cenv = cenvironment;
     int found = head->type == TYPE_FUN;
-    tap_prim_fun* prim_fun = NULL;
+	int cenv = found ? -1 : ccontext->cenvironment; // unnamed functions don't need to be looked up
+    const tap_prim_fun* prim_fun = NULL;
     tap_fun* fun = NULL;
+    int prim = 0;
+    char* name = found ? NULL : head->ev.strval->content;
     while (!found && cenv >= 0) {
-        hashlist* hl1 = lookupHashes(environments[cenv]->variables, head->ev.strval->content);
-        hashlist* hl2 = hl1;
+        hashelement* hl1 = ccontext->environments[cenv]->numvars > 0 ? lookupHashList(ccontext->environments[cenv]->variables, name) : NULL; // walk the table's list directly rather than copying the matches, and don't hash the name for an empty table
         while (hl1 != NULL) {
-            typelist* types;
-            int minargs;
-            if (cenv == 0) { // if the current environment is the root one containing primitive functions
+            if (strcmp(name, hl1->key) != 0) { // skip other keys with the same hashsum
+                hl1 = hl1->next;
+                continue;
+            }
+            prim = hl1->flag == HFLAG_PRIM; // primitives added at runtime live in the environments alongside the variables
+            if (prim) {
                 prim_fun = hl1->value;
-                if (prim_fun->minargs > numargs || (prim_fun->maxargs != ARGLEN_INF && prim_fun->maxargs < numargs)) {
-                    hl1 = hl1->next;
-                    continue;
-                }
-                types = prim_fun->types;
-                minargs = prim_fun->minargs;
+                found = primitiveAccepts(prim_fun, args, numargs);
             } else {
                 expression* expr = (expression*)(hl1->value);
                 if (expr->type == TYPE_FUN) {
                     fun = expr->ev.funval;
-                    if (fun->minargs > numargs || (fun->maxargs != ARGLEN_INF && fun->maxargs < numargs)) {
-                        hl1 = hl1->next;
-                        continue;
-                    }
-                    types = NULL;
-                    minargs = fun->minargs;
-                } else {
-                    continue;
+                    found = validFunTypes(fun, args, numargs);
                 }
             }
-            int validtypes = 1;
-            int i;
-            for (i = 0; i < minargs; ++i) {
-                if (cenv == 0) {
-                    if (i > 0) {
-                        types = types->next;
-                    }
-                } else {
-                    types = fun->args[i]->types;
-                }
-                int validtype = 0;
-                while (types != NULL) {
-                    if (types->type == TYPE_UNK || args[i]->type == types->type) { // if an argument's type doesn't match the function's requirements
-                        validtype = 1;
-                        break;
-                    }
-                    types = types->next;
-                }
-                if (!validtype) {
-                    validtypes = 0;
-                    break;
-                }
-            }
-            if (validtypes) {
-                found = 1;
+            if (found) {
                 break;
             }
             hl1 = hl1->next;
         }
-        while (hl2 != NULL) {
-            hl1 = hl2->next;
-            free(hl2);
-            hl2 = hl1;
+        cenv = ccontext->environments[cenv]->parent; // since no function was found, try searching in the parent environment
+        if (cenv < 0 && !found && name != NULL && defineImported(name)) { // search again once the imported packages have defined the name
+            cenv = ccontext->cenvironment;
+        }
+    }
+    if (!found && name != NULL) { // fall back to the built-in primitives
+        int count, i;
+        const tap_prim_fun* const* prims = lookupPrimitives(name, &count);
+        for (i = 0; i < count; ++i) {
+            if (primitiveAccepts(prims[i], args, numargs)) {
+                prim_fun = prims[i];
+                prim = found = 1;
+                break;
+            }
         }
-        cenv = environments[cenv]->parent; // since no function was found, try searching in the parent environment
     }
     tap_fun_search tfs;
     tfs.found = found;
-    int prim = prim_fun != NULL;
-    tfs.prim = prim;
-    if (prim) {
+    tfs.prim = found && prim;
+    if (tfs.prim) {
     	tfs.funs.prim_fun = prim_fun;
     } else {
     	tfs.funs.tap_fun = fun;
@@ -630,6 +757,33 @@ tap_fun_search findFunction (expression* head, expression* args[], int numargs)
     return tfs;
 }
 
+/* Returns whether or not the given arguments suit the given tap function's signature
+	@param fun		the function whose signature to check
+	@param args		the array of arguments
+	@param numargs	the number of arguments in the array
+	@return			1 if the function accepts the arguments, 0 otherwise
+*/
+int validFunTypes (tap_fun* fun, expression* args[], int numargs) {
+    if (fun->minargs > numargs || (fun->maxargs != ARGLEN_INF && fun->maxargs < numargs)) {
+        return 0;
+    }
+    int i;
+    for (i = 0; i < fun->minargs; ++i) {
+        typelist* types;
+        int validtype = 0;
+        for (types = fun->args[i]->types; types != NULL; types = types->next) {
+            if (types->type == TYPE_UNK || args[i]->type == types->type) {
+                validtype = 1;
+                break;
+            }
+        }
+        if (!validtype) { // if an argument's type doesn't match the function's requirements
+            return 0;
+        }
+    }
+    return 1;
+}
+
 /* Tries to call the function given by the tap_fun_search (primitive or tap), returning a nil expression on failure
 	@param tfs		tap_fun_search metadata
 	@param args		the array of arguments to pass to the called function
@@ -638,9 +792,19 @@ tap_fun_search findFunction (expression* head, expression* args[], int numargs)
 */
 expression* callFun (tap_fun_search tfs, expression* head, expression* args[], int numargs) {
 	expression* result;
+	safePoint(); // a green task may give way to the others here, between evaluating the arguments and calling the function
 	if (tfs.found) {
 		if (tfs.prim) {
-			result = callPrimFun(tfs.funs.prim_fun, args, numargs);
+			result = NULL;
+			if (tfs.funs.prim_fun->kernel != KERNEL_NONE) { // prefer the fast-call kernel when the arguments allow it
+				result = callPrimKernel(tfs.funs.prim_fun, args, numargs);
+			}
+			if (result == NULL) {
+				result = callPrimFun(tfs.funs.prim_fun, args, numargs);
+			}
+		} else if (stackExhausted()) { // a task's stack is far smaller than a thread's, so recursion that would overflow it is reported instead
+			addError(newErrorlist(ERR_TOO_DEEP, head->type == TYPE_STR ? copyString(head->ev.strval) : newString(strDup("function")), head->line, 0));
+			result = newExpressionNil();
 		} else {
 			if (validFunCall(tfs.funs.tap_fun, head, args, numargs)) {
 				result = callTapFun(tfs.funs.tap_fun, args, numargs);
@@ -660,7 +824,7 @@ expression* callFun (tap_fun_search tfs, expression* head, expression* args[], i
 	@param numargs	the number of arguments in the array
 	@return			the function call's resulting expression
 */
-expression* callPrimFun (tap_prim_fun* prim_fun, expression* args[], int numargs) {
+expression* callPrimFun (const tap_prim_fun* prim_fun, expression* args[], int numargs) {
 	setEnvironment(); // set up a new environment with a blank slate
     expression* result = newExpressionNil();
     datatype returntype = TYPE_NIL;
@@ -670,6 +834,39 @@ expression* callPrimFun (tap_prim_fun* prim_fun, expression* args[], int numargs
     return result;
 }
 
+/* Calls the given primitive function's fast-call kernel with the given arguments unboxed, if every argument has the kernel's operand type
+	@param prim_fun	the primitive function to call
+	@param args		the array of arguments to pass to the function
+	@param numargs	the number of arguments in the array
+	@return			the function call's resulting expression or null if the arguments don't suit the kernel
+*/
+expression* callPrimKernel (const tap_prim_fun* prim_fun, expression* args[], int numargs) {
+	datatype optype = prim_fun->kernel == KERNEL_INT ? TYPE_INT : TYPE_FLO;
+	int i;
+	for (i = 0; i < numargs; ++i) {
+		if (args[i]->type != optype) {
+			return NULL;
+		}
+	}
+	if (optype == TYPE_INT) {
+		tap_int operands[numargs];
+		for (i = 0; i < numargs; ++i) {
+			operands[i] = args[i]->ev.intval;
+		}
+		return newExpressionInt(prim_fun->fast.ints(operands, numargs));
+	} else {
+		tap_flo operands[numargs];
+		for (i = 0; i < numargs; ++i) {
+			operands[i] = args[i]->ev.floval;
+		}
+		if (prim_fun->kernel == KERNEL_FLO) {
+			return newExpressionFlo(prim_fun->fast.flos(operands, numargs));
+		} else {
+			return newExpressionInt(prim_fun->fast.flotests(operands, numargs));
+		}
+	}
+}
+
 /* Returns whether or not the given function is being given valid arguments
 	@param fun		the function whose signature to analyze
 	@param head		the function's container expression
@@ -709,21 +906,29 @@ int validFunCall (tap_fun* fun, expression* head, expression* args[], int numarg
 	@return			the function call's resulting expression
 */
 expression* callTapFun (tap_fun* fun, expression* args[], int numargs) {
-	int newenv = environments[cenvironment]->numvars > 0;
-    if (newenv) { // if this isn't a tail call
-        setEnvironment(); // set up a new environment with a blank slate
+    tap_memo* memo = NULL;
+    if (fun->memo != NULL && memoizable(args, numargs)) { // if the function is memoized and the arguments can be used as a key
+        memo = fun->memo;
+        expression* cached = lookupMemo(memo, args, numargs);
+        if (cached != NULL) { // if the function was already called with equal arguments then reuse the result
+            return cached;
+        }
     }
+    setEnvironment(); // set up a new environment with a blank slate so the caller's bindings are never shadowed after returning
+    environment* env = ccontext->environments[ccontext->cenvironment];
     int i;
     for (i = 0; i < numargs; ++i) { // add the arguments to the new environment's variables table
-        insertUserHash(environments[cenvironment]->variables, fun->args[i]->name->content, args[i]);
+        insertUserHash(env->variables, fun->args[i]->name->content, copyExpressionNR(args[i]));
     }
-    expression* cfunction = newExpressionOfType(TYPE_FUN); // insert the special variable "here" that refers to the current function
-    cfunction->ev.funval = fun;
-    insertUserHash(environments[cenvironment]->variables, "here", cfunction);
-    environments[cenvironment]->numvars += numargs; // indicate how many variables there are in the new environment
+    expression* cfunction = newExpressionFun(fun); // insert the special variable "here" that refers to the current function
+    insertDirectHash(env->variables, "here", cfunction); // the function itself is owned by the caller so it must not be freed with the environment
+    env->numvars += numargs + 1; // indicate how many variables (including "here") there are in the new environment
+    errorlist* lasterror = ccontext->cerror;
     expression* result = evaluateLaz(fun->body); // evaluate the function in the new environment
-    if (newenv) {
-        resetEnvironment(); // reset the environment to its previous state
+    resetEnvironment(); // reset the environment to its previous state
+    free(cfunction);
+    if (memo != NULL && ccontext->cerror == lasterror) { // a failed call isn't cached so that calling it again reports the errors again
+        storeMemo(memo, args, numargs, result);
     }
     return result;
 }
@@ -768,7 +973,7 @@ expression* evaluateObj (expression* head) {
 	expression* result;
 	expression* propname = evaluateArgument(head->next);
     if (propname->type == TYPE_STR) {
-        char* pnstr = propname->ev.strval->content;
+        char* pnstr = stringContent(propname->ev.strval);
         property* props = head->ev.objval->props;
         while (props != NULL) {
             if (strcmp(pnstr, props->name) == 0) {
@@ -821,6 +1026,11 @@ expression* evaluateArgument (expression* arg) {
             addError(newErrorlist(ERR_UNDEFINED_VAR, copyString(var), 0, 0));
             result = newExpressionNil();
         }
+    } else if (arg->type == TYPE_LAZ) { // if the argument is a lazy expression then give it its own unforced copy, since each evaluation of the code may force it differently
+        exprvals ev;
+        ev.lazval = copyLazyExpression(arg->ev.lazval);
+        result = newExpressionAll(TYPE_LAZ, &ev, NULL, arg->line);
+        result->flag = arg->flag;
     } else {
     	result = copyExpressionNR(arg);
     }
@@ -856,6 +1066,7 @@ expression* expressionsToArray (expression* head) {
 */
 char* printExpression (expression* result) {
     char* output = NULL; // the result string
+    char digits[NUMBER_MAX_SIZE]; // the text of a number before it's copied into the result
     int size;
     datatype typ;
     if (result == NULL) {
@@ -877,17 +1088,19 @@ char* printExpression (expression* result) {
             strcpy(output, "[lazy expression]");
             break;
         case TYPE_INT:
-            size = snprintf(NULL, 0, "%ld", result->ev.intval); // find out how many characters the integer will take up when cast as a string
+            size = formatInt(digits, result->ev.intval, BASE);
             output = allocate(size + 1);
-            sprintf(output, "%ld", result->ev.intval);
+            memcpy(output, digits, size + 1);
             break;
         case TYPE_FLO:
-            size = snprintf(NULL, 0, "%f", result->ev.floval); // find out how many characters the float will take up when cast as a string
+            size = formatFlo(digits, result->ev.floval); // the shortest text that reads back as the same float
             output = allocate(size + 1);
-            sprintf(output, "%f", result->ev.floval);
+            memcpy(output, digits, size + 1);
             break;
         case TYPE_STR:
-            output = strDup(result->ev.strval->content); // duplicate the content string to avoid accidentally deleting it
+            output = allocate(result->ev.strval->size + 1); // copy the content to avoid accidentally deleting it
+            memcpy(output, result->ev.strval->content, result->ev.strval->size);
+            output[result->ev.strval->size] = '\0';
             break;
         case TYPE_ARR:
             output = allocate(8);
@@ -904,6 +1117,26 @@ char* printExpression (expression* result) {
             output = allocate(11);
             strcpy(output, "[function]");
             break;
+        case TYPE_CHN:
+            output = allocate(10);
+            strcpy(output, "[channel]");
+            break;
+        case TYPE_BLD: {
+            output = releaseString(flattenBuilder(result->ev.bldval));
+            break;
+        }
+        case TYPE_MAT:
+            output = allocate(10);
+            strcpy(output, "[matcher]");
+            break;
+        case TYPE_REG:
+            output = allocate(8);
+            strcpy(output, "[regex]");
+            break;
+        case TYPE_FMT:
+            output = allocate(9);
+            strcpy(output, "[format]");
+            break;
         case TYPE_TYP:
             output = printType(result->ev.intval);
             break;
@@ -920,7 +1153,7 @@ char* printExpression (expression* result) {
     @return         a string representing the list of generated errors
 */
 char* printErrors () {
-    errorlist* error = errors;
+    errorlist* error = ccontext->errors;
     int errornum = 0;
     int size = 9;
     while (error != NULL) {
@@ -930,7 +1163,7 @@ char* printErrors () {
     char* errortext = (char*)allocate(size);
     strcpy(errortext, "Errors:\n");
     int pos = 8;
-    error = errors;
+    error = ccontext->errors;
     while (error != NULL) {
         char* ecs = errorCodeString(error->code);
         pos += sprintf(errortext + pos, "\tError %d: %s, line %d, index %d: \"%s\"\n", errornum++, ecs, error->line, error->index, error->message->content);
@@ -946,15 +1179,25 @@ char* printErrors () {
     @return         nothing
 */
 inline void addError (errorlist* error) {
-    if (errors == NULL) {
-        errors = error;
-        cerror = errors;
+    tap_context* context = ccontext;
+    if (context->errors == NULL) {
+        context->errors = error;
+        context->cerror = error;
     } else {
-        cerror->next = error;
-        cerror = cerror->next;
+        context->cerror->next = error;
+        context->cerror = error;
     }
 }
 
+/*! Removes every error generated thus far from the currently active error list
+    @return         nothing
+*/
+void clearErrors () {
+    freeErrors(ccontext->errors);
+    ccontext->errors = NULL;
+    ccontext->cerror = NULL;
+}
+
 /*! Returns the string description of the given error code
     @param code     the integer error code to return the string version of
     @return         a string representing the list of generated errors
@@ -995,6 +1238,24 @@ char* errorCodeString (uint code) {
         case ERR_OUT_OF_BOUNDS:
             desc = "index out of bounds";
             break;
+        case ERR_UNREADABLE_FILE:
+            desc = "unreadable file";
+            break;
+        case ERR_UNWRITABLE_FILE:
+            desc = "unwritable file";
+            break;
+        case ERR_INVALID_SNAPSHOT:
+            desc = "invalid snapshot";
+            break;
+        case ERR_INVALID_REGEX:
+            desc = "invalid regular expression";
+            break;
+        case ERR_INVALID_FORMAT:
+            desc = "invalid format";
+            break;
+        case ERR_TOO_DEEP:
+            desc = "recursion too deep";
+            break;
         default:
             desc = "unknown error";
             break;
@@ -1030,6 +1291,18 @@ int errorCodeStringSize (uint code) {
             return strlen("undefined property (for the given type)");
         case ERR_OUT_OF_BOUNDS:
             return strlen("index out of bounds");
+        case ERR_UNREADABLE_FILE:
+            return strlen("unreadable file");
+        case ERR_UNWRITABLE_FILE:
+            return strlen("unwritable file");
+        case ERR_INVALID_SNAPSHOT:
+            return strlen("invalid snapshot");
+        case ERR_INVALID_REGEX:
+            return strlen("invalid regular expression");
+        case ERR_INVALID_FORMAT:
+            return strlen("invalid format");
+        case ERR_TOO_DEEP:
+            return strlen("recursion too deep");
         default:
             return strlen("unknown error");
     }
@@ -1041,25 +1314,84 @@ int errorCodeStringSize (uint code) {
     @return         nothing
 */
 void addToEnvironment (char* key, expression* value) {
-    insertUserHash(environments[environments[cenvironment]->parent]->variables, key, value);
+    tap_context* context = ccontext;
+    int index = context->environments[context->cenvironment]->parent;
+    environment* env = context->environments[index];
+    while (env->loop && lookupHash(env->variables, key) == NULL) { // a loop's body sets variables where the loop was called unless they're the loop's own
+        index = env->parent;
+        env = context->environments[index];
+    }
+    if (!setUserHash(env->variables, key, value)) { // if the variable is new to the environment rather than updated in place
+        ++env->numvars;
+        noteBinding(index);
+    }
+}
+
+/*! Notes that a name was bound anew in the given environment, so that a running loop which resolves names there plans its body again
+    @param index    the index of the environment the name was bound in
+    @return         nothing
+*/
+void noteBinding (int index) {
+    if (index <= ccontext->watchenv) {
+        ++ccontext->rebinds;
+    }
 }
 
 /*! Sets up a new environment with no extant variables
     @return     nothing
 */
 void setEnvironment () {
-    environments[cenvironment + 1]->parent = cenvironment; // set the new environment's parent to the previous environment
-    ++cenvironment; // increment to a new, blank environment
+    tap_context* context = ccontext;
+    reserveEnvironment();
+    context->environments[context->cenvironment + 1]->parent = context->cenvironment; // set the new environment's parent to the previous environment
+    ++context->cenvironment; // increment to a new, blank environment
+}
+
+/*! Makes sure there is an environment after the current one, doubling the stack of environments if it's full
+    @return     nothing
+*/
+void reserveEnvironment () {
+    tap_context* context = ccontext;
+    if (context->cenvironment + 1 < context->numenvironments) {
+        return;
+    }
+    uint size = context->numenvironments * 2;
+    context->environments = realloc(context->environments, sizeof(environment*) * size);
+    if (context->environments == NULL) {
+        exit(EXIT_OUT_OF_MEMORY);
+    }
+    uint i;
+    for (i = context->numenvironments; i < size; ++i) {
+        context->environments[i] = newEnvironment(newHashtable(INITIAL_ENV_SIZE), -1);
+    }
+    context->numenvironments = size;
+}
+
+/*! Marks the current environment as a loop's, so that its body sets any variable but the loop's own where the loop was called
+    @return     nothing
+*/
+void loopEnvironment () {
+    ccontext->environments[ccontext->cenvironment]->loop = 1;
 }
 
 /*! Resets the current environment for use next time and pops to the previous environment
     @return     nothing
 */
 void resetEnvironment () {
-    int parent = environments[cenvironment]->parent;
-    clearHash(environments[cenvironment]->variables); // clear the environment
-    environments[cenvironment]->parent = -1; // reset its parent index to -1, indicating no parent
-    cenvironment = parent; // retreat to the previous environment
+    tap_context* context = ccontext;
+    environment* env = context->environments[context->cenvironment];
+    int parent = env->parent;
+    if (env->numvars > 0) { // only walk the table if something was added to it
+        clearHash(env->variables); // clear the environment
+        env->numvars = 0; // the environment no longer contains any variables
+    }
+    if (env->types != NULL) { // types defined in the environment go out of scope with it
+        freeTypedefs(env->types);
+        env->types = NULL;
+    }
+    env->parent = -1; // reset its parent index to -1, indicating no parent
+    env->loop = 0;
+    context->cenvironment = parent; // retreat to the previous environment
 }
 
 /*! Gets the expression value mapped to the given string name
@@ -1067,27 +1399,23 @@ void resetEnvironment () {
     @return         the value mapped to the name
 */
 expression* getVarValue (char* name) {
-	expression* result = NULL;
-    expression* found = NULL;
-    int cenv = cenvironment;
+    int cenv = ccontext->cenvironment;
     while (cenv >= 0) { // while there are more environments to check
-        hashlist* list1 = (hashlist*)lookupHashes(environments[cenv]->variables, name); // look for the value with the given name/key
-        hashlist* list2;
-        if (list1 != NULL) { // if a value was found
-            if (list1->flag == HFLAG_USER) { // if the value is a user variable (as opposed to a primitive function)
-                found = list1->value; // temporarily store the found value while the hash list memory is deleted
+        hashelement* list = ccontext->environments[cenv]->numvars > 0 ? lookupHashList(ccontext->environments[cenv]->variables, name) : NULL; // an empty environment needn't be searched
+        for (; list != NULL; list = list->next) { // look for the value with the given name/key
+            if (strcmp(name, list->key) == 0) { // if a value was found
+                if (list->flag == HFLAG_USER || list->flag == HFLAG_DIRECT) { // if the value is a user variable (as opposed to a primitive function)
+                    return copyExpression(list->value);
+                }
+                return NULL;
             }
-            do { // free the memory allocated for the hast list
-                list2 = list1->next; // store the next item in the hash list
-                free(list1); // free the current hash list element
-                list1 = list2; // advance to the next hash list element
-            } while (list1 != NULL);
-            result = copyExpression(found);
-            break;
         }
-        cenv = environments[cenv]->parent; // since the value wasn't found check the parent environment for it
+        cenv = ccontext->environments[cenv]->parent; // since the value wasn't found check the parent environment for it
     }
-    return result;
+    if (defineImported(name)) { // the imported packages have just defined the name
+        return getVarValue(name);
+    }
+    return builtinConstant(name); // the built-in constants are shadowed by any variable with the same name
 }
 
 /*! If the given expression is a regular or lazy expression, returns the expression value and otherwise returns null
@@ -1112,39 +1440,41 @@ expression* getExprValue (expression* expr) {
     @return         a new expression pointer with a value of nil that the old expression links to
 */
 expression* storeExprValue (expression* expr, char* text, int start, int end, expression** last, int lazy) {
-    if (end - start > 0) { // if there is something to evaluate
-        char* strval = substr(text, start, end); // store the expression's raw value
-        if (expr->type == TYPE_INT) { // if the expression is an int
-            int intval; // a temporary variable to store the integer result in
-            if (expr->flag > EFLAG_CONVBASE) { // if the expression needs its base converted
-                char* integer = substr(strval, 0, expr->flag - 2);
-                char* base = substr(text, expr->flag + 1, end);
-                intval = strtol(integer, NULL, atoi(base)); // convert the integer from ascii to numeric using the given base
-                free(integer); // free the substrings from memory
-                free(base);
+    if (end - start > 0 || (end == start && expr->type == TYPE_STR && expr->flag == EFLAG_NONE)) { // if there is something to evaluate (an empty string literal still is)
+        if (expr->type == TYPE_INT || expr->type == TYPE_FLO) { // if the expression is a number then it's read straight out of the text
+            int size = end - start;
+            tap_int base = BASE;
+            tap_int intval;
+            tap_flo floval;
+            if (expr->flag == EFLAG_CONVBASE) { // if the expression needs its base converted then the base follows the colon
+                size = (char*)memchr(text + start, ':', end - start) - (text + start);
+                if (parseNumber(text + start + size + 1, end - start - size - 1, BASE, &base, &floval) != TYPE_INT || base < 2 || base > 36) {
+                    base = 0; // which no number is in
+                }
+            }
+            expr->type = parseNumber(text + start, size, base, &intval, &floval); // an integer too big to fit is read as a float
+            expr->flag = EFLAG_NONE;
+            if (expr->type == TYPE_INT) {
+                expr->ev.intval = intval;
+            } else if (expr->type == TYPE_FLO) {
+                expr->ev.floval = floval;
             } else {
-                intval = atoi(strval); // convert the integer from ascii to numeric
+                expr->ev.intval = 0;
             }
-            expr->ev.intval = intval; // store the integer value in the expression
-            free(strval); // free the string value from memory
-        } else if (expr->type == TYPE_FLO) { // if the expression is a float
-            double floval = atof(strval); // convert the float from ascii to numeric
-            expr->ev.floval = floval; // store the float value in the expression
-            free(strval); // free the string value from memory
         } else if (expr->type == TYPE_STR) { // if the expression is a string
+            char* strval = substr(text, start, end); // store the expression's raw value
             if (expr->flag == EFLAG_SYMB) { // if the string is a sybol
                 hashsum intval = hashWithSize(INITIAL_SYMBOL_COUNT, strval); // map the symbol's string value to its hashed integer value
                 expr->ev.intval = intval; // store the integer value in the expression
                 expr->type = TYPE_INT; // set the expression's type to an integer
                 free(strval); // free the string value from memory
             } else {
-                expr->ev.strval = newString(strval);
+                expr->ev.strval = newStringCopy(strval, end - start); // kept with the struct if it's short
+                free(strval);
                 if (expr->flag == EFLAG_NONE && lazy) { // if the string is a variable and is inside a lazy expression
                     //expr->expr->lazval->refs = newExprstack(expr->expr->lazval->refs); // add a reference to it to the lazy expression list
                 }
             }
-        } else {
-            free(strval); // free the string value from memory
         }
         expr->next = newExpressionOfType(TYPE_NIL); // set the new expression to a value of nil
     }
@@ -1180,10 +1510,20 @@ char* printType (datatype typ) {
             return strDup("::function");
         case TYPE_TYP:
             return strDup("::type");
+        case TYPE_CHN:
+            return strDup("::channel");
+        case TYPE_BLD:
+            return strDup("::str-builder");
+        case TYPE_MAT:
+            return strDup("::matcher");
+        case TYPE_REG:
+            return strDup("::regex");
+        case TYPE_FMT:
+            return strDup("::format");
     }
-    int cenv = cenvironment;
+    int cenv = ccontext->cenvironment;
     while (cenv >= 0) {
-        typedefs* types = environments[cenv++]->types;
+        typedefs* types = ccontext->environments[cenv++]->types;
         while (types != NULL) {
             if (types->type->id == typ) {
                 char* typestr = allocate(strlen(types->type->name) + 3);
@@ -1224,6 +1564,16 @@ int printTypeSize (datatype typ) {
             return 8;
         case TYPE_TYP:
             return 4;
+        case TYPE_CHN:
+            return 7;
+        case TYPE_BLD:
+            return 11;
+        case TYPE_MAT:
+            return 7;
+        case TYPE_REG:
+            return 5;
+        case TYPE_FMT:
+            return 6;
         default:
             return 0;
     }
@@ -1234,25 +1584,23 @@ int printTypeSize (datatype typ) {
     @return         the type's integer equivalent
 */
 datatype typeFromString (char* type) {
-    datatype id = TYPE_UNK;
-    int cenv = cenvironment;
-    while (cenv >= 0 && id == TYPE_UNK) {
-        hashlist* hl1 = lookupHashes(environments[cenv--]->variables, type);
-        hashlist* hl2;
-        while (hl1 != NULL) {
-            if (hl1->flag == HFLAG_USER) {
-                expression* expr = (expression*)(hl1->value);
+    int cenv = ccontext->cenvironment;
+    while (cenv >= 0) {
+        hashelement* list;
+        for (list = lookupHashList(ccontext->environments[cenv]->variables, type); list != NULL; list = list->next) {
+            if (list->flag == HFLAG_USER && strcmp(type, list->key) == 0) {
+                expression* expr = (expression*)(list->value);
                 if (expr->type == TYPE_TYP) {
-                    id = expr->ev.intval;
-                    break;
+                    return expr->ev.intval;
                 }
             }
-            hl2 = hl1->next;
-            free(hl1);
-            hl1 = hl2;
         }
+        cenv = ccontext->environments[cenv]->parent;
     }
-    return id;
+    if (defineImported(type)) {
+        return typeFromString(type);
+    }
+    return builtinType(type);
 }
 
 /*! Converts the given argument into a string
@@ -1286,388 +1634,38 @@ char* printArg (argument* arg) {
     return argstr;
 }
 
-/*! Initializes all of the global variables (e.g. the environments, error list, etc.) needed for interpretation
+/*! Initializes all of the global variables needed for interpretation by giving the calling thread a context of its own
     @return     nothing
 */
 void initializeGlobals () {
     // initialize the random seed using the execution time
     srand(time(NULL));
 
-    // initialize the environments
-    environments[0] = newEnvironment(newHashtable(INITIAL_ROOT_ENV_SIZE), -1);
-    int i;
-    for (i = 1; i < INITIAL_ENV_COUNT; ++i) { // for each environment
-        environments[i] = newEnvironment(newHashtable(INITIAL_ENV_SIZE), -1); // initialize the environment and set its parent to -1, indicating no parent
-    }
-    cenvironment = 0; // set the current environment to 0, the top-most environment
-
-    // initialize the primitive functions
-    hashtable* cenv = environments[cenvironment]->variables;
-
-    insertPrimHash(cenv, "int", newPrimFunction(&prim_nInt, 1, 1, newTypelist(TYPE_NIL)));
-    insertPrimHash(cenv, "integer", newPrimFunction(&prim_nInt, 1, 1, newTypelist(TYPE_NIL)));
-    insertPrimHash(cenv, "str", newPrimFunction(&prim_nStr, 1, 1, newTypelist(TYPE_NIL)));
-    insertPrimHash(cenv, "string", newPrimFunction(&prim_nStr, 1, 1, newTypelist(TYPE_NIL)));
-    insertPrimHash(cenv, "typ", newPrimFunction(&prim_nTyp, 1, 1, newTypelist(TYPE_NIL)));
-    insertPrimHash(cenv, "type", newPrimFunction(&prim_nTyp, 1, 1, newTypelist(TYPE_NIL)));
-    insertPrimHash(cenv, "::", newPrimFunction(&prim_nTyp, 1, 1, newTypelist(TYPE_NIL)));
-
-    insertPrimHash(cenv, "eval", newPrimFunction(&prim_lEval, 1, 1, newTypelist(TYPE_LAZ)));
-    insertPrimHash(cenv, "function", newPrimFunction(&prim_lFunction, 2, 2, newTypelistWithNext(TYPE_LAZ, newTypelist(TYPE_LAZ))));
-    insertPrimHash(cenv, "lambda", newPrimFunction(&prim_lFunction, 2, 2, newTypelistWithNext(TYPE_LAZ, newTypelist(TYPE_LAZ))));
-    insertPrimHash(cenv, "&&", newPrimFunction(&prim_lAnd, 1, ARGLEN_INF, newTypelist(TYPE_LAZ)));
-    insertPrimHash(cenv, "||", newPrimFunction(&prim_lOr, 1, ARGLEN_INF, newTypelist(TYPE_LAZ)));
-    insertPrimHash(cenv, "^^", newPrimFunction(&prim_lXor, 1, ARGLEN_INF, newTypelist(TYPE_LAZ)));
-    insertPrimHash(cenv, "if", newPrimFunction(&prim_lIf, 2, ARGLEN_INF, newTypelistWithNext(TYPE_LAZ, newTypelist(TYPE_UNK))));
-    insertPrimHash(cenv, "typ", newPrimFunction(&prim_lTyp, 1, 1, newTypelist(TYPE_LAZ)));
-    insertPrimHash(cenv, "type", newPrimFunction(&prim_lTyp, 1, 1, newTypelist(TYPE_LAZ)));
-    insertPrimHash(cenv, "::", newPrimFunction(&prim_lTyp, 1, 1, newTypelist(TYPE_LAZ)));
-
-    insertPrimHash(cenv, "error", newPrimFunction(&prim_iError, 2, 2, newTypelistWithNext(TYPE_INT, newTypelist(TYPE_STR))));
-    insertPrimHash(cenv, "+", newPrimFunction(&prim_iAdd, 1, ARGLEN_INF, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "-", newPrimFunction(&prim_iSub, 1, ARGLEN_INF, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "*", newPrimFunction(&prim_iMul, 1, ARGLEN_INF, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "/", newPrimFunction(&prim_iDiv, 1, ARGLEN_INF, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "%", newPrimFunction(&prim_iMod, 1, ARGLEN_INF, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "**", newPrimFunction(&prim_iPow, 1, ARGLEN_INF, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "sqrt", newPrimFunction(&prim_iSqrt, 1, 1, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "log", newPrimFunction(&prim_iLog, 1, 1, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "abs", newPrimFunction(&prim_iAbs, 1, 1, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "max", newPrimFunction(&prim_iMax, 1, ARGLEN_INF, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "min", newPrimFunction(&prim_iMin, 1, ARGLEN_INF, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "round", newPrimFunction(&prim_iRound, 1, 1, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "ceil", newPrimFunction(&prim_iCeil, 1, 1, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "floor", newPrimFunction(&prim_iFloor, 1, 1, newTypelist(TYPE_INT)));
-    ///insertPrimHash(cenv, "scientific", newPrimFunction(&prim_iScientific, 1, 1, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "sin", newPrimFunction(&prim_iSin, 1, 1, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "cos", newPrimFunction(&prim_iCos, 1, 1, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "tan", newPrimFunction(&prim_iTan, 1, 1, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "asin", newPrimFunction(&prim_iAsin, 1, 1, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "acos", newPrimFunction(&prim_iAcos, 1, 1, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "atan", newPrimFunction(&prim_iAtan, 1, 1, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "atan2", newPrimFunction(&prim_iAtan2, 2, 2, newTypelistWithNext(TYPE_INT, newTypelist(TYPE_INT))));
-    insertPrimHash(cenv, "sinh", newPrimFunction(&prim_iSinh, 1, 1, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "cosh", newPrimFunction(&prim_iCosh, 1, 1, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "tanh", newPrimFunction(&prim_iTanh, 1, 1, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "radians", newPrimFunction(&prim_iRadians, 1, 1, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "degrees", newPrimFunction(&prim_iDegrees, 1, 1, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "~", newPrimFunction(&prim_iBnot, 1, 1, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "&", newPrimFunction(&prim_iBand, 1, ARGLEN_INF, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "|", newPrimFunction(&prim_iBor, 1, ARGLEN_INF, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "^", newPrimFunction(&prim_iBxor, 1, ARGLEN_INF, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "<<", newPrimFunction(&prim_iLshift, 2, 2, newTypelistWithNext(TYPE_INT, newTypelist(TYPE_INT))));
-    insertPrimHash(cenv, ">>", newPrimFunction(&prim_iRashift, 2, 2, newTypelistWithNext(TYPE_INT, newTypelist(TYPE_INT))));
-    insertPrimHash(cenv, ">>>", newPrimFunction(&prim_iRlshift, 2, 2, newTypelistWithNext(TYPE_INT, newTypelist(TYPE_INT))));
-    insertPrimHash(cenv, "!", newPrimFunction(&prim_iLnot, 1, 1, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "&&", newPrimFunction(&prim_iLand, 1, ARGLEN_INF, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "||", newPrimFunction(&prim_iLor, 1, ARGLEN_INF, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "^^", newPrimFunction(&prim_iLxor, 1, ARGLEN_INF, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "<", newPrimFunction(&prim_iLess, 1, ARGLEN_INF, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "<=", newPrimFunction(&prim_iLequal, 1, ARGLEN_INF, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "==", newPrimFunction(&prim_iEqual, 1, ARGLEN_INF, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "!=", newPrimFunction(&prim_iNequal, 1, ARGLEN_INF, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, ">=", newPrimFunction(&prim_iMequal, 1, ARGLEN_INF, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, ">", newPrimFunction(&prim_iMore, 1, ARGLEN_INF, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "if", newPrimFunction(&prim_iIf, 2, ARGLEN_INF, newTypelistWithNext(TYPE_INT, newTypelist(TYPE_UNK))));
-    insertPrimHash(cenv, "random", newPrimFunction(&prim_iRand, 1, 1, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "seed-random", newPrimFunction(&prim_iSrand, 1, 1, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "from-ascii", newPrimFunction(&prim_iFascii, 1, 1, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "bool", newPrimFunction(&prim_iBoo, 1, 1, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "ascii", newPrimFunction(&prim_iAscii, 1, 1, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "int", newPrimFunction(&prim_iInt, 1, 1, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "integer", newPrimFunction(&prim_iInt, 1, 1, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "flo", newPrimFunction(&prim_iFlo, 1, 1, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "float", newPrimFunction(&prim_iFlo, 1, 1, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "str", newPrimFunction(&prim_iStr, 1, 1, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "string", newPrimFunction(&prim_iStr, 1, 1, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "arr", newPrimFunction(&prim_iArr, 1, 1, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "array", newPrimFunction(&prim_iArr, 1, 1, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "typ", newPrimFunction(&prim_iTyp, 1, 1, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "type", newPrimFunction(&prim_iTyp, 1, 1, newTypelist(TYPE_INT)));
-    insertPrimHash(cenv, "::", newPrimFunction(&prim_iTyp, 1, 1, newTypelist(TYPE_INT)));
-
-    insertPrimHash(cenv, "+", newPrimFunction(&prim_fAdd, 1, ARGLEN_INF, newTypelist(TYPE_FLO)));
-    insertPrimHash(cenv, "-", newPrimFunction(&prim_fSub, 1, ARGLEN_INF, newTypelist(TYPE_FLO)));
-    insertPrimHash(cenv, "*", newPrimFunction(&prim_fMul, 1, ARGLEN_INF, newTypelist(TYPE_FLO)));
-    insertPrimHash(cenv, "/", newPrimFunction(&prim_fDiv, 1, ARGLEN_INF, newTypelist(TYPE_FLO)));
-    insertPrimHash(cenv, "**", newPrimFunction(&prim_fPow, 1, ARGLEN_INF, newTypelist(TYPE_FLO)));
-    insertPrimHash(cenv, "sqrt", newPrimFunction(&prim_fSqrt, 1, 1, newTypelist(TYPE_FLO)));
-    insertPrimHash(cenv, "log", newPrimFunction(&prim_fLog, 1, 1, newTypelist(TYPE_FLO)));
-    insertPrimHash(cenv, "abs", newPrimFunction(&prim_fAbs, 1, 1, newTypelist(TYPE_FLO)));
-    insertPrimHash(cenv, "max", newPrimFunction(&prim_fMax, 1, ARGLEN_INF, newTypelist(TYPE_FLO)));
-    insertPrimHash(cenv, "min", newPrimFunction(&prim_fMin, 1, ARGLEN_INF, newTypelist(TYPE_FLO)));
-    insertPrimHash(cenv, "round", newPrimFunction(&prim_fRound, 1, 1, newTypelist(TYPE_FLO)));
-    insertPrimHash(cenv, "ceil", newPrimFunction(&prim_fCeil, 1, 1, newTypelist(TYPE_FLO)));
-    insertPrimHash(cenv, "floor", newPrimFunction(&prim_fFloor, 1, 1, newTypelist(TYPE_FLO)));
-    ///insertPrimHash(cenv, "scientific", newPrimFunction(&prim_fScientific, 1, 1, newTypelist(TYPE_FLO)));
-    insertPrimHash(cenv, "sin", newPrimFunction(&prim_fSin, 1, 1, newTypelist(TYPE_FLO)));
-    insertPrimHash(cenv, "cos", newPrimFunction(&prim_fCos, 1, 1, newTypelist(TYPE_FLO)));
-    insertPrimHash(cenv, "tan", newPrimFunction(&prim_fTan, 1, 1, newTypelist(TYPE_FLO)));
-    insertPrimHash(cenv, "asin", newPrimFunction(&prim_fAsin, 1, 1, newTypelist(TYPE_FLO)));
-    insertPrimHash(cenv, "acos", newPrimFunction(&prim_fAcos, 1, 1, newTypelist(TYPE_FLO)));
-    insertPrimHash(cenv, "atan", newPrimFunction(&prim_fAtan, 1, 1, newTypelist(TYPE_FLO)));
-    insertPrimHash(cenv, "atan2", newPrimFunction(&prim_fAtan2, 2, 2, newTypelistWithNext(TYPE_FLO, newTypelist(TYPE_FLO))));
-    insertPrimHash(cenv, "sinh", newPrimFunction(&prim_fSinh, 1, 1, newTypelist(TYPE_FLO)));
-    insertPrimHash(cenv, "cosh", newPrimFunction(&prim_fCosh, 1, 1, newTypelist(TYPE_FLO)));
-    insertPrimHash(cenv, "tanh", newPrimFunction(&prim_fTanh, 1, 1, newTypelist(TYPE_FLO)));
-    insertPrimHash(cenv, "radians", newPrimFunction(&prim_fRadians, 1, 1, newTypelist(TYPE_FLO)));
-    insertPrimHash(cenv, "degrees", newPrimFunction(&prim_fDegrees, 1, 1, newTypelist(TYPE_FLO)));
-    insertPrimHash(cenv, "<", newPrimFunction(&prim_fLess, 1, ARGLEN_INF, newTypelist(TYPE_FLO)));
-    insertPrimHash(cenv, "<=", newPrimFunction(&prim_fLequal, 1, ARGLEN_INF, newTypelist(TYPE_FLO)));
-    insertPrimHash(cenv, "==", newPrimFunction(&prim_fEqual, 1, ARGLEN_INF, newTypelist(TYPE_FLO)));
-    insertPrimHash(cenv, "!=", newPrimFunction(&prim_fNequal, 1, ARGLEN_INF, newTypelist(TYPE_FLO)));
-    insertPrimHash(cenv, ">=", newPrimFunction(&prim_fMequal, 1, ARGLEN_INF, newTypelist(TYPE_FLO)));
-    insertPrimHash(cenv, ">", newPrimFunction(&prim_fMore, 1, ARGLEN_INF, newTypelist(TYPE_FLO)));
-    insertPrimHash(cenv, "int", newPrimFunction(&prim_fInt, 1, 1, newTypelist(TYPE_FLO)));
-    insertPrimHash(cenv, "integer", newPrimFunction(&prim_fInt, 1, 1, newTypelist(TYPE_FLO)));
-    insertPrimHash(cenv, "flo", newPrimFunction(&prim_fFlo, 1, 1, newTypelist(TYPE_FLO)));
-    insertPrimHash(cenv, "float", newPrimFunction(&prim_fFlo, 1, 1, newTypelist(TYPE_FLO)));
-    insertPrimHash(cenv, "str", newPrimFunction(&prim_fStr, 1, 1, newTypelist(TYPE_FLO)));
-    insertPrimHash(cenv, "string", newPrimFunction(&prim_fStr, 1, 1, newTypelist(TYPE_FLO)));
-    insertPrimHash(cenv, "arr", newPrimFunction(&prim_fArr, 1, 1, newTypelist(TYPE_FLO)));
-    insertPrimHash(cenv, "array", newPrimFunction(&prim_fArr, 1, 1, newTypelist(TYPE_FLO)));
-    insertPrimHash(cenv, "typ", newPrimFunction(&prim_fTyp, 1, 1, newTypelist(TYPE_FLO)));
-    insertPrimHash(cenv, "type", newPrimFunction(&prim_fTyp, 1, 1, newTypelist(TYPE_FLO)));
-    insertPrimHash(cenv, "::", newPrimFunction(&prim_fTyp, 1, 1, newTypelist(TYPE_FLO)));
-
-    insertPrimHash(cenv, "set", newPrimFunction(&prim_sSet, 2, 2, newTypelistWithNext(TYPE_STR, newTypelist(TYPE_UNK))));
-    insertPrimHash(cenv, "new-type", newPrimFunction(&prim_sNewtype, 2, 2, newTypelistWithNext(TYPE_STR, newTypelist(TYPE_LAZ))));
-    insertPrimHash(cenv, "print", newPrimFunction(&prim_sPrint, 1, 1, newTypelist(TYPE_STR)));
-    insertPrimHash(cenv, "copy", newPrimFunction(&prim_sCopy, 1, 1, newTypelist(TYPE_STR)));
-    insertPrimHash(cenv, "size", newPrimFunction(&prim_sSize, 1, 1, newTypelist(TYPE_STR)));
-    insertPrimHash(cenv, "char", newPrimFunction(&prim_sChar, 2, 2, newTypelistWithNext(TYPE_STR, newTypelist(TYPE_INT))));
-    insertPrimHash(cenv, "substr", newPrimFunction(&prim_sSubstr, 2, 3, newTypelistWithNext(TYPE_STR, newTypelistWithNext(TYPE_INT, newTypelist(TYPE_INT)))));
-    insertPrimHash(cenv, "find", newPrimFunction(&prim_sFind, 2, 2, newTypelistWithNext(TYPE_STR, newTypelist(TYPE_UNK))));
-    insertPrimHash(cenv, "find-last", newPrimFunction(&prim_sFindlast, 2, 2, newTypelistWithNext(TYPE_STR, newTypelist(TYPE_UNK))));
-    insertPrimHash(cenv, "find-all", newPrimFunction(&prim_sFindall, 2, 2, newTypelistWithNext(TYPE_STR, newTypelist(TYPE_UNK))));
-    insertPrimHash(cenv, "contains", newPrimFunction(&prim_sContains, 1, 2, newTypelistWithNext(TYPE_STR, newTypelist(TYPE_INT))));
-    insertPrimHash(cenv, "+", newPrimFunction(&prim_sConcat, 1, ARGLEN_INF, newTypelist(TYPE_STR)));
-    insertPrimHash(cenv, "concat", newPrimFunction(&prim_sConcat, 1, ARGLEN_INF, newTypelist(TYPE_STR)));
-    insertPrimHash(cenv, "replace", newPrimFunction(&prim_sReplace, 3, 3, newTypelistWithNext(TYPE_STR, newTypelistWithNext(TYPE_STR, newTypelist(TYPE_STR)))));
-    ///insertPrimHash(cenv, "replace-at", newPrimFunction(&prim_sReplaceat, 3, 4, newTypelistWithNext(TYPE_STR, newTypelistWithNext(TYPE_STR, newTypelistWithNext(TYPE_INT, newTypelist(TYPE_INT)))));
-    insertPrimHash(cenv, "insert", newPrimFunction(&prim_sInsert, 3, 3, newTypelistWithNext(TYPE_STR, newTypelistWithNext(TYPE_STR, newTypelist(TYPE_STR)))));
-    ///insertPrimHash(cenv, "insert-at", newPrimFunction(&prim_sInsertat, 3, 3, newTypelist(TYPE_STR, newTypelistWithNext(TYPE_STR, newTypelist(TYPE_INT))));
-    insertPrimHash(cenv, "-", newPrimFunction(&prim_sRemove, 3, 3, newTypelistWithNext(TYPE_STR, newTypelistWithNext(TYPE_UNK, newTypelist(TYPE_UNK)))));
-    insertPrimHash(cenv, "remove", newPrimFunction(&prim_sRemove, 3, 3, newTypelistWithNext(TYPE_STR, newTypelistWithNext(TYPE_UNK, newTypelist(TYPE_UNK)))));
-    ///insertPrimHash(cenv, "remove-at", newPrimFunction(&prim_sRemoveat, 2, 3, newTypelist(TYPE_STR, newTypelistWithNext(TYPE_INT, newTypelist(TYPE_INT))));
-    insertPrimHash(cenv, "reverse", newPrimFunction(&prim_sReverse, 1, 1, newTypelist(TYPE_STR)));
-    insertPrimHash(cenv, "upper-case", newPrimFunction(&prim_sUpper, 1, 1, newTypelist(TYPE_STR)));
-    insertPrimHash(cenv, "lower-case", newPrimFunction(&prim_sLower, 1, 1, newTypelist(TYPE_STR)));
-    insertPrimHash(cenv, "sentence-case", newPrimFunction(&prim_sSentence, 1, 1, newTypelist(TYPE_STR)));
-    insertPrimHash(cenv, "title-case", newPrimFunction(&prim_sTitle, 1, 1, newTypelist(TYPE_STR)));
-    insertPrimHash(cenv, "int", newPrimFunction(&prim_sInt, 1, 1, newTypelist(TYPE_STR)));
-    insertPrimHash(cenv, "integer", newPrimFunction(&prim_sInt, 1, 1, newTypelist(TYPE_STR)));
-    insertPrimHash(cenv, "flo", newPrimFunction(&prim_sFlo, 1, 1, newTypelist(TYPE_STR)));
-    insertPrimHash(cenv, "float", newPrimFunction(&prim_sFlo, 1, 1, newTypelist(TYPE_STR)));
-    insertPrimHash(cenv, "str", newPrimFunction(&prim_sStr, 1, 1, newTypelist(TYPE_STR)));
-    insertPrimHash(cenv, "string", newPrimFunction(&prim_sStr, 1, 1, newTypelist(TYPE_STR)));
-    insertPrimHash(cenv, "arr", newPrimFunction(&prim_sArr, 1, 1, newTypelist(TYPE_STR)));
-    insertPrimHash(cenv, "array", newPrimFunction(&prim_sArr, 1, 1, newTypelist(TYPE_STR)));
-    insertPrimHash(cenv, "dat", newPrimFunction(&prim_sDat, 1, 1, newTypelist(TYPE_STR)));
-    insertPrimHash(cenv, "date", newPrimFunction(&prim_sDat, 1, 1, newTypelist(TYPE_STR)));
-    insertPrimHash(cenv, "typ", newPrimFunction(&prim_sTyp, 1, 1, newTypelist(TYPE_STR)));
-    insertPrimHash(cenv, "type", newPrimFunction(&prim_sTyp, 1, 1, newTypelist(TYPE_STR)));
-    insertPrimHash(cenv, "::", newPrimFunction(&prim_sTyp, 1, 1, newTypelist(TYPE_STR)));
-
-    ///insertPrimHash(cenv, "@", newPrimFunction(&prim_aValue, 2, 3, newTypelistWithNext(TYPE_ARR, newTypelistWithNext(TYPE_INT, newTypelist(TYPE_UNK)))));
-    ///insertPrimHash(cenv, "@@", newPrimFunction(&prim_aValues, 3, 4, newTypelistWithNext(TYPE_ARR, newTypelistWithNext(TYPE_INT, newTypelistWithNext(TYPE_INT, newTypelist(TYPE_UNK)))));
-    insertPrimHash(cenv, "size", newPrimFunction(&prim_aSize, 1, 2, newTypelistWithNext(TYPE_ARR, newTypelist(TYPE_INT))));
-    insertPrimHash(cenv, "+", newPrimFunction(&prim_aConcat, 1, ARGLEN_INF, newTypelist(TYPE_ARR)));
-    /**insertPrimHash(cenv, "-", newPrimFunction(&prim_aRemove, 1, ARGLEN_INF, newTypelist(TYPE_ARR)));
-    insertPrimHash(cenv, "*", newPrimFunction(&prim_aMultiply, 2, 2, newTypelistWithNext(TYPE_ARR, newTypelist(TYPE_UNK))));
-    insertPrimHash(cenv, "trim-left", newPrimFunction(&prim_aTriml, 2, 2, newTypelistWithNext(TYPE_ARR, newTypelist(TYPE_INT))));
-    insertPrimHash(cenv, "trim-right", newPrimFunction(&prim_aTrimr, 2, 2, newTypelistWithNext(TYPE_ARR, newTypelist(TYPE_INT))));
-    insertPrimHash(cenv, "reverse", newPrimFunction(&prim_aReverse, 1, 1, newTypelist(TYPE_ARR)));
-    insertPrimHash(cenv, "sort", newPrimFunction(&prim_aSort, 1, 2, newTypelistWithNext(TYPE_ARR, newTypelist(TYPE_FUN))));
-    insertPrimHash(cenv, "map", newPrimFunction(&prim_aMap, 2, 2, newTypelistWithNext(TYPE_ARR, newTypelist(TYPE_FUN))));
-    insertPrimHash(cenv, "filter", newPrimFunction(&prim_aFilter, 2, 2, newTypelistWithNext(TYPE_ARR, newTypelist(TYPE_FUN))));
-    insertPrimHash(cenv, "accum", newPrimFunction(&prim_aAccum, 3, 3, newTypelistWithNext(TYPE_ARR, newTypelistWithNext(TYPE_FUN, newTypelist(TYPE_UNK)))));*/
-    insertPrimHash(cenv, "str", newPrimFunction(&prim_aStr, 1, 1, newTypelist(TYPE_ARR)));
-    insertPrimHash(cenv, "string", newPrimFunction(&prim_aStr, 1, 1, newTypelist(TYPE_ARR)));
-    insertPrimHash(cenv, "typ", newPrimFunction(&prim_aTyp, 1, 1, newTypelist(TYPE_ARR)));
-    insertPrimHash(cenv, "type", newPrimFunction(&prim_aTyp, 1, 1, newTypelist(TYPE_ARR)));
-    insertPrimHash(cenv, "::", newPrimFunction(&prim_aTyp, 1, 1, newTypelist(TYPE_ARR)));
-
-    insertPrimHash(cenv, "year", newPrimFunction(&prim_dYear, 1, 1, newTypelist(TYPE_DAT)));
-    insertPrimHash(cenv, "month", newPrimFunction(&prim_dMonth, 1, 1, newTypelist(TYPE_DAT)));
-    insertPrimHash(cenv, "day", newPrimFunction(&prim_dDay, 1, 1, newTypelist(TYPE_DAT)));
-    insertPrimHash(cenv, "hour", newPrimFunction(&prim_dHour, 1, 1, newTypelist(TYPE_DAT)));
-    insertPrimHash(cenv, "minute", newPrimFunction(&prim_dMinute, 1, 1, newTypelist(TYPE_DAT)));
-    insertPrimHash(cenv, "second", newPrimFunction(&prim_dSecond, 1, 1, newTypelist(TYPE_DAT)));
-    insertPrimHash(cenv, "week-of-year", newPrimFunction(&prim_dWeekOfYear, 1, 1, newTypelist(TYPE_DAT)));
-    insertPrimHash(cenv, "week-of-month", newPrimFunction(&prim_dWeekOfMonth, 1, 1, newTypelist(TYPE_DAT)));
-    insertPrimHash(cenv, "day-of-year", newPrimFunction(&prim_dDayOfYear, 1, 1, newTypelist(TYPE_DAT)));
-    insertPrimHash(cenv, "day-of-week", newPrimFunction(&prim_dDayOfWeek, 1, 1, newTypelist(TYPE_DAT)));
-    insertPrimHash(cenv, "leap-year?", newPrimFunction(&prim_dLeapYear, 1, 1, newTypelist(TYPE_DAT)));
-    insertPrimHash(cenv, "days-in-month", newPrimFunction(&prim_dDaysInMonth, 1, 1, newTypelist(TYPE_DAT)));
-    insertPrimHash(cenv, "+years", newPrimFunction(&prim_dAddYears, 2, 2, newTypelistWithNext(TYPE_DAT, newTypelist(TYPE_INT))));
-    insertPrimHash(cenv, "+months", newPrimFunction(&prim_dAddMonths, 2, 2, newTypelistWithNext(TYPE_DAT, newTypelist(TYPE_INT))));
-    insertPrimHash(cenv, "+days", newPrimFunction(&prim_dAddDays, 2, 2, newTypelistWithNext(TYPE_DAT, newTypelist(TYPE_INT))));
-    insertPrimHash(cenv, "+hours", newPrimFunction(&prim_dAddHours, 2, 2, newTypelistWithNext(TYPE_DAT, newTypelist(TYPE_INT))));
-    insertPrimHash(cenv, "+minutes", newPrimFunction(&prim_dAddMinutes, 2, 2, newTypelistWithNext(TYPE_DAT, newTypelist(TYPE_INT))));
-    insertPrimHash(cenv, "+seconds", newPrimFunction(&prim_dAddSeconds, 2, 2, newTypelistWithNext(TYPE_DAT, newTypelist(TYPE_INT))));
-    insertPrimHash(cenv, "int", newPrimFunction(&prim_dInt, 1, 1, newTypelist(TYPE_DAT)));
-    insertPrimHash(cenv, "integer", newPrimFunction(&prim_dInt, 1, 1, newTypelist(TYPE_DAT)));
-    insertPrimHash(cenv, "str", newPrimFunction(&prim_dStr, 1, 1, newTypelist(TYPE_DAT)));
-    insertPrimHash(cenv, "string", newPrimFunction(&prim_dStr, 1, 1, newTypelist(TYPE_DAT)));
-    insertPrimHash(cenv, "dat", newPrimFunction(&prim_dDat, 1, 1, newTypelist(TYPE_DAT)));
-    insertPrimHash(cenv, "date", newPrimFunction(&prim_dDat, 1, 1, newTypelist(TYPE_DAT)));
-    insertPrimHash(cenv, "typ", newPrimFunction(&prim_dTyp, 1, 1, newTypelist(TYPE_DAT)));
-    insertPrimHash(cenv, "type", newPrimFunction(&prim_dTyp, 1, 1, newTypelist(TYPE_DAT)));
-    insertPrimHash(cenv, "::", newPrimFunction(&prim_dTyp, 1, 1, newTypelist(TYPE_DAT)));
-
-    insertPrimHash(cenv, "obj", newPrimFunction(&prim_oObj, 1, 1, newTypelist(TYPE_OBJ)));
-    insertPrimHash(cenv, "object", newPrimFunction(&prim_oObj, 1, 1, newTypelist(TYPE_OBJ)));
-    insertPrimHash(cenv, "typ", newPrimFunction(&prim_oTyp, 1, 1, newTypelist(TYPE_OBJ)));
-    insertPrimHash(cenv, "type", newPrimFunction(&prim_oTyp, 1, 1, newTypelist(TYPE_OBJ)));
-    insertPrimHash(cenv, "::", newPrimFunction(&prim_oTyp, 1, 1, newTypelist(TYPE_OBJ)));
-
-    insertPrimHash(cenv, "str", newPrimFunction(&prim_uStr, 1, 1, newTypelist(TYPE_FUN)));
-    insertPrimHash(cenv, "string", newPrimFunction(&prim_uStr, 1, 1, newTypelist(TYPE_FUN)));
-    insertPrimHash(cenv, "fun", newPrimFunction(&prim_uFun, 1, 1, newTypelist(TYPE_FUN)));
-    insertPrimHash(cenv, "function", newPrimFunction(&prim_uFun, 1, 1, newTypelist(TYPE_FUN)));
-    insertPrimHash(cenv, "typ", newPrimFunction(&prim_uTyp, 1, 1, newTypelist(TYPE_FUN)));
-    insertPrimHash(cenv, "type", newPrimFunction(&prim_uTyp, 1, 1, newTypelist(TYPE_FUN)));
-    insertPrimHash(cenv, "::", newPrimFunction(&prim_uTyp, 1, 1, newTypelist(TYPE_FUN)));
-
-    insertPrimHash(cenv, "new", newPrimFunction(&prim_tNew, 1, 2, newTypelistWithNext(TYPE_TYP, newTypelist(TYPE_LAZ))));
-    insertPrimHash(cenv, "obj", newPrimFunction(&prim_tNew, 1, 2, newTypelistWithNext(TYPE_TYP, newTypelist(TYPE_LAZ))));
-    insertPrimHash(cenv, "object", newPrimFunction(&prim_tNew, 1, 2, newTypelistWithNext(TYPE_TYP, newTypelist(TYPE_LAZ))));
-    insertPrimHash(cenv, "int", newPrimFunction(&prim_tInt, 1, 1, newTypelist(TYPE_TYP)));
-    insertPrimHash(cenv, "integer", newPrimFunction(&prim_tInt, 1, 1, newTypelist(TYPE_TYP)));
-    insertPrimHash(cenv, "str", newPrimFunction(&prim_tStr, 1, 1, newTypelist(TYPE_TYP)));
-    insertPrimHash(cenv, "string", newPrimFunction(&prim_tStr, 1, 1, newTypelist(TYPE_TYP)));
-    insertPrimHash(cenv, "typ", newPrimFunction(&prim_tTyp, 1, 1, newTypelist(TYPE_TYP)));
-    insertPrimHash(cenv, "type", newPrimFunction(&prim_tTyp, 1, 1, newTypelist(TYPE_TYP)));
-    insertPrimHash(cenv, "::", newPrimFunction(&prim_tTyp, 1, 1, newTypelist(TYPE_TYP)));
-
-    // initialize default variables
-    expression* expr;
-    expr = newExpressionOfType(TYPE_NIL);
-    insertUserHash(cenv, "nil", expr);
-    expr = newExpressionOfType(TYPE_INT);
-    expr->ev.intval = 1;
-    insertUserHash(cenv, "true", expr);
-    expr = newExpressionOfType(TYPE_INT);
-    expr->ev.intval = 0;
-    insertUserHash(cenv, "false", expr);
-    expr = newExpressionOfType(TYPE_INT);
-    expr->ev.intval = ERR_GENERAL;
-    insertUserHash(cenv, "general-error", expr);
-    expr = newExpressionOfType(TYPE_INT);
-    expr->ev.intval = ERR_INVALID_ARG;
-    insertUserHash(cenv, "inval-arg-error", expr);
-    expr = newExpressionOfType(TYPE_INT);
-    expr->ev.intval = ERR_INVALID_NUM_ARGS;
-    insertUserHash(cenv, "inval-num-args-error", expr);
-    expr = newExpressionOfType(TYPE_FLO);
-    expr->ev.floval = PI;
-    insertUserHash(cenv, "pi", expr);
-    expr = newExpressionOfType(TYPE_FLO);
-    expr->ev.floval = E;
-    insertUserHash(cenv, "e", expr);
-    expr = newExpressionOfType(TYPE_TYP);
-    expr->ev.intval = TYPE_NIL;
-    insertUserHash(cenv, "nil", expr);
-    expr = newExpressionOfType(TYPE_TYP);
-    expr->ev.intval = TYPE_EXP;
-    insertUserHash(cenv, "exp", expr);
-    expr = newExpressionOfType(TYPE_TYP);
-    expr->ev.intval = TYPE_EXP;
-    insertUserHash(cenv, "expression", expr);
-    expr = newExpressionOfType(TYPE_TYP);
-    expr->ev.intval = TYPE_LAZ;
-    insertUserHash(cenv, "laz", expr);
-    expr = newExpressionOfType(TYPE_TYP);
-    expr->ev.intval = TYPE_LAZ;
-    insertUserHash(cenv, "lazy-expression", expr);
-    expr = newExpressionOfType(TYPE_TYP);
-    expr->ev.intval = TYPE_INT;
-    insertUserHash(cenv, "int", expr);
-    expr = newExpressionOfType(TYPE_TYP);
-    expr->ev.intval = TYPE_INT;
-    insertUserHash(cenv, "integer", expr);
-    expr = newExpressionOfType(TYPE_TYP);
-    expr->ev.intval = TYPE_FLO;
-    insertUserHash(cenv, "flo", expr);
-    expr = newExpressionOfType(TYPE_TYP);
-    expr->ev.intval = TYPE_FLO;
-    insertUserHash(cenv, "float", expr);
-    expr = newExpressionOfType(TYPE_TYP);
-    expr->ev.intval = TYPE_STR;
-    insertUserHash(cenv, "str", expr);
-    expr = newExpressionOfType(TYPE_TYP);
-    expr->ev.intval = TYPE_STR;
-    insertUserHash(cenv, "string", expr);
-    expr = newExpressionOfType(TYPE_TYP);
-    expr->ev.intval = TYPE_ARR;
-    insertUserHash(cenv, "arr", expr);
-    expr = newExpressionOfType(TYPE_TYP);
-    expr->ev.intval = TYPE_ARR;
-    insertUserHash(cenv, "array", expr);
-    expr = newExpressionOfType(TYPE_TYP);
-    expr->ev.intval = TYPE_DAT;
-    insertUserHash(cenv, "dat", expr);
-    expr = newExpressionOfType(TYPE_TYP);
-    expr->ev.intval = TYPE_DAT;
-    insertUserHash(cenv, "date", expr);
-    expr = newExpressionOfType(TYPE_TYP);
-    expr->ev.intval = TYPE_OBJ;
-    insertUserHash(cenv, "obj", expr);
-    expr = newExpressionOfType(TYPE_TYP);
-    expr->ev.intval = TYPE_OBJ;
-    insertUserHash(cenv, "object", expr);
-    expr = newExpressionOfType(TYPE_TYP);
-    expr->ev.intval = TYPE_FUN;
-    insertUserHash(cenv, "fun", expr);
-    expr = newExpressionOfType(TYPE_TYP);
-    expr->ev.intval = TYPE_FUN;
-    insertUserHash(cenv, "function", expr);
-    expr = newExpressionOfType(TYPE_TYP);
-    expr->ev.intval = TYPE_TYP;
-    insertUserHash(cenv, "typ", expr);
-    expr = newExpressionOfType(TYPE_TYP);
-    expr->ev.intval = TYPE_TYP;
-    insertUserHash(cenv, "type", expr);
-
-    // initialize the first ID composite types can be assigned to
-    ctypeid = TYPE_COMP_START;
-
-    // initialize the error list
-    errors = NULL;
-    cerror = errors;
-
-    // initialize the monthdays array, which contains the number of days elapsed in the year by each month
-    monthdays[0] = 31;
-    monthdays[1] = 59;
-    monthdays[2] = 90;
-    monthdays[3] = 120;
-    monthdays[4] = 151;
-    monthdays[5] = 181;
-    monthdays[6] = 212;
-    monthdays[7] = 243;
-    monthdays[8] = 273;
-    monthdays[9] = 304;
-    monthdays[10] = 334;
-    monthdays[11] = 365;
+    ccontext = newContext();
 }
 
-/*! Frees all of the memory that global variables have reserved
+/*! Frees all of the memory that global variables have reserved, including the calling thread's context
     @return     nothing
 */
 void freeGlobals () {
-    int i;
-    for (i = 0; i < INITIAL_ENV_COUNT; ++i) { // for every environment
-        deleteHash(environments[i]->variables); // delete the environment and its hashtable
-        free(environments[i]);
-    }
-    while (errors != NULL) { // delete the list of errors
-        errorlist* error = errors->next;
-        free(errors->message->content);
-        free(errors->message);
-        free(errors);
-        errors = error;
-    }
-    cerror = NULL;
+    freeContext(ccontext);
+    ccontext = NULL;
+}
+
+/*! Makes the given context the one the calling thread interprets code in; each thread has its own current context so independent contexts can be used in parallel
+    @param context  the context to use (may be null)
+    @return         the context that was previously current
+*/
+tap_context* setContext (tap_context* context) {
+    tap_context* previous = ccontext;
+    ccontext = context;
+    return previous;
+}
+
+/*! Returns the context the calling thread currently interprets code in
+    @return     the current context or null if there isn't one
+*/
+tap_context* getContext () {
+    return ccontext;
 }
 
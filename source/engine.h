@@ -20,15 +20,23 @@ void storeChildExpression(expression*, expression*);
 expression* evaluate(expression*);
 expression* evaluateExp(expression*);
 expression* evaluateLaz(expression*);
+expression* evaluateBody(expression*);
+expression* forceLaz(expression*);
 expression* evaluateInt(expression*);
 expression* evaluateFlo(expression*);
 expression* evaluateFun(expression*);
+int specialForm(expression*);
+expression* evaluateSpecialForm(int, expression*);
+int evaluateCondition(expression*);
+expression* evaluateBranch(expression*);
 int numArgs(expression*);
 void fillArgs(expression*, expression*[], int);
 int freeArgs(expression*[], int);
 tap_fun_search findFunction(expression*, expression*[], int);
+int validFunTypes(tap_fun*, expression*[], int);
 expression* callFun(tap_fun_search, expression*, expression*[], int);
-expression* callPrimFun(tap_prim_fun*, expression*[], int);
+expression* callPrimFun(const tap_prim_fun*, expression*[], int);
+expression* callPrimKernel(const tap_prim_fun*, expression*[], int);
 int validFunCall(tap_fun*, expression*, expression*[], int);
 expression* callTapFun(tap_fun*, expression*[], int);
 expression* evaluateArr(expression*);
@@ -41,10 +49,14 @@ expression* expressionsToArray(expression*);
 char* printExpression(expression*);
 char* printErrors();
 void addError(errorlist*);
+void clearErrors();
 char* errorCodeString(uint);
 int errorCodeStringSize(uint);
 void addToEnvironment(char*, expression*);
+void noteBinding(int);
 void setEnvironment();
+void reserveEnvironment();
+void loopEnvironment();
 void resetEnvironment();
 expression* getVarValue(char*);
 expression* getExprValue(expression*);
@@ -55,6 +67,8 @@ datatype typeFromString(char*);
 char* printArg(argument*);
 void initializeGlobals();
 void freeGlobals();
+tap_context* setContext(tap_context*);
+tap_context* getContext();
 
 #endif
 
@@ -9,12 +9,9 @@
 #define EXTERNS_H
 
 #include "constants.h"
+#include "dep_structs.h"
 
-environment* environments[INITIAL_ENV_COUNT];
-uint cenvironment;
-datatype ctypeid;
-errorlist* errors;
-errorlist* cerror;
-int monthdays[MON_IN_YEAR];
+extern __thread tap_context* ccontext; // the interpreter state used by the calling thread
+extern const int monthdays[MON_IN_YEAR];
 
 #endif
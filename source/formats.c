@@ -0,0 +1,465 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   formats.c
+    @brief  Formats, which are compiled once from a template and then fill in its fields with a single allocation
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <float.h>
+
+#include "formats.h"
+#include "constants.h"
+#include "constructors.h"
+#include "memory.h"
+#include "strings.h"
+#include "numbers.h"
+#include "dates.h"
+#include "casting.h"
+#include "engine.h"
+
+/* A template is literal text with fields in braces, each {[argument][:spec]}: the number of the argument the field writes (or,
+   if none is given, the one after the previous field's) and how it's written, [[fill]align][0][width][.precision][conversion].
+   A doubled brace stands for itself. The template is parsed once into a list of operations that either copy literal text out
+   of it or write a field, so filling it in only works out the text of each field (numbers go into scratch space, strings are
+   used where they are), adds up the exact size of the result, then writes the result in one pass. */
+
+#define FORMAT_OP_TEXT 0 // copy size bytes of the template from start
+#define FORMAT_OP_FIELD 1 // write an argument
+
+#define FORMAT_FIXED_SIZE (DBL_MAX_10_EXP + FORMAT_MAX_PRECISION + 4) // the most bytes a float is written in with a precision: a sign, its whole digits, a point, its fraction and a null
+#define FORMAT_DEFAULT_PRECISION 6 // the digits written after the point of a float converted with f when no precision is given
+#define FORMAT_DEFAULT_DATE "%M/%D/%Y %H:%U:%S %P" // the format a date is written in when its field gives none, the same one str uses
+
+typedef struct fmtparser_ fmtparser;
+typedef struct fmtpiece_ fmtpiece;
+
+struct fmtparser_ {
+    char* text;
+    int size;
+    int pos;
+    fmtop* ops;
+    uint numops;
+    char* dates; // the formats of the date fields, each null terminated
+    int datessize;
+    int nextarg; // the argument a field that doesn't name one writes
+    uint numargs;
+    char* error; // what's wrong with the template, or null if nothing is yet
+};
+
+struct fmtpiece_ {
+    char* text; // the field's text, or null if it's in the scratch space
+    int offset; // where the field's text starts in the scratch space
+    int size;
+    int numeric; // whether the field is a number, which is padded on the left unless an alignment is given
+    int owned; // whether the text was allocated for the field and must be freed
+};
+
+static void addText(fmtparser*, int, int);
+static void parseField(fmtparser*);
+static void parseSpec(fmtparser*, fmtop*);
+static int parseDigits(fmtparser*, int, int*);
+static int isAlignment(char);
+static int isConversion(char);
+static void writeField(tap_fmt*, fmtop*, expression*, fmtpiece*, char*, char**);
+static char* padField(char*, fmtop*, fmtpiece*, char*);
+
+/*! Compiles the given template into a format
+    @param template     the template, which may contain null characters
+    @param size         the size of the template
+    @param error        set to what's wrong with the template if it can't be compiled
+    @return             the new format, or null if the template can't be compiled
+*/
+tap_fmt* newFormat (char* template, int size, char** error) {
+    fmtparser parser = {.text = template, .size = size, .pos = 0, .numops = 0, .datessize = 0, .nextarg = 0, .numargs = 0, .error = NULL};
+    parser.ops = allocate(sizeof(fmtop) * (size + 1)); // every operation takes up at least one byte of the template
+    parser.dates = allocate(size + 1);
+    while (parser.pos < size && parser.error == NULL) {
+        char c = template[parser.pos];
+        if ((c == '{' || c == '}') && parser.pos + 1 < size && template[parser.pos + 1] == c) { // a doubled brace stands for itself
+            addText(&parser, parser.pos, 1);
+            parser.pos += 2;
+        } else if (c == '{') {
+            parseField(&parser);
+        } else if (c == '}') {
+            parser.error = "unmatched closing brace";
+        } else {
+            int start = parser.pos;
+            while (parser.pos < size && template[parser.pos] != '{' && template[parser.pos] != '}') {
+                ++parser.pos;
+            }
+            addText(&parser, start, parser.pos - start);
+        }
+    }
+    if (parser.error != NULL) {
+        *error = parser.error;
+        free(parser.ops);
+        free(parser.dates);
+        return NULL;
+    }
+    tap_fmt* fmt = allocate(sizeof(tap_fmt));
+    fmt->source = newStringCopy(template, size);
+    fmt->ops = parser.ops;
+    fmt->numops = parser.numops;
+    fmt->dates = parser.dates;
+    fmt->numargs = parser.numargs;
+    fmt->owners = 1;
+    return fmt;
+}
+
+/*! Adds another owner to the given format, which is never changed once it's compiled so every owner can use it at once
+    @param fmt          the format
+    @return             the same format
+*/
+tap_fmt* shareFormat (tap_fmt* fmt) {
+    __atomic_add_fetch(&fmt->owners, 1, __ATOMIC_RELAXED);
+    return fmt;
+}
+
+/*! Removes an owner from the given format, freeing it once it has none left
+    @param fmt          the format
+    @return             0
+*/
+bool freeFormat (tap_fmt* fmt) {
+    if (__atomic_sub_fetch(&fmt->owners, 1, __ATOMIC_ACQ_REL) > 0) {
+        return 0;
+    }
+    freeStr(fmt->source);
+    free(fmt->ops);
+    free(fmt->dates);
+    free(fmt);
+    return 0;
+}
+
+/*! Fills in the fields of the given format with the given arguments
+    @param fmt          the format
+    @param args         the arguments the fields write
+    @param numargs      the number of arguments
+    @param error        set to what's wrong if the arguments don't suit the format
+    @return             the new string, or null if the arguments don't suit the format
+*/
+string* applyFormat (tap_fmt* fmt, expression* args[], int numargs, char** error) {
+    if (numargs < (int)fmt->numargs) {
+        *error = "too few arguments for its fields";
+        return NULL;
+    }
+    fmtpiece localpieces[FORMAT_STACK_FIELDS];
+    fmtpiece* pieces = fmt->numops <= FORMAT_STACK_FIELDS ? localpieces : allocate(sizeof(fmtpiece) * fmt->numops);
+    char localscratch[FORMAT_SCRATCH_SIZE];
+    char* scratch = localscratch;
+    int capacity = FORMAT_SCRATCH_SIZE;
+    int used = 0;
+    int size = 0; // the size of the result
+    string* result = NULL;
+    uint numdone;
+    *error = NULL;
+    for (numdone = 0; numdone < fmt->numops && *error == NULL; ++numdone) { // work out the text of each field and so the size of the result
+        fmtop* op = &fmt->ops[numdone];
+        if (op->kind == FORMAT_OP_TEXT) {
+            size += op->size;
+            continue;
+        }
+        if (capacity - used < FORMAT_FIXED_SIZE) { // make sure there's room for the longest number a field can write
+            capacity = 2 * capacity + FORMAT_FIXED_SIZE;
+            char* grown = allocate(capacity);
+            memcpy(grown, scratch, used);
+            if (scratch != localscratch) {
+                free(scratch);
+            }
+            scratch = grown;
+        }
+        fmtpiece* piece = &pieces[numdone];
+        writeField(fmt, op, args[op->arg], piece, scratch + used, error);
+        piece->offset = used;
+        if (piece->text == NULL) {
+            used += piece->size;
+        }
+        size += piece->size > op->width ? piece->size : op->width;
+    }
+    if (*error == NULL) {
+        result = newStringOfSize(size);
+        char* dest = result->content;
+        uint i;
+        for (i = 0; i < fmt->numops; ++i) {
+            fmtop* op = &fmt->ops[i];
+            if (op->kind == FORMAT_OP_TEXT) {
+                memcpy(dest, fmt->source->content + op->start, op->size);
+                dest += op->size;
+            } else {
+                dest = padField(dest, op, &pieces[i], scratch);
+            }
+        }
+    }
+    uint i;
+    for (i = 0; i < numdone; ++i) {
+        if (fmt->ops[i].kind == FORMAT_OP_FIELD && pieces[i].owned) {
+            free(pieces[i].text);
+        }
+    }
+    if (pieces != localpieces) {
+        free(pieces);
+    }
+    if (scratch != localscratch) {
+        free(scratch);
+    }
+    return result;
+}
+
+/*! Adds an operation that copies the given range of the template, extending the previous one if it copies the range just before
+    @param parser       the parser
+    @param start        where the range starts in the template
+    @param size         the size of the range
+    @return             nothing
+*/
+static void addText (fmtparser* parser, int start, int size) {
+    if (parser->numops > 0) {
+        fmtop* last = &parser->ops[parser->numops - 1];
+        if (last->kind == FORMAT_OP_TEXT && last->start + last->size == start) {
+            last->size += size;
+            return;
+        }
+    }
+    fmtop* op = &parser->ops[parser->numops++];
+    op->kind = FORMAT_OP_TEXT;
+    op->start = start;
+    op->size = size;
+}
+
+/*! Parses the field that starts at the parser's position (at its opening brace) into an operation
+    @param parser       the parser
+    @return             nothing
+*/
+static void parseField (fmtparser* parser) {
+    fmtop* op = &parser->ops[parser->numops];
+    op->kind = FORMAT_OP_FIELD;
+    op->fill = ' ';
+    op->align = 0; // numbers go on the right and everything else on the left
+    op->conversion = 0;
+    op->arg = parser->nextarg;
+    op->width = 0;
+    op->precision = -1;
+    op->start = 0;
+    op->size = 0;
+    ++parser->pos; // skip the opening brace
+    if (parser->pos < parser->size && parser->text[parser->pos] >= '0' && parser->text[parser->pos] <= '9') {
+        if (!parseDigits(parser, FORMAT_MAX_ARG, &op->arg)) {
+            parser->error = "argument number too large";
+            return;
+        }
+    }
+    if (parser->pos < parser->size && parser->text[parser->pos] == ':') {
+        ++parser->pos;
+        parseSpec(parser, op);
+        if (parser->error != NULL) {
+            return;
+        }
+    }
+    if (parser->pos >= parser->size) {
+        parser->error = "unclosed brace";
+        return;
+    }
+    if (parser->text[parser->pos] != '}') {
+        parser->error = "invalid field";
+        return;
+    }
+    ++parser->pos;
+    ++parser->numops;
+    parser->nextarg = op->arg + 1;
+    if ((uint)op->arg >= parser->numargs) {
+        parser->numargs = op->arg + 1;
+    }
+}
+
+/*! Parses how a field is written, [[fill]align][0][width][.precision][conversion], from the parser's position
+    @param parser       the parser
+    @param op           the field's operation
+    @return             nothing
+*/
+static void parseSpec (fmtparser* parser, fmtop* op) {
+    char* text = parser->text;
+    int size = parser->size;
+    if (parser->pos + 1 < size && isAlignment(text[parser->pos + 1])) {
+        op->fill = text[parser->pos];
+        op->align = text[parser->pos + 1];
+        parser->pos += 2;
+    } else if (parser->pos < size && isAlignment(text[parser->pos])) {
+        op->align = text[parser->pos++];
+    }
+    if (op->align == 0 && parser->pos < size && text[parser->pos] == '0') { // pad with zeros after the sign
+        op->fill = '0';
+        op->align = '=';
+        ++parser->pos;
+    }
+    if (parser->pos < size && text[parser->pos] >= '0' && text[parser->pos] <= '9' && !parseDigits(parser, FORMAT_MAX_WIDTH, &op->width)) {
+        parser->error = "width too large";
+        return;
+    }
+    if (parser->pos < size && text[parser->pos] == '.') {
+        ++parser->pos;
+        if (parser->pos >= size || text[parser->pos] < '0' || text[parser->pos] > '9') {
+            parser->error = "missing precision";
+            return;
+        }
+        if (!parseDigits(parser, FORMAT_MAX_PRECISION, &op->precision)) {
+            parser->error = "precision too large";
+            return;
+        }
+    }
+    if (parser->pos < size && isConversion(text[parser->pos])) {
+        op->conversion = text[parser->pos++];
+    }
+    if (op->conversion == 't') { // the rest of the field is the format of the date
+        int start = parser->pos;
+        while (parser->pos < size && text[parser->pos] != '}') {
+            ++parser->pos;
+        }
+        op->start = parser->datessize;
+        op->size = parser->pos - start;
+        memcpy(parser->dates + parser->datessize, text + start, op->size);
+        parser->dates[parser->datessize + op->size] = '\0';
+        parser->datessize += op->size + 1;
+    }
+}
+
+/*! Parses the decimal number at the parser's position
+    @param parser       the parser
+    @param max          the largest the number can be
+    @param value        set to the number
+    @return             1 if the number is no larger than the given maximum, 0 otherwise
+*/
+static int parseDigits (fmtparser* parser, int max, int* value) {
+    int number = 0;
+    int fits = 1;
+    while (parser->pos < parser->size && parser->text[parser->pos] >= '0' && parser->text[parser->pos] <= '9') {
+        number = number * 10 + parser->text[parser->pos++] - '0';
+        if (number > max) {
+            fits = 0;
+            number = max;
+        }
+    }
+    *value = number;
+    return fits;
+}
+
+/*! Returns whether or not the given character aligns a field
+    @param c            the character
+    @return             1 if it does, 0 if it doesn't
+*/
+static int isAlignment (char c) {
+    return c == '<' || c == '>' || c == '^' || c == '=';
+}
+
+/*! Returns whether or not the given character converts a field: d (an integer), x or X (in hexadecimal), o (in octal), b (in binary),
+    f (a float with a fixed number of digits after its point), s (a string, or anything else as one) or t (a date)
+    @param c            the character
+    @return             1 if it does, 0 if it doesn't
+*/
+static int isConversion (char c) {
+    return c == 'd' || c == 'x' || c == 'X' || c == 'o' || c == 'b' || c == 'f' || c == 's' || c == 't';
+}
+
+/*! Works out the text of the given field, writing a number into the given scratch space
+    @param fmt          the format
+    @param op           the field's operation
+    @param value        the argument the field writes
+    @param piece        set to the field's text
+    @param dest         where a number is written, which has room for FORMAT_FIXED_SIZE bytes
+    @param error        set to what's wrong if the argument can't be written with the field's conversion
+    @return             nothing
+*/
+static void writeField (tap_fmt* fmt, fmtop* op, expression* value, fmtpiece* piece, char* dest, char** error) {
+    piece->text = NULL;
+    piece->size = 0;
+    piece->numeric = 0;
+    piece->owned = 0;
+    int isnumber = value->type == TYPE_INT || value->type == TYPE_FLO;
+    switch (op->conversion) {
+        case 'd':
+        case 'x':
+        case 'X':
+        case 'o':
+        case 'b':
+            if (!isnumber) {
+                break;
+            }
+            piece->size = formatInt(dest, castToInt(value), op->conversion == 'd' ? 10 : op->conversion == 'o' ? 8 : op->conversion == 'b' ? 2 : 16); // a float is rounded
+            if (op->conversion == 'x') {
+                convertCase(dest, dest, piece->size, CASE_LOWER);
+            }
+            piece->numeric = 1;
+            return;
+        case 'f':
+            if (!isnumber) {
+                break;
+            }
+            piece->size = snprintf(dest, FORMAT_FIXED_SIZE, "%.*f", op->precision < 0 ? FORMAT_DEFAULT_PRECISION : op->precision, value->type == TYPE_INT ? (tap_flo)value->ev.intval : value->ev.floval);
+            piece->numeric = 1;
+            return;
+        case 't':
+            if (value->type != TYPE_DAT) {
+                break;
+            }
+            piece->text = printDate(value->ev.datval, op->size > 0 ? fmt->dates + op->start : FORMAT_DEFAULT_DATE);
+            piece->size = strlen(piece->text);
+            piece->owned = 1;
+            return;
+        default: // write the argument as a string
+            if (value->type == TYPE_INT) {
+                piece->size = formatInt(dest, value->ev.intval, BASE);
+            } else if (value->type == TYPE_FLO && op->precision >= 0 && op->conversion == 0) { // a precision without a conversion fixes the digits after a float's point
+                piece->size = snprintf(dest, FORMAT_FIXED_SIZE, "%.*f", op->precision, value->ev.floval);
+            } else if (value->type == TYPE_FLO) {
+                piece->size = formatFlo(dest, value->ev.floval);
+            } else if (value->type == TYPE_STR) {
+                piece->text = value->ev.strval->content;
+                piece->size = value->ev.strval->size;
+            } else { // anything else is written as a string it casts to or, failing that, as it's printed
+                string* str = castToStr(value);
+                if (str != NULL) {
+                    piece->size = str->size;
+                    piece->text = releaseString(str);
+                } else {
+                    piece->text = printExpression(value);
+                    piece->size = strlen(piece->text);
+                }
+                piece->owned = 1;
+            }
+            piece->numeric = isnumber && op->conversion == 0;
+            if (op->conversion == 's' && op->precision >= 0 && piece->size > op->precision) { // a precision on a string is the most of it written
+                piece->size = op->precision;
+            }
+            return;
+    }
+    *error = "an argument doesn't suit its field's conversion";
+}
+
+/*! Writes the given field's text padded to its width
+    @param dest         where to write the field
+    @param op           the field's operation
+    @param piece        the field's text
+    @param scratch      the scratch space the text of numbers was written into
+    @return             where the field ends
+*/
+static char* padField (char* dest, fmtop* op, fmtpiece* piece, char* scratch) {
+    char* text = piece->text != NULL ? piece->text : scratch + piece->offset;
+    int size = piece->size;
+    int padding = op->width - size;
+    if (padding <= 0) {
+        memcpy(dest, text, size);
+        return dest + size;
+    }
+    char align = op->align != 0 ? op->align : piece->numeric ? '>' : '<';
+    int before = align == '<' ? 0 : align == '^' ? padding / 2 : padding;
+    if (align == '=' && piece->numeric && size > 0 && text[0] == '-') { // the sign goes before the padding
+        *dest++ = *text++;
+        --size;
+    }
+    memset(dest, op->fill, before);
+    dest += before;
+    memcpy(dest, text, size);
+    dest += size;
+    memset(dest, op->fill, padding - before);
+    return dest + padding - before;
+}
@@ -0,0 +1,41 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   formats.h
+    @brief  The header file for formats.c
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#ifndef FORMATS_H
+#define FORMATS_H
+
+#include "structs.h"
+
+typedef struct fmtop_ fmtop;
+
+struct fmtop_ {
+    unsigned char kind; // what the operation writes, one of the FORMAT_OP codes
+    char fill; // the byte a field is padded with
+    char align; // how a field is padded to its width: '<', '>', '^', or '=' to pad between a number's sign and its digits
+    char conversion; // the letter a field is converted with, or 0 to write its value as str would
+    int arg; // the argument a field writes
+    int width; // the fewest bytes a field takes up
+    int precision; // the digits after the point of a float or the most bytes of a string, or -1 if none is given
+    int start; // where the literal text starts in the template, or where a date's format starts in the format's dates
+    int size;
+};
+
+struct tap_fmt_ {
+    string* source; // the template the format was compiled from, which also holds its literal text
+    fmtop* ops;
+    uint numops;
+    char* dates; // the formats of the date fields, each null terminated
+    uint numargs; // the number of arguments the fields refer to
+    uint owners; // the number of expressions, in any context, that refer to the format, which never changes once it's compiled
+};
+
+tap_fmt* newFormat(char*, int, char**);
+tap_fmt* shareFormat(tap_fmt*);
+bool freeFormat(tap_fmt*);
+string* applyFormat(tap_fmt*, expression*[], int, char**);
+
+#endif
@@ -148,6 +148,25 @@ inline int insertDirectHash (hashtable* table, char* key, void* value) {
     return insertFlaggedHash(table, key, value, HFLAG_DIRECT);
 }
 
+/*! Replaces the value of the user variable with the given key in place, freeing the old value, or inserts it if the table doesn't have one yet
+    @param table    the pointer to the appropriate hash table
+    @param key      the string key used to generate the hashsum
+    @param value    the value to be stored in the table
+    @return         1 if an existing value was replaced, otherwise 0
+*/
+int setUserHash (hashtable* table, char* key, void* value) {
+    hashelement* list;
+    for (list = lookupHashList(table, key); list != NULL; list = list->next) { // for each element at this key's hashsum
+        if (list->flag == HFLAG_USER && strcmp(key, list->key) == 0) { // if the user variable already exists
+            freeExpr(list->value);
+            list->value = value;
+            return 1;
+        }
+    }
+    insertUserHash(table, key, value);
+    return 0;
+}
+
 /*! Inserts an element into the given hash table using the given key and marking it as a user variable
     @param table    the pointer to the appropriate hash table
     @param key      the string key used to generate the hashsum
@@ -215,12 +234,6 @@ static void deleteHash_ (hashtable* table, int deletetable) {
             list = list->next; // advance to the next item
             free(temp->key); // free the memory of the string key
             if (temp->flag == HFLAG_PRIM) { // if the element is a primitive function then free it
-                typelist* types = ((tap_prim_fun*)temp->value)->types;
-                while (types != NULL) {
-                    typelist* tempat = types->next;
-                    free(types);
-                    types = tempat;
-                }
                 free(temp->value);
             } else if (temp->flag == HFLAG_USER) { // if the element is a user expression then free it
                 freeExpr(temp->value);
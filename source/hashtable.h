@@ -32,7 +32,7 @@ struct hashtable_ {
 
 struct hashlist_ {
     void* value;
-    uint flag:1;
+    uint flag:2;
     hashlist* next;
 };
 
@@ -46,6 +46,7 @@ hashelement* lookupHashList(hashtable*, char*);
 int insertPrimHash(hashtable*, char*, void*);
 int insertUserHash(hashtable*, char*, void*);
 int insertDirectHash(hashtable*, char*, void*);
+int setUserHash(hashtable*, char*, void*);
 int insertHash(hashtable*, char*, void*);
 void clearHash(hashtable*);
 void deleteHash(hashtable*);
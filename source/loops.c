@@ -0,0 +1,515 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   loops.c
+    @brief  Plans of loop bodies, which resolve the names a body refers to once rather than on every pass through the loop
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "loops.h"
+#include "engine.h"
+#include "externs.h"
+#include "constants.h"
+#include "builtins.h"
+#include "packages.h"
+#include "scheduler.h"
+#include "casting.h"
+#include "strings.h"
+#include "memory.h"
+#include "constructors.h"
+#include "../primitives/prim_str.h"
+
+/* A loop's body is planned in the environment it's evaluated in, the first time the loop runs it. Each expression becomes a node
+   that already knows which variable a name refers to (keeping its hash element, whose value is read and written in place) and
+   which primitives a call's name means, so a pass through the loop neither walks the environments nor searches the built-ins.
+   Integers and floats are passed between nodes unboxed, and a call whose arguments all have its primitive's kernel type goes
+   straight to the kernel. Anything the plan can't be sure of, like a user function, a special form, or a name a package will
+   define, is evaluated the usual way.
+
+   A plan only stays right while no name is bound anew where it resolves names, since a new binding can shadow a variable or a
+   primitive it found. So while a loop runs, the context counts the names bound at or below the loop's environment; a node
+   that sees the count change falls back to the usual evaluation, and the body is planned again before its next pass. */
+
+static void planBody(loopbody*);
+static loopnode* planNode(expression*);
+static void planCall(loopnode*, expression*);
+static hashelement* findBinding(char*);
+static hashelement* findSetTarget(char*);
+static int nameBound(char*);
+static inline void runNode(loopbody*, loopnode*);
+static void runCall(loopbody*, loopnode*);
+static void callUsually(loopnode*);
+static void choosePrimitive(loopnode*);
+static int runKernel(loopnode*);
+static void storeValue(hashelement*, loopvalue*);
+static void readValue(expression*, loopvalue*);
+static loopvalue unboxValue(expression*);
+static expression* boxValue(loopvalue*);
+static void freeNodes(loopnode**, int);
+
+/*! Creates a loop body for the given lazy expression, which is planned the first time it's run; the current environment must be the loop's own
+    @param body         the lazy expression the loop evaluates
+    @return             the new loop body
+*/
+loopbody* newLoopBody (expression* body) {
+    loopbody* loop = allocate(sizeof(loopbody));
+    loop->body = body;
+    loop->context = ccontext;
+    loop->nodes = NULL;
+    loop->numnodes = 0;
+    loop->rebinds = 0;
+    loop->watchenv = ccontext->watchenv;
+    loop->last = NULL;
+    if (ccontext->watchenv < (int)ccontext->cenvironment) { // an inner loop watches its own environment as well as the outer loop's
+        ccontext->watchenv = ccontext->cenvironment;
+    }
+    return loop;
+}
+
+/*! Evaluates the given loop body once in the current environment, keeping the result of its last expression; the body is planned again first if its plan is stale
+    @param loop         the loop body to evaluate
+    @return             nothing
+*/
+void runLoopBody (loopbody* loop) {
+    if (loop->nodes == NULL || loop->rebinds != loop->context->rebinds) {
+        planBody(loop);
+    }
+    int i;
+    for (i = 0; i < loop->numnodes; ++i) {
+        if (loop->last != NULL && loop->last->boxed != NULL) { // only the result of the body's last expression is kept
+            freeExpr(loop->last->boxed);
+            loop->last->boxed = NULL;
+        }
+        runNode(loop, loop->nodes[i]); // variables set by the body stay in the current environment
+        loop->last = &loop->nodes[i]->value;
+    }
+}
+
+/*! Returns whether or not the result of the given loop body's last evaluation is true; an empty body's result is nil, which is false
+    @param loop         the loop body
+    @return             1 if the result is true, 0 otherwise
+*/
+int loopBodyTruth (loopbody* loop) {
+    if (loop->last == NULL) {
+        return 0;
+    }
+    if (loop->last->type == TYPE_INT) {
+        return loop->last->ev.intval != 0;
+    }
+    expression* value = boxValue(loop->last);
+    int truth = castToInt(value) != 0;
+    *loop->last = unboxValue(value);
+    return truth;
+}
+
+/*! Returns the result of the given loop body's last evaluation, which then belongs to the caller
+    @param loop         the loop body
+    @return             the result, or nil if the body was never evaluated or is empty
+*/
+expression* loopBodyResult (loopbody* loop) {
+    if (loop->last == NULL) {
+        return newExpressionNil();
+    }
+    expression* result = boxValue(loop->last);
+    loop->last->boxed = NULL;
+    loop->last = NULL;
+    return result;
+}
+
+/*! Frees the given loop body and its plan, and stops watching the loop's environment for new bindings
+    @param loop         the loop body to free
+    @return             nothing
+*/
+void freeLoopBody (loopbody* loop) {
+    ccontext->watchenv = loop->watchenv;
+    if (loop->last != NULL) {
+        freeExpr(loop->last->boxed);
+    }
+    freeNodes(loop->nodes, loop->numnodes);
+    free(loop);
+}
+
+/*! Plans each expression of the given loop body in the current environment, replacing any plan it had
+    @param loop         the loop body to plan
+    @return             nothing
+*/
+static void planBody (loopbody* loop) {
+    if (loop->last != NULL) { // the last result goes with the old plan, and the next pass gives a new one
+        freeExpr(loop->last->boxed);
+        loop->last = NULL;
+    }
+    freeNodes(loop->nodes, loop->numnodes);
+    expression* expr;
+    int numnodes = 0;
+    for (expr = loop->body->ev.lazval->expval; expr != NULL; expr = expr->next) {
+        ++numnodes;
+    }
+    loop->nodes = allocate(sizeof(loopnode*) * (numnodes + 1)); // never empty, so an empty body still counts as planned
+    loop->numnodes = numnodes;
+    numnodes = 0;
+    for (expr = loop->body->ev.lazval->expval; expr != NULL; expr = expr->next) {
+        loop->nodes[numnodes++] = planNode(expr);
+    }
+    loop->rebinds = ccontext->rebinds;
+}
+
+/*! Plans the given argument of a loop body, which is evaluated the usual way unless its names can be resolved now
+    @param arg          the argument to plan
+    @return             the argument's node
+*/
+static loopnode* planNode (expression* arg) {
+    loopnode* node = allocate(sizeof(loopnode));
+    memset(node, 0, sizeof(loopnode));
+    node->kind = LOOP_GENERIC;
+    node->source = arg;
+    if (arg->type == TYPE_INT || arg->type == TYPE_FLO) {
+        node->kind = LOOP_LITERAL;
+        node->value.type = arg->type;
+        node->value.ev = arg->ev;
+    } else if (arg->type == TYPE_STR && arg->flag == EFLAG_VAR) {
+        char* name = arg->ev.strval->content;
+        hashelement* binding = findBinding(name);
+        if (binding != NULL) {
+            if (binding->flag == HFLAG_USER || binding->flag == HFLAG_DIRECT) { // anything else is an error, which is left to the usual evaluation
+                node->kind = LOOP_VARIABLE;
+                node->binding = binding;
+            }
+        } else if (!importsDefine(name)) { // a built-in constant is only certain if no package will define the name
+            expression* constant = builtinConstant(name);
+            if (constant != NULL && (constant->type == TYPE_INT || constant->type == TYPE_FLO)) {
+                node->kind = LOOP_CONSTANT;
+                node->value.type = constant->type;
+                node->value.ev = constant->ev;
+            }
+            freeExpr(constant);
+        }
+    } else if (arg->type == TYPE_EXP && arg->flag != EFLAG_ARR && arg->ev.expval != NULL) {
+        planCall(node, arg->ev.expval);
+    }
+    return node;
+}
+
+/*! Plans the given call as a call of the built-in primitives its name means, if nothing can shadow them, and its arguments along with it
+    @param node         the node to plan the call into
+    @param head         the expression containing the function name and its arguments
+    @return             nothing
+*/
+static void planCall (loopnode* node, expression* head) {
+    if (head->type != TYPE_STR || head->flag != EFLAG_VAR || specialForm(head) != SFORM_NONE) {
+        return;
+    }
+    char* name = head->ev.strval->content;
+    int count;
+    const tap_prim_fun* const* prims = lookupPrimitives(name, &count);
+    int numargs = numArgs(head);
+    if (count == 0 || numargs > LOOP_MAX_ARGS || nameBound(name)) {
+        return;
+    }
+    node->kind = LOOP_CALL;
+    node->prims = prims;
+    node->numprims = count;
+    node->numargs = numargs;
+    node->args = allocate(sizeof(loopnode*) * (numargs + 1));
+    expression* arg = head->next;
+    int i;
+    node->leafargs = 1;
+    for (i = 0; i < numargs; ++i, arg = arg->next) {
+        node->args[i] = planNode(arg);
+        node->leafargs &= node->args[i]->kind == LOOP_LITERAL || node->args[i]->kind == LOOP_CONSTANT || node->args[i]->kind == LOOP_VARIABLE;
+    }
+    arg = head->next;
+    if (count == 1 && prims[0]->address == prim_sSet && numargs == 2 && arg->type == TYPE_STR && arg->flag != EFLAG_VAR) { // setting a variable by its literal name
+        hashelement* target = findSetTarget(stringContent(arg->ev.strval));
+        if (target != NULL) { // a variable that's new is set the usual way, which plans the body again
+            node->kind = LOOP_SET;
+            node->binding = target;
+            node->leafargs = node->args[1]->kind == LOOP_LITERAL || node->args[1]->kind == LOOP_CONSTANT || node->args[1]->kind == LOOP_VARIABLE;
+        }
+    }
+}
+
+/*! Finds the element that binds the given name in the current environment or the ones it can see, as getVarValue would
+    @param name         the name to look for
+    @return             the first element with the name, whatever its flag, or null if no environment binds it
+*/
+static hashelement* findBinding (char* name) {
+    int cenv = ccontext->cenvironment;
+    while (cenv >= 0) {
+        hashelement* list = ccontext->environments[cenv]->numvars > 0 ? lookupHashList(ccontext->environments[cenv]->variables, name) : NULL;
+        for (; list != NULL; list = list->next) {
+            if (strcmp(name, list->key) == 0) {
+                return list;
+            }
+        }
+        cenv = ccontext->environments[cenv]->parent;
+    }
+    return NULL;
+}
+
+/*! Finds the user variable that set would replace if the body set the given name, as addToEnvironment would
+    @param name         the name of the variable
+    @return             the variable's element, or null if setting the name would bind it anew
+*/
+static hashelement* findSetTarget (char* name) {
+    environment* env = ccontext->environments[ccontext->cenvironment];
+    while (env->loop && lookupHash(env->variables, name) == NULL) {
+        env = ccontext->environments[env->parent];
+    }
+    hashelement* list;
+    for (list = lookupHashList(env->variables, name); list != NULL; list = list->next) {
+        if (list->flag == HFLAG_USER && strcmp(name, list->key) == 0) {
+            return list;
+        }
+    }
+    return NULL;
+}
+
+/*! Returns whether or not the given name is bound in the current environment or the ones it can see, or defined by an imported package, either of which would take precedence over a primitive
+    @param name         the name to look for
+    @return             1 if the name is bound or will be, 0 otherwise
+*/
+static int nameBound (char* name) {
+    return findBinding(name) != NULL || importsDefine(name);
+}
+
+/*! Evaluates the given node of the given loop body into the node's value, the usual way if the body's plan is stale
+    @param loop         the loop body the node belongs to
+    @param node         the node to evaluate
+    @return             nothing
+*/
+static inline void runNode (loopbody* loop, loopnode* node) {
+    if (node->kind == LOOP_LITERAL) { // a number is the same however names are bound
+        return;
+    } else if (node->kind == LOOP_GENERIC || loop->rebinds != loop->context->rebinds) {
+        node->value = unboxValue(evaluateArgument(node->source));
+    } else if (node->kind == LOOP_VARIABLE) {
+        readValue(node->binding->value, &node->value);
+    } else if (node->kind != LOOP_CONSTANT) {
+        runCall(loop, node);
+    }
+}
+
+/*! Evaluates the given call or set node, evaluating its arguments left to right first as evaluateFun does
+    @param loop         the loop body the node belongs to
+    @param node         the node to evaluate
+    @return             nothing
+*/
+static void runCall (loopbody* loop, loopnode* node) {
+    loopnode** args = node->args;
+    int numargs = node->numargs;
+    int i;
+    int first = node->kind == LOOP_SET; // a set's name is a literal, so it isn't evaluated unless the set is
+    if (node->leafargs) { // reading these can't bind a name, so the plan is as fresh as it was when the call was reached
+        for (i = first; i < numargs; ++i) {
+            if (args[i]->kind == LOOP_VARIABLE) {
+                readValue(args[i]->binding->value, &args[i]->value);
+            }
+        }
+    } else {
+        for (i = first; i < numargs; ++i) {
+            runNode(loop, args[i]);
+        }
+        if (loop->rebinds != loop->context->rebinds) { // an argument bound a name anew
+            callUsually(node);
+            return;
+        }
+    }
+    if (node->kind == LOOP_SET) { // setting a variable and calling a kernel are bounded, so the safe point of each pass through the loop is enough for them
+        storeValue(node->binding, &args[1]->value);
+        node->value.type = TYPE_INT;
+        node->value.ev.intval = 1;
+        node->value.boxed = NULL;
+        return;
+    } else if (node->usekernel && runKernel(node)) {
+        return;
+    }
+    for (i = 0; i < numargs && args[i]->value.type == node->chosenfor[i]; ++i);
+    if (i < numargs || !node->haschosen) { // the primitive is only chosen again when the arguments' types change
+        choosePrimitive(node);
+        if (node->usekernel && runKernel(node)) {
+            return;
+        }
+    }
+    safePoint(); // a green task may give way to the others here, as it may before any other call
+    expression* boxed[LOOP_MAX_ARGS];
+    for (i = 0; i < numargs; ++i) {
+        boxed[i] = boxValue(&args[i]->value);
+    }
+    expression* result = node->chosen != NULL ? callPrimFun(node->chosen, boxed, numargs) : newExpressionNil(); // a call no primitive accepts evaluates to nil, as it does in callFun
+    freeArgs(boxed, numargs);
+    node->value = unboxValue(result);
+}
+
+/*! Calls the given call or set node's function the usual way, looking it up by name, once its arguments have been evaluated
+    @param node         the node whose function to call
+    @return             nothing
+*/
+static void callUsually (loopnode* node) {
+    expression* args[LOOP_MAX_ARGS];
+    int numargs = node->numargs;
+    int first = node->kind == LOOP_SET;
+    int i;
+    if (first) {
+        args[0] = evaluateArgument(node->args[0]->source);
+    }
+    for (i = first; i < numargs; ++i) {
+        args[i] = boxValue(&node->args[i]->value);
+    }
+    expression* head = node->source->ev.expval;
+    tap_fun_search tfs = findFunction(head, args, numargs);
+    expression* result = callFun(tfs, head, args, numargs);
+    freeArgs(args, numargs);
+    node->value = unboxValue(result);
+}
+
+/*! Chooses the first of the given call node's primitives that accepts the types of its arguments' values, which is kept for as long as the types stay the same
+    @param node         the call node
+    @return             nothing
+*/
+static void choosePrimitive (loopnode* node) {
+    int numargs = node->numargs;
+    expression probes[LOOP_MAX_ARGS]; // primitiveAccepts only looks at the arguments' types
+    expression* probeargs[LOOP_MAX_ARGS];
+    int i;
+    for (i = 0; i < numargs; ++i) {
+        probes[i].type = node->args[i]->value.type;
+        probeargs[i] = &probes[i];
+        node->chosenfor[i] = probes[i].type;
+    }
+    node->chosen = NULL;
+    node->haschosen = 1;
+    for (i = 0; i < node->numprims; ++i) {
+        if (primitiveAccepts(node->prims[i], probeargs, numargs)) {
+            node->chosen = node->prims[i];
+            break;
+        }
+    }
+    node->usekernel = node->chosen != NULL && node->chosen->kernel != KERNEL_NONE;
+    datatype optype = node->usekernel && node->chosen->kernel == KERNEL_INT ? TYPE_INT : TYPE_FLO;
+    for (i = 0; i < numargs && node->usekernel; ++i) { // the kernel is only used when every argument has its operand type, as in callPrimKernel
+        node->usekernel = node->chosenfor[i] == optype;
+    }
+}
+
+/*! Calls the given call node's chosen primitive's fast-call kernel with its arguments' values unboxed, if every argument has the kernel's operand type, as callPrimKernel does
+    @param node         the call node
+    @return             1 if the kernel was called, 0 if the arguments don't suit it
+*/
+static int runKernel (loopnode* node) {
+    const tap_prim_fun* prim_fun = node->chosen;
+    loopnode** args = node->args;
+    int numargs = node->numargs;
+    int i;
+    if (prim_fun->kernel == KERNEL_INT) {
+        tap_int operands[LOOP_MAX_ARGS];
+        for (i = 0; i < numargs; ++i) {
+            if (args[i]->value.type != TYPE_INT) { // the primitive was chosen for integers, so any other type means choosing again
+                return 0;
+            }
+            operands[i] = args[i]->value.ev.intval;
+        }
+        node->value.type = TYPE_INT;
+        node->value.ev.intval = prim_fun->fast.ints(operands, numargs);
+    } else {
+        tap_flo operands[LOOP_MAX_ARGS];
+        for (i = 0; i < numargs; ++i) {
+            if (args[i]->value.type != TYPE_FLO) {
+                return 0;
+            }
+            operands[i] = args[i]->value.ev.floval;
+        }
+        if (prim_fun->kernel == KERNEL_FLO) {
+            node->value.type = TYPE_FLO;
+            node->value.ev.floval = prim_fun->fast.flos(operands, numargs);
+        } else {
+            node->value.type = TYPE_INT;
+            node->value.ev.intval = prim_fun->fast.flotests(operands, numargs);
+        }
+    }
+    node->value.boxed = NULL;
+    return 1;
+}
+
+/*! Stores the given value in the given variable, in place if the variable already holds a number of the same type, as prim_sSet would
+    @param binding      the variable's element
+    @param value        the value to store, which the variable takes
+    @return             nothing
+*/
+static void storeValue (hashelement* binding, loopvalue* value) {
+    expression* old = binding->value;
+    if (value->boxed == NULL && old->type == value->type) {
+        old->ev = value->ev;
+    } else {
+        expression* stored;
+        if (value->boxed == NULL) {
+            stored = boxValue(value);
+        } else {
+            stored = copyExpressionNR(value->boxed);
+            freeExpr(value->boxed);
+        }
+        freeExpr(old);
+        binding->value = stored;
+    }
+}
+
+/*! Reads the given variable's value as getVarValue would
+    @param value        the value of the variable
+    @param copy         where a copy of the value is stored
+    @return             nothing
+*/
+static void readValue (expression* value, loopvalue* copy) {
+    copy->type = value->type;
+    if (value->type == TYPE_INT || value->type == TYPE_FLO) {
+        copy->ev = value->ev;
+        copy->boxed = NULL;
+    } else {
+        copy->boxed = copyExpression(value);
+    }
+}
+
+/*! Turns the given expression into a loop value, unboxing it if it's an integer or a float
+    @param expr         the expression, which the loop value takes
+    @return             the loop value
+*/
+static loopvalue unboxValue (expression* expr) {
+    loopvalue value;
+    value.type = expr->type;
+    if (expr->type == TYPE_INT || expr->type == TYPE_FLO) {
+        value.ev = expr->ev;
+        value.boxed = NULL;
+        freeExpr(expr);
+    } else {
+        value.boxed = expr;
+    }
+    return value;
+}
+
+/*! Turns the given loop value into an expression, boxing it if it's an integer or a float
+    @param value        the loop value, whose expression the caller takes
+    @return             the expression
+*/
+static expression* boxValue (loopvalue* value) {
+    if (value->boxed != NULL) {
+        return value->boxed;
+    }
+    return value->type == TYPE_INT ? newExpressionInt(value->ev.intval) : newExpressionFlo(value->ev.floval);
+}
+
+/*! Frees the given nodes and everything they plan
+    @param nodes        the nodes to free (may be null)
+    @param numnodes     the number of nodes
+    @return             nothing
+*/
+static void freeNodes (loopnode** nodes, int numnodes) {
+    if (nodes == NULL) {
+        return;
+    }
+    int i;
+    for (i = 0; i < numnodes; ++i) {
+        freeNodes(nodes[i]->args, nodes[i]->numargs);
+        free(nodes[i]);
+    }
+    free(nodes);
+}
@@ -0,0 +1,58 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   loops.h
+    @brief  The header file for loops.c
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#ifndef LOOPS_H
+#define LOOPS_H
+
+#include "structs.h"
+#include "dep_structs.h"
+#include "constants.h"
+#include "hashtable.h"
+
+typedef struct loopvalue_ loopvalue;
+typedef struct loopnode_ loopnode;
+typedef struct loopbody_ loopbody;
+
+struct loopvalue_ {
+    datatype type;
+    exprvals ev; // the value if it's an integer or a float, which are never boxed
+    expression* boxed; // the value if it's anything else, which the loop value owns (null for an integer or a float)
+};
+
+struct loopnode_ {
+    int kind; // the LOOP_ constant saying how the node is evaluated
+    expression* source; // the code the node was planned from, which is evaluated the usual way whenever the plan is stale
+    loopvalue value; // the node's value once it's evaluated, which its parent takes (a literal's or a constant's is set when it's planned)
+    hashelement* binding; // the variable a variable node reads or a set node writes
+    const tap_prim_fun* const* prims; // the primitives a call node's name means, in the order they are tried
+    int numprims;
+    const tap_prim_fun* chosen; // the primitive that accepts the argument types last seen (null if none does)
+    datatype chosenfor[LOOP_MAX_ARGS]; // the argument types the primitive was chosen for
+    int haschosen; // set once a primitive has been chosen for some argument types
+    int usekernel; // set if the chosen primitive's kernel takes arguments of the types it was chosen for
+    loopnode** args;
+    int numargs;
+    int leafargs; // set if every argument that's evaluated is a literal, a constant, or a variable, none of which can bind a name
+};
+
+struct loopbody_ {
+    expression* body; // the lazy expression the loop evaluates
+    tap_context* context; // the context the loop runs in
+    loopnode** nodes; // the plan of each expression in the body (null until the body is first run)
+    int numnodes;
+    uint rebinds; // the context's count of new bindings when the body was planned
+    int watchenv; // the environment the context watched before the loop started
+    loopvalue* last; // the value of the node that was evaluated last, which is the body's result (null if there isn't one)
+};
+
+loopbody* newLoopBody(expression*);
+void runLoopBody(loopbody*);
+int loopBodyTruth(loopbody*);
+expression* loopBodyResult(loopbody*);
+void freeLoopBody(loopbody*);
+
+#endif
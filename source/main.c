@@ -7,13 +7,13 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
+#include <time.h>
 
-#include "engine.h"
+#include "tap.h"
+#include "server.h"
 #include "constants.h"
-#include "constructors.h"
-
-extern errorlist* errors;
 
 /*! Main function run from the command line
     @param argc     argument count (the number of arguments given)
@@ -21,21 +21,49 @@ extern errorlist* errors;
     @return         the return code of the program (EXIT_SUCCESS for a successful output, another code for an error)
 */
 int main (int argc, char* argv[]) {
-    if (argc >= 2) {
-        initializeGlobals();
-        expression* parsed = parse(argv[1]);
-        expression* evaluated;
-        if (errors == NULL) {
-            evaluated = evaluate(parsed);
-        } else {
-            evaluated = newExpressionOfType(TYPE_NIL);
+    if (argc >= 3 && strcmp(argv[1], "-serve") == 0) { // tap -serve <socket path> [package path...]
+        srand(time(NULL));
+        if (tapServe(argv[2], argv + 3, argc - 3) != 0) {
+            fprintf(stderr, "Could not serve on %s\n", argv[2]);
+            return EXIT_NO_SERVER;
+        }
+        return EXIT_SUCCESS;
+    } else if (argc >= 3 && strcmp(argv[1], "-snapshot") == 0) { // tap -snapshot <snapshot path> [package path...]
+        tap_context* context = tapCreate();
+        int i;
+        int saved = 1;
+        for (i = 3; i < argc && saved; ++i) {
+            saved = tapLoadPackage(context, argv[i]);
+        }
+        saved = saved && tapSaveSnapshot(context, argv[2]);
+        if (!saved) {
+            char* errortext = tapPrintErrors(context);
+            fprintf(stderr, "%s", errortext);
+            free(errortext);
+        }
+        tapDestroy(context);
+        return saved ? EXIT_SUCCESS : EXIT_NO_SNAPSHOT;
+    } else if (argc >= 2) {
+        srand(time(NULL)); // initialize the random seed using the execution time
+        tap_context* context = tapCreate();
+        if (argc >= 4 && strcmp(argv[1], "-restore") == 0) { // tap -restore <snapshot path> <code>
+            if (!tapRestoreSnapshot(context, argv[2])) {
+                char* errortext = tapPrintErrors(context);
+                fprintf(stderr, "%s", errortext);
+                free(errortext);
+                tapDestroy(context);
+                return EXIT_NO_SNAPSHOT;
+            }
+            argv += 2;
         }
-        char* printed = printExpression(evaluated);
-        char* errortext = printErrors();
+        expression* evaluated = tapEvalString(context, argv[1]);
+        char* printed = tapPrintResult(evaluated);
+        char* errortext = tapPrintErrors(context);
         printf("%s\n%s", printed, errortext);
         free(printed);
-        freeExpr(evaluated);
-        freeGlobals();
+        free(errortext);
+        tapFreeResult(evaluated);
+        tapDestroy(context);
         return EXIT_SUCCESS;
     } else {
         return EXIT_NO_ARGS;
@@ -0,0 +1,210 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   matchers.c
+    @brief  Matchers, which find any of a set of needles in a string in a single scan using an Aho-Corasick automaton
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "matchers.h"
+#include "constants.h"
+#include "constructors.h"
+#include "memory.h"
+#include "strings.h"
+
+/* A matcher is a trie of its needles whose states also know where to go when the next byte doesn't continue any needle: the
+   state for the longest suffix of what has been read that is still a prefix of some needle. Those moves are worked out when
+   the matcher is made, so scanning a string takes a single table lookup per byte however many needles there are. To keep the
+   table small, bytes are grouped into classes (each byte that appears in a needle has its own, and every other byte shares
+   class 0), so a state has a row of as many entries as there are distinct bytes in the needles rather than 256. */
+
+static int addState(tap_mat*, uint*);
+
+/*! Creates a new matcher for the given needles
+    @param needles      the needles, which are copied; an empty needle matches nowhere
+    @param numneedles   the number of needles
+    @return             the new matcher
+*/
+tap_mat* newMatcher (string** needles, uint numneedles) {
+    tap_mat* mat = allocate(sizeof(tap_mat));
+    memset(mat->classes, 0, sizeof(mat->classes));
+    mat->numclasses = 1;
+    mat->needles = allocate(sizeof(string*) * (numneedles > 0 ? numneedles : 1));
+    mat->numneedles = numneedles;
+    mat->owners = 1;
+    uint i;
+    int j;
+    for (i = 0; i < numneedles; ++i) { // give each byte that appears in a needle a class of its own
+        mat->needles[i] = copyString(needles[i]);
+        for (j = 0; j < needles[i]->size; ++j) {
+            unsigned char byte = needles[i]->content[j];
+            if (mat->classes[byte] == 0) {
+                mat->classes[byte] = mat->numclasses++;
+            }
+        }
+    }
+    uint capacity = MATCHER_INITIAL_STATES;
+    mat->next = allocate(sizeof(int) * capacity * mat->numclasses);
+    mat->output = allocate(sizeof(int) * capacity);
+    mat->numstates = 0;
+    addState(mat, &capacity); // the root
+    for (i = 0; i < numneedles; ++i) { // put each needle in the trie
+        string* needle = mat->needles[i];
+        if (needle->size == 0) {
+            continue;
+        }
+        int state = 0;
+        for (j = 0; j < needle->size; ++j) {
+            uint move = state * mat->numclasses + mat->classes[(unsigned char)needle->content[j]];
+            if (mat->next[move] < 0) {
+                int child = addState(mat, &capacity); // may move the table, so it's indexed again afterwards
+                mat->next[move] = child;
+            }
+            state = mat->next[move];
+        }
+        if (mat->output[state] < 0) { // a needle given twice is reported as the first of them
+            mat->output[state] = i;
+        }
+    }
+    int* fail = allocate(sizeof(int) * mat->numstates);
+    int* queue = allocate(sizeof(int) * mat->numstates);
+    mat->dictionary = allocate(sizeof(int) * mat->numstates);
+    mat->dictionary[0] = -1;
+    int head = 0;
+    int tail = 0;
+    uint c;
+    for (c = 0; c < mat->numclasses; ++c) { // the root's children fail back to the root, and its missing moves lead back to it
+        int child = mat->next[c];
+        if (child < 0) {
+            mat->next[c] = 0;
+        } else {
+            fail[child] = 0;
+            mat->dictionary[child] = -1;
+            queue[tail++] = child;
+        }
+    }
+    while (head < tail) { // fill in the rest breadth first, so a state's failure (which is shallower) is always done before it
+        int state = queue[head++];
+        int* row = mat->next + state * mat->numclasses;
+        int* failrow = mat->next + fail[state] * mat->numclasses;
+        for (c = 0; c < mat->numclasses; ++c) {
+            if (row[c] < 0) { // a byte that doesn't continue a needle goes where the failure goes on it
+                row[c] = failrow[c];
+            } else {
+                int child = row[c];
+                fail[child] = failrow[c];
+                mat->dictionary[child] = mat->output[fail[child]] >= 0 ? fail[child] : mat->dictionary[fail[child]];
+                queue[tail++] = child;
+            }
+        }
+    }
+    free(fail);
+    free(queue);
+    return mat;
+}
+
+/*! Adds an owner to the given matcher
+    @param mat          the matcher
+    @return             the matcher
+*/
+tap_mat* shareMatcher (tap_mat* mat) {
+    __atomic_add_fetch(&mat->owners, 1, __ATOMIC_RELAXED);
+    return mat;
+}
+
+/*! Removes an owner from the given matcher, freeing it once it has none left
+    @param mat          the matcher
+    @return             0
+*/
+bool freeMatcher (tap_mat* mat) {
+    if (__atomic_sub_fetch(&mat->owners, 1, __ATOMIC_ACQ_REL) > 0) {
+        return 0;
+    }
+    uint i;
+    for (i = 0; i < mat->numneedles; ++i) {
+        freeStr(mat->needles[i]);
+    }
+    free(mat->needles);
+    free(mat->next);
+    free(mat->output);
+    free(mat->dictionary);
+    free(mat);
+    return 0;
+}
+
+/*! Returns whether or not any of the given matcher's needles occurs in the given text
+    @param mat          the matcher
+    @param text         the text to scan, which may contain null characters
+    @param size         the size of the text
+    @return             1 if a needle occurs in the text, 0 otherwise
+*/
+int matchAny (tap_mat* mat, char* text, int size) {
+    int state = 0;
+    int i;
+    for (i = 0; i < size; ++i) {
+        state = mat->next[state * mat->numclasses + mat->classes[(unsigned char)text[i]]];
+        if (mat->output[state] >= 0 || mat->dictionary[state] >= 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*! Returns every occurrence of any of the given matcher's needles in the given text, including ones that overlap
+    @param mat          the matcher
+    @param text         the text to scan, which may contain null characters
+    @param size         the size of the text
+    @param count        set to the number of occurrences found
+    @return             a pair for each occurrence, in the order they end, of the position it starts at and the index of its needle; this must be freed by the caller
+*/
+int* matchAll (tap_mat* mat, char* text, int size, int* count) {
+    int capacity = MATCHER_INITIAL_MATCHES;
+    int* matches = allocate(sizeof(int) * 2 * capacity);
+    *count = 0;
+    int state = 0;
+    int i;
+    for (i = 0; i < size; ++i) {
+        state = mat->next[state * mat->numclasses + mat->classes[(unsigned char)text[i]]];
+        int found = mat->output[state] >= 0 ? state : mat->dictionary[state];
+        while (found >= 0) { // every needle that ends here, longest first
+            if (*count == capacity) {
+                capacity *= 2;
+                matches = realloc(matches, sizeof(int) * 2 * capacity);
+                if (matches == NULL) {
+                    exit(EXIT_OUT_OF_MEMORY);
+                }
+            }
+            int needle = mat->output[found];
+            matches[2 * *count] = i - mat->needles[needle]->size + 1;
+            matches[2 * *count + 1] = needle;
+            ++*count;
+            found = mat->dictionary[found];
+        }
+    }
+    return matches;
+}
+
+/*! Adds a state with no moves or output to the given matcher, making room for it if needed
+    @param mat          the matcher
+    @param capacity     the number of states there is room for, which is updated if more room is made
+    @return             the new state
+*/
+static int addState (tap_mat* mat, uint* capacity) {
+    if (mat->numstates == *capacity) {
+        *capacity *= 2;
+        mat->next = realloc(mat->next, sizeof(int) * *capacity * mat->numclasses);
+        mat->output = realloc(mat->output, sizeof(int) * *capacity);
+        if (mat->next == NULL || mat->output == NULL) {
+            exit(EXIT_OUT_OF_MEMORY);
+        }
+    }
+    int state = mat->numstates++;
+    uint c;
+    for (c = 0; c < mat->numclasses; ++c) {
+        mat->next[state * mat->numclasses + c] = -1;
+    }
+    mat->output[state] = -1;
+    return state;
+}
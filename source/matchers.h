@@ -0,0 +1,31 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   matchers.h
+    @brief  The header file for matchers.c
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#ifndef MATCHERS_H
+#define MATCHERS_H
+
+#include "structs.h"
+
+struct tap_mat_ {
+    unsigned short classes[256]; // the class of each byte; bytes that no needle contains share class 0
+    uint numclasses;
+    int* next; // the state each state goes to on each class of byte, numclasses entries per state, the root being state 0
+    int* output; // the needle that ends at each state, or -1
+    int* dictionary; // the nearest state down each state's chain of failures that a needle ends at, or -1
+    uint numstates;
+    string** needles;
+    uint numneedles;
+    uint owners; // the number of expressions, in any context, that refer to the matcher, which never changes once it's made
+};
+
+tap_mat* newMatcher(string**, uint);
+tap_mat* shareMatcher(tap_mat*);
+bool freeMatcher(tap_mat*);
+int matchAny(tap_mat*, char*, int);
+int* matchAll(tap_mat*, char*, int, int*);
+
+#endif
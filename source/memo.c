@@ -0,0 +1,386 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   memo.c
+    @brief  A bounded result cache for memoized functions, keyed by the structure of the arguments and evicted least recently used first
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "memo.h"
+#include "constants.h"
+#include "memory.h"
+#include "constructors.h"
+
+#define MEMO_HASH_SEED 2166136261u // FNV-1a offset basis
+#define MEMO_HASH_PRIME 16777619u // FNV-1a prime
+
+static uint hashBytes(uint, void*, size_t);
+static int memoizableExpr(expression*);
+static void unlinkEntry(tap_memo*, memoentry*);
+static void pushEntry(tap_memo*, memoentry*);
+static void evictEntry(tap_memo*, memoentry*);
+static void freeEntry(memoentry*);
+
+/*! Creates a new, empty memoization cache holding at most the given number of results
+    @param capacity     the maximum number of results to keep before evicting the least recently used one
+    @return             the new cache
+*/
+tap_memo* newMemo (uint capacity) {
+    if (capacity < 1) {
+        capacity = MEMO_DEFAULT_CAPACITY;
+    }
+    tap_memo* memo = allocate(sizeof(tap_memo));
+    memo->size = capacity < MEMO_MIN_TABLE_SIZE ? MEMO_MIN_TABLE_SIZE : capacity; // keep the load factor at or below 1
+    memo->table = allocate(sizeof(memoentry*) * memo->size);
+    memset(memo->table, 0, sizeof(memoentry*) * memo->size);
+    memo->newest = NULL;
+    memo->oldest = NULL;
+    memo->capacity = capacity;
+    memo->count = 0;
+    memo->hits = 0;
+    memo->misses = 0;
+    memo->refs = 1; // the creator holds the only reference
+    return memo;
+}
+
+/*! Registers another owner of the given cache so copies of a function keep sharing its results
+    @param memo     the cache to share (may be null)
+    @return         the same cache
+*/
+tap_memo* shareMemo (tap_memo* memo) {
+    if (memo != NULL) {
+        ++memo->refs;
+    }
+    return memo;
+}
+
+/*! Drops one owner of the given cache, freeing it and its results once nothing refers to it
+    @param memo     the cache to release (may be null)
+    @return         0
+*/
+bool releaseMemo (tap_memo* memo) {
+    if (memo != NULL && --memo->refs == 0) {
+        clearMemo(memo);
+        free(memo->table);
+        free(memo);
+    }
+    return 0;
+}
+
+/*! Removes every stored result from the given cache and resets its counters
+    @param memo     the cache to clear
+    @return         nothing
+*/
+void clearMemo (tap_memo* memo) {
+    memoentry* entry = memo->newest;
+    while (entry != NULL) {
+        memoentry* older = entry->older;
+        freeEntry(entry);
+        entry = older;
+    }
+    memset(memo->table, 0, sizeof(memoentry*) * memo->size);
+    memo->newest = NULL;
+    memo->oldest = NULL;
+    memo->count = 0;
+    memo->hits = 0;
+    memo->misses = 0;
+}
+
+/*! Looks up the result previously stored for the given arguments, counting the hit or miss
+    @param memo     the cache to search
+    @param args     the evaluated arguments of the call
+    @param numargs  the number of arguments
+    @return         a copy of the stored result or null if there isn't one
+*/
+expression* lookupMemo (tap_memo* memo, expression* args[], int numargs) {
+    uint sum = MEMO_HASH_SEED;
+    int i;
+    for (i = 0; i < numargs; ++i) {
+        sum = hashExpression(args[i], sum);
+    }
+    memoentry* entry = memo->table[sum % memo->size];
+    while (entry != NULL) {
+        if (entry->sum == sum && entry->numargs == numargs) {
+            for (i = 0; i < numargs; ++i) {
+                if (!equalExpressions(entry->args[i], args[i])) {
+                    break;
+                }
+            }
+            if (i == numargs) { // if every argument matched
+                ++memo->hits;
+                if (memo->newest != entry) { // mark the entry as the most recently used one
+                    unlinkEntry(memo, entry);
+                    pushEntry(memo, entry);
+                }
+                return copyExpressionNR(entry->result);
+            }
+        }
+        entry = entry->next;
+    }
+    ++memo->misses;
+    return NULL;
+}
+
+/*! Stores a copy of the given result for the given arguments, evicting the least recently used result if the cache is full
+    @param memo     the cache to store into
+    @param args     the evaluated arguments of the call
+    @param numargs  the number of arguments
+    @param result   the result of the call
+    @return         nothing
+*/
+void storeMemo (tap_memo* memo, expression* args[], int numargs, expression* result) {
+    if (memo->count >= memo->capacity) {
+        evictEntry(memo, memo->oldest);
+    }
+    memoentry* entry = allocate(sizeof(memoentry));
+    entry->sum = MEMO_HASH_SEED;
+    entry->numargs = numargs;
+    entry->args = allocate(sizeof(expression*) * (numargs > 0 ? numargs : 1));
+    int i;
+    for (i = 0; i < numargs; ++i) {
+        entry->sum = hashExpression(args[i], entry->sum);
+        entry->args[i] = copyExpressionNR(args[i]);
+    }
+    entry->result = copyExpressionNR(result);
+    uint index = entry->sum % memo->size;
+    entry->next = memo->table[index];
+    memo->table[index] = entry;
+    pushEntry(memo, entry);
+    ++memo->count;
+}
+
+/*! Returns whether or not every given argument can be used as part of a cache key; objects and functions can't since they are compared by identity
+    @param args     the evaluated arguments of the call
+    @param numargs  the number of arguments
+    @return         1 if the call can be memoized, 0 otherwise
+*/
+int memoizable (expression* args[], int numargs) {
+    int i;
+    for (i = 0; i < numargs; ++i) {
+        if (!memoizableExpr(args[i])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*! Mixes the structure of the given expression (but not the expressions following it) into the given hashsum
+    @param expr     the expression to hash
+    @param sum      the hashsum so far
+    @return         the updated hashsum
+*/
+uint hashExpression (expression* expr, uint sum) {
+    sum = hashBytes(sum, &expr->type, sizeof(datatype));
+    switch (expr->type) {
+        case TYPE_INT:
+        case TYPE_TYP:
+            sum = hashBytes(sum, &expr->ev.intval, sizeof(tap_int));
+            break;
+        case TYPE_FLO:
+            sum = hashBytes(sum, &expr->ev.floval, sizeof(tap_flo));
+            break;
+        case TYPE_DAT:
+            sum = hashBytes(sum, &expr->ev.datval, sizeof(tap_dat));
+            break;
+        case TYPE_STR:
+            sum = hashBytes(sum, expr->ev.strval->content, expr->ev.strval->size);
+            break;
+        case TYPE_ARR: {
+            array* arr = expr->ev.arrval;
+            int i;
+            for (i = arr->start; i <= arr->end; ++i) {
+                if (arr->content[i] != NULL) {
+                    sum = hashExpression(arr->content[i], sum);
+                }
+            }
+            break;
+        }
+        case TYPE_EXP:
+        case TYPE_LAZ: {
+            expression* child = expr->type == TYPE_EXP ? expr->ev.expval : expr->ev.lazval->expval;
+            while (child != NULL) {
+                sum = hashExpression(child, sum);
+                child = child->next;
+            }
+            break;
+        }
+    }
+    return sum;
+}
+
+/*! Returns whether or not the two given expressions (but not the expressions following them) are structurally equal
+    @param expr1    the first expression
+    @param expr2    the second expression
+    @return         1 if equal, 0 otherwise
+*/
+int equalExpressions (expression* expr1, expression* expr2) {
+    if (expr1 == expr2) {
+        return 1;
+    } else if (expr1 == NULL || expr2 == NULL || expr1->type != expr2->type) {
+        return 0;
+    }
+    switch (expr1->type) {
+        case TYPE_NIL:
+            return 1;
+        case TYPE_INT:
+        case TYPE_TYP:
+            return expr1->ev.intval == expr2->ev.intval;
+        case TYPE_FLO:
+            return memcmp(&expr1->ev.floval, &expr2->ev.floval, sizeof(tap_flo)) == 0; // compare bitwise so that NaN keys can still be found
+        case TYPE_DAT:
+            return expr1->ev.datval == expr2->ev.datval;
+        case TYPE_STR:
+            return expr1->ev.strval->size == expr2->ev.strval->size && memcmp(expr1->ev.strval->content, expr2->ev.strval->content, expr1->ev.strval->size) == 0;
+        case TYPE_ARR: {
+            array* arr1 = expr1->ev.arrval;
+            array* arr2 = expr2->ev.arrval;
+            if (arr1->end - arr1->start != arr2->end - arr2->start) {
+                return 0;
+            }
+            int i;
+            for (i = 0; i <= arr1->end - arr1->start; ++i) {
+                if (!equalExpressions(arr1->content[arr1->start + i], arr2->content[arr2->start + i])) {
+                    return 0;
+                }
+            }
+            return 1;
+        }
+        case TYPE_EXP:
+        case TYPE_LAZ: {
+            expression* child1 = expr1->type == TYPE_EXP ? expr1->ev.expval : expr1->ev.lazval->expval;
+            expression* child2 = expr2->type == TYPE_EXP ? expr2->ev.expval : expr2->ev.lazval->expval;
+            while (child1 != NULL && child2 != NULL) {
+                if (!equalExpressions(child1, child2)) {
+                    return 0;
+                }
+                child1 = child1->next;
+                child2 = child2->next;
+            }
+            return child1 == child2;
+        }
+        default:
+            return 0;
+    }
+}
+
+/*! Mixes the given bytes into the given hashsum
+    @param sum      the hashsum so far
+    @param bytes    the bytes to hash
+    @param size     the number of bytes
+    @return         the updated hashsum
+*/
+static uint hashBytes (uint sum, void* bytes, size_t size) {
+    unsigned char* b = bytes;
+    size_t i;
+    for (i = 0; i < size; ++i) {
+        sum ^= b[i];
+        sum *= MEMO_HASH_PRIME;
+    }
+    return sum;
+}
+
+/*! Returns whether or not the given expression and everything it contains can be used as part of a cache key
+    @param expr     the expression to check
+    @return         1 if it can, 0 otherwise
+*/
+static int memoizableExpr (expression* expr) {
+    switch (expr->type) {
+        case TYPE_OBJ:
+        case TYPE_FUN:
+        case TYPE_CHN: // what a channel holds changes from one call to the next
+        case TYPE_BLD:
+        case TYPE_MAT:
+        case TYPE_REG:
+        case TYPE_FMT:
+            return 0;
+        case TYPE_ARR: {
+            array* arr = expr->ev.arrval;
+            int i;
+            for (i = arr->start; i <= arr->end; ++i) {
+                if (arr->content[i] != NULL && !memoizableExpr(arr->content[i])) {
+                    return 0;
+                }
+            }
+            return 1;
+        }
+        case TYPE_EXP:
+        case TYPE_LAZ: {
+            expression* child = expr->type == TYPE_EXP ? expr->ev.expval : expr->ev.lazval->expval;
+            while (child != NULL) {
+                if (!memoizableExpr(child)) {
+                    return 0;
+                }
+                child = child->next;
+            }
+            return 1;
+        }
+        default:
+            return 1;
+    }
+}
+
+/*! Removes the given entry from the cache's recency list
+    @param memo     the cache containing the entry
+    @param entry    the entry to remove
+    @return         nothing
+*/
+static void unlinkEntry (tap_memo* memo, memoentry* entry) {
+    if (entry->newer != NULL) {
+        entry->newer->older = entry->older;
+    } else {
+        memo->newest = entry->older;
+    }
+    if (entry->older != NULL) {
+        entry->older->newer = entry->newer;
+    } else {
+        memo->oldest = entry->newer;
+    }
+}
+
+/*! Adds the given entry to the front of the cache's recency list
+    @param memo     the cache to add the entry to
+    @param entry    the entry to add
+    @return         nothing
+*/
+static void pushEntry (tap_memo* memo, memoentry* entry) {
+    entry->newer = NULL;
+    entry->older = memo->newest;
+    if (memo->newest != NULL) {
+        memo->newest->newer = entry;
+    } else {
+        memo->oldest = entry;
+    }
+    memo->newest = entry;
+}
+
+/*! Removes the given entry from the cache entirely and frees it
+    @param memo     the cache containing the entry
+    @param entry    the entry to evict
+    @return         nothing
+*/
+static void evictEntry (tap_memo* memo, memoentry* entry) {
+    memoentry** link = &memo->table[entry->sum % memo->size];
+    while (*link != entry) {
+        link = &(*link)->next;
+    }
+    *link = entry->next;
+    unlinkEntry(memo, entry);
+    freeEntry(entry);
+    --memo->count;
+}
+
+/*! Frees the given entry along with its stored arguments and result
+    @param entry    the entry to free
+    @return         nothing
+*/
+static void freeEntry (memoentry* entry) {
+    int i;
+    for (i = 0; i < entry->numargs; ++i) {
+        freeExprNR(entry->args[i]);
+    }
+    free(entry->args);
+    freeExprNR(entry->result);
+    free(entry);
+}
@@ -0,0 +1,24 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   memo.h
+    @brief  The header file for memo.c
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#ifndef MEMO_H
+#define MEMO_H
+
+#include "structs.h"
+
+tap_memo* newMemo(uint);
+tap_memo* shareMemo(tap_memo*);
+bool releaseMemo(tap_memo*);
+void clearMemo(tap_memo*);
+expression* lookupMemo(tap_memo*, expression*[], int);
+void storeMemo(tap_memo*, expression*[], int, expression*);
+int memoizable(expression*[], int);
+uint hashExpression(expression*, uint);
+int equalExpressions(expression*, expression*);
+
+#endif
+
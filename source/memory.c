@@ -6,12 +6,29 @@
 */
 
 #include <stdlib.h>
+#include <pthread.h>
 
 #include "memory.h"
 #include "constants.h"
 #include "constructors.h"
+#include "memo.h"
+#include "workers.h"
+#include "channels.h"
+#include "builders.h"
+#include "matchers.h"
+#include "regexes.h"
+#include "formats.h"
 
 static bool freeExpr_(expression*, bool);
+static void releaseExpression(expression*);
+static void freeSpareExpressions(void*);
+static void createSpareKey();
+
+static __thread expression* spareexprs = NULL; // expressions the calling thread freed, kept to be reused rather than handed back to malloc
+static __thread int numspare = 0;
+static __thread bool sparekeyset = 0; // whether the thread's spare expressions are freed when it exits
+static pthread_key_t sparekey;
+static pthread_once_t sparekeyonce = PTHREAD_ONCE_INIT;
 
 /*! Attempts to allocate the amount of memory specified by the given size and errors out if the memory could not be allocated
     @param size     how much memory to allocate (in bytes)
@@ -26,6 +43,19 @@ inline void* allocate (size_t size) {
 	}
 }
 
+/*! Returns the memory for a new expression, reusing one the calling thread freed if it kept any
+    @return         the location of the expression, whose fields aren't set
+*/
+expression* allocateExpression () {
+    expression* expr = spareexprs;
+    if (expr == NULL) {
+        return allocate(sizeof(expression));
+    }
+    spareexprs = expr->next;
+    --numspare;
+    return expr;
+}
+
 /*! Frees from memory the given expression and all its associated content
     @param expr     the expression to free from memory
     @return         0
@@ -68,22 +98,83 @@ static bool freeExpr_ (expression* expr, bool next) {
             case TYPE_FUN:
                 freeFun(ev.funval);
                 break;
+            case TYPE_CHN:
+                freeChannel(ev.chnval);
+                break;
+            case TYPE_BLD:
+                freeBuilder(ev.bldval);
+                break;
+            case TYPE_MAT:
+                freeMatcher(ev.matval);
+                break;
+            case TYPE_REG:
+                freeRegex(ev.regval);
+                break;
+            case TYPE_FMT:
+                freeFormat(ev.fmtval);
+                break;
         }
         if (next) { // if the next expression should be freed
             freeExpr(expr->next); // recursively call this function with the expression's next expression
         }
-        free(expr); // free the expression itself
+        releaseExpression(expr); // free the expression itself
     }
     
     return 0;
 }
 
+/*! Keeps the memory of the given expression for the calling thread's next one, or frees it if the thread already keeps enough
+    @param expr     the expression, whose content is already freed
+    @return         nothing
+*/
+static void releaseExpression (expression* expr) {
+    if (numspare >= EXPR_MAX_SPARE) {
+        free(expr);
+        return;
+    }
+    if (!sparekeyset) { // the first time the thread keeps an expression, arrange for what it keeps to be freed when it exits
+        pthread_once(&sparekeyonce, &createSpareKey);
+        pthread_setspecific(sparekey, &spareexprs);
+        sparekeyset = 1;
+    }
+    expr->next = spareexprs;
+    spareexprs = expr;
+    ++numspare;
+}
+
+/*! Frees the expressions the calling thread kept to reuse, which it does as it exits
+    @param list     unused
+    @return         nothing
+*/
+static void freeSpareExpressions (void* list) {
+    while (spareexprs != NULL) {
+        expression* next = spareexprs->next;
+        free(spareexprs);
+        spareexprs = next;
+    }
+    numspare = 0;
+}
+
+/*! Creates the key whose destructor frees each thread's spare expressions
+    @return         nothing
+*/
+static void createSpareKey () {
+    pthread_key_create(&sparekey, &freeSpareExpressions);
+}
+
 /*! Frees from memory the given array and its content
     @param le       the lazy expression to free from memory
     @return         0
 */
 bool freeLaz (tap_laz* laz) {
+	if (--laz->owners > 0) { // if other expressions still share the lazy expression
+		return 0;
+	}
+	if (laz->future != NULL) { // nothing will force it now, but the worker evaluating it still refers to the future
+		discardFuture(laz->future);
+	}
 	freeExpr(laz->expval);
+	freeExprNR(laz->value);
 	exprstack* es1 = laz->refs;
 	exprstack* es2;
 	while (es1 != NULL) {
@@ -101,7 +192,14 @@ bool freeLaz (tap_laz* laz) {
 	@return			0
 */
 bool freeStr (string* str) {
-	free(str->content);
+	if (__atomic_sub_fetch(&str->owners, 1, __ATOMIC_ACQ_REL) > 0) { // slices of the string still use its content
+		return 0;
+	}
+	if (str->parent != NULL) { // a slice gives up its share of its parent's content
+		freeStr(str->parent);
+	} else if (str->content != str->text) { // a short string's content is freed along with it
+		free(str->content);
+	}
 	free(str);
 	
 	return 0;
@@ -143,6 +241,9 @@ bool freeObj (tap_obj* obj) {
     @return         0
 */
 bool freeProp (property* prop) {
+	if (prop == NULL) { // types and objects may have no properties at all
+		return 0;
+	}
 	free(prop->name);
 	freeTypelist(prop->types);
 	freeExpr(prop->value);
@@ -160,6 +261,7 @@ bool freeProp (property* prop) {
 */
 bool freeFun (tap_fun* fun) {
 	freeExpr(fun->body);
+	releaseMemo(fun->memo);
     int numargs;
     if (fun->maxargs == ARGLEN_INF) {
         numargs = fun->minargs;
@@ -254,7 +356,6 @@ bool freeExprstack (exprstack* es) {
 	@return			0
 */
 bool freePrimFun (tap_prim_fun* fun) {
-	freeTypelist(fun->types);
 	free(fun);
 	
 	return 0;
@@ -272,6 +373,22 @@ bool freeEnv (environment* env) {
 	return 0;
 }
 
+/*! Frees from memory the given list of imports (the packages themselves are shared by the whole process and stay loaded)
+	@param imports	the list of imports
+	@return			0
+*/
+bool freeImportlist (importlist* imports) {
+	importlist* next;
+	while (imports != NULL) {
+		next = imports->next;
+		free(imports->defined);
+		free(imports);
+		imports = next;
+	}
+	
+	return 0;
+}
+
 /*! Frees from memory the given list of strings
 	@param sl		the list of strings to free from memory
 	@return			0
@@ -303,3 +420,38 @@ bool freeErrorlist (errorlist* el) {
 	return 0;
 }
 
+/*! Frees from memory the given list of errors along with their messages
+	@param el		the list of errors to free from memory
+	@return			0
+*/
+bool freeErrors (errorlist* el) {
+	errorlist* next_el;
+	while (el != NULL) {
+		next_el = el->next;
+		freeStr(el->message);
+		free(el);
+		el = next_el;
+	}
+	
+	return 0;
+}
+
+/*! Frees from memory the given context along with its environments and errors
+	@param context	the context to free from memory (may be null)
+	@return			0
+*/
+bool freeContext (tap_context* context) {
+	if (context == NULL) {
+		return 0;
+	}
+	int i;
+	for (i = 0; i < context->numenvironments; ++i) { // for every environment
+		freeEnv(context->environments[i]); // delete the environment along with its hashtable and types
+	}
+	free(context->environments);
+	freeErrors(context->errors);
+	freeImportlist(context->imports);
+	free(context);
+	
+	return 0;
+}
@@ -12,8 +12,13 @@
 
 struct environment_;
 typedef struct environment_ environment;
+struct tap_context_;
+typedef struct tap_context_ tap_context;
+struct importlist_;
+typedef struct importlist_ importlist;
 
 void* allocate(size_t);
+expression* allocateExpression();
 bool freeExpr(expression*);
 bool freeExprNR(expression*);
 bool freeLaz(tap_laz*);
@@ -31,5 +36,8 @@ bool freePrimFun(tap_prim_fun*);
 bool freeEnv(environment*);
 bool freeStringlist(stringlist*);
 bool freeErrorlist(errorlist*);
+bool freeErrors(errorlist*);
+bool freeContext(tap_context*);
+bool freeImportlist(importlist*);
 
 #endif
@@ -0,0 +1,498 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   numbers.c
+    @brief  Conversions between numbers and text, which print each float as the shortest text that reads back as the same float
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "numbers.h"
+#include "constants.h"
+#include "memory.h"
+#include "strings.h"
+
+/* Floats are printed with Ryu (Ulf Adams, "Ryu: fast float-to-string conversion", PLDI 2018). The float and the halfway
+   points to its neighbours are scaled by a power of 10 with a single 64 by 128 bit multiplication each, which gives the
+   interval of decimals that read back as the float; digits are then dropped while the interval still holds a decimal with
+   fewer of them. The multipliers are 5 to the power of each exponent (or its inverse), kept to 125 bits. Rather than
+   listing them, they're worked out exactly with multiple word arithmetic the first time a float is printed.
+
+   Numbers are read in a single pass that gathers the digits into a 64 bit integer. Integers that fit are exact; a decimal
+   float whose digits and power of 10 are both small enough to be exact as doubles is a single multiplication or division,
+   which is then correctly rounded, and anything else (e.g. 17 digits or an exponent of 300) is handed to strtod. */
+
+#define FLO_MANTISSA_BITS 52
+#define FLO_EXPONENT_BITS 11
+#define FLO_BIAS 1023
+#define POW5_BITCOUNT 125 // the bits kept of each power of 5
+#define POW5_INV_BITCOUNT 125
+#define POW5_TABLE_SIZE 326 // enough for the smallest subnormal
+#define POW5_INV_TABLE_SIZE 342 // enough for the largest float
+#define POW5_WORDS 14 // enough 64 bit words for 5 to the power of POW5_INV_TABLE_SIZE, with a word to spare for shifting
+#define EXACT_MANTISSA 9007199254740992ul // 2 to the power of 53, the largest integer up to which every integer is a double
+#define EXACT_POWER 22 // the largest power of 10 that's exactly a double
+#define MAX_EXPONENT 100000 // exponents beyond this are clamped while they're read, since the result is 0 or infinity anyway
+
+static uint64_t pow5split[POW5_TABLE_SIZE][2]; // 5^i scaled to POW5_BITCOUNT bits, least significant word first
+static uint64_t pow5invsplit[POW5_INV_TABLE_SIZE][2]; // 2^(bits of 5^i - 1 + POW5_INV_BITCOUNT) / 5^i, rounded up
+static pthread_once_t tablesonce = PTHREAD_ONCE_INIT;
+
+static const char digitpairs[] = "00010203040506070809101112131415161718192021222324252627282930313233343536373839404142434445464748495051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899";
+static const char digitletters[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+static const uint64_t powers10[] = {1ul, 10ul, 100ul, 1000ul, 10000ul, 100000ul, 1000000ul, 10000000ul, 100000000ul, 1000000000ul, 10000000000ul, 100000000000ul, 1000000000000ul, 10000000000000ul, 100000000000000ul, 1000000000000000ul, 10000000000000000ul, 100000000000000000ul, 1000000000000000000ul, 10000000000000000000ul};
+static const double exactpowers10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+static void buildTables();
+static int formatDigits(char*, uint64_t, uint);
+static int countDigits(uint64_t, uint);
+static uint64_t shortestDecimal(uint64_t, uint, int*);
+static uint64_t mulShift(uint64_t, uint64_t*, int);
+static int pow5bits(int);
+static int pow5Factor(uint64_t);
+static int digitValue(char);
+
+/*! Writes the given integer in the given base, using capital letters for digits from 10 up
+    @param dest     where to write the integer, which must have room for NUMBER_MAX_SIZE bytes
+    @param value    the integer
+    @param base     the base, from 2 to 36
+    @return         the number of bytes written, not counting the terminating null
+*/
+int formatInt (char* dest, tap_int value, uint base) {
+    if (value < 0) {
+        dest[0] = '-';
+        return 1 + formatDigits(dest + 1, -(uint64_t)value, base); // negated unsigned so that the most negative integer has a magnitude
+    }
+    return formatDigits(dest, value, base);
+}
+
+/*! Writes the given float as the shortest decimal that reads back as the same float, positionally if its exponent is from -4 to 15 (e.g. 0.001, 22.0) and in scientific notation otherwise (e.g. 1e+16, 2.5e-07)
+    @param dest     where to write the float, which must have room for NUMBER_MAX_SIZE bytes
+    @param value    the float
+    @return         the number of bytes written, not counting the terminating null
+*/
+int formatFlo (char* dest, tap_flo value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    int negative = bits >> (FLO_MANTISSA_BITS + FLO_EXPONENT_BITS);
+    uint64_t mantissa = bits & ((1ul << FLO_MANTISSA_BITS) - 1);
+    uint exponent = (bits >> FLO_MANTISSA_BITS) & ((1u << FLO_EXPONENT_BITS) - 1);
+    char* pos = dest;
+    if (exponent == (1u << FLO_EXPONENT_BITS) - 1) { // infinity or not a number
+        strcpy(dest, mantissa != 0 ? "nan" : negative ? "-inf" : "inf");
+        return strlen(dest);
+    }
+    if (negative) {
+        *pos++ = '-';
+    }
+    if (mantissa == 0 && exponent == 0) {
+        strcpy(pos, "0.0");
+        return pos + 3 - dest;
+    }
+    int e10;
+    uint64_t output = shortestDecimal(mantissa, exponent, &e10);
+    char digits[NUMBER_MAX_SIZE];
+    int numdigits = formatDigits(digits, output, 10);
+    int scientific = e10 + numdigits - 1; // the exponent the float has in scientific notation
+    if (scientific < -4 || scientific >= 16) {
+        *pos++ = digits[0];
+        if (numdigits > 1) {
+            *pos++ = '.';
+            memcpy(pos, digits + 1, numdigits - 1);
+            pos += numdigits - 1;
+        }
+        *pos++ = 'e';
+        *pos++ = scientific < 0 ? '-' : '+';
+        if (scientific > -10 && scientific < 10) {
+            *pos++ = '0';
+        }
+        pos += formatDigits(pos, abs(scientific), 10);
+    } else if (e10 >= 0) { // an integer, which keeps a fractional digit so it still reads as a float
+        memcpy(pos, digits, numdigits);
+        pos += numdigits;
+        memset(pos, '0', e10);
+        pos += e10;
+        memcpy(pos, ".0", 2);
+        pos += 2;
+    } else if (scientific >= 0) { // the point falls among the digits
+        memcpy(pos, digits, scientific + 1);
+        pos += scientific + 1;
+        *pos++ = '.';
+        memcpy(pos, digits + scientific + 1, numdigits - scientific - 1);
+        pos += numdigits - scientific - 1;
+    } else { // the point comes before the digits
+        memcpy(pos, "0.", 2);
+        pos += 2;
+        memset(pos, '0', -scientific - 1);
+        pos += -scientific - 1;
+        memcpy(pos, digits, numdigits);
+        pos += numdigits;
+    }
+    *pos = '\0';
+    return pos - dest;
+}
+
+/*! Reads the number in the given text in a single pass: an optional sign, digits in the given base with an optional fractional part, and, in base 10, an optional exponent (e.g. 1.5e-3); whitespace around the number is skipped
+    @param text     the text, which needn't be null terminated
+    @param size     the size of the text
+    @param base     the base, from 2 to 36; digits from 10 up are letters of either case
+    @param intval   set to the number if it's an integer that fits in tap_int
+    @param floval   set to the number if it's a float, including an integer with too many digits to fit
+    @return         TYPE_INT or TYPE_FLO depending on which was set, or TYPE_NIL if the text isn't a number in the given base
+*/
+datatype parseNumber (char* text, int size, uint base, tap_int* intval, tap_flo* floval) {
+    if (base < 2 || base > 36) {
+        return TYPE_NIL;
+    }
+    int start = spanClass(text, size, CLASS_SPACE);
+    int end = start < size ? size - spanClassBack(text, size, CLASS_SPACE) : size;
+    int i = start;
+    int negative = 0;
+    if (i < end && (text[i] == '-' || text[i] == '+')) {
+        negative = text[i++] == '-';
+    }
+    uint64_t mantissa = 0;
+    int overflow = 0; // whether the digits no longer fit in the mantissa
+    double approximate = 0; // the digits read as a float, for bases other than 10
+    int numdigits = 0;
+    int fraction = 0; // the number of digits after the point
+    int isflo = 0;
+    for (; i < end; ++i) {
+        if (text[i] == '.' && !isflo) {
+            isflo = 1;
+            continue;
+        }
+        uint digit = digitValue(text[i]);
+        if (digit >= base) {
+            break;
+        }
+        overflow |= __builtin_mul_overflow(mantissa, (uint64_t)base, &mantissa) | __builtin_add_overflow(mantissa, (uint64_t)digit, &mantissa);
+        approximate = approximate * base + digit;
+        ++numdigits;
+        fraction += isflo;
+    }
+    int exponent = 0;
+    if (base == 10 && i < end && numdigits > 0 && (text[i] == 'e' || text[i] == 'E')) {
+        isflo = 1;
+        ++i;
+        int expnegative = i < end && text[i] == '-';
+        if (i < end && (text[i] == '-' || text[i] == '+')) {
+            ++i;
+        }
+        int expstart = i;
+        for (; i < end && text[i] >= '0' && text[i] <= '9'; ++i) {
+            if (exponent < MAX_EXPONENT) {
+                exponent = exponent * 10 + (text[i] - '0');
+            }
+        }
+        if (i == expstart) {
+            return TYPE_NIL;
+        }
+        exponent = expnegative ? -exponent : exponent;
+    }
+    if (numdigits == 0 || i < end) {
+        return TYPE_NIL;
+    }
+    if (!isflo && !overflow && mantissa <= (uint64_t)LONG_MAX + negative) { // the most negative integer has one more than the largest's magnitude
+        *intval = negative ? -mantissa : mantissa;
+        return TYPE_INT;
+    }
+    double result;
+    if (base != 10) {
+        result = approximate / pow(base, fraction);
+    } else {
+        int power = exponent - fraction;
+        if (!overflow && mantissa <= EXACT_MANTISSA && power >= -EXACT_POWER && power <= EXACT_POWER) { // both operands are exact, so the one rounding is correct
+            result = power < 0 ? (double)mantissa / exactpowers10[-power] : (double)mantissa * exactpowers10[power];
+        } else {
+            int length = end - start;
+            char* copy = allocate(length + 1); // strtod needs a null terminated copy
+            memcpy(copy, text + start, length);
+            copy[length] = '\0';
+            result = fabs(strtod(copy, NULL));
+            free(copy);
+        }
+    }
+    *floval = negative ? -result : result;
+    return TYPE_FLO;
+}
+
+/*! Works out the multipliers Ryu scales by, each to 125 bits: 5^i, and 2^k / 5^i rounded up, where k is chosen so the quotient also has 125 bits
+    @return         nothing
+*/
+static void buildTables () {
+    uint64_t power[POW5_WORDS] = {1}; // 5^i, least significant word first
+    uint64_t remainder[POW5_WORDS];
+    int i, j, k;
+    for (i = 0; i < POW5_INV_TABLE_SIZE; ++i) {
+        int bits = pow5bits(i); // the number of bits in 5^i
+        if (i < POW5_TABLE_SIZE) {
+            int shift = bits - POW5_BITCOUNT;
+            unsigned __int128 scaled;
+            if (shift <= 0) { // 5^i has fewer than 125 bits, so it fits in the two low words
+                scaled = (((unsigned __int128)power[1] << 64) | power[0]) << -shift;
+            } else { // take the top 125 bits, which start in one of the words and may reach into the two above it
+                int word = shift / 64;
+                int offset = shift % 64;
+                scaled = (((unsigned __int128)power[word + 1] << 64) | power[word]) >> offset;
+                if (offset > 0) {
+                    scaled |= (unsigned __int128)power[word + 2] << (128 - offset);
+                }
+            }
+            pow5split[i][0] = (uint64_t)scaled;
+            pow5split[i][1] = (uint64_t)(scaled >> 64);
+        }
+        // 2^(bits - 1 + 125) / 5^i by long division: the first bits digits of the dividend are 2^(bits - 1), and the rest are zeros
+        memset(remainder, 0, sizeof(remainder));
+        remainder[(bits - 1) / 64] = 1ul << ((bits - 1) % 64);
+        unsigned __int128 quotient = 0;
+        for (j = 0; j <= POW5_INV_BITCOUNT; ++j) {
+            if (j > 0) { // bring down the next zero
+                for (k = POW5_WORDS - 1; k > 0; --k) {
+                    remainder[k] = (remainder[k] << 1) | (remainder[k - 1] >> 63);
+                }
+                remainder[0] <<= 1;
+                quotient <<= 1;
+            }
+            for (k = POW5_WORDS - 1; k > 0 && remainder[k] == power[k]; --k);
+            if (remainder[k] >= power[k]) { // the remainder is at least 5^i, so take it away
+                uint64_t borrow = 0;
+                for (k = 0; k < POW5_WORDS; ++k) {
+                    uint64_t difference = remainder[k] - power[k] - borrow;
+                    borrow = remainder[k] < power[k] || (remainder[k] == power[k] && borrow);
+                    remainder[k] = difference;
+                }
+                quotient |= 1;
+            }
+        }
+        quotient += 1;
+        pow5invsplit[i][0] = (uint64_t)quotient;
+        pow5invsplit[i][1] = (uint64_t)(quotient >> 64);
+        uint64_t carry = 0;
+        for (k = 0; k < POW5_WORDS; ++k) { // on to 5^(i + 1)
+            unsigned __int128 product = (unsigned __int128)power[k] * 5 + carry;
+            power[k] = (uint64_t)product;
+            carry = (uint64_t)(product >> 64);
+        }
+    }
+}
+
+/*! Writes the given unsigned integer in the given base, two digits at a time in base 10 and with shifts in bases that are powers of 2
+    @param dest     where to write the digits
+    @param value    the integer
+    @param base     the base, from 2 to 36
+    @return         the number of digits written, not counting the terminating null
+*/
+static int formatDigits (char* dest, uint64_t value, uint base) {
+    int size = countDigits(value, base);
+    char* pos = dest + size;
+    *pos = '\0';
+    if (base == 10) {
+        while (value >= 100) {
+            uint pair = (value % 100) * 2;
+            value /= 100;
+            *--pos = digitpairs[pair + 1];
+            *--pos = digitpairs[pair];
+        }
+        if (value >= 10) {
+            *--pos = digitpairs[value * 2 + 1];
+            *--pos = digitpairs[value * 2];
+        } else {
+            *--pos = '0' + value;
+        }
+    } else if ((base & (base - 1)) == 0) {
+        int shift = __builtin_ctz(base);
+        do {
+            *--pos = digitletters[value & (base - 1)];
+            value >>= shift;
+        } while (value != 0);
+    } else {
+        do {
+            *--pos = digitletters[value % base];
+            value /= base;
+        } while (value != 0);
+    }
+    return size;
+}
+
+/*! Returns how many digits the given unsigned integer has in the given base, which in base 10 is worked out from the number of bits it has rather than by dividing
+    @param value    the integer
+    @param base     the base, from 2 to 36
+    @return         the number of digits
+*/
+static int countDigits (uint64_t value, uint base) {
+    int bits = 64 - __builtin_clzl(value | 1);
+    if (base == 10) {
+        int guess = bits * 1233 >> 12; // bits * log10(2), which is the number of digits or one fewer
+        return guess + (value >= powers10[guess]) + (value == 0);
+    } else if ((base & (base - 1)) == 0) {
+        int shift = __builtin_ctz(base);
+        return (bits + shift - 1) / shift;
+    }
+    int count = 1;
+    while (value >= base) {
+        value /= base;
+        ++count;
+    }
+    return count;
+}
+
+/*! Returns the decimal with the fewest digits that reads back as the float with the given fields, breaking ties by which is closest to it
+    @param mantissa the float's 52 bit mantissa field
+    @param exponent the float's biased exponent field
+    @param e10      set to the power of 10 the returned digits are multiplied by
+    @return         the digits
+*/
+static uint64_t shortestDecimal (uint64_t mantissa, uint exponent, int* e10) {
+    pthread_once(&tablesonce, &buildTables);
+    int e2;
+    uint64_t m2;
+    if (exponent == 0) { // subnormal
+        e2 = 1 - FLO_BIAS - FLO_MANTISSA_BITS - 2;
+        m2 = mantissa;
+    } else {
+        e2 = (int)exponent - FLO_BIAS - FLO_MANTISSA_BITS - 2;
+        m2 = (1ul << FLO_MANTISSA_BITS) | mantissa;
+    }
+    int acceptbounds = (m2 & 1) == 0; // a halfway point reads back as the float if its mantissa is even
+    uint64_t mv = 4 * m2; // the float and the halfway points on either side, times 4 so that they're integers
+    uint mmshift = mantissa != 0 || exponent <= 1; // the lower neighbour is closer when the mantissa wraps to a smaller exponent
+    uint64_t vr, vp, vm; // mv, mv + 2 and mv - 1 - mmshift, scaled to decimal
+    int vmtrailingzeros = 0; // whether the digits dropped from vm so far are all zeros
+    int vrtrailingzeros = 0;
+    if (e2 >= 0) {
+        int q = ((e2 * 78913) >> 18) - (e2 > 3); // log10(2^e2), less one to be sure there are enough digits
+        *e10 = q;
+        int shift = -e2 + q + POW5_INV_BITCOUNT + pow5bits(q) - 1;
+        vr = mulShift(4 * m2, pow5invsplit[q], shift);
+        vp = mulShift(4 * m2 + 2, pow5invsplit[q], shift);
+        vm = mulShift(4 * m2 - 1 - mmshift, pow5invsplit[q], shift);
+        if (q <= 21) { // only then can any of them be a multiple of 5^q, which makes the scaling exact
+            if (mv % 5 == 0) {
+                vrtrailingzeros = pow5Factor(mv) >= q;
+            } else if (acceptbounds) {
+                vmtrailingzeros = pow5Factor(mv - 1 - mmshift) >= q;
+            } else {
+                vp -= pow5Factor(mv + 2) >= q;
+            }
+        }
+    } else {
+        int q = ((-e2 * 732923) >> 20) - (-e2 > 1); // log10(5^-e2), less one
+        *e10 = q + e2;
+        int i = -e2 - q;
+        int shift = q - (pow5bits(i) - POW5_BITCOUNT);
+        vr = mulShift(4 * m2, pow5split[i], shift);
+        vp = mulShift(4 * m2 + 2, pow5split[i], shift);
+        vm = mulShift(4 * m2 - 1 - mmshift, pow5split[i], shift);
+        if (q <= 1) { // mv has at least 2 trailing zero bits, so the scaled values are exact
+            vrtrailingzeros = 1;
+            if (acceptbounds) {
+                vmtrailingzeros = mmshift == 1;
+            } else {
+                --vp;
+            }
+        } else if (q < 63) {
+            vrtrailingzeros = (mv & ((1ul << q) - 1)) == 0;
+        }
+    }
+    int removed = 0;
+    uint lastremoved = 0;
+    uint64_t output;
+    if (vmtrailingzeros || vrtrailingzeros) { // rarely, the bounds or the float are exact and ties need care
+        while (vp / 10 > vm / 10) {
+            vmtrailingzeros &= vm % 10 == 0;
+            vrtrailingzeros &= lastremoved == 0;
+            lastremoved = vr % 10;
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            ++removed;
+        }
+        if (vmtrailingzeros) {
+            while (vm % 10 == 0) {
+                vrtrailingzeros &= lastremoved == 0;
+                lastremoved = vr % 10;
+                vr /= 10;
+                vp /= 10;
+                vm /= 10;
+                ++removed;
+            }
+        }
+        if (vrtrailingzeros && lastremoved == 5 && vr % 2 == 0) { // exactly halfway, so round to even
+            lastremoved = 4;
+        }
+        output = vr + ((vr == vm && (!acceptbounds || !vmtrailingzeros)) || lastremoved >= 5);
+    } else {
+        int roundup = 0;
+        if (vp / 100 > vm / 100) { // usually at least two digits can go, so try that first
+            roundup = vr % 100 >= 50;
+            vr /= 100;
+            vp /= 100;
+            vm /= 100;
+            removed += 2;
+        }
+        while (vp / 10 > vm / 10) {
+            roundup = vr % 10 >= 5;
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            ++removed;
+        }
+        output = vr + (vr == vm || roundup);
+    }
+    *e10 += removed;
+    return output;
+}
+
+/*! Returns the given integer times the given 128 bit multiplier, shifted right by the given amount
+    @param m        the integer
+    @param mul      the multiplier, least significant word first
+    @param shift    the shift, which is at least 64
+    @return         the result, which fits in 64 bits
+*/
+static uint64_t mulShift (uint64_t m, uint64_t* mul, int shift) {
+    unsigned __int128 low = (unsigned __int128)m * mul[0];
+    unsigned __int128 high = (unsigned __int128)m * mul[1];
+    return (uint64_t)(((low >> 64) + high) >> (shift - 64));
+}
+
+/*! Returns the number of bits in 5 to the given power, or 1 for 5^0
+    @param e        the power, from 0 to 3528
+    @return         the number of bits
+*/
+static int pow5bits (int e) {
+    return ((e * 1217359) >> 19) + 1;
+}
+
+/*! Returns how many times 5 divides the given integer
+    @param value    the integer, which isn't 0
+    @return         the number of times
+*/
+static int pow5Factor (uint64_t value) {
+    int count = 0;
+    while (value % 5 == 0) {
+        value /= 5;
+        ++count;
+    }
+    return count;
+}
+
+/*! Returns the value of the given digit in any base up to 36
+    @param chr      the digit
+    @return         its value, or 36 if it isn't a digit
+*/
+static int digitValue (char chr) {
+    if (chr >= '0' && chr <= '9') {
+        return chr - '0';
+    } else if (chr >= 'a' && chr <= 'z') {
+        return chr - 'a' + 10;
+    } else if (chr >= 'A' && chr <= 'Z') {
+        return chr - 'A' + 10;
+    }
+    return 36;
+}
@@ -0,0 +1,17 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   numbers.h
+    @brief  The header file for numbers.c
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#ifndef NUMBERS_H
+#define NUMBERS_H
+
+#include "structs.h"
+
+int formatInt(char*, tap_int, uint);
+int formatFlo(char*, tap_flo);
+datatype parseNumber(char*, int, uint, tap_int*, tap_flo*);
+
+#endif
@@ -0,0 +1,399 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   packages.c
+    @brief  Finds and reads package files and imports them by indexing their top-level definitions, each of which is only parsed and evaluated once it is first referenced
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+#include <pthread.h>
+
+#include "packages.h"
+#include "engine.h"
+#include "externs.h"
+#include "constants.h"
+#include "constructors.h"
+#include "memory.h"
+#include "strings.h"
+#include "hashtable.h"
+
+/* A package is read and indexed once per process and shared by every context that imports it. The index only records where each
+   top-level expression starts and ends and, for (set "name" ...) and (new-type "name" ...), the name it defines; a definition is
+   parsed the first time any context needs it and the parsed form is kept for the rest. Top-level expressions that aren't
+   definitions are evaluated when the package is imported, since nothing refers to them by name. */
+
+static tap_package* packages = NULL; // every package read so far
+static pthread_mutex_t packageslock = PTHREAD_MUTEX_INITIALIZER; // guards the list of packages and the parsed form of each definition
+
+static char* resolvePackage(char*);
+static tap_package* loadPackage(char*);
+static uint skipExpression(char*, uint, uint);
+static char* definitionName(char*, uint, uint);
+static void evaluateDefinition(importlist*, int);
+static expression* evaluateInRoot(expression*);
+
+/*! Imports the package with the given name into the current context; its definitions are evaluated in the root environment when they are first referenced
+    @param name         the name of a package in one of the directories listed in TAP_PATH (or in ./packages if it isn't set), or the path of a package file
+    @return             the number of named definitions in the package or -1 if it couldn't be read
+*/
+int importPackage (char* name) {
+    char* path = resolvePackage(name);
+    if (path == NULL) {
+        addError(newErrorlist(ERR_UNREADABLE_FILE, newString(strDup(name)), 0, 0));
+        return -1;
+    }
+    tap_package* package;
+    pthread_mutex_lock(&packageslock);
+    for (package = packages; package != NULL && strcmp(package->path, path) != 0; package = package->next);
+    if (package == NULL) {
+        package = loadPackage(path);
+        if (package != NULL) {
+            package->next = packages;
+            packages = package;
+        }
+    }
+    pthread_mutex_unlock(&packageslock);
+    free(path);
+    if (package == NULL) { // readPackage has reported the error
+        return -1;
+    }
+    int numnamed = 0;
+    int i;
+    for (i = 0; i < package->numdefs; ++i) {
+        numnamed += package->defs[i].name != NULL;
+    }
+    importlist** tail = &ccontext->imports;
+    for (; *tail != NULL; tail = &(*tail)->next) {
+        if ((*tail)->package == package) { // importing a package again doesn't evaluate anything
+            return numnamed;
+        }
+    }
+    importlist* import = allocate(sizeof(importlist));
+    import->package = package;
+    import->defined = allocate(package->numdefs + 1);
+    memset(import->defined, 0, package->numdefs + 1);
+    import->next = NULL;
+    *tail = import; // packages imported first are searched first
+    noteBinding(0); // names a running loop took for built-ins may now be the package's
+    for (i = 0; i < package->numdefs; ++i) {
+        if (package->defs[i].name == NULL) {
+            evaluateDefinition(import, i);
+        }
+    }
+    return numnamed;
+}
+
+/*! Evaluates every definition of the given name in the packages imported into the current context that hasn't been evaluated yet
+    @param name         the name being referenced
+    @return             1 if any definitions were evaluated (so the name should be looked up again), 0 otherwise
+*/
+int defineImported (char* name) {
+    int defined = 0;
+    importlist* import;
+    for (import = ccontext->imports; import != NULL; import = import->next) {
+        tap_package* package = import->package;
+        packagedef* def = lookupHash(package->index, name);
+        int i;
+        for (i = def != NULL ? def - package->defs : -1; i >= 0; i = package->defs[i].next) {
+            if (!import->defined[i]) {
+                evaluateDefinition(import, i);
+                defined = 1;
+            }
+        }
+    }
+    return defined;
+}
+
+/*! Evaluates every definition in the packages imported into the current context that hasn't been evaluated yet, in the order the packages define them
+    @return             nothing
+*/
+void defineAllImported () {
+    importlist* import;
+    for (import = ccontext->imports; import != NULL; import = import->next) {
+        int i;
+        for (i = 0; i < import->package->numdefs; ++i) {
+            if (!import->defined[i]) {
+                evaluateDefinition(import, i);
+            }
+        }
+    }
+}
+
+/*! Returns whether or not any package imported into the current context defines the given name, whether or not the definition has been evaluated yet
+    @param name         the name to look for
+    @return             1 if an imported package defines the name, 0 otherwise
+*/
+int importsDefine (char* name) {
+    importlist* import;
+    for (import = ccontext->imports; import != NULL; import = import->next) {
+        if (lookupHash(import->package->index, name) != NULL) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*! Reads the entire given file into a string, adding an error to the current context if it can't be read
+    @param path         the path of the file
+    @return             the contents of the file, which must be freed by the caller, or null if it couldn't be read
+*/
+char* readPackage (char* path) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        addError(newErrorlist(ERR_UNREADABLE_FILE, newString(strDup(path)), 0, 0));
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    rewind(file);
+    char* text = allocate(size + 1);
+    size_t read = fread(text, 1, size, file);
+    fclose(file);
+    text[read] = '\0';
+    return text;
+}
+
+/*! Finds the package file with the given name
+    @param name         the name of the package or the path of a package file
+    @return             the canonical path of the file, which must be freed by the caller, or null if there is no such file
+*/
+static char* resolvePackage (char* name) {
+    int hasextension = strlen(name) >= strlen(PACKAGE_EXTENSION) && strcmp(name + strlen(name) - strlen(PACKAGE_EXTENSION), PACKAGE_EXTENSION) == 0;
+    char candidate[PATH_MAX];
+    if (strchr(name, '/') != NULL) { // a path rather than a name
+        if (snprintf(candidate, PATH_MAX, "%s%s", name, hasextension ? "" : PACKAGE_EXTENSION) >= PATH_MAX) {
+            return NULL;
+        }
+        return realpath(candidate, NULL);
+    }
+    char* directories = getenv(PACKAGE_PATH_VARIABLE);
+    if (directories == NULL) {
+        directories = PACKAGE_DEFAULT_PATH;
+    }
+    while (*directories != '\0') {
+        size_t length = strcspn(directories, ":");
+        if (length > 0 && snprintf(candidate, PATH_MAX, "%.*s/%s%s", (int)length, directories, name, hasextension ? "" : PACKAGE_EXTENSION) < PATH_MAX) {
+            char* path = realpath(candidate, NULL);
+            if (path != NULL) {
+                return path;
+            }
+        }
+        directories += length;
+        if (*directories == ':') {
+            ++directories;
+        }
+    }
+    return NULL;
+}
+
+/*! Reads the given package file and indexes its top-level expressions
+    @param path         the canonical path of the package file
+    @return             the new package or null if the file couldn't be read
+*/
+static tap_package* loadPackage (char* path) {
+    char* text = readPackage(path);
+    if (text == NULL) {
+        return NULL;
+    }
+    tap_package* package = allocate(sizeof(tap_package));
+    package->path = strDup(path);
+    package->text = text;
+    package->numdefs = 0;
+    package->index = newHashtable(INITIAL_PACKAGE_INDEX_SIZE);
+    package->next = NULL;
+    int capacity = INITIAL_PACKAGE_DEF_COUNT;
+    package->defs = allocate(sizeof(packagedef) * capacity);
+    uint size = strlen(text);
+    uint i = 0;
+    while (i < size) {
+        if (isspace((unsigned char)text[i])) {
+            ++i;
+        } else if (strncmp(text + i, "'''", 3) == 0) { // a block comment
+            char* close = strstr(text + i + 3, "'''");
+            i = close != NULL ? close - text + 3 : size;
+        } else if (text[i] == '#') { // a line comment
+            while (i < size && text[i] != '\n') {
+                ++i;
+            }
+        } else {
+            if (package->numdefs == capacity) {
+                capacity *= 2;
+                package->defs = realloc(package->defs, sizeof(packagedef) * capacity);
+                if (package->defs == NULL) {
+                    exit(EXIT_OUT_OF_MEMORY);
+                }
+            }
+            packagedef* def = &package->defs[package->numdefs++];
+            def->start = i;
+            def->end = i = skipExpression(text, i, size);
+            def->name = definitionName(text, def->start, def->end);
+            def->next = -1;
+            def->parsed = NULL;
+        }
+    }
+    int j;
+    for (j = 0; j < package->numdefs; ++j) { // index the definitions only once they're all read, since the index points into them
+        packagedef* def = &package->defs[j];
+        if (def->name != NULL) {
+            packagedef* first = lookupHash(package->index, def->name);
+            if (first == NULL) {
+                insertDirectHash(package->index, def->name, def);
+            } else { // chain the later definitions of a name to the first one so that they're evaluated in order
+                while (first->next >= 0) {
+                    first = &package->defs[first->next];
+                }
+                first->next = j;
+            }
+        }
+    }
+    return package;
+}
+
+/*! Returns where the top-level expression starting at the given index ends
+    @param text         the package's text
+    @param start        the index of the first character of the expression
+    @param size         the size of the text
+    @return             the index just past the end of the expression
+*/
+static uint skipExpression (char* text, uint start, uint size) {
+    uint i = start;
+    int depth = 0;
+    for (; i < size; ++i) {
+        char c = text[i];
+        if (c == '"') { // skip string literals, which may contain delimiters
+            for (++i; i < size && text[i] != '"'; ++i) {
+                if (text[i] == '\\' && i + 1 < size) {
+                    ++i;
+                }
+            }
+        } else if (c == '(' || c == '[' || c == '{') {
+            ++depth;
+        } else if (c == ')' || c == ']' || c == '}') {
+            if (--depth <= 0) {
+                return i + 1;
+            }
+        } else if (depth == 0 && isspace((unsigned char)c)) { // a bare value at the top level ends at the next space
+            return i;
+        }
+    }
+    return size;
+}
+
+/*! Returns the name the given top-level expression defines, if it's a definition
+    @param text         the package's text
+    @param start        the index of the first character of the expression
+    @param end          the index just past the end of the expression
+    @return             the name, which must be freed by the caller, or null if the expression isn't a (set "name" ...) or (new-type "name" ...) definition
+*/
+static char* definitionName (char* text, uint start, uint end) {
+    if (text[start] != '(') {
+        return NULL;
+    }
+    uint i = start + 1;
+    while (i < end && isspace((unsigned char)text[i])) {
+        ++i;
+    }
+    uint head = i;
+    while (i < end && !isspace((unsigned char)text[i]) && text[i] != '"' && text[i] != '(' && text[i] != '[') {
+        ++i;
+    }
+    if (!((i - head == 3 && strncmp(text + head, "set", 3) == 0) || (i - head == 8 && strncmp(text + head, "new-type", 8) == 0))) {
+        return NULL;
+    }
+    while (i < end && isspace((unsigned char)text[i])) {
+        ++i;
+    }
+    if (i >= end || text[i] != '"') {
+        return NULL;
+    }
+    uint namestart = ++i;
+    while (i < end && text[i] != '"') {
+        if (text[i] == '\\') { // names with escapes are left for the package to define when it's imported
+            return NULL;
+        }
+        ++i;
+    }
+    return i < end ? substr(text, namestart, i) : NULL;
+}
+
+/*! Evaluates the given definition of the given import in the root environment of the current context, parsing it first if no context has needed it yet
+    @param import       the import the definition belongs to
+    @param index        the index of the definition in the package
+    @return             nothing
+*/
+static void evaluateDefinition (importlist* import, int index) {
+    import->defined[index] = 1; // mark it first so that a definition that refers to its own name doesn't evaluate itself again
+    tap_package* package = import->package;
+    packagedef* def = &package->defs[index];
+    pthread_mutex_lock(&packageslock);
+    if (def->parsed == NULL) {
+        errorlist* lasterror = ccontext->cerror;
+        char* text = substr(package->text, def->start, def->end);
+        expression* parsed = parse(text);
+        free(text);
+        if (ccontext->cerror == lasterror) {
+            def->parsed = parsed;
+        } else { // leave it unparsed so that every context that needs it reports the errors
+            freeExpr(parsed);
+        }
+    }
+    expression* code = copyExpressionUnshared(def->parsed); // each context evaluates a copy of its own so the parsed form never changes
+    pthread_mutex_unlock(&packageslock);
+    expression* head;
+    for (head = code; head != NULL; head = head->next) {
+        freeExpr(evaluateInRoot(head));
+    }
+    freeExpr(code);
+}
+
+/*! Evaluates the given expression in a new environment whose parent is the root environment and moves whatever it defines into the root environment
+    @param expr         the expression to evaluate
+    @return             the result of the evaluation
+*/
+static expression* evaluateInRoot (expression* expr) {
+    tap_context* context = ccontext;
+    environment* root = context->environments[0];
+    int previous = context->cenvironment;
+    reserveEnvironment();
+    context->environments[previous + 1]->parent = 0; // only the root environment is visible to the definition, not whatever referred to it
+    ++context->cenvironment;
+    environment* env = context->environments[context->cenvironment];
+    expression* result = evaluateArgument(expr);
+    int i;
+    for (i = 0; i < env->variables->size; ++i) {
+        hashelement* element = env->variables->table[i];
+        while (element != NULL) {
+            hashelement* next = element->next;
+            if (element->flag == HFLAG_USER) {
+                if (!setUserHash(root->variables, element->key, element->value)) {
+                    ++root->numvars;
+                    noteBinding(0);
+                }
+            } else if (element->flag == HFLAG_PRIM) {
+                insertPrimHash(root->variables, element->key, element->value);
+                noteBinding(0);
+            }
+            free(element->key);
+            free(element);
+            element = next;
+        }
+        env->variables->table[i] = NULL;
+    }
+    env->numvars = 0;
+    if (env->types != NULL) {
+        typedefs* td = env->types;
+        while (td->next != NULL) {
+            td = td->next;
+        }
+        td->next = root->types;
+        root->types = env->types;
+        env->types = NULL;
+    }
+    resetEnvironment();
+    context->cenvironment = previous; // resetEnvironment returns to the root environment, its parent
+    return result;
+}
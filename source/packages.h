@@ -0,0 +1,20 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   packages.h
+    @brief  The header file for packages.c
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#ifndef PACKAGES_H
+#define PACKAGES_H
+
+#include "structs.h"
+#include "dep_structs.h"
+
+int importPackage(char*);
+int defineImported(char*);
+void defineAllImported();
+int importsDefine(char*);
+char* readPackage(char*);
+
+#endif
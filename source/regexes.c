@@ -0,0 +1,1073 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   regexes.c
+    @brief  Regular expressions, which are compiled once and then matched in time linear in the size of the text
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "regexes.h"
+#include "constants.h"
+#include "constructors.h"
+#include "memory.h"
+
+/* A pattern is parsed into a tree and compiled into a program for a Thompson NFA: instructions that match a set of bytes,
+   split into two ways to go on, jump, save the position into a group's slot, check for the start or end of the text, or end
+   a match. The program is run by a Pike VM, which steps every thread of the NFA along the text together, one byte at a
+   time, so that each byte is only looked at once per instruction however the pattern backtracks. Threads are kept in the
+   order a backtracking matcher would try them, so the match found is the one Perl would find.
+
+   Most texts scanned don't match, and the Pike VM does more work per byte than needed to find that out, so the text is first
+   scanned by a DFA whose states are the sets of instructions the NFA could be at. The states are worked out as the scan
+   reaches them and kept for later scans, so a state costs its work once and then a table lookup per byte. If there's no
+   match the Pike VM isn't run at all. */
+
+#define REGEX_OP_SET 0 // match a byte in set x
+#define REGEX_OP_MATCH 1 // end the match
+#define REGEX_OP_EOL 2 // only go on at the end of the text
+#define REGEX_OP_BOL 3 // only go on at the start of the text
+#define REGEX_OP_JMP 4 // go on at x
+#define REGEX_OP_SPLIT 5 // go on at x and, failing that, at y
+#define REGEX_OP_SAVE 6 // save the position in slot x
+
+#define REGEX_NODE_EMPTY 0
+#define REGEX_NODE_SET 1 // a is the set
+#define REGEX_NODE_BOL 2
+#define REGEX_NODE_EOL 3
+#define REGEX_NODE_CAT 4 // a then b
+#define REGEX_NODE_ALT 5 // a or else b
+#define REGEX_NODE_GROUP 6 // a, saved as group b (if b > 0)
+#define REGEX_NODE_REPEAT 7 // a repeated from min to max times (max < 0 being unbounded)
+
+#define REGEX_BUCKETS (REGEX_MAX_STATES * 2) // the size of the hash table of automaton states, which is kept at most half full
+#define SET_SIZE 32
+#define SET_HAS(set, byte) ((set)[(byte) >> 3] >> ((byte) & 7) & 1)
+#define SET_ADD(set, byte) ((set)[(byte) >> 3] |= 1 << ((byte) & 7))
+
+typedef struct {
+    uint kind;
+    int a;
+    int b;
+    int min;
+    int max;
+    int greedy;
+} regnode;
+
+typedef struct {
+    char* text;
+    int size;
+    int pos;
+    regnode* nodes;
+    int numnodes;
+    int nodecapacity;
+    unsigned char* sets;
+    int numsets;
+    int setcapacity;
+    int numgroups;
+    int depth; // how deeply the groups and repetitions being parsed are nested
+    reginst* program;
+    int numinsts;
+    int instcapacity;
+    char* error; // what went wrong, or null
+} regparser;
+
+typedef struct {
+    int pc; // the instruction to add, or -1 for a frame that restores a slot
+    int slot;
+    int value;
+} regframe;
+
+typedef struct {
+    int* pcs;
+    int* slots; // numgroups * 2 slots for each thread
+    int count;
+} regthreads;
+
+static int parseAlternation(regparser*);
+static int parseConcatenation(regparser*);
+static int parseRepetition(regparser*);
+static int parseCount(regparser*, int*, int*);
+static int parseAtom(regparser*);
+static int parseClass(regparser*);
+static int parseEscape(regparser*, unsigned char*);
+static int addNode(regparser*, uint, int, int);
+static int addSet(regparser*, unsigned char*);
+static int compileNode(regparser*, int);
+static int emit(regparser*, unsigned char, int, int);
+static void classifyBytes(tap_reg*);
+static int runProgram(tap_reg*, char*, int, int, int*);
+static void addThread(tap_reg*, regthreads*, int*, int, regframe*, int*, int, int, int);
+static int scanAutomaton(tap_reg*, char*, int, int);
+static int startState(tap_reg*, int);
+static int stepState(tap_reg*, int, uint);
+static int closeState(tap_reg*, int*, int, int, int);
+static int findState(tap_reg*, int*, int);
+static void clearStates(tap_reg*);
+
+/*! Compiles the given pattern into a regular expression
+    @param pattern      the pattern, which may contain null characters
+    @param size         the size of the pattern
+    @param error        set to what's wrong with the pattern if it can't be compiled
+    @return             the new regular expression, or null if the pattern can't be compiled
+*/
+tap_reg* newRegex (char* pattern, int size, char** error) {
+    regparser parser = {.text = pattern, .size = size, .pos = 0, .numgroups = 1, .depth = 0, .error = NULL};
+    parser.nodecapacity = size + 1;
+    parser.nodes = allocate(sizeof(regnode) * parser.nodecapacity);
+    parser.setcapacity = size + 1;
+    parser.sets = allocate(SET_SIZE * parser.setcapacity);
+    parser.numnodes = 0;
+    parser.numsets = 0;
+    int root = parseAlternation(&parser);
+    if (root >= 0 && parser.pos < size) { // only a closing parenthesis stops the top level early
+        parser.error = "unmatched closing parenthesis";
+    }
+    parser.instcapacity = 2 * size + 4;
+    parser.program = allocate(sizeof(reginst) * parser.instcapacity);
+    parser.numinsts = 0;
+    if (parser.error == NULL) { // the whole match is group 0
+        emit(&parser, REGEX_OP_SAVE, 0, 0);
+        compileNode(&parser, root);
+        emit(&parser, REGEX_OP_SAVE, 1, 0);
+        emit(&parser, REGEX_OP_MATCH, 0, 0);
+    }
+    free(parser.nodes);
+    if (parser.error != NULL) {
+        *error = parser.error;
+        free(parser.sets);
+        free(parser.program);
+        return NULL;
+    }
+    tap_reg* reg = allocate(sizeof(tap_reg));
+    reg->source = newStringCopy(pattern, size);
+    reg->program = parser.program;
+    reg->numinsts = parser.numinsts;
+    reg->sets = parser.sets;
+    reg->numgroups = parser.numgroups;
+    classifyBytes(reg);
+    pthread_mutex_init(&reg->lock, NULL);
+    reg->statecapacity = REGEX_INITIAL_STATES;
+    reg->states = allocate(sizeof(regstate) * reg->statecapacity);
+    reg->next = allocate(sizeof(int) * reg->statecapacity * reg->numclasses);
+    reg->poolcapacity = 2 * reg->numinsts;
+    reg->pool = allocate(sizeof(int) * reg->poolcapacity);
+    reg->buckets = allocate(sizeof(int) * REGEX_BUCKETS);
+    reg->scratch = allocate(sizeof(int) * (5 * reg->numinsts + 2));
+    reg->marks = allocate(sizeof(int) * reg->numinsts);
+    memset(reg->marks, 0, sizeof(int) * reg->numinsts);
+    reg->generation = 0;
+    clearStates(reg);
+    reg->owners = 1;
+    return reg;
+}
+
+/*! Adds an owner to the given regular expression
+    @param reg          the regular expression
+    @return             the regular expression
+*/
+tap_reg* shareRegex (tap_reg* reg) {
+    __atomic_add_fetch(&reg->owners, 1, __ATOMIC_RELAXED);
+    return reg;
+}
+
+/*! Removes an owner from the given regular expression, freeing it once it has none left
+    @param reg          the regular expression
+    @return             0
+*/
+bool freeRegex (tap_reg* reg) {
+    if (__atomic_sub_fetch(&reg->owners, 1, __ATOMIC_ACQ_REL) > 0) {
+        return 0;
+    }
+    freeStr(reg->source);
+    free(reg->program);
+    free(reg->sets);
+    pthread_mutex_destroy(&reg->lock);
+    free(reg->states);
+    free(reg->next);
+    free(reg->pool);
+    free(reg->buckets);
+    free(reg->scratch);
+    free(reg->marks);
+    free(reg);
+    return 0;
+}
+
+/*! Finds the first match of the given regular expression in the given text that starts at or after the given position
+    @param reg          the regular expression
+    @param text         the text to search, which may contain null characters
+    @param size         the size of the text
+    @param from         the first position a match can start at
+    @param groups       set to where each group starts and ends (two entries per group, -1 for a group that didn't take part)
+    @return             1 if there's a match, 0 otherwise
+*/
+int regexSearch (tap_reg* reg, char* text, int size, int from, int* groups) {
+    if (from > size) {
+        return 0;
+    }
+    if (from < size && scanAutomaton(reg, text, size, from) == 0) { // an empty rest of the text goes straight to the program
+        return 0;
+    }
+    return runProgram(reg, text, size, from, groups);
+}
+
+/*! Parses alternatives separated by |
+    @param parser       the parser
+    @return             the node parsed, or -1 on error
+*/
+static int parseAlternation (regparser* parser) {
+    int node = parseConcatenation(parser);
+    int last = -1; // the last alternative is added to, so that the tree leans right and is compiled without recursing down it
+    while (node >= 0 && parser->pos < parser->size && parser->text[parser->pos] == '|') {
+        ++parser->pos;
+        int right = parseConcatenation(parser);
+        if (right < 0) {
+            return -1;
+        }
+        if (last < 0) {
+            node = last = addNode(parser, REGEX_NODE_ALT, node, right);
+        } else {
+            int alternation = addNode(parser, REGEX_NODE_ALT, parser->nodes[last].b, right);
+            parser->nodes[last].b = alternation;
+            last = alternation;
+        }
+    }
+    return node;
+}
+
+/*! Parses a sequence of repetitions up to the next | or closing parenthesis
+    @param parser       the parser
+    @return             the node parsed, or -1 on error
+*/
+static int parseConcatenation (regparser* parser) {
+    int node = -1;
+    int last = -1; // as with alternation, the tree leans right
+    while (parser->pos < parser->size && parser->text[parser->pos] != '|' && parser->text[parser->pos] != ')') {
+        int right = parseRepetition(parser);
+        if (right < 0) {
+            return -1;
+        }
+        if (node < 0) {
+            node = right;
+        } else if (last < 0) {
+            node = last = addNode(parser, REGEX_NODE_CAT, node, right);
+        } else {
+            int concatenation = addNode(parser, REGEX_NODE_CAT, parser->nodes[last].b, right);
+            parser->nodes[last].b = concatenation;
+            last = concatenation;
+        }
+    }
+    return node < 0 ? addNode(parser, REGEX_NODE_EMPTY, 0, 0) : node;
+}
+
+/*! Parses an atom followed by any number of quantifiers (*, +, ?, {n}, {n,} or {n,m}, each optionally followed by ? to repeat as few times as possible)
+    @param parser       the parser
+    @return             the node parsed, or -1 on error
+*/
+static int parseRepetition (regparser* parser) {
+    int depth = parser->depth;
+    int node = parseAtom(parser);
+    while (node >= 0 && parser->pos < parser->size) {
+        int min;
+        int max;
+        char c = parser->text[parser->pos];
+        if (c == '*') {
+            min = 0;
+            max = -1;
+        } else if (c == '+') {
+            min = 1;
+            max = -1;
+        } else if (c == '?') {
+            min = 0;
+            max = 1;
+        } else if (c != '{' || !parseCount(parser, &min, &max)) { // a brace that doesn't start a count is an ordinary character
+            break;
+        }
+        if (parser->error != NULL) {
+            return -1;
+        }
+        if (c != '{') {
+            ++parser->pos;
+        }
+        if (++parser->depth > REGEX_MAX_DEPTH) { // each repetition of a repetition is compiled a level deeper
+            parser->error = "pattern nested too deeply";
+            return -1;
+        }
+        node = addNode(parser, REGEX_NODE_REPEAT, node, 0);
+        parser->nodes[node].min = min;
+        parser->nodes[node].max = max;
+        parser->nodes[node].greedy = 1;
+        if (parser->pos < parser->size && parser->text[parser->pos] == '?') {
+            parser->nodes[node].greedy = 0;
+            ++parser->pos;
+        }
+    }
+    parser->depth = depth;
+    return node;
+}
+
+/*! Parses a count in braces, leaving the position alone if there isn't one
+    @param parser       the parser
+    @param min          set to the least number of repetitions
+    @param max          set to the most number of repetitions, or -1 if there's no limit
+    @return             1 if there's a count, 0 otherwise
+*/
+static int parseCount (regparser* parser, int* min, int* max) {
+    int pos = parser->pos + 1;
+    int values[2] = {0, -1};
+    int numvalues = 0;
+    int digits = 0;
+    while (pos < parser->size) {
+        char c = parser->text[pos++];
+        if (isdigit((unsigned char)c)) {
+            values[numvalues] = (values[numvalues] < 0 ? 0 : values[numvalues]) * 10 + c - '0';
+            if (values[numvalues] > REGEX_MAX_REPEAT) {
+                parser->error = "repetition count too large";
+                return 1;
+            }
+            ++digits;
+        } else if (c == ',' && numvalues == 0 && digits > 0) {
+            ++numvalues;
+        } else if (c == '}' && digits > 0) {
+            *min = values[0];
+            *max = numvalues == 0 ? values[0] : values[1];
+            if (*max >= 0 && *max < *min) {
+                parser->error = "repetition count out of order";
+            }
+            parser->pos = pos;
+            return 1;
+        } else {
+            return 0;
+        }
+    }
+    return 0;
+}
+
+/*! Parses a single character, class, group, anchor or escape
+    @param parser       the parser
+    @return             the node parsed, or -1 on error
+*/
+static int parseAtom (regparser* parser) {
+    unsigned char set[SET_SIZE];
+    memset(set, 0, SET_SIZE);
+    char c = parser->text[parser->pos++];
+    switch (c) {
+        case '(': {
+            int group = 0;
+            if (parser->pos + 1 < parser->size && parser->text[parser->pos] == '?' && parser->text[parser->pos + 1] == ':') {
+                parser->pos += 2;
+            } else {
+                group = parser->numgroups++;
+            }
+            if (++parser->depth > REGEX_MAX_DEPTH) {
+                parser->error = "pattern nested too deeply";
+                return -1;
+            }
+            int node = parseAlternation(parser);
+            --parser->depth;
+            if (node < 0) {
+                return -1;
+            }
+            if (parser->pos >= parser->size) {
+                parser->error = "unclosed group";
+                return -1;
+            }
+            ++parser->pos;
+            return addNode(parser, REGEX_NODE_GROUP, node, group);
+        }
+        case '[':
+            return parseClass(parser);
+        case '.': { // any byte but a new line
+            int i;
+            for (i = 0; i < 256; ++i) {
+                if (i != '\n') {
+                    SET_ADD(set, i);
+                }
+            }
+            return addNode(parser, REGEX_NODE_SET, addSet(parser, set), 0);
+        }
+        case '^':
+            return addNode(parser, REGEX_NODE_BOL, 0, 0);
+        case '$':
+            return addNode(parser, REGEX_NODE_EOL, 0, 0);
+        case '*':
+        case '+':
+        case '?':
+            parser->error = "nothing to repeat";
+            return -1;
+        case '\\':
+            if (parseEscape(parser, set) < 0) {
+                return -1;
+            }
+            return addNode(parser, REGEX_NODE_SET, addSet(parser, set), 0);
+        default:
+            SET_ADD(set, (unsigned char)c);
+            return addNode(parser, REGEX_NODE_SET, addSet(parser, set), 0);
+    }
+}
+
+/*! Parses a class of bytes in brackets, which may be negated with ^ and contain ranges and escapes
+    @param parser       the parser
+    @return             the node parsed, or -1 on error
+*/
+static int parseClass (regparser* parser) {
+    unsigned char set[SET_SIZE];
+    memset(set, 0, SET_SIZE);
+    int negated = 0;
+    if (parser->pos < parser->size && parser->text[parser->pos] == '^') {
+        negated = 1;
+        ++parser->pos;
+    }
+    int first = 1;
+    while (1) {
+        if (parser->pos >= parser->size) {
+            parser->error = "unclosed class";
+            return -1;
+        }
+        unsigned char c = parser->text[parser->pos++];
+        if (c == ']' && !first) {
+            break;
+        }
+        first = 0;
+        int low = c;
+        if (c == '\\' && (low = parseEscape(parser, set)) < 0) {
+            return -1;
+        }
+        if (low == REGEX_ESCAPE_CLASS) { // a class such as \d, which has already been added
+            continue;
+        }
+        int high = low;
+        if (parser->pos + 1 < parser->size && parser->text[parser->pos] == '-' && parser->text[parser->pos + 1] != ']') {
+            parser->pos += 1;
+            high = (unsigned char)parser->text[parser->pos++];
+            if (high == '\\') {
+                unsigned char ignored[SET_SIZE];
+                high = parseEscape(parser, ignored);
+                if (high < 0) {
+                    return -1;
+                }
+            }
+            if (high == REGEX_ESCAPE_CLASS || high < low) {
+                parser->error = "invalid range in class";
+                return -1;
+            }
+        }
+        for (; low <= high; ++low) {
+            SET_ADD(set, low);
+        }
+    }
+    if (negated) {
+        int i;
+        for (i = 0; i < SET_SIZE; ++i) {
+            set[i] = ~set[i];
+        }
+    }
+    return addNode(parser, REGEX_NODE_SET, addSet(parser, set), 0);
+}
+
+/*! Parses the escape after a backslash, adding the bytes it stands for to the given set
+    @param parser       the parser
+    @param set          the set to add to
+    @return             the byte if the escape stands for one, REGEX_ESCAPE_CLASS if it stands for more, or -1 on error
+*/
+static int parseEscape (regparser* parser, unsigned char* set) {
+    if (parser->pos >= parser->size) {
+        parser->error = "trailing backslash";
+        return -1;
+    }
+    char c = parser->text[parser->pos++];
+    int byte;
+    int (*test)(int) = NULL;
+    switch (c) {
+        case 'd':
+        case 'D':
+            test = isdigit;
+            break;
+        case 's':
+        case 'S':
+            test = isspace;
+            break;
+        case 'w':
+        case 'W':
+            test = isalnum;
+            break;
+        case 'n':
+            byte = '\n';
+            break;
+        case 't':
+            byte = '\t';
+            break;
+        case 'r':
+            byte = '\r';
+            break;
+        case 'f':
+            byte = '\f';
+            break;
+        case 'v':
+            byte = '\v';
+            break;
+        case '0':
+            byte = '\0';
+            break;
+        case 'x': {
+            int i;
+            byte = 0;
+            for (i = 0; i < 2; ++i) {
+                char digit = parser->pos < parser->size ? parser->text[parser->pos++] : '\0';
+                if (!isxdigit((unsigned char)digit)) {
+                    parser->error = "invalid hexadecimal escape";
+                    return -1;
+                }
+                byte = byte * 16 + (isdigit((unsigned char)digit) ? digit - '0' : tolower((unsigned char)digit) - 'a' + 10);
+            }
+            break;
+        }
+        default:
+            if (isalnum((unsigned char)c)) { // letters are kept for escapes that may mean something later
+                parser->error = "unknown escape";
+                return -1;
+            }
+            byte = (unsigned char)c;
+            break;
+    }
+    if (test == NULL) {
+        SET_ADD(set, byte);
+        return byte;
+    }
+    int negated = isupper((unsigned char)c);
+    int i;
+    for (i = 0; i < 256; ++i) { // tested in the C locale, so only ASCII bytes are digits, spaces or letters
+        int member = i < 128 && (test(i) || (test == isalnum && i == '_'));
+        if (member != negated) {
+            SET_ADD(set, i);
+        }
+    }
+    return REGEX_ESCAPE_CLASS;
+}
+
+/*! Adds a node to the parse tree
+    @param parser       the parser
+    @param kind         the kind of node, one of the REGEX_NODE codes
+    @param a            the node's first child, or its set
+    @param b            the node's second child, or its group
+    @return             the new node
+*/
+static int addNode (regparser* parser, uint kind, int a, int b) {
+    if (parser->numnodes == parser->nodecapacity) {
+        parser->nodecapacity *= 2;
+        parser->nodes = realloc(parser->nodes, sizeof(regnode) * parser->nodecapacity);
+        if (parser->nodes == NULL) {
+            exit(EXIT_OUT_OF_MEMORY);
+        }
+    }
+    regnode* node = parser->nodes + parser->numnodes;
+    node->kind = kind;
+    node->a = a;
+    node->b = b;
+    return parser->numnodes++;
+}
+
+/*! Adds a set of bytes to those the program matches
+    @param parser       the parser
+    @param set          the set, which is copied
+    @return             the new set's index
+*/
+static int addSet (regparser* parser, unsigned char* set) {
+    if (parser->numsets == parser->setcapacity) {
+        parser->setcapacity *= 2;
+        parser->sets = realloc(parser->sets, SET_SIZE * parser->setcapacity);
+        if (parser->sets == NULL) {
+            exit(EXIT_OUT_OF_MEMORY);
+        }
+    }
+    memcpy(parser->sets + SET_SIZE * parser->numsets, set, SET_SIZE);
+    return parser->numsets++;
+}
+
+/*! Compiles the given node of the parse tree onto the end of the program
+    @param parser       the parser
+    @param index        the node
+    @return             1 on success, 0 if the program grew too large
+*/
+static int compileNode (regparser* parser, int index) {
+    regnode node = parser->nodes[index];
+    int i;
+    switch (node.kind) {
+        case REGEX_NODE_EMPTY:
+            return 1;
+        case REGEX_NODE_SET:
+            return emit(parser, REGEX_OP_SET, node.a, 0) >= 0;
+        case REGEX_NODE_BOL:
+            return emit(parser, REGEX_OP_BOL, 0, 0) >= 0;
+        case REGEX_NODE_EOL:
+            return emit(parser, REGEX_OP_EOL, 0, 0) >= 0;
+        case REGEX_NODE_CAT:
+            while (node.kind == REGEX_NODE_CAT) { // down the right of the tree in a loop, since long patterns make it deep
+                if (!compileNode(parser, node.a)) {
+                    return 0;
+                }
+                index = node.b;
+                node = parser->nodes[index];
+            }
+            return compileNode(parser, index);
+        case REGEX_NODE_ALT: {
+            int jumps = -1; // the jumps to the end of the alternatives, linked through their targets until the end is known
+            while (node.kind == REGEX_NODE_ALT) {
+                int split = emit(parser, REGEX_OP_SPLIT, 0, 0);
+                if (split < 0 || !compileNode(parser, node.a)) {
+                    return 0;
+                }
+                int jump = emit(parser, REGEX_OP_JMP, jumps, 0);
+                if (jump < 0) {
+                    return 0;
+                }
+                jumps = jump;
+                parser->program[split].x = split + 1;
+                parser->program[split].y = parser->numinsts;
+                index = node.b;
+                node = parser->nodes[index];
+            }
+            if (!compileNode(parser, index)) {
+                return 0;
+            }
+            while (jumps >= 0) {
+                int previous = parser->program[jumps].x;
+                parser->program[jumps].x = parser->numinsts;
+                jumps = previous;
+            }
+            return 1;
+        }
+        case REGEX_NODE_GROUP:
+            if (node.b == 0) {
+                return compileNode(parser, node.a);
+            }
+            return emit(parser, REGEX_OP_SAVE, 2 * node.b, 0) >= 0 && compileNode(parser, node.a) && emit(parser, REGEX_OP_SAVE, 2 * node.b + 1, 0) >= 0;
+        case REGEX_NODE_REPEAT: {
+            for (i = 0; i < node.min; ++i) {
+                if (!compileNode(parser, node.a)) {
+                    return 0;
+                }
+            }
+            if (node.max < 0) { // a loop that tries the node again before (or, if not greedy, after) going on
+                int split = emit(parser, REGEX_OP_SPLIT, 0, 0);
+                if (split < 0 || !compileNode(parser, node.a) || emit(parser, REGEX_OP_JMP, split, 0) < 0) {
+                    return 0;
+                }
+                parser->program[split].x = node.greedy ? split + 1 : parser->numinsts;
+                parser->program[split].y = node.greedy ? parser->numinsts : split + 1;
+                return 1;
+            }
+            int optional = node.max - node.min;
+            if (optional == 0) {
+                return 1;
+            }
+            int* splits = allocate(sizeof(int) * optional); // each optional copy can skip to the end
+            for (i = 0; i < optional; ++i) {
+                splits[i] = emit(parser, REGEX_OP_SPLIT, 0, 0);
+                if (splits[i] < 0 || !compileNode(parser, node.a)) {
+                    free(splits);
+                    return 0;
+                }
+            }
+            for (i = 0; i < optional; ++i) {
+                parser->program[splits[i]].x = node.greedy ? splits[i] + 1 : parser->numinsts;
+                parser->program[splits[i]].y = node.greedy ? parser->numinsts : splits[i] + 1;
+            }
+            free(splits);
+            return 1;
+        }
+    }
+    return 1;
+}
+
+/*! Adds an instruction to the end of the program
+    @param parser       the parser
+    @param op           what the instruction does, one of the REGEX_OP codes
+    @param x            the instruction's first operand
+    @param y            the instruction's second operand
+    @return             the new instruction, or -1 if the program has grown too large
+*/
+static int emit (regparser* parser, unsigned char op, int x, int y) {
+    if (parser->numinsts == REGEX_MAX_INSTRUCTIONS) {
+        parser->error = "pattern too large";
+        return -1;
+    }
+    if (parser->numinsts == parser->instcapacity) {
+        parser->instcapacity *= 2;
+        parser->program = realloc(parser->program, sizeof(reginst) * parser->instcapacity);
+        if (parser->program == NULL) {
+            exit(EXIT_OUT_OF_MEMORY);
+        }
+    }
+    reginst* inst = parser->program + parser->numinsts;
+    inst->op = op;
+    inst->x = x;
+    inst->y = y;
+    return parser->numinsts++;
+}
+
+/*! Splits the bytes into classes that are in exactly the same sets, so that the automaton only needs a move for each class
+    @param reg          the regular expression
+    @return             nothing
+*/
+static void classifyBytes (tap_reg* reg) {
+    memset(reg->classes, 0, sizeof(reg->classes));
+    reg->numclasses = 1;
+    int split[512];
+    uint i;
+    int byte;
+    for (i = 0; i < reg->numinsts; ++i) { // split each class by whether its bytes are in each set
+        if (reg->program[i].op != REGEX_OP_SET) {
+            continue;
+        }
+        unsigned char* set = reg->sets + SET_SIZE * reg->program[i].x;
+        uint numclasses = 0;
+        memset(split, -1, sizeof(int) * 2 * reg->numclasses);
+        for (byte = 0; byte < 256; ++byte) {
+            int key = 2 * reg->classes[byte] + SET_HAS(set, byte);
+            if (split[key] < 0) {
+                split[key] = numclasses++;
+            }
+            reg->classes[byte] = split[key];
+        }
+        reg->numclasses = numclasses;
+    }
+    for (byte = 255; byte >= 0; --byte) {
+        reg->representatives[reg->classes[byte]] = byte;
+    }
+}
+
+/*! Runs the program over the given text with the Pike VM, finding the first match that starts at or after the given position
+    @param reg          the regular expression
+    @param text         the text to search
+    @param size         the size of the text
+    @param from         the first position a match can start at
+    @param groups       set to where each group starts and ends
+    @return             1 if there's a match, 0 otherwise
+*/
+static int runProgram (tap_reg* reg, char* text, int size, int from, int* groups) {
+    int numinsts = reg->numinsts;
+    int numslots = reg->numgroups * 2;
+    regthreads lists[2];
+    int i;
+    for (i = 0; i < 2; ++i) {
+        lists[i].pcs = allocate(sizeof(int) * numinsts);
+        lists[i].slots = allocate(sizeof(int) * numinsts * numslots);
+        lists[i].count = 0;
+    }
+    int* marks = allocate(sizeof(int) * numinsts);
+    memset(marks, 0, sizeof(int) * numinsts);
+    regframe* stack = allocate(sizeof(regframe) * (3 * numinsts + 2));
+    int* slots = allocate(sizeof(int) * numslots);
+    regthreads* current = lists;
+    regthreads* next = lists + 1;
+    int generation = 1;
+    int matched = 0;
+    memset(slots, -1, sizeof(int) * numslots);
+    addThread(reg, current, marks, generation, stack, slots, 0, from, size);
+    for (i = from; current->count > 0 || !matched; ++i) { // until the match is done or, failing one, the text is
+        next->count = 0;
+        ++generation;
+        int t;
+        for (t = 0; t < current->count; ++t) { // in order, so the threads a backtracking matcher would try first go first
+            reginst* inst = reg->program + current->pcs[t];
+            int* threadslots = current->slots + t * numslots;
+            if (inst->op == REGEX_OP_MATCH) { // the threads after this one would only be tried if it failed
+                memcpy(groups, threadslots, sizeof(int) * numslots);
+                matched = 1;
+                break;
+            }
+            if (i < size && SET_HAS(reg->sets + SET_SIZE * inst->x, (unsigned char)text[i])) {
+                memcpy(slots, threadslots, sizeof(int) * numslots);
+                addThread(reg, next, marks, generation, stack, slots, current->pcs[t] + 1, i + 1, size);
+            }
+        }
+        if (i >= size) {
+            break;
+        }
+        if (!matched) { // a match could also start at the next position, though it would come after every one started already
+            memset(slots, -1, sizeof(int) * numslots);
+            addThread(reg, next, marks, generation, stack, slots, 0, i + 1, size);
+        }
+        regthreads* swap = current;
+        current = next;
+        next = swap;
+    }
+    for (i = 0; i < 2; ++i) {
+        free(lists[i].pcs);
+        free(lists[i].slots);
+    }
+    free(marks);
+    free(stack);
+    free(slots);
+    return matched;
+}
+
+/*! Adds a thread at the given instruction to the given list, following jumps, splits, saves and anchors to the instructions that match a byte or end the match
+    @param reg          the regular expression
+    @param list         the list of threads
+    @param marks        the generation each instruction was last added to a list in
+    @param generation   the list's generation
+    @param stack        room for the instructions still to follow
+    @param slots        the thread's slots, which are left as they were
+    @param pc           the instruction
+    @param pos          the position in the text the thread is at
+    @param size         the size of the text
+    @return             nothing
+*/
+static void addThread (tap_reg* reg, regthreads* list, int* marks, int generation, regframe* stack, int* slots, int pc, int pos, int size) {
+    int numslots = reg->numgroups * 2;
+    int top = 0;
+    stack[top++].pc = pc;
+    while (top > 0) {
+        regframe frame = stack[--top];
+        if (frame.pc < 0) { // everything after the save has been added
+            slots[frame.slot] = frame.value;
+            continue;
+        }
+        if (marks[frame.pc] == generation) { // a thread that got here first has priority
+            continue;
+        }
+        marks[frame.pc] = generation;
+        reginst* inst = reg->program + frame.pc;
+        switch (inst->op) {
+            case REGEX_OP_JMP:
+                stack[top++].pc = inst->x;
+                break;
+            case REGEX_OP_SPLIT: // pushed second so it's followed first
+                stack[top++].pc = inst->y;
+                stack[top++].pc = inst->x;
+                break;
+            case REGEX_OP_SAVE:
+                stack[top].pc = -1;
+                stack[top].slot = inst->x;
+                stack[top++].value = slots[inst->x];
+                slots[inst->x] = pos;
+                stack[top++].pc = frame.pc + 1;
+                break;
+            case REGEX_OP_BOL:
+                if (pos == 0) {
+                    stack[top++].pc = frame.pc + 1;
+                }
+                break;
+            case REGEX_OP_EOL:
+                if (pos == size) {
+                    stack[top++].pc = frame.pc + 1;
+                }
+                break;
+            default:
+                list->pcs[list->count] = frame.pc;
+                memcpy(list->slots + list->count * numslots, slots, sizeof(int) * numslots);
+                ++list->count;
+                break;
+        }
+    }
+}
+
+/*! Scans the given text with the automaton to find out whether a match starts at or after the given position
+    @param reg          the regular expression
+    @param text         the text to scan
+    @param size         the size of the text, which is more than the position
+    @param from         the first position a match can start at
+    @return             1 if there's a match, 0 if there isn't, or -1 if another thread is using the automaton
+*/
+static int scanAutomaton (tap_reg* reg, char* text, int size, int from) {
+    if (pthread_mutex_trylock(&reg->lock) != 0) { // the program can be run without the automaton, so there's no point waiting
+        return -1;
+    }
+    int state = startState(reg, from == 0);
+    int i;
+    for (i = from; i < size && !reg->states[state].accepting; ++i) {
+        uint class = reg->classes[(unsigned char)text[i]];
+        int following = reg->next[state * reg->numclasses + class];
+        state = following >= 0 ? following : stepState(reg, state, class);
+    }
+    int found = reg->states[state].accepting || reg->states[state].acceptsatend;
+    pthread_mutex_unlock(&reg->lock);
+    return found;
+}
+
+/*! Returns the state scanning starts in, working it out if need be
+    @param reg          the regular expression
+    @param atstart      whether scanning starts at the start of the text
+    @return             the state
+*/
+static int startState (tap_reg* reg, int atstart) {
+    if (reg->starts[atstart] < 0) {
+        reg->scratch[0] = 0;
+        reg->starts[atstart] = closeState(reg, reg->scratch, 1, atstart, 0);
+    }
+    return reg->starts[atstart];
+}
+
+/*! Works out the state the given one goes to on a byte of the given class and remembers the move
+    @param reg          the regular expression
+    @param state        the state
+    @param class        the class of the byte
+    @return             the state it goes to
+*/
+static int stepState (tap_reg* reg, int state, uint class) {
+    unsigned char byte = reg->representatives[class];
+    int* members = reg->pool + reg->states[state].members;
+    int numseeds = 0;
+    int i;
+    for (i = 0; i < reg->states[state].nummembers; ++i) {
+        reginst* inst = reg->program + members[i];
+        if (inst->op == REGEX_OP_SET && SET_HAS(reg->sets + SET_SIZE * inst->x, byte)) {
+            reg->scratch[numseeds++] = members[i] + 1;
+        }
+    }
+    reg->scratch[numseeds++] = 0; // a match can also start after the byte
+    uint numstates = reg->numstates;
+    int following = closeState(reg, reg->scratch, numseeds, 0, 0);
+    if (reg->numstates >= numstates) { // the states weren't cleared to make room, so the state given is still there
+        reg->next[state * reg->numclasses + class] = following;
+    }
+    return following;
+}
+
+/*! Finds the state for the instructions reachable from the given ones without matching a byte, adding it if it's new
+    @param reg          the regular expression
+    @param seeds        the instructions, which may be overwritten
+    @param numseeds     the number of instructions
+    @param atstart      whether the instructions are at the start of the text
+    @param atend        whether the instructions are at the end of the text, in which case only whether the match ends matters
+    @return             the state, or for the end of the text 1 if the match ends and 0 otherwise
+*/
+static int closeState (tap_reg* reg, int* seeds, int numseeds, int atstart, int atend) {
+    int* members = reg->scratch + reg->numinsts;
+    int* stack = reg->scratch + 2 * reg->numinsts; // every instruction followed pushes at most two more
+    int nummembers = 0;
+    int top = 0;
+    int accepting = 0;
+    ++reg->generation;
+    while (numseeds > 0) {
+        stack[top++] = seeds[--numseeds];
+    }
+    while (top > 0) {
+        int pc = stack[--top];
+        if (reg->marks[pc] == reg->generation) {
+            continue;
+        }
+        reg->marks[pc] = reg->generation;
+        reginst* inst = reg->program + pc;
+        switch (inst->op) {
+            case REGEX_OP_JMP:
+                stack[top++] = inst->x;
+                break;
+            case REGEX_OP_SPLIT:
+                stack[top++] = inst->y;
+                stack[top++] = inst->x;
+                break;
+            case REGEX_OP_SAVE:
+                stack[top++] = pc + 1;
+                break;
+            case REGEX_OP_BOL:
+                if (atstart) {
+                    stack[top++] = pc + 1;
+                }
+                break;
+            case REGEX_OP_EOL: // kept in the state until it's known whether the text ends there
+                if (atend) {
+                    stack[top++] = pc + 1;
+                } else {
+                    members[nummembers++] = pc;
+                }
+                break;
+            case REGEX_OP_MATCH:
+                accepting = 1;
+                members[nummembers++] = pc;
+                break;
+            default:
+                members[nummembers++] = pc;
+                break;
+        }
+    }
+    if (atend) {
+        return accepting;
+    }
+    int i;
+    for (i = 1; i < nummembers; ++i) { // sorted so that the same instructions are always the same state
+        int member = members[i];
+        int j;
+        for (j = i; j > 0 && members[j - 1] > member; --j) {
+            members[j] = members[j - 1];
+        }
+        members[j] = member;
+    }
+    int state = findState(reg, members, nummembers);
+    if (state >= 0) {
+        return state;
+    }
+    if (reg->numstates == REGEX_MAX_STATES || reg->poolsize + nummembers > REGEX_MAX_POOL) {
+        clearStates(reg);
+    }
+    if (reg->numstates == reg->statecapacity) {
+        reg->statecapacity *= 2;
+        reg->states = realloc(reg->states, sizeof(regstate) * reg->statecapacity);
+        reg->next = realloc(reg->next, sizeof(int) * reg->statecapacity * reg->numclasses);
+        if (reg->states == NULL || reg->next == NULL) {
+            exit(EXIT_OUT_OF_MEMORY);
+        }
+    }
+    if (reg->poolsize + nummembers > reg->poolcapacity) {
+        reg->poolcapacity = 2 * (reg->poolsize + nummembers);
+        reg->pool = realloc(reg->pool, sizeof(int) * reg->poolcapacity);
+        if (reg->pool == NULL) {
+            exit(EXIT_OUT_OF_MEMORY);
+        }
+    }
+    state = reg->numstates++;
+    regstate* added = reg->states + state;
+    added->members = reg->poolsize;
+    added->nummembers = nummembers;
+    added->accepting = accepting;
+    memcpy(reg->pool + reg->poolsize, members, sizeof(int) * nummembers);
+    reg->poolsize += nummembers;
+    memset(reg->next + state * reg->numclasses, -1, sizeof(int) * reg->numclasses);
+    uint hash = findState(reg, members, -1 - nummembers);
+    reg->buckets[hash] = state;
+    added->acceptsatend = accepting || closeState(reg, members, nummembers, 0, 1); // the members are no longer needed, so they can be the seeds
+    return state;
+}
+
+/*! Finds the state with the given instructions
+    @param reg          the regular expression
+    @param members      the instructions, sorted
+    @param nummembers   the number of instructions, or -1 minus the number to return the empty bucket the state belongs in instead
+    @return             the state (or bucket), or -1 if there isn't one
+*/
+static int findState (tap_reg* reg, int* members, int nummembers) {
+    int wantbucket = nummembers < 0;
+    if (wantbucket) {
+        nummembers = -1 - nummembers;
+    }
+    uint hash = 2166136261u; // FNV-1a
+    int i;
+    for (i = 0; i < nummembers; ++i) {
+        hash = (hash ^ (uint)members[i]) * 16777619u;
+    }
+    uint bucket = hash % REGEX_BUCKETS;
+    while (reg->buckets[bucket] >= 0) {
+        regstate* state = reg->states + reg->buckets[bucket];
+        if (!wantbucket && state->nummembers == nummembers && memcmp(reg->pool + state->members, members, sizeof(int) * nummembers) == 0) {
+            return reg->buckets[bucket];
+        }
+        bucket = (bucket + 1) % REGEX_BUCKETS;
+    }
+    return wantbucket ? (int)bucket : -1;
+}
+
+/*! Drops every state of the automaton
+    @param reg          the regular expression
+    @return             nothing
+*/
+static void clearStates (tap_reg* reg) {
+    reg->numstates = 0;
+    reg->poolsize = 0;
+    memset(reg->buckets, -1, sizeof(int) * REGEX_BUCKETS);
+    reg->starts[0] = -1;
+    reg->starts[1] = -1;
+}
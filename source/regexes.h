@@ -0,0 +1,61 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   regexes.h
+    @brief  The header file for regexes.c
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#ifndef REGEXES_H
+#define REGEXES_H
+
+#include <pthread.h>
+
+#include "structs.h"
+
+typedef struct reginst_ reginst;
+typedef struct regstate_ regstate;
+
+struct reginst_ {
+    unsigned char op; // what the instruction does, one of the REGEX_OP codes
+    int x; // the set of bytes to match, the slot to save the position in, or the target to try first
+    int y; // the target to try second
+};
+
+struct regstate_ {
+    int members; // where the state's instructions start in the pool
+    int nummembers;
+    int accepting; // whether a match has ended once the state is reached
+    int acceptsatend; // whether a match ends if the text ends in the state
+};
+
+struct tap_reg_ {
+    string* source; // the pattern the expression was compiled from
+    reginst* program;
+    uint numinsts;
+    unsigned char* sets; // the sets of bytes the program matches, 32 bytes (one bit per byte) each
+    uint numgroups; // the number of groups, including the whole match as group 0
+    unsigned short classes[256]; // the class of each byte; bytes in a class are in exactly the same sets
+    unsigned char representatives[256]; // a byte of each class
+    uint numclasses;
+    pthread_mutex_t lock; // held while the automaton below is used, since it's built as the text is scanned
+    regstate* states; // the states of the automaton worked out so far
+    uint numstates;
+    uint statecapacity;
+    int* next; // the state each state goes to on each class of byte, numclasses entries per state, or -1 if not yet known
+    int* pool; // the instructions of every state
+    uint poolsize;
+    uint poolcapacity;
+    int* buckets; // a hash table of the states by their instructions
+    int starts[2]; // the state scanning starts in at the start of the text and elsewhere, or -1 if not yet known
+    int* scratch; // room to work out a state in, 5 entries per instruction
+    int* marks; // the generation each instruction was last visited in while working out a state
+    int generation;
+    uint owners; // the number of expressions, in any context, that refer to the regular expression, which never changes once it's compiled
+};
+
+tap_reg* newRegex(char*, int, char**);
+tap_reg* shareRegex(tap_reg*);
+bool freeRegex(tap_reg*);
+int regexSearch(tap_reg*, char*, int, int, int*);
+
+#endif
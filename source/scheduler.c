@@ -0,0 +1,327 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   scheduler.c
+    @brief  A scheduler that runs many evaluations as green tasks over a few threads, switching between them at safe points
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "scheduler.h"
+#include "tap.h"
+#include "engine.h"
+#include "constants.h"
+#include "memory.h"
+
+/* Each task evaluates on a stack of its own, so the scheduler can switch away from it in the middle of an evaluation and come
+   back later. Tasks are spread across a few carrier threads and each stays on the carrier it was given, since the interpreter
+   keeps its current context (and the worker pool its own state) per thread. A carrier runs its queue of ready tasks in turn:
+   a task runs until it has passed through its quantum of safe points (every function call a loop body hasn't planned and every iteration of a loop),
+   waits on something, or finishes, and then switches back to the carrier, which moves on to the next task. A task only ever
+   waits by parking, which puts it in a list that whoever changes what it's waiting for empties back into the carriers' queues;
+   parkTask and unparkTasks fall back to a condition variable in threads that aren't running a task, so the code that waits
+   doesn't need to know which kind of thread it's in. A task's stack is much smaller than a thread's, so calling a function with
+   less than TASK_STACK_MARGIN bytes of it left is reported as an error, and a guard page below it catches anything that slips past. */
+
+static __thread tap_task* ctask = NULL; // the task the calling thread is running, if it's a carrier
+
+static void* runCarrier(void*);
+static char* allocateStack();
+static void freeStack(char*);
+static void prepareTask(tap_task*);
+static void runTask();
+static void queueTask(taskcarrier*, tap_task*);
+static void finishTask(tap_task*);
+
+/*! Starts a scheduler with the given number of carrier threads
+    @param numthreads   the number of carrier threads, or 0 for one per online processor
+    @param quantum      the number of safe points a task may pass before it gives way to the other tasks of its carrier, or 0 for TASK_DEFAULT_QUANTUM
+    @return             the running scheduler
+*/
+tap_scheduler* tapStartScheduler (int numthreads, int quantum) {
+    if (numthreads < 1) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        numthreads = cores > 0 ? cores : 1;
+    }
+    if (quantum < 1) {
+        quantum = TASK_DEFAULT_QUANTUM;
+    }
+    tap_scheduler* scheduler = allocate(sizeof(tap_scheduler));
+    scheduler->carriers = allocate(sizeof(taskcarrier) * numthreads);
+    scheduler->numcarriers = numthreads;
+    int i;
+    for (i = 0; i < numthreads; ++i) {
+        taskcarrier* carrier = &scheduler->carriers[i];
+        carrier->first = NULL;
+        carrier->last = NULL;
+        carrier->numtasks = 0;
+        carrier->quantum = quantum;
+        carrier->stopping = 0;
+        pthread_mutex_init(&carrier->lock, NULL);
+        pthread_cond_init(&carrier->ready, NULL);
+    }
+    for (i = 0; i < numthreads; ++i) { // only started once every carrier is ready, since a task can wake tasks on other carriers
+        pthread_create(&scheduler->carriers[i].thread, NULL, &runCarrier, &scheduler->carriers[i]);
+    }
+    return scheduler;
+}
+
+/*! Waits for every task given to the given scheduler to finish and then stops and frees it; the results of the tasks can still be collected afterwards
+    @param scheduler    the scheduler
+    @return             nothing
+*/
+void tapStopScheduler (tap_scheduler* scheduler) {
+    int i;
+    for (i = 0; i < scheduler->numcarriers; ++i) {
+        taskcarrier* carrier = &scheduler->carriers[i];
+        pthread_mutex_lock(&carrier->lock);
+        carrier->stopping = 1;
+        pthread_cond_signal(&carrier->ready);
+        pthread_mutex_unlock(&carrier->lock);
+    }
+    for (i = 0; i < scheduler->numcarriers; ++i) {
+        taskcarrier* carrier = &scheduler->carriers[i];
+        pthread_join(carrier->thread, NULL);
+        pthread_mutex_destroy(&carrier->lock);
+        pthread_cond_destroy(&carrier->ready);
+    }
+    free(scheduler->carriers);
+    free(scheduler);
+}
+
+/*! Starts evaluating the given code in the given context as a task of the given scheduler, on whichever carrier has the fewest unfinished tasks
+    @param scheduler    the scheduler
+    @param context      the context to evaluate in, which must not be used for anything else until the task's result is collected
+    @param text         the code to evaluate, which is copied
+    @return             the task, whose result must be collected with tapTaskResult
+*/
+tap_task* tapSpawnTask (tap_scheduler* scheduler, tap_context* context, char* text) {
+    taskcarrier* carrier = &scheduler->carriers[0];
+    int i;
+    for (i = 1; i < scheduler->numcarriers; ++i) { // the counts may be changing, but they only steer the choice
+        if (__atomic_load_n(&scheduler->carriers[i].numtasks, __ATOMIC_RELAXED) < __atomic_load_n(&carrier->numtasks, __ATOMIC_RELAXED)) {
+            carrier = &scheduler->carriers[i];
+        }
+    }
+    tap_task* task = allocate(sizeof(tap_task));
+    task->stack = allocateStack();
+    task->context = context;
+    task->text = allocate(strlen(text) + 1);
+    strcpy(task->text, text);
+    task->result = NULL;
+    task->status = TASK_RUNNING;
+    task->steps = 0;
+    task->carrier = carrier;
+    task->next = NULL;
+    task->release = NULL;
+    task->waiters.first = NULL;
+    pthread_mutex_init(&task->lock, NULL);
+    pthread_cond_init(&task->done, NULL);
+    prepareTask(task);
+    pthread_mutex_lock(&carrier->lock);
+    __atomic_add_fetch(&carrier->numtasks, 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&carrier->lock);
+    queueTask(carrier, task);
+    return task;
+}
+
+/*! Returns whether or not the given task is finished, in which case tapTaskResult returns without waiting
+    @param task         the task
+    @return             1 if the task is finished, 0 otherwise
+*/
+int tapTaskFinished (tap_task* task) {
+    return __atomic_load_n(&task->status, __ATOMIC_ACQUIRE) == TASK_FINISHED;
+}
+
+/*! Waits for the given task to finish (parking the calling task if it's called from one) and frees it, returning its result; the task's errors are in its context
+    @param task         the task
+    @return             the result of the task's evaluation, which must be freed with tapFreeResult
+*/
+expression* tapTaskResult (tap_task* task) {
+    pthread_mutex_lock(&task->lock);
+    while (task->status != TASK_FINISHED) {
+        parkTask(&task->waiters, &task->done, &task->lock);
+    }
+    pthread_mutex_unlock(&task->lock);
+    expression* result = task->result;
+    pthread_mutex_destroy(&task->lock);
+    pthread_cond_destroy(&task->done);
+    freeStack(task->stack);
+    free(task->text);
+    free(task);
+    return result;
+}
+
+/*! Gives way to the other tasks of the calling thread's carrier if the task it's running has used up its quantum; the interpreter calls this wherever switching tasks is safe, and it does nothing outside a task
+    @return             nothing
+*/
+void safePoint () {
+    tap_task* task = ctask;
+    if (task != NULL && --task->steps <= 0) {
+        task->carrier->reason = TASK_YIELDED;
+        swapcontext(&task->state, &task->carrier->state);
+    }
+}
+
+/*! Returns whether or not the task the calling thread is running is too close to the end of its stack to call another function
+    @return             1 if less than TASK_STACK_MARGIN bytes of the task's stack are left, 0 otherwise (including outside a task)
+*/
+int stackExhausted () {
+    tap_task* task = ctask;
+    char marker; // the stack grows down, so the address of a local is how much of the stack is left above its lowest byte
+    return task != NULL && &marker - task->stack < TASK_STACK_MARGIN;
+}
+
+/*! Waits until the given list of parked tasks is unparked, like pthread_cond_wait: the given lock must be held, and is released while waiting and held again once this returns; a task parks and lets its carrier run other tasks, while any other thread waits on the given condition variable
+    @param parked       the list the task parks in
+    @param cond         the condition variable other threads wait on
+    @param lock         the lock guarding whatever is being waited for
+    @return             nothing
+*/
+void parkTask (tasklist* parked, pthread_cond_t* cond, pthread_mutex_t* lock) {
+    tap_task* task = ctask;
+    if (task == NULL) {
+        pthread_cond_wait(cond, lock);
+        return;
+    }
+    task->next = parked->first;
+    parked->first = task;
+    task->release = lock; // released by the carrier, so that nothing can unpark the task before it has switched out
+    task->carrier->reason = TASK_PARKED;
+    swapcontext(&task->state, &task->carrier->state);
+    pthread_mutex_lock(lock);
+}
+
+/*! Wakes every task parked in the given list and every thread waiting on the given condition variable; the lock they wait with must be held
+    @param parked       the list of parked tasks
+    @param cond         the condition variable
+    @return             nothing
+*/
+void unparkTasks (tasklist* parked, pthread_cond_t* cond) {
+    pthread_cond_broadcast(cond);
+    tap_task* task = parked->first;
+    parked->first = NULL;
+    while (task != NULL) {
+        tap_task* next = task->next;
+        queueTask(task->carrier, task);
+        task = next;
+    }
+}
+
+/*! Runs the given carrier's tasks until it's told to stop and has none left
+    @param arg          the carrier
+    @return             null
+*/
+static void* runCarrier (void* arg) {
+    taskcarrier* carrier = arg;
+    while (1) {
+        pthread_mutex_lock(&carrier->lock);
+        while (carrier->first == NULL && !(carrier->stopping && carrier->numtasks == 0)) {
+            pthread_cond_wait(&carrier->ready, &carrier->lock);
+        }
+        tap_task* task = carrier->first;
+        if (task == NULL) { // stopping
+            pthread_mutex_unlock(&carrier->lock);
+            break;
+        }
+        carrier->first = task->next;
+        if (carrier->first == NULL) {
+            carrier->last = NULL;
+        }
+        pthread_mutex_unlock(&carrier->lock);
+        ctask = task;
+        task->steps = carrier->quantum;
+        setContext(task->context); // the last task to run may have left the thread in its own context
+        swapcontext(&carrier->state, &task->state);
+        ctask = NULL;
+        setContext(NULL);
+        if (carrier->reason == TASK_YIELDED) {
+            queueTask(carrier, task);
+        } else if (carrier->reason == TASK_PARKED) {
+            pthread_mutex_t* lock = task->release;
+            task->release = NULL;
+            pthread_mutex_unlock(lock);
+        } else {
+            finishTask(task);
+            pthread_mutex_lock(&carrier->lock);
+            __atomic_sub_fetch(&carrier->numtasks, 1, __ATOMIC_RELAXED);
+            pthread_mutex_unlock(&carrier->lock);
+        }
+    }
+    return NULL;
+}
+
+/*! Allocates a task's stack with an inaccessible guard page below it, so that overflowing the stack faults rather than overwriting
+    whatever memory lies below it
+    @return             the lowest usable byte of the stack, which must be freed with freeStack
+*/
+static char* allocateStack () {
+    size_t guard = sysconf(_SC_PAGESIZE);
+    char* base = mmap(NULL, guard + TASK_STACK_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+    if (base == MAP_FAILED || mprotect(base, guard, PROT_NONE) != 0) {
+        exit(EXIT_OUT_OF_MEMORY);
+    }
+    return base + guard;
+}
+
+/*! Frees the given task's stack along with its guard page
+    @param stack        the stack, as allocateStack returned it
+    @return             nothing
+*/
+static void freeStack (char* stack) {
+    size_t guard = sysconf(_SC_PAGESIZE);
+    munmap(stack - guard, guard + TASK_STACK_SIZE);
+}
+
+/*! Sets up the given task's registers so that switching to it starts runTask on the task's own stack
+    @param task         the task, whose carrier is set
+    @return             nothing
+*/
+static void prepareTask (tap_task* task) {
+    getcontext(&task->state);
+    task->state.uc_stack.ss_sp = task->stack;
+    task->state.uc_stack.ss_size = TASK_STACK_SIZE;
+    task->state.uc_link = &task->carrier->state; // returning from runTask switches back to the carrier
+    makecontext(&task->state, &runTask, 0);
+}
+
+/*! Evaluates the task the calling carrier is switching to, on the task's own stack, and then switches back to the carrier for good
+    @return             nothing
+*/
+static void runTask () {
+    tap_task* task = ctask;
+    task->result = tapEvalString(task->context, task->text);
+    task->carrier->reason = TASK_FINISHED;
+}
+
+/*! Adds the given task to the back of the given carrier's queue of ready tasks
+    @param carrier      the carrier the task belongs to
+    @param task         the task
+    @return             nothing
+*/
+static void queueTask (taskcarrier* carrier, tap_task* task) {
+    pthread_mutex_lock(&carrier->lock);
+    task->next = NULL;
+    if (carrier->last == NULL) {
+        carrier->first = task;
+    } else {
+        carrier->last->next = task;
+    }
+    carrier->last = task;
+    pthread_cond_signal(&carrier->ready);
+    pthread_mutex_unlock(&carrier->lock);
+}
+
+/*! Marks the given task finished and wakes whatever is waiting for its result, after which its carrier must not touch it again
+    @param task         the task
+    @return             nothing
+*/
+static void finishTask (tap_task* task) {
+    pthread_mutex_lock(&task->lock);
+    __atomic_store_n(&task->status, TASK_FINISHED, __ATOMIC_RELEASE);
+    unparkTasks(&task->waiters, &task->done);
+    pthread_mutex_unlock(&task->lock);
+}
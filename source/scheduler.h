@@ -0,0 +1,70 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   scheduler.h
+    @brief  The header file for scheduler.c
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <pthread.h>
+#include <ucontext.h>
+
+#include "structs.h"
+#include "dep_structs.h"
+
+typedef struct tap_task_ tap_task;
+typedef struct tap_scheduler_ tap_scheduler;
+typedef struct taskcarrier_ taskcarrier;
+typedef struct tasklist_ tasklist;
+
+struct tasklist_ {
+    tap_task* first; // the tasks parked waiting for the same thing, linked through their next fields
+};
+
+struct tap_task_ {
+    ucontext_t state; // the task's registers while it isn't running
+    char* stack;
+    tap_context* context; // the context the task evaluates in, which nothing else may use until the task is finished
+    char* text; // the code the task evaluates
+    expression* result; // set once the task is finished
+    int status; // TASK_RUNNING until the task is finished, then TASK_FINISHED
+    int steps; // the number of safe points left in the task's quantum
+    taskcarrier* carrier; // the thread the task always runs on, so that it keeps the same thread-local state
+    tap_task* next; // the next task in the carrier's queue or in the list the task is parked in
+    pthread_mutex_t* release; // the lock the carrier releases once a parking task has switched out
+    tasklist waiters; // the tasks waiting for this one to finish
+    pthread_mutex_t lock; // guards the status and the list of waiting tasks
+    pthread_cond_t done; // signaled when the task finishes, for threads outside the scheduler
+};
+
+struct taskcarrier_ {
+    pthread_t thread;
+    ucontext_t state; // the carrier's loop, which every task switches back to
+    tap_task* first; // the queue of tasks ready to run
+    tap_task* last;
+    int numtasks; // the number of unfinished tasks assigned to the carrier
+    int quantum;
+    int reason; // why the task that ran last switched back: TASK_YIELDED, TASK_PARKED or TASK_FINISHED
+    int stopping;
+    pthread_mutex_t lock; // guards the queue, the count of tasks and the stopping flag
+    pthread_cond_t ready; // signaled when a task is queued or the carrier should stop
+};
+
+struct tap_scheduler_ {
+    taskcarrier* carriers;
+    int numcarriers;
+};
+
+tap_scheduler* tapStartScheduler(int, int);
+void tapStopScheduler(tap_scheduler*);
+tap_task* tapSpawnTask(tap_scheduler*, tap_context*, char*);
+int tapTaskFinished(tap_task*);
+expression* tapTaskResult(tap_task*);
+void safePoint();
+int stackExhausted();
+void parkTask(tasklist*, pthread_cond_t*, pthread_mutex_t*);
+void unparkTasks(tasklist*, pthread_cond_t*);
+
+#endif
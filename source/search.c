@@ -0,0 +1,246 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   search.c
+    @brief  Substring search, which finds where one string occurs in another without boxing the positions it finds
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "search.h"
+#include "constants.h"
+#include "memory.h"
+
+/* A search first runs a vector filter over the text: for a block of positions at once, it compares the byte at each position
+   with the needle's first byte and the byte the needle's length further on with its last byte, and only the positions where
+   both match are compared in full. Almost every position is ruled out a block at a time this way. A needle whose first and
+   last bytes are common in the text (e.g. "aaaa" in a run of a's) lets too much through, so once the filter has compared
+   more than a few bytes per byte it has scanned, the rest of the text is searched with Two-Way, which is linear in the worst
+   case. Without vector instructions everything is searched with Two-Way. */
+
+#if defined(__AVX2__)
+#define SEARCH_BLOCK 32 // the number of positions the vector filter checks at once
+typedef __m256i searchbytes;
+#define SPLAT_BYTE(byte) _mm256_set1_epi8(byte)
+#define MATCH_BYTES(text, bytes) (uint)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i*)(text)), bytes))
+#elif defined(__SSE2__)
+#define SEARCH_BLOCK 16
+typedef __m128i searchbytes;
+#define SPLAT_BYTE(byte) _mm_set1_epi8(byte)
+#define MATCH_BYTES(text, bytes) (uint)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((__m128i*)(text)), bytes))
+#else
+#define SEARCH_BLOCK 0
+#endif
+
+static int searchTwoWay(unsigned char*, int, unsigned char*, int);
+static int maximalSuffix(unsigned char*, int, int*, int);
+
+/*! Returns the first position at or after the given one where the given needle occurs in the given text
+    @param haystack     the text to search, which may contain null characters
+    @param hsize        the size of the text
+    @param needle       the text to search for
+    @param nsize        the size of the needle
+    @param from         the first position to consider
+    @return             the position or -1 if the needle doesn't occur there
+*/
+int searchFirst (char* haystack, int hsize, char* needle, int nsize, int from) {
+    if (from < 0) {
+        from = 0;
+    }
+    if (nsize == 0) { // the empty string occurs everywhere
+        return from <= hsize ? from : -1;
+    }
+    if (nsize > hsize - from) {
+        return -1;
+    }
+    if (nsize == 1) {
+        char* found = memchr(haystack + from, needle[0], hsize - from);
+        return found == NULL ? -1 : found - haystack;
+    }
+    int i = from;
+#if SEARCH_BLOCK > 0
+    searchbytes first = SPLAT_BYTE(needle[0]);
+    searchbytes last = SPLAT_BYTE(needle[nsize - 1]);
+    long work = 0; // the bytes compared checking the positions the filter let through
+    while (i + nsize - 1 + SEARCH_BLOCK <= hsize) { // while both loads of the block are inside the text
+        uint candidates = MATCH_BYTES(haystack + i, first) & MATCH_BYTES(haystack + i + nsize - 1, last);
+        while (candidates != 0) {
+            int position = i + __builtin_ctz(candidates);
+            if (memcmp(haystack + position + 1, needle + 1, nsize - 2) == 0) {
+                return position;
+            }
+            work += nsize;
+            candidates &= candidates - 1;
+        }
+        i += SEARCH_BLOCK;
+        if (work > (long)(i - from) * SEARCH_MAX_WORK + SEARCH_WORK_SLACK) { // the filter lets too much through for this needle
+            break;
+        }
+    }
+#endif
+    int found = searchTwoWay((unsigned char*)haystack + i, hsize - i, (unsigned char*)needle, nsize);
+    return found < 0 ? -1 : i + found;
+}
+
+/*! Returns the last position where the given needle occurs in the given text
+    @param haystack     the text to search, which may contain null characters
+    @param hsize        the size of the text
+    @param needle       the text to search for
+    @param nsize        the size of the needle
+    @return             the position or -1 if the needle doesn't occur in the text
+*/
+int searchLast (char* haystack, int hsize, char* needle, int nsize) {
+    if (nsize == 0) { // the empty string occurs at the very end
+        return hsize;
+    }
+    if (nsize > hsize) {
+        return -1;
+    }
+    int i = hsize - nsize + 1; // one past the last position the needle could start at
+#if SEARCH_BLOCK > 0
+    searchbytes first = SPLAT_BYTE(needle[0]);
+    searchbytes last = SPLAT_BYTE(needle[nsize - 1]);
+    while (i >= SEARCH_BLOCK) { // check whole blocks from the end of the text back
+        i -= SEARCH_BLOCK;
+        uint candidates = MATCH_BYTES(haystack + i, first) & MATCH_BYTES(haystack + i + nsize - 1, last);
+        while (candidates != 0) {
+            int offset = 31 - __builtin_clz(candidates); // the last candidate in the block comes first
+            if (memcmp(haystack + i + 1 + offset, needle + 1, nsize - 1) == 0) {
+                return i + offset;
+            }
+            candidates &= ~(1u << offset);
+        }
+    }
+#endif
+    while (i-- > 0) { // the positions before the first whole block
+        if (haystack[i] == needle[0] && haystack[i + nsize - 1] == needle[nsize - 1] && memcmp(haystack + i, needle, nsize) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*! Returns every position where the given needle occurs in the given text, leaving out matches that overlap an earlier one
+    @param haystack     the text to search, which may contain null characters
+    @param hsize        the size of the text
+    @param needle       the text to search for, which matches nowhere if it's empty
+    @param nsize        the size of the needle
+    @param count        set to the number of positions found
+    @return             the positions in increasing order, which must be freed by the caller
+*/
+int* searchAll (char* haystack, int hsize, char* needle, int nsize, int* count) {
+    int capacity = SEARCH_INITIAL_MATCHES;
+    int* positions = allocate(sizeof(int) * capacity);
+    *count = 0;
+    if (nsize == 0) {
+        return positions;
+    }
+    int position = searchFirst(haystack, hsize, needle, nsize, 0);
+    while (position >= 0) {
+        if (*count == capacity) {
+            capacity *= 2;
+            positions = realloc(positions, sizeof(int) * capacity);
+            if (positions == NULL) {
+                exit(EXIT_OUT_OF_MEMORY);
+            }
+        }
+        positions[(*count)++] = position;
+        position = searchFirst(haystack, hsize, needle, nsize, position + nsize);
+    }
+    return positions;
+}
+
+/*! Finds the first position where the given needle occurs in the given text with the Two-Way algorithm, which splits the needle at a critical factorization and matches the right part forwards and then the left part backwards
+    @param text         the text to search
+    @param tsize        the size of the text
+    @param needle       the text to search for
+    @param nsize        the size of the needle, which must be at least 1
+    @return             the position or -1 if the needle doesn't occur in the text
+*/
+static int searchTwoWay (unsigned char* text, int tsize, unsigned char* needle, int nsize) {
+    int period1;
+    int period2;
+    int suffix1 = maximalSuffix(needle, nsize, &period1, 0);
+    int suffix2 = maximalSuffix(needle, nsize, &period2, 1);
+    int split = suffix1 > suffix2 ? suffix1 : suffix2; // the critical factorization is the later of the two maximal suffixes
+    int period = suffix1 > suffix2 ? period1 : period2;
+    int i;
+    int j = 0;
+    if (memcmp(needle, needle + period, split + 1) == 0) { // the needle is periodic, so what's matched of one period is remembered for the next
+        int memory = -1;
+        while (j <= tsize - nsize) {
+            i = (split > memory ? split : memory) + 1;
+            while (i < nsize && needle[i] == text[i + j]) {
+                ++i;
+            }
+            if (i < nsize) {
+                j += i - split;
+                memory = -1;
+                continue;
+            }
+            for (i = split; i > memory && needle[i] == text[i + j]; --i);
+            if (i <= memory) {
+                return j;
+            }
+            j += period;
+            memory = nsize - period - 1;
+        }
+    } else {
+        period = (split + 1 > nsize - split - 1 ? split + 1 : nsize - split - 1) + 1;
+        while (j <= tsize - nsize) {
+            for (i = split + 1; i < nsize && needle[i] == text[i + j]; ++i);
+            if (i < nsize) {
+                j += i - split;
+                continue;
+            }
+            for (i = split; i >= 0 && needle[i] == text[i + j]; --i);
+            if (i < 0) {
+                return j;
+            }
+            j += period;
+        }
+    }
+    return -1;
+}
+
+/*! Finds the maximal suffix of the given needle under the normal order of bytes or its reverse
+    @param needle       the needle
+    @param nsize        the size of the needle
+    @param period       set to the period of the suffix
+    @param reversed     1 to use the reverse order of bytes, 0 to use the normal order
+    @return             the position just before the suffix starts (-1 if it's the whole needle)
+*/
+static int maximalSuffix (unsigned char* needle, int nsize, int* period, int reversed) {
+    int suffix = -1;
+    int j = 0;
+    int k = 1;
+    *period = 1;
+    while (j + k < nsize) {
+        unsigned char a = needle[j + k];
+        unsigned char b = needle[suffix + k];
+        if (reversed ? a > b : a < b) { // the suffix can't start between it and here
+            j += k;
+            k = 1;
+            *period = j - suffix;
+        } else if (a == b) {
+            if (k != *period) {
+                ++k;
+            } else {
+                j += *period;
+                k = 1;
+            }
+        } else { // a later suffix is larger
+            suffix = j;
+            j = suffix + 1;
+            k = 1;
+            *period = 1;
+        }
+    }
+    return suffix;
+}
@@ -0,0 +1,17 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   search.h
+    @brief  The header file for search.c
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include "structs.h"
+
+int searchFirst(char*, int, char*, int, int);
+int searchLast(char*, int, char*, int);
+int* searchAll(char*, int, char*, int, int*);
+
+#endif
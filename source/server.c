@@ -0,0 +1,383 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   server.c
+    @brief  A server that keeps a pool of warm contexts, one per worker thread, and evaluates requests sent to it over a Unix domain socket
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <arpa/inet.h>
+
+#include "server.h"
+#include "tap.h"
+#include "engine.h"
+#include "constants.h"
+#include "memory.h"
+#include "strings.h"
+
+/* The protocol: every request is a 4 byte big-endian length followed by that many bytes of code. Every reply is a 4 byte big-endian
+   length followed by that many bytes: a status byte (SERVER_STATUS_OK or SERVER_STATUS_ERROR) and then the printed result or the
+   printed errors. A connection may send any number of requests, each of which is answered before the next one is read. Each
+   connection has a worker to itself, so a connection that sends nothing for SERVER_IDLE_TIMEOUT milliseconds is closed, as is an
+   idle one whenever every worker has a connection and another is waiting to be accepted. */
+
+static int removeStaleSocket(char*);
+static void* runWorker(void*);
+static void serveClient(tap_worker*, int);
+static int serverFull(tap_server*);
+static int awaitRequest(tap_server*, int);
+static int readAll(int, void*, size_t);
+static int writeAll(int, void*, size_t);
+static int writeReply(int, char, char*);
+
+/*! Starts a server listening on the given socket path with the given number of workers, each of which has its own context with the given packages loaded
+    @param path         the path of the Unix domain socket to listen on (a socket left at the path by a server that is no longer running is replaced)
+    @param packages     the paths of the packages to load into every context
+    @param numpackages  the number of packages
+    @param numworkers   the number of worker threads, or 0 for one per online processor
+    @return             the running server or null if the socket couldn't be set up (including when something else is at the path) or a package couldn't be loaded
+*/
+tap_server* tapStartServer (char* path, char* packages[], int numpackages, int numworkers) {
+    struct sockaddr_un address;
+    if (strlen(path) >= sizeof(address.sun_path) || !removeStaleSocket(path)) {
+        return NULL;
+    }
+    if (numworkers < 1) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        numworkers = cores > 0 ? cores : 1;
+    }
+    tap_context* contexts[numworkers];
+    int i, j;
+    for (i = 0; i < numworkers; ++i) { // load every package before accepting anything so that no request sees a half loaded context
+        contexts[i] = tapCreate();
+        for (j = 0; j < numpackages; ++j) {
+            if (!tapLoadPackage(contexts[i], packages[j])) {
+                char* errortext = tapPrintErrors(contexts[i]);
+                fprintf(stderr, "%s: %s", packages[j], errortext);
+                free(errortext);
+                for (; i >= 0; --i) {
+                    tapDestroy(contexts[i]);
+                }
+                return NULL;
+            }
+        }
+    }
+    int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+    if (sock < 0 || bind(sock, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(sock, SERVER_BACKLOG) != 0) {
+        if (sock >= 0) {
+            close(sock);
+        }
+        for (i = 0; i < numworkers; ++i) {
+            tapDestroy(contexts[i]);
+        }
+        return NULL;
+    }
+    tap_server* server = allocate(sizeof(tap_server));
+    server->socket = sock;
+    server->path = strDup(path);
+    server->numworkers = numworkers;
+    server->numbusy = 0;
+    server->stopping = 0;
+    pthread_mutex_init(&server->lock, NULL);
+    server->workers = allocate(sizeof(tap_worker) * numworkers);
+    for (i = 0; i < numworkers; ++i) {
+        tap_worker* worker = &server->workers[i];
+        worker->context = contexts[i];
+        worker->server = server;
+        worker->client = -1;
+        pthread_create(&worker->thread, NULL, &runWorker, worker);
+    }
+    return server;
+}
+
+/*! Stops the given server, waiting for every worker to finish the request it is evaluating, and frees it along with its contexts
+    @param server       the server to stop
+    @return             nothing
+*/
+void tapStopServer (tap_server* server) {
+    pthread_mutex_lock(&server->lock);
+    server->stopping = 1;
+    shutdown(server->socket, SHUT_RDWR); // wake up the workers waiting to accept a connection
+    int i;
+    for (i = 0; i < server->numworkers; ++i) {
+        if (server->workers[i].client >= 0) {
+            shutdown(server->workers[i].client, SHUT_RD); // let the current reply go out but read nothing more
+        }
+    }
+    pthread_mutex_unlock(&server->lock);
+    for (i = 0; i < server->numworkers; ++i) {
+        pthread_join(server->workers[i].thread, NULL);
+        tapDestroy(server->workers[i].context);
+    }
+    close(server->socket);
+    unlink(server->path);
+    pthread_mutex_destroy(&server->lock);
+    free(server->workers);
+    free(server->path);
+    free(server);
+}
+
+/*! Runs a server on the given socket path with one worker per online processor until the process is terminated
+    @param path         the path of the Unix domain socket to listen on
+    @param packages     the paths of the packages to load into every context
+    @param numpackages  the number of packages
+    @return             0 if the server ran and stopped, 1 if it couldn't be started
+*/
+int tapServe (char* path, char* packages[], int numpackages) {
+    tap_server* server = tapStartServer(path, packages, numpackages, 0);
+    if (server == NULL) {
+        return 1;
+    }
+    int i;
+    for (i = 0; i < server->numworkers; ++i) {
+        pthread_join(server->workers[i].thread, NULL);
+    }
+    return 0;
+}
+
+/*! Sends the given code to the server connected to the given socket and waits for the reply
+    @param sock         the socket connected to a server
+    @param text         the code to evaluate
+    @param failed       set to 1 if the reply contains errors rather than a result, 0 otherwise (may be null)
+    @return             the reply text, which must be freed by the caller, or null if the connection failed
+*/
+char* tapRequest (int sock, char* text, int* failed) {
+    uint32_t size = strlen(text);
+    uint32_t header = htonl(size);
+    if (!writeAll(sock, &header, sizeof(header)) || !writeAll(sock, text, size) || !readAll(sock, &header, sizeof(header))) {
+        return NULL;
+    }
+    size = ntohl(header);
+    if (size < 1) {
+        return NULL;
+    }
+    char status;
+    char* reply = allocate(size);
+    if (!readAll(sock, &status, 1) || !readAll(sock, reply, size - 1)) {
+        free(reply);
+        return NULL;
+    }
+    reply[size - 1] = '\0';
+    if (failed != NULL) {
+        *failed = status != SERVER_STATUS_OK;
+    }
+    return reply;
+}
+
+/*! Removes the socket at the given path if no server is listening on it any more, leaving anything else at the path alone
+    @param path         the path of the socket
+    @return             1 if nothing is at the path now, 0 if something is
+*/
+static int removeStaleSocket (char* path) {
+    struct stat info;
+    if (lstat(path, &info) != 0) {
+        return errno == ENOENT;
+    }
+    if (!S_ISSOCK(info.st_mode)) { // never replace a file that isn't a socket
+        return 0;
+    }
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+    int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock < 0) {
+        return 0;
+    }
+    int stale = connect(sock, (struct sockaddr*)&address, sizeof(address)) != 0 && errno == ECONNREFUSED; // nothing answers on a socket whose server is gone
+    close(sock);
+    return stale && unlink(path) == 0;
+}
+
+/*! Accepts connections and serves them one at a time until the server stops
+    @param arg          the worker to run
+    @return             null
+*/
+static void* runWorker (void* arg) {
+    tap_worker* worker = arg;
+    tap_server* server = worker->server;
+    setContext(worker->context); // this thread only ever evaluates in its own context
+    while (1) {
+        int client = accept(server->socket, NULL, NULL);
+        if (client < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            break; // the server is stopping
+        }
+        pthread_mutex_lock(&server->lock);
+        int stopping = server->stopping;
+        worker->client = stopping ? -1 : client;
+        server->numbusy += !stopping;
+        pthread_mutex_unlock(&server->lock);
+        if (!stopping) {
+            serveClient(worker, client);
+            pthread_mutex_lock(&server->lock);
+            worker->client = -1;
+            --server->numbusy;
+            pthread_mutex_unlock(&server->lock);
+        }
+        close(client);
+    }
+    return NULL;
+}
+
+/*! Evaluates every request the given client sends until it hangs up, sends a malformed request, or idles while it's needed elsewhere
+    @param worker       the worker serving the client, whose context the requests are evaluated in
+    @param client       the connection to the client
+    @return             nothing
+*/
+static void serveClient (tap_worker* worker, int client) {
+    tap_context* context = worker->context;
+    uint32_t header;
+    while (awaitRequest(worker->server, client) && readAll(client, &header, sizeof(header))) {
+        uint32_t size = ntohl(header);
+        if (size > SERVER_MAX_REQUEST) {
+            return;
+        }
+        char* text = allocate(size + 1);
+        if (!readAll(client, text, size)) {
+            free(text);
+            return;
+        }
+        text[size] = '\0';
+        expression* result = tapEvalString(context, text);
+        free(text);
+        int failed = tapFailed(context);
+        char* reply = failed ? tapPrintErrors(context) : tapPrintResult(result);
+        tapFreeResult(result);
+        tapReset(context); // leave the context as the packages left it for the next request
+        int sent = writeReply(client, failed ? SERVER_STATUS_ERROR : SERVER_STATUS_OK, reply);
+        free(reply);
+        if (!sent) {
+            return;
+        }
+    }
+}
+
+/*! Returns whether the given server is stopping or has a client for every worker
+    @param server       the server to check
+    @return             1 if no worker is free to accept another connection, 0 otherwise
+*/
+static int serverFull (tap_server* server) {
+    pthread_mutex_lock(&server->lock);
+    int full = server->stopping || server->numbusy >= server->numworkers;
+    pthread_mutex_unlock(&server->lock);
+    return full;
+}
+
+/*! Waits for the given client to send its next request, giving up once it has been idle for SERVER_IDLE_TIMEOUT milliseconds or as soon
+    as every worker is busy while another connection waits to be accepted
+    @param server       the server the client is connected to
+    @param client       the connection to the client
+    @return             1 if the client sent something (or hung up, which reading tells), 0 if the connection should be closed
+*/
+static int awaitRequest (tap_server* server, int client) {
+    struct pollfd waiting[2];
+    waiting[0].fd = client;
+    waiting[0].events = POLLIN;
+    waiting[1].fd = server->socket;
+    waiting[1].events = POLLIN;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long deadline = now.tv_sec * 1000 + now.tv_nsec / 1000000 + SERVER_IDLE_TIMEOUT;
+    while (1) {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long remaining = deadline - (now.tv_sec * 1000 + now.tv_nsec / 1000000);
+        if (remaining <= 0) {
+            return 0;
+        }
+        int ready = poll(waiting, 2, remaining);
+        if (ready < 0 && errno != EINTR) {
+            return 0;
+        }
+        if (ready > 0 && waiting[0].revents != 0) {
+            return 1;
+        }
+        if (ready > 0 && waiting[1].revents != 0) { // a connection is waiting, which an idle worker will accept unless there isn't one
+            if (!serverFull(server)) {
+                sched_yield(); // give the idle worker a chance to accept it before looking again
+            }
+            else if (poll(waiting, 1, SERVER_IDLE_GRACE) > 0) { // a worker about to notice its client hung up may still take it
+                return 1;
+            }
+            else if (serverFull(server)) {
+                return 0;
+            }
+        }
+    }
+}
+
+/*! Reads exactly the given number of bytes from the given socket
+    @param sock         the socket to read from
+    @param buffer       the buffer to read into
+    @param size         the number of bytes to read
+    @return             1 if every byte was read, 0 if the connection closed or failed first
+*/
+static int readAll (int sock, void* buffer, size_t size) {
+    char* pos = buffer;
+    while (size > 0) {
+        ssize_t count = read(sock, pos, size);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        } else if (count <= 0) {
+            return 0;
+        }
+        pos += count;
+        size -= count;
+    }
+    return 1;
+}
+
+/*! Writes exactly the given number of bytes to the given socket
+    @param sock         the socket to write to
+    @param buffer       the bytes to write
+    @param size         the number of bytes to write
+    @return             1 if every byte was written, 0 if the connection failed first
+*/
+static int writeAll (int sock, void* buffer, size_t size) {
+    char* pos = buffer;
+    while (size > 0) {
+        ssize_t count = send(sock, pos, size, MSG_NOSIGNAL); // a peer hanging up fails the write instead of raising SIGPIPE in the host process
+        if (count < 0 && errno == EINTR) {
+            continue;
+        } else if (count <= 0) {
+            return 0;
+        }
+        pos += count;
+        size -= count;
+    }
+    return 1;
+}
+
+/*! Writes a reply frame containing the given status and text to the given socket
+    @param sock         the socket to write to
+    @param status       the status of the reply
+    @param text         the text of the reply
+    @return             1 if the reply was written, 0 otherwise
+*/
+static int writeReply (int sock, char status, char* text) {
+    uint32_t size = strlen(text);
+    char* frame = allocate(sizeof(uint32_t) + 1 + size); // send the frame in one write so small replies leave in a single packet
+    uint32_t header = htonl(size + 1);
+    memcpy(frame, &header, sizeof(header));
+    frame[sizeof(header)] = status;
+    memcpy(frame + sizeof(header) + 1, text, size);
+    int sent = writeAll(sock, frame, sizeof(header) + 1 + size);
+    free(frame);
+    return sent;
+}
@@ -0,0 +1,41 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   server.h
+    @brief  The header file for server.c
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <pthread.h>
+
+#include "structs.h"
+#include "dep_structs.h"
+
+typedef struct tap_worker_ tap_worker;
+typedef struct tap_server_ tap_server;
+
+struct tap_worker_ {
+    pthread_t thread;
+    tap_context* context; // the context this worker evaluates every request in
+    tap_server* server;
+    int client; // the connection currently being served or -1 if there isn't one
+};
+
+struct tap_server_ {
+    int socket; // the listening socket every worker accepts connections from
+    char* path;
+    tap_worker* workers;
+    int numworkers;
+    int numbusy; // the number of workers serving a client
+    int stopping;
+    pthread_mutex_t lock; // guards the workers' client connections and the stopping flag
+};
+
+tap_server* tapStartServer(char*, char*[], int, int);
+void tapStopServer(tap_server*);
+int tapServe(char*, char*[], int);
+char* tapRequest(int, char*, int*);
+
+#endif
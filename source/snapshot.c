@@ -0,0 +1,733 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   snapshot.c
+    @brief  Saves what a context's packages defined to a snapshot file and restores it into a new context without evaluating the packages again
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "snapshot.h"
+#include "engine.h"
+#include "constants.h"
+#include "constructors.h"
+#include "memory.h"
+#include "strings.h"
+#include "memo.h"
+#include "workers.h"
+#include "builders.h"
+#include "matchers.h"
+#include "regexes.h"
+#include "formats.h"
+#include "packages.h"
+
+/* A snapshot holds everything the root environment of a context gained while its packages were loaded: the composite types, the
+   variables and functions, and the next composite type ID. It contains no pointers, only counts and sizes followed by what they
+   describe, so it can be mapped at any address and restored in one pass. Numbers are written in the machine's byte order and the
+   header records the layout of the build that wrote it, so a snapshot is only restored by a build that reads it the same way. */
+
+static void putBytes(snapshotwriter*, const void*, size_t);
+static void putUint(snapshotwriter*, uint32_t);
+static void putText(snapshotwriter*, const char*, int);
+static void putExprs(snapshotwriter*, expression*);
+static void putExpr(snapshotwriter*, expression*);
+static void putTypelist(snapshotwriter*, typelist*);
+static void putProperties(snapshotwriter*, property*);
+static void putType(snapshotwriter*, type*);
+static void putVariables(snapshotwriter*, hashelement*);
+static void getBytes(snapshotreader*, void*, size_t);
+static uint32_t getUint(snapshotreader*);
+static uint32_t getCount(snapshotreader*);
+static char* getText(snapshotreader*, int*);
+static expression* getExprs(snapshotreader*);
+static expression* getExpr(snapshotreader*);
+static typelist* getTypelist(snapshotreader*);
+static property* getProperties(snapshotreader*);
+static type* getType(snapshotreader*);
+static void putHeader(snapshotwriter*);
+static int getHeader(snapshotreader*);
+
+/*! Writes the composite types, variables, and functions defined in the given context's root environment to a snapshot file, first evaluating whatever its imported packages define that it hasn't needed yet
+    @param context      the context to save, which must be the current one so that errors can be reported in it
+    @param path         the path of the snapshot file (an existing file at the path is replaced once the snapshot is complete)
+    @return             1 if the snapshot was written, 0 otherwise
+*/
+int saveSnapshot (tap_context* context, char* path) {
+    defineAllImported(); // the snapshot can't refer back to the imported packages, so whatever they define has to be in the root environment
+    environment* root = context->environments[0];
+    snapshotwriter writer;
+    writer.data = allocate(SNAPSHOT_INITIAL_SIZE);
+    writer.size = 0;
+    writer.capacity = SNAPSHOT_INITIAL_SIZE;
+    writer.failed = 0;
+    putHeader(&writer);
+    putUint(&writer, context->ctypeid);
+    uint32_t count = 0;
+    typedefs* td;
+    for (td = root->types; td != NULL; td = td->next) {
+        ++count;
+    }
+    putUint(&writer, count);
+    for (td = root->types; td != NULL; td = td->next) {
+        putType(&writer, td->type);
+    }
+    count = 0;
+    int i;
+    hashelement* element;
+    for (i = 0; i < root->variables->size; ++i) {
+        for (element = root->variables->table[i]; element != NULL; element = element->next) {
+            if (element->flag == HFLAG_USER) {
+                ++count;
+            } else { // primitive functions added at runtime point into the process that added them
+                writer.failed = 1;
+            }
+        }
+    }
+    putUint(&writer, count);
+    for (i = 0; i < root->variables->size; ++i) {
+        putVariables(&writer, root->variables->table[i]);
+    }
+    int saved = 0;
+    if (writer.failed) {
+        addError(newErrorlist(ERR_INVALID_SNAPSHOT, newString(strDup(path)), 0, 0));
+    } else {
+        char* temppath = allocate(strlen(path) + 5);
+        sprintf(temppath, "%s.tmp", path);
+        FILE* file = fopen(temppath, "wb"); // write beside the snapshot and rename it so that nothing ever maps a half written one
+        if (file != NULL) {
+            saved = fwrite(writer.data, 1, writer.size, file) == writer.size;
+            saved = fclose(file) == 0 && saved;
+            saved = saved && rename(temppath, path) == 0;
+            if (!saved) {
+                remove(temppath);
+            }
+        }
+        if (!saved) {
+            addError(newErrorlist(ERR_UNWRITABLE_FILE, newString(strDup(path)), 0, 0));
+        }
+        free(temppath);
+    }
+    free(writer.data);
+    return saved;
+}
+
+/*! Maps the given snapshot file and restores the composite types, variables, and functions it holds into the root environment of the given context
+    @param context      the context to restore into, which must be the current one and must not have defined anything yet
+    @param path         the path of the snapshot file
+    @return             1 if the snapshot was restored, 0 otherwise (in which case the context is left empty)
+*/
+int restoreSnapshot (tap_context* context, char* path) {
+    environment* root = context->environments[0];
+    if (context->ctypeid != TYPE_COMP_START || root->types != NULL || root->numvars > 0) { // the snapshot's type IDs and variables would collide with what the context already has
+        addError(newErrorlist(ERR_INVALID_SNAPSHOT, newString(strDup(path)), 0, 0));
+        return 0;
+    }
+    int file = open(path, O_RDONLY);
+    struct stat info;
+    if (file < 0 || fstat(file, &info) != 0) {
+        if (file >= 0) {
+            close(file);
+        }
+        addError(newErrorlist(ERR_UNREADABLE_FILE, newString(strDup(path)), 0, 0));
+        return 0;
+    }
+    size_t size = info.st_size;
+    void* image = size > 0 ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, file, 0) : MAP_FAILED;
+    close(file); // the mapping stays valid once the file is closed
+    if (image == MAP_FAILED) {
+        addError(newErrorlist(size > 0 ? ERR_UNREADABLE_FILE : ERR_INVALID_SNAPSHOT, newString(strDup(path)), 0, 0));
+        return 0;
+    }
+    snapshotreader reader;
+    reader.pos = image;
+    reader.end = reader.pos + size;
+    reader.failed = 0;
+    datatype ctypeid = TYPE_COMP_START;
+    if (getHeader(&reader)) {
+        ctypeid = getUint(&reader);
+        if (ctypeid < TYPE_COMP_START) {
+            reader.failed = 1;
+        }
+        uint32_t count = getCount(&reader);
+        uint32_t i;
+        typedefs* tail = NULL;
+        for (i = 0; i < count && !reader.failed; ++i) { // keep the types in the order they were saved in
+            typedefs* td = newTypedefs(getType(&reader));
+            if (tail == NULL) {
+                root->types = td;
+            } else {
+                tail->next = td;
+            }
+            tail = td;
+        }
+        count = getCount(&reader);
+        for (i = 0; i < count && !reader.failed; ++i) {
+            char* key = getText(&reader, NULL);
+            insertUserHash(root->variables, key, getExprs(&reader));
+            ++root->numvars;
+            free(key);
+        }
+        if (reader.pos != reader.end) { // anything left over means the counts didn't describe the snapshot
+            reader.failed = 1;
+        }
+    }
+    munmap(image, size);
+    if (reader.failed) {
+        clearHash(root->variables);
+        root->numvars = 0;
+        freeTypedefs(root->types);
+        root->types = NULL;
+        addError(newErrorlist(ERR_INVALID_SNAPSHOT, newString(strDup(path)), 0, 0));
+        return 0;
+    }
+    context->ctypeid = ctypeid;
+    return 1;
+}
+
+/*! Writes the header identifying a snapshot and the layout of the build writing it
+    @param writer       the snapshot being written
+    @return             nothing
+*/
+static void putHeader (snapshotwriter* writer) {
+    putBytes(writer, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    putUint(writer, SNAPSHOT_VERSION);
+    putUint(writer, SNAPSHOT_BYTE_ORDER);
+    putUint(writer, sizeof(exprvals));
+    putUint(writer, sizeof(tap_int));
+    putUint(writer, sizeof(tap_flo));
+    putUint(writer, sizeof(tap_dat));
+}
+
+/*! Reads the header of a snapshot and checks that this build can read the rest of it
+    @param reader       the snapshot being read
+    @return             1 if the snapshot can be read, 0 otherwise
+*/
+static int getHeader (snapshotreader* reader) {
+    char magic[sizeof(SNAPSHOT_MAGIC)];
+    getBytes(reader, magic, sizeof(magic));
+    int valid = memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) == 0;
+    valid = getUint(reader) == SNAPSHOT_VERSION && valid;
+    valid = getUint(reader) == SNAPSHOT_BYTE_ORDER && valid;
+    valid = getUint(reader) == sizeof(exprvals) && valid;
+    valid = getUint(reader) == sizeof(tap_int) && valid;
+    valid = getUint(reader) == sizeof(tap_flo) && valid;
+    valid = getUint(reader) == sizeof(tap_dat) && valid;
+    if (!valid) {
+        reader->failed = 1;
+    }
+    return !reader->failed;
+}
+
+/*! Appends the given bytes to the snapshot being written, growing it as needed
+    @param writer       the snapshot being written
+    @param bytes        the bytes to append
+    @param size         the number of bytes
+    @return             nothing
+*/
+static void putBytes (snapshotwriter* writer, const void* bytes, size_t size) {
+    if (writer->size + size > writer->capacity) {
+        while (writer->size + size > writer->capacity) {
+            writer->capacity *= 2;
+        }
+        writer->data = realloc(writer->data, writer->capacity);
+        if (writer->data == NULL) {
+            exit(EXIT_OUT_OF_MEMORY);
+        }
+    }
+    memcpy(writer->data + writer->size, bytes, size);
+    writer->size += size;
+}
+
+/*! Appends the given number to the snapshot being written
+    @param writer       the snapshot being written
+    @param value        the number
+    @return             nothing
+*/
+static void putUint (snapshotwriter* writer, uint32_t value) {
+    putBytes(writer, &value, sizeof(value));
+}
+
+/*! Appends the given text, preceded by its size, to the snapshot being written
+    @param writer       the snapshot being written
+    @param text         the text
+    @param size         the number of characters in the text
+    @return             nothing
+*/
+static void putText (snapshotwriter* writer, const char* text, int size) {
+    putUint(writer, size);
+    putBytes(writer, text, size);
+}
+
+/*! Appends the given list of expressions, preceded by its length, to the snapshot being written
+    @param writer       the snapshot being written
+    @param head         the first expression in the list (may be null)
+    @return             nothing
+*/
+static void putExprs (snapshotwriter* writer, expression* head) {
+    uint32_t count = 0;
+    expression* expr;
+    for (expr = head; expr != NULL; expr = expr->next) {
+        ++count;
+    }
+    putUint(writer, count);
+    for (expr = head; expr != NULL; expr = expr->next) {
+        putExpr(writer, expr);
+    }
+}
+
+/*! Appends the given expression and everything it owns (but not the expressions after it) to the snapshot being written
+    @param writer       the snapshot being written
+    @param expr         the expression
+    @return             nothing
+*/
+static void putExpr (snapshotwriter* writer, expression* expr) {
+    putUint(writer, expr->type);
+    putUint(writer, expr->line);
+    putUint(writer, (expr->flag & 3) | (expr->isref << 2));
+    putUint(writer, expr->refs);
+    exprvals ev = expr->ev;
+    int i;
+    switch (expr->type) {
+        case TYPE_NIL:
+        case TYPE_INT:
+        case TYPE_FLO:
+        case TYPE_DAT:
+        case TYPE_TYP:
+            putBytes(writer, &ev, sizeof(ev));
+            break;
+        case TYPE_EXP:
+            putExprs(writer, ev.expval);
+            break;
+        case TYPE_LAZ: // every owner of the lazy expression gets a copy of its own when it's restored
+            if (ev.lazval->future != NULL) { // a spawned expression is written with its result
+                awaitFuture(ev.lazval);
+            }
+            putExprs(writer, ev.lazval->expval);
+            putUint(writer, ev.lazval->value != NULL);
+            if (ev.lazval->value != NULL) {
+                putExpr(writer, ev.lazval->value);
+            }
+            break;
+        case TYPE_STR:
+            putText(writer, ev.strval->content, ev.strval->size);
+            break;
+        case TYPE_BLD: { // written as the string it has built so far and restored as a builder holding it in one piece
+            string* str = flattenBuilder(ev.bldval);
+            putText(writer, str->content, str->size);
+            freeStr(str);
+            break;
+        }
+        case TYPE_MAT: // written as its needles, from which the automaton is built again when it's read
+            putUint(writer, ev.matval->numneedles);
+            for (i = 0; i < (int)ev.matval->numneedles; ++i) {
+                putText(writer, ev.matval->needles[i]->content, ev.matval->needles[i]->size);
+            }
+            break;
+        case TYPE_REG: // written as its pattern, which is compiled again when it's read
+            putText(writer, ev.regval->source->content, ev.regval->source->size);
+            break;
+        case TYPE_FMT: // likewise written as its template
+            putText(writer, ev.fmtval->source->content, ev.fmtval->source->size);
+            break;
+        case TYPE_ARR:
+            putUint(writer, ev.arrval->size);
+            putUint(writer, ev.arrval->start);
+            putUint(writer, ev.arrval->end);
+            for (i = ev.arrval->start; i <= ev.arrval->end; ++i) {
+                putExprs(writer, ev.arrval->content[i]);
+            }
+            break;
+        case TYPE_OBJ:
+            putUint(writer, ev.objval->type);
+            putProperties(writer, ev.objval->props);
+            break;
+        case TYPE_FUN: { // the memoized results aren't saved, only how many the function keeps
+            tap_fun* fun = ev.funval;
+            putUint(writer, fun->minargs);
+            putUint(writer, fun->maxargs);
+            putUint(writer, fun->memo != NULL ? fun->memo->capacity : 0);
+            putExprs(writer, fun->body);
+            int numargs = fun->maxargs == ARGLEN_INF ? fun->minargs : fun->maxargs;
+            for (i = 0; i < numargs; ++i) {
+                putText(writer, fun->args[i]->name->content, fun->args[i]->name->size);
+                putTypelist(writer, fun->args[i]->types);
+                putExprs(writer, fun->args[i]->initial);
+            }
+            break;
+        }
+        default:
+            writer->failed = 1;
+            break;
+    }
+}
+
+/*! Appends the given list of types, preceded by its length, to the snapshot being written
+    @param writer       the snapshot being written
+    @param tl           the list of types (may be null)
+    @return             nothing
+*/
+static void putTypelist (snapshotwriter* writer, typelist* tl) {
+    uint32_t count = 0;
+    typelist* types;
+    for (types = tl; types != NULL; types = types->next) {
+        ++count;
+    }
+    putUint(writer, count);
+    for (types = tl; types != NULL; types = types->next) {
+        putUint(writer, types->type);
+    }
+}
+
+/*! Appends the given list of properties, preceded by its length, to the snapshot being written
+    @param writer       the snapshot being written
+    @param props        the list of properties (may be null)
+    @return             nothing
+*/
+static void putProperties (snapshotwriter* writer, property* props) {
+    uint32_t count = 0;
+    property* prop;
+    for (prop = props; prop != NULL; prop = prop->next) {
+        ++count;
+    }
+    putUint(writer, count);
+    for (prop = props; prop != NULL; prop = prop->next) {
+        putText(writer, prop->name, strlen(prop->name));
+        putTypelist(writer, prop->types);
+        putUint(writer, prop->privacy);
+        putUint(writer, prop->range);
+        putExprs(writer, prop->value);
+    }
+}
+
+/*! Appends the given composite type to the snapshot being written
+    @param writer       the snapshot being written
+    @param typ          the composite type
+    @return             nothing
+*/
+static void putType (snapshotwriter* writer, type* typ) {
+    putUint(writer, typ->id);
+    putText(writer, typ->name, strlen(typ->name));
+    uint32_t count = 0;
+    stringlist* sl;
+    for (sl = typ->required; sl != NULL; sl = sl->next) {
+        ++count;
+    }
+    putUint(writer, count);
+    for (sl = typ->required; sl != NULL; sl = sl->next) {
+        putText(writer, sl->str->content, sl->str->size);
+    }
+    putTypelist(writer, typ->inherits);
+    putProperties(writer, typ->properties);
+}
+
+/*! Appends the user variables in the given list of hash elements to the snapshot being written, last first so that restoring them in order recreates the list
+    @param writer       the snapshot being written
+    @param element      the first element of the list
+    @return             nothing
+*/
+static void putVariables (snapshotwriter* writer, hashelement* element) {
+    if (element == NULL) {
+        return;
+    }
+    putVariables(writer, element->next);
+    if (element->flag == HFLAG_USER) {
+        putText(writer, element->key, strlen(element->key));
+        putExprs(writer, element->value);
+    }
+}
+
+/*! Reads the given number of bytes from the snapshot, filling them with zeros if the snapshot ends first
+    @param reader       the snapshot being read
+    @param bytes        where to store the bytes
+    @param size         the number of bytes
+    @return             nothing
+*/
+static void getBytes (snapshotreader* reader, void* bytes, size_t size) {
+    if (reader->failed || (size_t)(reader->end - reader->pos) < size) {
+        reader->failed = 1;
+        memset(bytes, 0, size);
+        return;
+    }
+    memcpy(bytes, reader->pos, size);
+    reader->pos += size;
+}
+
+/*! Reads a number from the snapshot
+    @param reader       the snapshot being read
+    @return             the number (0 if the snapshot ended first)
+*/
+static uint32_t getUint (snapshotreader* reader) {
+    uint32_t value;
+    getBytes(reader, &value, sizeof(value));
+    return value;
+}
+
+/*! Reads the length of a list from the snapshot, rejecting lengths that the rest of the snapshot couldn't possibly hold
+    @param reader       the snapshot being read
+    @return             the length (0 if it's invalid)
+*/
+static uint32_t getCount (snapshotreader* reader) {
+    uint32_t count = getUint(reader);
+    if (count > (size_t)(reader->end - reader->pos)) { // every item takes at least one byte
+        reader->failed = 1;
+        return 0;
+    }
+    return count;
+}
+
+/*! Reads text from the snapshot
+    @param reader       the snapshot being read
+    @param size         set to the number of characters read (may be null)
+    @return             the null terminated text, which must be freed by the caller
+*/
+static char* getText (snapshotreader* reader, int* size) {
+    uint32_t length = getCount(reader);
+    char* text = allocate(length + 1);
+    getBytes(reader, text, length);
+    text[length] = '\0';
+    if (size != NULL) {
+        *size = length;
+    }
+    return text;
+}
+
+/*! Reads a list of expressions from the snapshot
+    @param reader       the snapshot being read
+    @return             the first expression in the list (null if the list is empty)
+*/
+static expression* getExprs (snapshotreader* reader) {
+    uint32_t count = getCount(reader);
+    expression* head = NULL;
+    expression* tail = NULL;
+    uint32_t i;
+    for (i = 0; i < count && !reader->failed; ++i) {
+        expression* expr = getExpr(reader);
+        if (tail == NULL) {
+            head = expr;
+        } else {
+            tail->next = expr;
+        }
+        tail = expr;
+    }
+    return head;
+}
+
+/*! Reads an expression and everything it owns from the snapshot
+    @param reader       the snapshot being read
+    @return             the expression, which is always safe to free even if the snapshot turns out to be malformed
+*/
+static expression* getExpr (snapshotreader* reader) {
+    datatype type = getUint(reader);
+    linenum line = getUint(reader);
+    uint32_t flags = getUint(reader);
+    uint32_t refs = getUint(reader);
+    expression* expr = newExpressionAll(TYPE_NIL, NULL, NULL, line);
+    expr->flag = flags & 3;
+    expr->isref = (flags >> 2) & 1;
+    expr->refs = refs;
+    exprvals* ev = &expr->ev;
+    int size;
+    int i;
+    switch (type) {
+        case TYPE_NIL:
+        case TYPE_INT:
+        case TYPE_FLO:
+        case TYPE_DAT:
+        case TYPE_TYP:
+            getBytes(reader, ev, sizeof(*ev));
+            break;
+        case TYPE_EXP:
+            ev->expval = getExprs(reader);
+            break;
+        case TYPE_LAZ:
+            ev->lazval = newLazyExpression();
+            ev->lazval->expval = getExprs(reader);
+            if (getUint(reader)) {
+                ev->lazval->value = getExpr(reader);
+            }
+            break;
+        case TYPE_STR: {
+            char* content = getText(reader, &size);
+            ev->strval = newString(content);
+            ev->strval->size = size; // the text may contain null characters
+            break;
+        }
+        case TYPE_BLD: {
+            char* content = getText(reader, &size);
+            ev->bldval = newBuilder();
+            appendBuilder(ev->bldval, content, size);
+            free(content);
+            break;
+        }
+        case TYPE_MAT: {
+            uint32_t numneedles = getCount(reader);
+            string** needles = allocate(sizeof(string*) * (numneedles > 0 ? numneedles : 1));
+            uint32_t j;
+            for (j = 0; j < numneedles; ++j) {
+                char* content = getText(reader, &size);
+                needles[j] = newStringCopy(content, size);
+                free(content);
+            }
+            ev->matval = newMatcher(needles, numneedles);
+            for (j = 0; j < numneedles; ++j) {
+                freeStr(needles[j]);
+            }
+            free(needles);
+            break;
+        }
+        case TYPE_REG: {
+            char* content = getText(reader, &size);
+            char* error;
+            ev->regval = newRegex(content, size, &error);
+            free(content);
+            if (ev->regval == NULL) { // only a snapshot made by a build with a different syntax could hold a pattern that doesn't compile
+                reader->failed = 1;
+                ev->regval = newRegex("", 0, &error);
+            }
+            break;
+        }
+        case TYPE_FMT: {
+            char* content = getText(reader, &size);
+            char* error;
+            ev->fmtval = newFormat(content, size, &error);
+            free(content);
+            if (ev->fmtval == NULL) {
+                reader->failed = 1;
+                ev->fmtval = newFormat("", 0, &error);
+            }
+            break;
+        }
+        case TYPE_ARR: {
+            uint32_t arrsize = getCount(reader);
+            int start = getUint(reader);
+            int end = getUint(reader);
+            ev->arrval = newArray(arrsize);
+            if (start < 0 || end >= (int)arrsize || start > end + 1) {
+                reader->failed = 1;
+                start = 0;
+                end = -1;
+            }
+            ev->arrval->start = start;
+            ev->arrval->end = end;
+            for (i = start; i <= end; ++i) {
+                ev->arrval->content[i] = getExprs(reader);
+            }
+            break;
+        }
+        case TYPE_OBJ: {
+            datatype objtype = getUint(reader);
+            ev->objval = newObject(objtype, getProperties(reader));
+            break;
+        }
+        case TYPE_FUN: {
+            int minargs = getUint(reader);
+            int maxargs = getUint(reader);
+            uint capacity = getUint(reader);
+            expression* body = getExprs(reader);
+            int numargs = maxargs == ARGLEN_INF ? minargs : maxargs;
+            if (minargs < 0 || (maxargs != ARGLEN_INF && maxargs < minargs) || numargs > reader->end - reader->pos) {
+                reader->failed = 1;
+                minargs = maxargs = numargs = 0;
+            }
+            argument* args[numargs > 0 ? numargs : 1];
+            for (i = 0; i < numargs; ++i) {
+                char* name = getText(reader, &size);
+                typelist* types = getTypelist(reader);
+                args[i] = newArgument(newString(name), types, getExprs(reader));
+            }
+            ev->funval = newTapFunction(args, minargs, maxargs, body);
+            if (capacity > 0) {
+                ev->funval->memo = newMemo(capacity);
+            }
+            break;
+        }
+        default:
+            reader->failed = 1;
+            return expr;
+    }
+    expr->type = type;
+    return expr;
+}
+
+/*! Reads a list of types from the snapshot
+    @param reader       the snapshot being read
+    @return             the list of types (null if it's empty)
+*/
+static typelist* getTypelist (snapshotreader* reader) {
+    uint32_t count = getCount(reader);
+    typelist* head = NULL;
+    typelist* tail = NULL;
+    uint32_t i;
+    for (i = 0; i < count && !reader->failed; ++i) {
+        typelist* tl = newTypelist(getUint(reader));
+        if (tail == NULL) {
+            head = tl;
+        } else {
+            tail->next = tl;
+        }
+        tail = tl;
+    }
+    return head;
+}
+
+/*! Reads a list of properties from the snapshot
+    @param reader       the snapshot being read
+    @return             the list of properties (null if it's empty)
+*/
+static property* getProperties (snapshotreader* reader) {
+    uint32_t count = getCount(reader);
+    property* head = NULL;
+    property* tail = NULL;
+    uint32_t i;
+    for (i = 0; i < count && !reader->failed; ++i) {
+        char* name = getText(reader, NULL);
+        typelist* types = getTypelist(reader);
+        int privacy = getUint(reader);
+        int range = getUint(reader);
+        property* prop = newProperty(name, types, privacy, range, NULL);
+        prop->value = getExprs(reader); // take the restored value rather than a copy of it
+        free(name);
+        if (tail == NULL) {
+            head = prop;
+        } else {
+            tail->next = prop;
+        }
+        tail = prop;
+    }
+    return head;
+}
+
+/*! Reads a composite type from the snapshot
+    @param reader       the snapshot being read
+    @return             the composite type
+*/
+static type* getType (snapshotreader* reader) {
+    datatype id = getUint(reader);
+    char* name = getText(reader, NULL);
+    uint32_t count = getCount(reader);
+    stringlist* required = NULL;
+    stringlist* tail = NULL;
+    uint32_t i;
+    for (i = 0; i < count && !reader->failed; ++i) {
+        int size;
+        char* content = getText(reader, &size);
+        stringlist* sl = newStringlist(newString(content), NULL);
+        sl->str->size = size;
+        if (tail == NULL) {
+            required = sl;
+        } else {
+            tail->next = sl;
+        }
+        tail = sl;
+    }
+    typelist* inherits = getTypelist(reader);
+    type* typ = newType(id, name, required, inherits, getProperties(reader));
+    free(name);
+    return typ;
+}
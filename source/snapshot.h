@@ -0,0 +1,36 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   snapshot.h
+    @brief  The header file for snapshot.c
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "structs.h"
+#include "dep_structs.h"
+
+typedef struct snapshotwriter_ snapshotwriter;
+typedef struct snapshotreader_ snapshotreader;
+
+struct snapshotwriter_ {
+    char* data;
+    size_t size;
+    size_t capacity;
+    int failed; // set if something in the context can't be written to a snapshot
+};
+
+struct snapshotreader_ {
+    const char* pos;
+    const char* end;
+    int failed; // set once a read runs past the end of the snapshot or finds something malformed
+};
+
+int saveSnapshot(tap_context*, char*);
+int restoreSnapshot(tap_context*, char*);
+
+#endif
@@ -8,11 +8,58 @@
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include "strings.h"
 #include "constants.h"
 #include "constructors.h"
 
+/* Case conversion, reversal and character class spans work on a block of bytes at once where vector instructions are
+   available, falling back to a byte at a time for what's left over at the ends. A byte is tested against a range with two
+   signed comparisons, so bytes from 128 up (which compare as negative) are never in any of the ASCII ranges. */
+
+#if defined(__AVX2__)
+#define BYTES_BLOCK 32 // the number of bytes worked on at once
+#define BLOCK_MASK 0xFFFFFFFFu // the mask of a block's worth of comparison results
+typedef __m256i bytevector;
+#define LOAD_BYTES(text) _mm256_loadu_si256((__m256i*)(text))
+#define STORE_BYTES(text, bytes) _mm256_storeu_si256((__m256i*)(text), bytes)
+#define SPLAT_BYTE(byte) _mm256_set1_epi8(byte)
+#define AND_BYTES(a, b) _mm256_and_si256(a, b)
+#define OR_BYTES(a, b) _mm256_or_si256(a, b)
+#define XOR_BYTES(a, b) _mm256_xor_si256(a, b)
+#define EQUAL_BYTES(a, b) _mm256_cmpeq_epi8(a, b)
+#define GREATER_BYTES(a, b) _mm256_cmpgt_epi8(a, b)
+#define MASK_BYTES(bytes) (uint)_mm256_movemask_epi8(bytes)
+#elif defined(__SSE2__)
+#define BYTES_BLOCK 16
+#define BLOCK_MASK 0xFFFFu
+typedef __m128i bytevector;
+#define LOAD_BYTES(text) _mm_loadu_si128((__m128i*)(text))
+#define STORE_BYTES(text, bytes) _mm_storeu_si128((__m128i*)(text), bytes)
+#define SPLAT_BYTE(byte) _mm_set1_epi8(byte)
+#define AND_BYTES(a, b) _mm_and_si128(a, b)
+#define OR_BYTES(a, b) _mm_or_si128(a, b)
+#define XOR_BYTES(a, b) _mm_xor_si128(a, b)
+#define EQUAL_BYTES(a, b) _mm_cmpeq_epi8(a, b)
+#define GREATER_BYTES(a, b) _mm_cmpgt_epi8(a, b)
+#define MASK_BYTES(bytes) (uint)_mm_movemask_epi8(bytes)
+#else
+#define BYTES_BLOCK 0
+#endif
+
+#if BYTES_BLOCK > 0
+#define RANGE_BYTES(bytes, low, high) AND_BYTES(GREATER_BYTES(bytes, SPLAT_BYTE((low) - 1)), GREATER_BYTES(SPLAT_BYTE((high) + 1), bytes))
+
+static bytevector classBytes(bytevector, int);
+static bytevector reverseBlock(bytevector);
+#endif
+static int inClass(unsigned char, int);
+
 /*! Returns the index of the first occurrence of the given character in the given string (starting from start) or -1 if the character isn't found
     @param text     the text to search from
     @param chr      the character to search for
@@ -66,49 +113,164 @@ uint safeEdit (char* text, uint index, char value, uint size) {
     @return         the new string
 */
 string* changeCase (string* origstr, int flag) {
-    string* result = newString(strDup(origstr->content));
-    int difference;
-    int min1;
-    int max1;
-    int min2;
-    int max2;
-    if (flag == CASE_LOWER) {
-        difference = 'A' - 'a';
-        min1 = 'A';
-        max1 = 'Z';
-        min2 = 0;
-        max2 = 0;
-    } else {
-        difference = 'a' - 'A';
-        min1 = 'a';
-        max1 = 'z';
-        min2 = 'A';
-        max2 = 'Z';
-    }
-    int first = 1;
-    int i;
-    for (i = 0; i < result->size; ++i) {
-        int chr = origstr->content[i];
-        if (!first && ((flag == CASE_SENTENCE && chr == '.') || (flag == CASE_TITLE && chr == ' '))) {
-            first = 1;
-        } else {
-            if (chr >= min1 && chr <= max1 && first) {
-                result->content[i] -= difference;
-            }
-            if ((flag == CASE_SENTENCE || flag == CASE_TITLE) && result->content[i] >= min2 && result->content[i] <= max2) {
-                first = 0;
+    string* result = newStringOfSize(origstr->size);
+    convertCase(result->content, origstr->content, origstr->size, flag);
+    return result;
+}
+
+/*! Writes the given text with its case changed according to the flag given (0 = upper, 1 = lower, 2 = sentence, 3 = title)
+    @param dest     where to write the text, which may be the text itself
+    @param src      the text to read, which may contain null characters
+    @param size     the size of the text
+    @param flag     the integer flag used to determine how and when to change each character's case
+    @return         nothing
+*/
+void convertCase (char* dest, char* src, int size, int flag) {
+    int i = 0;
+    if (flag == CASE_SENTENCE || flag == CASE_TITLE) { // only the first letter after each break is changed, which depends on what came before
+        int first = 1;
+        for (i = 0; i < size; ++i) {
+            char chr = src[i];
+            if (!first && ((flag == CASE_SENTENCE && chr == '.') || (flag == CASE_TITLE && chr == ' '))) {
+                first = 1;
+            } else {
+                if (chr >= 'a' && chr <= 'z' && first) {
+                    chr -= 'a' - 'A';
+                }
+                if (chr >= 'A' && chr <= 'Z') {
+                    first = 0;
+                }
             }
+            dest[i] = chr;
         }
+        return;
     }
-    return result;
+    char low = flag == CASE_LOWER ? 'A' : 'a'; // the range of letters that change
+    char high = flag == CASE_LOWER ? 'Z' : 'z';
+#if BYTES_BLOCK > 0
+    bytevector bit = SPLAT_BYTE('a' - 'A'); // the bit that differs between the two cases of a letter
+    for (; i + BYTES_BLOCK <= size; i += BYTES_BLOCK) {
+        bytevector bytes = LOAD_BYTES(src + i);
+        STORE_BYTES(dest + i, XOR_BYTES(bytes, AND_BYTES(RANGE_BYTES(bytes, low, high), bit)));
+    }
+#endif
+    for (; i < size; ++i) {
+        char chr = src[i];
+        dest[i] = chr >= low && chr <= high ? chr ^ ('a' - 'A') : chr;
+    }
+}
+
+/*! Writes the given text in reverse, swapping a block from each end at a time
+    @param dest     where to write the reversed text, which may be the text itself
+    @param src      the text to read, which may contain null characters
+    @param size     the size of the text
+    @return         nothing
+*/
+void reverseBytes (char* dest, char* src, int size) {
+    int front = 0;
+    int back = size;
+#if BYTES_BLOCK > 0
+    for (; back - front >= 2 * BYTES_BLOCK; front += BYTES_BLOCK, back -= BYTES_BLOCK) { // both blocks are read before either is written, so this works in place
+        bytevector head = LOAD_BYTES(src + front);
+        bytevector tail = LOAD_BYTES(src + back - BYTES_BLOCK);
+        STORE_BYTES(dest + front, reverseBlock(tail));
+        STORE_BYTES(dest + back - BYTES_BLOCK, reverseBlock(head));
+    }
+#endif
+    for (; back - front >= 2; ++front, --back) {
+        char chr = src[front];
+        dest[front] = src[back - 1];
+        dest[back - 1] = chr;
+    }
+    if (back > front) {
+        dest[front] = src[front];
+    }
+}
+
+/*! Returns how many bytes at the start of the given text are in the given character class
+    @param text     the text to scan, which may contain null characters
+    @param size     the size of the text
+    @param class    the class, one of the CLASS constants
+    @return         the number of bytes before the first one that isn't in the class, or the size if they all are
+*/
+int spanClass (char* text, int size, int class) {
+    int i = 0;
+#if BYTES_BLOCK > 0
+    for (; i + BYTES_BLOCK <= size; i += BYTES_BLOCK) {
+        uint outside = ~MASK_BYTES(classBytes(LOAD_BYTES(text + i), class)) & BLOCK_MASK;
+        if (outside != 0) {
+            return i + __builtin_ctz(outside);
+        }
+    }
+#endif
+    while (i < size && inClass(text[i], class)) {
+        ++i;
+    }
+    return i;
 }
 
-/*! Copies the given string, including its contents
+/*! Returns how many bytes at the end of the given text are in the given character class
+    @param text     the text to scan, which may contain null characters
+    @param size     the size of the text
+    @param class    the class, one of the CLASS constants
+    @return         the number of bytes after the last one that isn't in the class, or the size if they all are
+*/
+int spanClassBack (char* text, int size, int class) {
+    int i = size; // the end of the bytes not yet scanned
+#if BYTES_BLOCK > 0
+    for (; i >= BYTES_BLOCK; i -= BYTES_BLOCK) {
+        uint outside = ~MASK_BYTES(classBytes(LOAD_BYTES(text + i - BYTES_BLOCK), class)) & BLOCK_MASK;
+        if (outside != 0) {
+            return BYTES_BLOCK - 1 - (31 - __builtin_clz(outside)) + size - i;
+        }
+    }
+#endif
+    while (i > 0 && inClass(text[i - 1], class)) {
+        --i;
+    }
+    return size - i;
+}
+
+/*! Copies the given string; a long string's copy shares its content, which is never written to once the string has been made
     @param oldstr   the string to copy
-    @return         a copy of the given string with a copy of its contents
+    @return         a copy of the given string
 */
 inline string* copyString (string* oldstr) {
-    return newString(strDup(oldstr->content));
+    return newStringSlice(oldstr, 0, oldstr->size);
+}
+
+/*! Returns the given string's content as a null terminated C string, first giving a slice that isn't null terminated a copy of its content
+    @param str      the string
+    @return         the string's content
+*/
+char* stringContent (string* str) {
+    if (str->content[str->size] == '\0') { // the content is already null terminated (a slice can always read one past its end, which is at most its parent's terminator)
+        return str->content;
+    }
+    char* content = allocate(str->size + 1);
+    memcpy(content, str->content, str->size);
+    content[str->size] = '\0';
+    freeStr(str->parent);
+    str->parent = NULL;
+    str->content = content;
+    return content;
+}
+
+/*! Frees the given string struct but keeps its content, copying it out first if the string doesn't have content of its own
+    @param str      the string to free
+    @return         the string's content, which must be freed by the caller
+*/
+char* releaseString (string* str) {
+    char* content = str->content;
+    if (content == str->text || str->parent != NULL || str->owners > 1) { // the content is kept with the struct or shared
+        content = allocate(str->size + 1);
+        memcpy(content, str->content, str->size);
+        content[str->size] = '\0';
+        freeStr(str);
+    } else {
+        free(str);
+    }
+    return content;
 }
 
 /*! Attempts to duplicate the string (using strDup) and errors out if the memory could not be allocated
@@ -143,3 +305,66 @@ inline int stringSize (int i) {
         return log10(i) + 1;
     }
 }
+
+/*! Returns whether or not the given byte is in the given character class
+    @param chr      the byte
+    @param class    the class, one of the CLASS constants
+    @return         1 if the byte is in the class, 0 otherwise
+*/
+static int inClass (unsigned char chr, int class) {
+    switch (class) {
+        case CLASS_SPACE:
+            return chr == ' ' || (chr >= '\t' && chr <= '\r');
+        case CLASS_DIGIT:
+            return chr >= '0' && chr <= '9';
+        case CLASS_UPPER:
+            return chr >= 'A' && chr <= 'Z';
+        case CLASS_LOWER:
+            return chr >= 'a' && chr <= 'z';
+        case CLASS_ALPHA:
+            return (chr | ('a' - 'A')) >= 'a' && (chr | ('a' - 'A')) <= 'z';
+        default:
+            return inClass(chr, CLASS_ALPHA) || inClass(chr, CLASS_DIGIT);
+    }
+}
+
+#if BYTES_BLOCK > 0
+/*! Returns which of the given bytes are in the given character class
+    @param bytes    the bytes
+    @param class    the class, one of the CLASS constants
+    @return         each byte set to all ones if it's in the class or zero if it isn't
+*/
+static bytevector classBytes (bytevector bytes, int class) {
+    switch (class) {
+        case CLASS_SPACE:
+            return OR_BYTES(EQUAL_BYTES(bytes, SPLAT_BYTE(' ')), RANGE_BYTES(bytes, '\t', '\r'));
+        case CLASS_DIGIT:
+            return RANGE_BYTES(bytes, '0', '9');
+        case CLASS_UPPER:
+            return RANGE_BYTES(bytes, 'A', 'Z');
+        case CLASS_LOWER:
+            return RANGE_BYTES(bytes, 'a', 'z');
+        case CLASS_ALPHA:
+            return RANGE_BYTES(OR_BYTES(bytes, SPLAT_BYTE('a' - 'A')), 'a', 'z');
+        default:
+            return OR_BYTES(classBytes(bytes, CLASS_ALPHA), classBytes(bytes, CLASS_DIGIT));
+    }
+}
+
+/*! Returns the given block of bytes in reverse order
+    @param bytes    the bytes
+    @return         the reversed bytes
+*/
+static bytevector reverseBlock (bytevector bytes) {
+#if defined(__AVX2__)
+    bytevector order = _mm256_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    bytes = _mm256_shuffle_epi8(bytes, order); // reverse each half, then swap the halves
+    return _mm256_permute2x128_si256(bytes, bytes, 1);
+#else
+    bytes = _mm_or_si128(_mm_slli_epi16(bytes, 8), _mm_srli_epi16(bytes, 8)); // swap the bytes of each pair, then reverse the pairs
+    bytes = _mm_shufflelo_epi16(bytes, _MM_SHUFFLE(0, 1, 2, 3));
+    bytes = _mm_shufflehi_epi16(bytes, _MM_SHUFFLE(0, 1, 2, 3));
+    return _mm_shuffle_epi32(bytes, _MM_SHUFFLE(1, 0, 3, 2));
+#endif
+}
+#endif
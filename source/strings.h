@@ -15,11 +15,24 @@
 #define CASE_SENTENCE 2
 #define CASE_TITLE 3
 
+#define CLASS_SPACE 0
+#define CLASS_DIGIT 1
+#define CLASS_UPPER 2
+#define CLASS_LOWER 3
+#define CLASS_ALPHA 4
+#define CLASS_ALNUM 5
+
 int indexOf(char*, char, uint);
 char* substr(char*, uint, uint);
 uint safeEdit(char*, uint, char, uint);
 string* changeCase(string*, int);
+void convertCase(char*, char*, int, int);
+void reverseBytes(char*, char*, int);
+int spanClass(char*, int, int);
+int spanClassBack(char*, int, int);
 string* copyString(string*);
+char* stringContent(string*);
+char* releaseString(string*);
 char* strDup(char*);
 int isNumber(char);
 int stringSize(int);
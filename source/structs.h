@@ -9,6 +9,8 @@
 #define STRUCTS_H
 
 #include "typedefs.h"
+#include "constants.h"
+#include "tap.h"
 
 typedef union exprvals_ exprvals;
 typedef struct expression_ expression;
@@ -20,6 +22,11 @@ typedef struct type_ type;
 typedef struct typedefs_ typedefs;
 typedef struct property_ property;
 typedef struct tap_fun_ tap_fun;
+typedef struct tap_chn_ tap_chn;
+typedef struct tap_bld_ tap_bld;
+typedef struct tap_mat_ tap_mat;
+typedef struct tap_reg_ tap_reg;
+typedef struct tap_fmt_ tap_fmt;
 typedef struct argument_ argument;
 typedef struct typelist_ typelist;
 typedef struct exprstack_ exprstack;
@@ -27,10 +34,14 @@ typedef struct tap_prim_fun_ tap_prim_fun;
 typedef struct stringlist_ stringlist;
 typedef struct errorlist_ errorlist;
 typedef union tap_fun_con_ tap_fun_con;
+typedef union prim_kernel_ prim_kernel;
 typedef struct tap_fun_search_ tap_fun_search;
+typedef struct tap_memo_ tap_memo;
+typedef struct memoentry_ memoentry;
+typedef struct builtinconst_ builtinconst;
+typedef struct builtinslot_ builtinslot;
+typedef struct tap_future_ tap_future;
 
-typedef long tap_int;
-typedef double tap_flo;
 typedef string tap_str;
 typedef array tap_arr;
 typedef time_t tap_dat;
@@ -45,6 +56,11 @@ union exprvals_ {
     tap_dat datval;
     tap_obj* objval;
     tap_fun* funval;
+    tap_chn* chnval;
+    tap_bld* bldval;
+    tap_mat* matval;
+    tap_reg* regval;
+    tap_fmt* fmtval;
 };
 
 struct expression_ {
@@ -60,11 +76,17 @@ struct expression_ {
 struct tap_laz_ {
     expression* expval;
     exprstack* refs;
+    expression* value;
+    uint owners;
+    tap_future* future; // set while a spawned evaluation of the expression is running on the worker pool
 };
 
 struct string_ {
     char* content;
     int size;
+    int owners; // the number of strings using this string's content, including itself
+    string* parent; // the string whose content this string is a slice of, or null if it has content of its own
+    char text[]; // the content of a short string, kept in the same allocation as the struct (content then points here)
 };
 
 struct array_ {
@@ -103,6 +125,7 @@ struct property_ {
 
 struct tap_fun_ {
     expression* body;
+    tap_memo* memo;
     int minargs;
     int maxargs;
     argument* args[0];
@@ -124,11 +147,35 @@ struct exprstack_ {
     exprstack* next;
 };
 
+union prim_kernel_ {
+    tap_int(*ints)(tap_int[], int);
+    tap_flo(*flos)(tap_flo[], int);
+    tap_int(*flotests)(tap_flo[], int);
+};
+
 struct tap_prim_fun_ {
+    const char* name; // the name the function is called by (null if it isn't a built-in)
     void(*address)(expression*[], int, exprvals*, datatype*);
     int minargs;
     int maxargs;
-    typelist* types;
+    uint types[PRIM_MAX_ARGTYPES]; // the mask of types accepted at each of the first argument positions (0 if the position isn't checked)
+    uint kernel:2;
+    prim_kernel fast;
+};
+
+struct builtinconst_ {
+    const char* name;
+    datatype type;
+    exprvals value;
+};
+
+struct builtinslot_ {
+    const char* name; // null if the slot is empty
+    const tap_prim_fun* const* prims; // the primitive functions with this name, in the order they are tried
+    int numprims;
+    const builtinconst* constant; // the constant variables see (may be null)
+    const builtinconst* typeconstant; // the type constant typeFromString sees (may be null)
+    int impure; // set if the primitive functions with this name are listed as impure
 };
 
 struct stringlist_ {
@@ -145,7 +192,7 @@ struct errorlist_ {
 };
 
 union tap_fun_con_ {
-	tap_prim_fun* prim_fun;
+	const tap_prim_fun* prim_fun;
 	tap_fun* tap_fun;
 };
 
@@ -155,5 +202,27 @@ struct tap_fun_search_ {
 	tap_fun_con funs;
 };
 
+struct tap_memo_ {
+    memoentry** table;
+    memoentry* newest;
+    memoentry* oldest;
+    uint size;
+    uint capacity;
+    uint count;
+    uint hits;
+    uint misses;
+    uint refs;
+};
+
+struct memoentry_ {
+    uint sum;
+    int numargs;
+    expression** args;
+    expression* result;
+    memoentry* next;
+    memoentry* newer;
+    memoentry* older;
+};
+
 #endif
 
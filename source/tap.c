@@ -0,0 +1,223 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   tap.c
+    @brief  The interface for embedding the interpreter in other programs; a context is created once and then used for any number of evaluations
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "tap.h"
+#include "engine.h"
+#include "constants.h"
+#include "constructors.h"
+#include "memory.h"
+#include "strings.h"
+#include "casting.h"
+#include "snapshot.h"
+#include "packages.h"
+
+static expression* evaluateText(char*, int);
+
+/*! Creates a new interpreter context with every primitive function and built-in type already defined
+    @return             the new context
+*/
+tap_context* tapCreate () {
+    return newContext(); // the primitive functions and built-in types are static so there's nothing to fill in
+}
+
+/*! Frees the given context along with everything defined in it
+    @param context      the context to free
+    @return             nothing
+*/
+void tapDestroy (tap_context* context) {
+    if (getContext() == context) { // don't leave the calling thread pointing at a freed context
+        setContext(NULL);
+    }
+    freeContext(context);
+}
+
+/*! Evaluates the given package file in the root environment of the given context so that the variables and functions it sets stay defined for every later evaluation
+    @param context      the context to load the package into
+    @param path         the path of the package file
+    @return             1 if the package was loaded without errors, 0 otherwise
+*/
+int tapLoadPackage (tap_context* context, const char* path) {
+    tap_context* previous = setContext(context);
+    clearErrors();
+    char* text = readPackage((char*)path);
+    if (text != NULL) {
+        freeExpr(evaluateText(text, 1));
+        free(text);
+    }
+    int loaded = context->errors == NULL;
+    setContext(previous);
+    return loaded;
+}
+
+/*! Saves what the packages loaded into the given context defined to a snapshot file, which tapRestoreSnapshot can restore much faster than the packages can be loaded again
+    @param context      the context to save
+    @param path         the path of the snapshot file
+    @return             1 if the snapshot was written, 0 otherwise
+*/
+int tapSaveSnapshot (tap_context* context, const char* path) {
+    tap_context* previous = setContext(context);
+    clearErrors();
+    int saved = saveSnapshot(context, (char*)path);
+    setContext(previous);
+    return saved;
+}
+
+/*! Restores a snapshot file written by tapSaveSnapshot into the given context in place of loading the packages it was made from
+    @param context      the context to restore into, which must not have loaded any packages yet
+    @param path         the path of the snapshot file
+    @return             1 if the snapshot was restored, 0 otherwise
+*/
+int tapRestoreSnapshot (tap_context* context, const char* path) {
+    tap_context* previous = setContext(context);
+    clearErrors();
+    int restored = restoreSnapshot(context, (char*)path);
+    setContext(previous);
+    return restored;
+}
+
+/*! Parses and evaluates the given string in the given context; the errors of any previous evaluation are discarded first
+    @param context      the context to evaluate in
+    @param text         the code to evaluate
+    @return             the result of the evaluation (nil if there were errors), which must be freed with tapFreeResult
+*/
+expression* tapEvalString (tap_context* context, const char* text) {
+    tap_context* previous = setContext(context);
+    clearErrors();
+    expression* result = evaluateText((char*)text, 0); // parsing only reads the text
+    setContext(previous);
+    return result;
+}
+
+/*! Parses and evaluates the given file in the given context; the errors of any previous evaluation are discarded first
+    @param context      the context to evaluate in
+    @param path         the path of the file to evaluate
+    @return             the result of the evaluation (nil if there were errors), which must be freed with tapFreeResult
+*/
+expression* tapEvalFile (tap_context* context, const char* path) {
+    tap_context* previous = setContext(context);
+    clearErrors();
+    expression* result;
+    char* text = readPackage((char*)path);
+    if (text != NULL) {
+        result = evaluateText(text, 0);
+        free(text);
+    } else {
+        result = newExpressionNil();
+    }
+    setContext(previous);
+    return result;
+}
+
+/*! Returns the given context to the state it was in after its packages were loaded by discarding its errors and any environments an interrupted evaluation left behind
+    @param context      the context to reset
+    @return             nothing
+*/
+void tapReset (tap_context* context) {
+    tap_context* previous = setContext(context);
+    while (context->cenvironment > 0) { // pop back to the root environment, which holds what the packages defined
+        resetEnvironment();
+    }
+    clearErrors();
+    setContext(previous);
+}
+
+/*! Returns whether or not the last evaluation in the given context generated any errors
+    @param context      the context to check
+    @return             1 if there were errors, 0 otherwise
+*/
+int tapFailed (tap_context* context) {
+    return context->errors != NULL;
+}
+
+/*! Prints the errors the last evaluation in the given context generated in a user friendly format
+    @param context      the context whose errors are printed
+    @return             a string representing the list of errors, which must be freed by the caller
+*/
+char* tapPrintErrors (tap_context* context) {
+    tap_context* previous = setContext(context);
+    char* errortext = printErrors();
+    setContext(previous);
+    return errortext;
+}
+
+/*! Returns the type of the given result
+    @param result       the result of an evaluation
+    @return             the type of the result
+*/
+datatype tapResultType (expression* result) {
+    return result->type;
+}
+
+/*! Returns the given result as an integer
+    @param result       the result of an evaluation
+    @return             the integer value of the result
+*/
+tap_int tapResultInt (expression* result) {
+    return castToInt(result);
+}
+
+/*! Returns the given result as a float
+    @param result       the result of an evaluation
+    @return             the float value of the result
+*/
+tap_flo tapResultFlo (expression* result) {
+    return castToFlo(result);
+}
+
+/*! Returns the given result as a string
+    @param result       the result of an evaluation
+    @return             the string value of the result, which must be freed by the caller, or null if the result can't be cast to a string
+*/
+char* tapResultStr (expression* result) {
+    string* str = castToStr(result);
+    if (str == NULL) {
+        return NULL;
+    }
+    return releaseString(str);
+}
+
+/*! Prints the given result the same way the tap program does
+    @param result       the result of an evaluation
+    @return             the printed result, which must be freed by the caller
+*/
+char* tapPrintResult (expression* result) {
+    return printExpression(result);
+}
+
+/*! Frees the given result of an evaluation
+    @param result       the result to free
+    @return             nothing
+*/
+void tapFreeResult (expression* result) {
+    freeExpr(result);
+}
+
+/*! Parses and evaluates the given text in the current context
+    @param text         the code to evaluate
+    @param inroot       1 if the top-level expressions should be evaluated in the root environment so that what they set persists, 0 if they get an environment of their own
+    @return             the result of the evaluation (nil if there were errors)
+*/
+static expression* evaluateText (char* text, int inroot) {
+    expression* parsed = parse(text);
+    expression* result = NULL;
+    if (tapFailed(getContext())) { // don't evaluate code that didn't parse
+        result = newExpressionNil();
+    } else if (inroot && parsed->type == TYPE_EXP) {
+        expression* head;
+        for (head = parsed; head != NULL; head = head->next) { // evaluate each expression like evaluateExp does, but without setting up a new environment
+            freeExpr(result);
+            result = evaluateArgument(head);
+        }
+    } else {
+        result = evaluate(parsed);
+    }
+    freeExpr(parsed);
+    return result;
+}
@@ -0,0 +1,51 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   tap.h
+    @brief  The header file for tap.c, the interface for embedding the interpreter in other programs
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#ifndef TAP_H
+#define TAP_H
+
+/* This header includes nothing and keeps the interpreter's structs opaque, so a program embedding the interpreter (in C or C++) only
+   sees the names below, each of which starts with tap. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct tap_context_ tap_context; // the state needed to interpret code independently of any other context
+typedef struct expression_ tap_expression; // the result of an evaluation, which must be freed with tapFreeResult
+typedef long tap_int;
+typedef double tap_flo;
+typedef unsigned int tap_type;
+
+// the types tapResultType returns (the same as the TYPE_ constants in constants.h)
+#define TAP_TYPE_NIL 1
+#define TAP_TYPE_INT 4
+#define TAP_TYPE_FLO 5
+#define TAP_TYPE_STR 6
+
+tap_context* tapCreate(void);
+void tapDestroy(tap_context*);
+int tapLoadPackage(tap_context*, const char*);
+int tapSaveSnapshot(tap_context*, const char*);
+int tapRestoreSnapshot(tap_context*, const char*);
+tap_expression* tapEvalString(tap_context*, const char*);
+tap_expression* tapEvalFile(tap_context*, const char*);
+void tapReset(tap_context*);
+int tapFailed(tap_context*);
+char* tapPrintErrors(tap_context*);
+tap_type tapResultType(tap_expression*);
+tap_int tapResultInt(tap_expression*);
+tap_flo tapResultFlo(tap_expression*);
+char* tapResultStr(tap_expression*);
+char* tapPrintResult(tap_expression*);
+void tapFreeResult(tap_expression*);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
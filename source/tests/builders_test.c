@@ -0,0 +1,115 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   builders_test.c
+    @brief  Tests for builders.c
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../../testing/cspec.h"
+#include "../../testing/cspec_output_unit.h"
+
+#include "../builders.h"
+#include "../tap.h"
+#include "../constants.h"
+#include "../constructors.h"
+#include "../memory.h"
+
+#define TEST_APPENDS 100000
+
+DESCRIBE(appendBuilder, "void appendBuilder (tap_bld* bld, char* text, uint size)")
+	tap_bld* bld;
+	string* str;
+	char buffer[8];
+	int i;
+
+	IT("Keeps the pieces few however many times it's appended to")
+		bld = newBuilder();
+		for (i = 0; i < TEST_APPENDS; ++i) {
+			appendBuilder(bld, i % 2 ? "def" : "abc", 3);
+		}
+		SHOULD_EQUAL(bld->size, TEST_APPENDS * 3)
+		SHOULD_BE_TRUE(bld->numpieces < 32)
+		freeBuilder(bld);
+	END_IT
+
+	IT("Finds characters and ranges across pieces")
+		bld = newBuilder();
+		for (i = 0; i < TEST_APPENDS; ++i) {
+			appendBuilder(bld, i % 2 ? "def" : "abc", 3);
+		}
+		SHOULD_EQUAL(builderChar(bld, 0), 'a')
+		SHOULD_EQUAL(builderChar(bld, 5), 'f')
+		SHOULD_EQUAL(builderChar(bld, TEST_APPENDS * 3 - 1), 'f')
+		int matched = 1;
+		int j;
+		for (i = 1; i < bld->numpieces; ++i) { // read across the start of every piece
+			uint start = bld->pieces[i].start - 3;
+			readBuilder(bld, start, 6, buffer);
+			for (j = 0; j < 6; ++j) {
+				matched &= buffer[j] == "abcdef"[(start + j) % 6];
+			}
+		}
+		SHOULD_EQUAL(matched, 1)
+		freeBuilder(bld);
+	END_IT
+
+	IT("Puts the pieces together into one string")
+		bld = newBuilder();
+		appendBuilder(bld, "ab", 2);
+		appendBuilder(bld, "", 0);
+		appendBuilder(bld, "cd", 2);
+		str = flattenBuilder(bld);
+		SHOULD_MATCH(str->content, "abcd")
+		SHOULD_EQUAL(str->size, 4)
+		freeStr(str);
+		freeBuilder(bld);
+	END_IT
+END_DESCRIBE
+
+DESCRIBE(prim_bAppend, "(+ bld *...)")
+	tap_context* context = tapCreate();
+	expression* result;
+	char* str;
+
+	IT("Appends to the builder every copy of it refers to")
+		result = tapEvalString(context, "(set \"b\" (str-builder \"\")) (+ b \"ab\" 12) (append b \"cd\") (str b)");
+		str = tapResultStr(result);
+		SHOULD_MATCH(str, "ab12cd")
+		free(str);
+		tapFreeResult(result);
+	END_IT
+
+	IT("Gives copies made with copy a string of their own")
+		result = tapEvalString(context, "(set \"b\" (str-builder \"x\")) (set \"c\" (copy b)) (+ c \"y\") (+ (str b) \"|\" (str c))");
+		str = tapResultStr(result);
+		SHOULD_MATCH(str, "x|xy")
+		free(str);
+		tapFreeResult(result);
+	END_IT
+
+	IT("Reads characters and substrings without putting the string together")
+		result = tapEvalString(context, "(set \"b\" (str-builder \"hello \")) (+ b \"world\") (substr b 4 7)");
+		str = tapResultStr(result);
+		SHOULD_MATCH(str, "o wo")
+		free(str);
+		tapFreeResult(result);
+		result = tapEvalString(context, "(set \"b\" (str-builder \"hello \")) (+ b \"world\") (char b 6)");
+		SHOULD_EQUAL(tapResultInt(result), 'w')
+		tapFreeResult(result);
+		result = tapEvalString(context, "(char (str-builder \"a\") 1)");
+		SHOULD_EQUAL(tapFailed(context), 1)
+		tapFreeResult(result);
+	END_IT
+	tapDestroy(context);
+END_DESCRIBE
+
+int main () {
+	CSpec_Run(DESCRIPTION(appendBuilder), CSpec_NewOutputUnit());
+	CSpec_Run(DESCRIPTION(prim_bAppend), CSpec_NewOutputUnit());
+
+	return 0;
+}
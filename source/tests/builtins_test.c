@@ -0,0 +1,113 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   builtins_test.c
+    @brief  Tests for builtins.c
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#include <stdlib.h>
+
+#include "../../testing/cspec.h"
+#include "../../testing/cspec_output_unit.h"
+
+#include "../builtins.h"
+#include "../constructors.h"
+#include "../constants.h"
+#include "../memory.h"
+#include "../strings.h"
+#include "../../primitives/prim_int.h"
+#include "../../primitives/prim_arr.h"
+#include "../../primitives/prim_bld.h"
+
+DESCRIBE(lookupPrimitives, "const tap_prim_fun* const* lookupPrimitives (char* name, int* count)")
+	int count;
+	const tap_prim_fun* const* prims;
+
+	IT("Returns every overload of a name, the last one listed first")
+		prims = lookupPrimitives("+", &count);
+		SHOULD_EQUAL(count, 5)
+		SHOULD_EQUAL(prims[0]->address, prim_bAppend)
+		SHOULD_EQUAL(prims[1]->address, prim_aConcat)
+		SHOULD_EQUAL(prims[4]->address, prim_iAdd)
+		SHOULD_EQUAL(prims[4]->kernel, KERNEL_INT)
+		SHOULD_EQUAL(prims[4]->types[0], TYPE_MASK(TYPE_INT))
+	END_IT
+
+	IT("Returns nothing for names that aren't primitive functions")
+		SHOULD_EQUAL(lookupPrimitives("no-such-function", &count), NULL)
+		SHOULD_EQUAL(count, 0)
+		SHOULD_EQUAL(lookupPrimitives("pi", &count), NULL)
+		SHOULD_EQUAL(count, 0)
+	END_IT
+END_DESCRIBE
+
+DESCRIBE(builtinConstant, "expression* builtinConstant (char* name)")
+	expression* expr;
+
+	IT("Returns a new expression holding the constant")
+		expr = builtinConstant("true");
+		SHOULD_EQUAL(expr->type, TYPE_INT)
+		SHOULD_EQUAL(expr->ev.intval, 1)
+		freeExpr(expr);
+		expr = builtinConstant("pi");
+		SHOULD_EQUAL(expr->type, TYPE_FLO)
+		SHOULD_EQUAL(expr->ev.floval, PI)
+		freeExpr(expr);
+	END_IT
+
+	IT("Returns the last constant listed with a name")
+		expr = builtinConstant("nil");
+		SHOULD_EQUAL(expr->type, TYPE_TYP)
+		SHOULD_EQUAL(expr->ev.intval, TYPE_NIL)
+		freeExpr(expr);
+	END_IT
+
+	IT("Returns null for names that aren't constants")
+		SHOULD_EQUAL(builtinConstant("+"), NULL)
+		SHOULD_EQUAL(builtinConstant("no-such-constant"), NULL)
+	END_IT
+END_DESCRIBE
+
+DESCRIBE(builtinType, "datatype builtinType (char* name)")
+	IT("Returns the type with the given name")
+		SHOULD_EQUAL(builtinType("int"), TYPE_INT)
+		SHOULD_EQUAL(builtinType("lazy-expression"), TYPE_LAZ)
+		SHOULD_EQUAL(builtinType("nil"), TYPE_NIL)
+	END_IT
+
+	IT("Returns TYPE_UNK for names that aren't types")
+		SHOULD_EQUAL(builtinType("pi"), TYPE_UNK)
+		SHOULD_EQUAL(builtinType("no-such-type"), TYPE_UNK)
+	END_IT
+END_DESCRIBE
+
+DESCRIBE(primitiveAccepts, "int primitiveAccepts (const tap_prim_fun* prim_fun, expression* args[], int numargs)")
+	tap_prim_fun* prim = newPrimFunction(&prim_iAdd, 2, 3, newTypelistWithNext(TYPE_INT, newTypelist(TYPE_UNK)));
+	expression* args[3];
+	args[0] = newExpressionInt(1);
+	args[1] = newExpressionFlo(2.0);
+	args[2] = newExpressionFlo(3.0);
+
+	IT("Checks the type of each required argument")
+		SHOULD_EQUAL(primitiveAccepts(prim, args, 2), 1)
+		SHOULD_EQUAL(primitiveAccepts(prim, args + 1, 2), 0)
+	END_IT
+
+	IT("Checks the number of arguments")
+		SHOULD_EQUAL(primitiveAccepts(prim, args, 1), 0)
+		SHOULD_EQUAL(primitiveAccepts(prim, args, 3), 1)
+	END_IT
+	freeExpr(args[0]);
+	freeExpr(args[1]);
+	freeExpr(args[2]);
+	freePrimFun(prim);
+END_DESCRIBE
+
+int main () {
+	CSpec_Run(DESCRIPTION(lookupPrimitives), CSpec_NewOutputUnit());
+	CSpec_Run(DESCRIPTION(builtinConstant), CSpec_NewOutputUnit());
+	CSpec_Run(DESCRIPTION(builtinType), CSpec_NewOutputUnit());
+	CSpec_Run(DESCRIPTION(primitiveAccepts), CSpec_NewOutputUnit());
+
+	return 0;
+}
@@ -221,7 +221,7 @@ DESCRIBE(castToStr, "string* castToStr (expression* expr)")
 	IT("casts floats into their string equivalents")
 		expr = newExpressionFlo(22.0);
 		result = castToStr(expr);
-		SHOULD_EQUAL(strcmp(result->content, "22.000000"), 0)
+		SHOULD_EQUAL(strcmp(result->content, "22.0"), 0)
 		freeStr(result);
 		freeExpr(expr);
 	END_IT
@@ -237,7 +237,7 @@ DESCRIBE(castToStr, "string* castToStr (expression* expr)")
 	END_IT
 END_DESCRIBE
 
-DESCRIBE(castToStrWithBase, "string* castToStrWithBase (int intval, uint base)")
+DESCRIBE(castToStrWithBase, "string* castToStrWithBase (tap_int intval, uint base)")
 	string* result;
 	
 	IT("casts base 10 integers into strings")
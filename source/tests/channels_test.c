@@ -0,0 +1,89 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   channels_test.c
+    @brief  Tests for channels.c
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../../testing/cspec.h"
+#include "../../testing/cspec_output_unit.h"
+
+#include "../channels.h"
+#include "../tap.h"
+#include "../constants.h"
+#include "../constructors.h"
+#include "../memory.h"
+#include "../workers.h"
+
+#define PRODUCER "(set \"produce\" (function [c (int i) (int n)] [(if (> i n) (close c) (if (send c i) (produce c (+ i 1) n) 0))])) "
+#define CONSUMER "(set \"drainfrom\" (function [c (int total) (int v)] [(if (< v 0) total (drainfrom c (+ total v) (receive c -1)))])) (set \"drain\" (function [c] [(drainfrom c 0 (receive c -1))])) "
+
+DESCRIBE(sendChannel, "int sendChannel (tap_chn* chn, expression* value)")
+	tap_chn* chn;
+	expression* value;
+
+	IT("Receives the values in the order they were sent")
+		chn = newChannel(3);
+		SHOULD_EQUAL(sendChannel(chn, newExpressionInt(1)), 1)
+		SHOULD_EQUAL(sendChannel(chn, newExpressionInt(2)), 1)
+		SHOULD_EQUAL(channelCount(chn), 2)
+		value = receiveChannel(chn);
+		SHOULD_EQUAL(value->ev.intval, 1)
+		freeExpr(value);
+		value = receiveChannel(chn);
+		SHOULD_EQUAL(value->ev.intval, 2)
+		freeExpr(value);
+		SHOULD_EQUAL(channelCount(chn), 0)
+		freeChannel(chn);
+	END_IT
+
+	IT("Keeps the values sent before closing but refuses new ones")
+		chn = newChannel(1);
+		SHOULD_EQUAL(sendChannel(chn, newExpressionInt(5)), 1)
+		closeChannel(chn);
+		value = newExpressionInt(6);
+		SHOULD_EQUAL(sendChannel(chn, value), 0)
+		freeExpr(value);
+		value = receiveChannel(chn);
+		SHOULD_EQUAL(value->ev.intval, 5)
+		freeExpr(value);
+		SHOULD_BE_NULL(receiveChannel(chn))
+		freeChannel(chn);
+	END_IT
+END_DESCRIBE
+
+DESCRIBE(prim_cSend, "(send chn *)")
+	tap_context* context = tapCreate();
+	expression* result;
+
+	IT("Passes values from a spawned producer to the calling context")
+		result = tapEvalString(context, PRODUCER CONSUMER "(set \"c\" (channel 1)) (set \"p\" (spawn [(produce c 1 20)])) (drain c)");
+		SHOULD_EQUAL(tapResultInt(result), 210)
+		tapFreeResult(result);
+	END_IT
+
+	IT("Shares the values between several spawned consumers")
+		result = tapEvalString(context, PRODUCER CONSUMER "(set \"c\" (channel 2)) (set \"a\" (spawn [(drain c)])) (set \"b\" (spawn [(drain c)])) (set \"d\" (spawn [(drain c)])) (set \"p\" (spawn [(produce c 1 20)])) (+ (await a) (await b) (await d))");
+		SHOULD_EQUAL(tapResultInt(result), 210)
+		tapFreeResult(result);
+	END_IT
+
+	IT("Returns the default once the channel is closed and empty")
+		result = tapEvalString(context, "(set \"c\" (channel 4)) (send c 3) (close c) (+ (send c 4) (receive c 0) (receive c 10))");
+		SHOULD_EQUAL(tapResultInt(result), 13)
+		tapFreeResult(result);
+	END_IT
+	tapDestroy(context);
+END_DESCRIBE
+
+int main () {
+	setenv(WORKER_COUNT_VARIABLE, "4", 1); // use the pool however many processors the machine running the tests has
+	CSpec_Run(DESCRIPTION(sendChannel), CSpec_NewOutputUnit());
+	CSpec_Run(DESCRIPTION(prim_cSend), CSpec_NewOutputUnit());
+
+	return 0;
+}
@@ -167,10 +167,27 @@ DESCRIBE(newLazyExpression, "tap_laz* newLazyExpression ()")
 		tap_laz* laz = newLazyExpression();
 		SHOULD_EQUAL(laz->expval, NULL)
 		SHOULD_EQUAL(laz->refs, NULL)
+		SHOULD_EQUAL(laz->value, NULL)
 		freeLaz(laz);
 	END_IT
 END_DESCRIBE
 
+DESCRIBE(copyLazyExpression, "tap_laz* copyLazyExpression (tap_laz* lazy)")
+	IT("Copies the given lazy expression without its cached result")
+		expression* orig = newExpressionLaz(newExpressionInt(3));
+		orig->ev.lazval->value = newExpressionInt(3);
+		expression* shared = copyExpression(orig);
+		SHOULD_EQUAL(shared->ev.lazval, orig->ev.lazval)
+		tap_laz* laz = copyLazyExpression(orig->ev.lazval);
+		SHOULD_NOT_EQUAL(laz, orig->ev.lazval)
+		SHOULD_EQUAL(laz->expval->ev.intval, 3)
+		SHOULD_EQUAL(laz->value, NULL)
+		freeLaz(laz);
+		freeExpr(shared);
+		freeExpr(orig);
+	END_IT
+END_DESCRIBE
+
 DESCRIBE(newString, "string* newString (char* content)")
 	IT("Creates a new string expression with the correct content and size")
 		string* str = newString(strDup("testing"));
@@ -180,6 +197,55 @@ DESCRIBE(newString, "string* newString (char* content)")
 	END_IT
 END_DESCRIBE
 
+DESCRIBE(newStringCopy, "string* newStringCopy (char* content, int size)")
+	IT("Keeps a short string in the same allocation as the struct and a long one in its own")
+		string* str1 = newStringCopy("key", 3);
+		SHOULD_EQUAL(strcmp(str1->content, "key"), 0)
+		SHOULD_EQUAL(str1->size, 3)
+		SHOULD_EQUAL(str1->content == str1->text, 1)
+		freeStr(str1);
+		string* str2 = newStringCopy("a much longer string than the short ones", 40);
+		SHOULD_EQUAL(strcmp(str2->content, "a much longer string than the short ones"), 0)
+		SHOULD_EQUAL(str2->content == str2->text, 0)
+		freeStr(str2);
+	END_IT
+	IT("Copies null characters along with the rest of the text")
+		string* str = newStringCopy("a\0b", 3);
+		SHOULD_EQUAL(str->size, 3)
+		SHOULD_EQUAL(str->content[2], 'b')
+		SHOULD_EQUAL(str->content[3], '\0')
+		freeStr(str);
+	END_IT
+END_DESCRIBE
+
+DESCRIBE(newStringSlice, "string* newStringSlice (string* str, int start, int size)")
+	IT("Shares the content of the string it's a slice of until both are freed")
+		string* str = newStringCopy("the quick brown fox jumps over the lazy dog", 43);
+		string* slice1 = newStringSlice(str, 4, 30);
+		string* slice2 = newStringSlice(slice1, 6, 20);
+		SHOULD_EQUAL(slice1->content, str->content + 4)
+		SHOULD_EQUAL(slice2->content, str->content + 10)
+		SHOULD_EQUAL(slice2->parent, str)
+		SHOULD_EQUAL(str->owners, 3)
+		freeStr(str);
+		SHOULD_EQUAL(strncmp(slice1->content, "quick brown fox jumps over the", 30), 0)
+		SHOULD_EQUAL(strcmp(stringContent(slice1), "quick brown fox jumps over the"), 0)
+		SHOULD_EQUAL(slice1->parent, NULL)
+		freeStr(slice1);
+		SHOULD_EQUAL(strcmp(stringContent(slice2), "brown fox jumps over"), 0)
+		freeStr(slice2);
+	END_IT
+	IT("Copies a short range instead of sharing it")
+		string* str = newStringCopy("the quick brown fox jumps over the lazy dog", 43);
+		string* slice = newStringSlice(str, 4, 5);
+		SHOULD_EQUAL(slice->parent, NULL)
+		SHOULD_EQUAL(strcmp(slice->content, "quick"), 0)
+		SHOULD_EQUAL(str->owners, 1)
+		freeStr(slice);
+		freeStr(str);
+	END_IT
+END_DESCRIBE
+
 DESCRIBE(newArray, "array* newArray (int size)")
 	IT("Creates a new array expression with the correct size")
 		array* arr = newArray(5);
@@ -456,7 +522,8 @@ DESCRIBE(newPrimFunction, "tap_prim_fun* newPrimFunction (void(*address)(express
 		SHOULD_EQUAL(fun->address, prim_iAdd)
 		SHOULD_EQUAL(fun->minargs, 1)
 		SHOULD_EQUAL(fun->maxargs, ARGLEN_INF)
-		SHOULD_EQUAL(fun->types->type, TYPE_INT)
+		SHOULD_EQUAL(fun->types[0], TYPE_MASK(TYPE_INT))
+		SHOULD_EQUAL(fun->types[1], 0)
 		freePrimFun(fun);
 	END_IT
 END_DESCRIBE
@@ -515,7 +582,10 @@ int main () {
 	CSpec_Run(DESCRIPTION(copyExpression), CSpec_NewOutputUnit());
 	CSpec_Run(DESCRIPTION(copyExpressionNR), CSpec_NewOutputUnit());
 	CSpec_Run(DESCRIPTION(newLazyExpression), CSpec_NewOutputUnit());
+	CSpec_Run(DESCRIPTION(copyLazyExpression), CSpec_NewOutputUnit());
 	CSpec_Run(DESCRIPTION(newString), CSpec_NewOutputUnit());
+	CSpec_Run(DESCRIPTION(newStringCopy), CSpec_NewOutputUnit());
+	CSpec_Run(DESCRIPTION(newStringSlice), CSpec_NewOutputUnit());
 	CSpec_Run(DESCRIPTION(newArray), CSpec_NewOutputUnit());
 	CSpec_Run(DESCRIPTION(copyArray), CSpec_NewOutputUnit());
 	CSpec_Run(DESCRIPTION(copyArrayDeep), CSpec_NewOutputUnit());
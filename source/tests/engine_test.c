@@ -6,6 +6,7 @@
 */
 
 #include <stdlib.h>
+#include <stdio.h>
 #include <string.h>
 
 #include "../../testing/cspec.h"
@@ -15,8 +16,12 @@
 #include "../constants.h"
 #include "../constructors.h"
 #include "../strings.h"
+#include "../memory.h"
+#include "../externs.h"
+#include "../tap.h"
+#include "../../primitives/prim_int.h"
 
-extern errorlist* cerror;
+#define TEST_PACKAGE "./engine_test_package.tap"
 
 DESCRIBE(parse, "expression* parse (char* text)")
 	expression* result;
@@ -161,19 +166,19 @@ DESCRIBE(parse, "expression* parse (char* text)")
 		initializeGlobals();
 		result = parse("(");
 		SHOULD_EQUAL(result->type, TYPE_NIL)
-		SHOULD_EQUAL(cerror->code, ERR_UNCLOSED_PAREN)
+		SHOULD_EQUAL(ccontext->cerror->code, ERR_UNCLOSED_PAREN)
 		freeExpr(result);
 		result = parse(")");
 		SHOULD_EQUAL(result->type, TYPE_NIL)
-		SHOULD_EQUAL(cerror->code, ERR_UNMATCHED_PAREN)
+		SHOULD_EQUAL(ccontext->cerror->code, ERR_UNMATCHED_PAREN)
 		freeExpr(result);
 		result = parse("()");
 		SHOULD_EQUAL(result->type, TYPE_NIL)
-		SHOULD_EQUAL(cerror->code, ERR_INVALID_NUM_ARGS)
+		SHOULD_EQUAL(ccontext->cerror->code, ERR_INVALID_NUM_ARGS)
 		freeExpr(result);
 		result = parse("(\"x )");
 		SHOULD_EQUAL(result->type, TYPE_NIL)
-		SHOULD_EQUAL(cerror->code, ERR_UNCLOSED_STR_LIT)
+		SHOULD_EQUAL(ccontext->cerror->code, ERR_UNCLOSED_STR_LIT)
 		freeExpr(result);
 		freeGlobals();
 	END_IT
@@ -364,6 +369,85 @@ DESCRIBE(evaluateFun, "expression* evaluateFun (expression* head)")
 	END_IT
 END_DESCRIBE
 
+DESCRIBE(specialForm, "int specialForm (expression* head)")
+	IT("Recognizes if, && and || but not other functions")
+		initializeGlobals();
+		expression* expr1 = newExpressionStr(newString(strDup("if")));
+		SHOULD_EQUAL(specialForm(expr1), SFORM_IF)
+		freeExpr(expr1);
+		expr1 = newExpressionStr(newString(strDup("&&")));
+		SHOULD_EQUAL(specialForm(expr1), SFORM_AND)
+		freeExpr(expr1);
+		expr1 = newExpressionStr(newString(strDup("||")));
+		SHOULD_EQUAL(specialForm(expr1), SFORM_OR)
+		freeExpr(expr1);
+		expr1 = newExpressionStr(newString(strDup("+")));
+		SHOULD_EQUAL(specialForm(expr1), SFORM_NONE)
+		freeExpr(expr1);
+		freeGlobals();
+	END_IT
+END_DESCRIBE
+
+DESCRIBE(evaluateSpecialForm, "expression* evaluateSpecialForm (int form, expression* head)")
+	tap_context* context = tapCreate();
+	expression* result;
+	char* str;
+
+	IT("Returns the value of the chosen branch, whether it's a variable, a literal or an expression")
+		result = tapEvalString(context, "(set \"x\" 1) (set \"half\" (function [(int n)] [(if (< n 2) [n] [(/ n 2)])])) (+ (str (if 1 [x] [7])) (str (if 0 [x] [7])) (str (if 0 [x] 0 [8] [(+ x 8)])) (str (half 1)) (str (half 8)))");
+		str = tapResultStr(result);
+		SHOULD_MATCH(str, "17914")
+		free(str);
+		tapFreeResult(result);
+	END_IT
+
+	IT("Never evaluates the branches and conditions it doesn't need")
+		result = tapEvalString(context, "(set \"n\" 0) (if 1 [5] [(set \"n\" 1)]) (if 0 [(set \"n\" 2)] [5]) (&& 0 [(set \"n\" 3)]) (|| 1 [(set \"n\" 4)]) (+ n (if 1 0 [(undefined-function)]))");
+		SHOULD_EQUAL(tapResultInt(result), 0)
+		SHOULD_EQUAL(tapFailed(context), 0)
+		tapFreeResult(result);
+	END_IT
+
+	IT("Gives way to a user definition of its name, even one an imported package hasn't defined yet")
+		FILE* file = fopen(TEST_PACKAGE, "w");
+		fputs("(set \"||\" (function [(int a) (int b)] [(+ a b 10)]))", file);
+		fclose(file);
+		result = tapEvalString(context, "(import \"" TEST_PACKAGE "\") (|| 1 2)");
+		SHOULD_EQUAL(tapResultInt(result), 13)
+		tapFreeResult(result);
+		result = tapEvalString(context, "(|| 1 2)");
+		SHOULD_EQUAL(tapResultInt(result), 13)
+		tapFreeResult(result);
+		remove(TEST_PACKAGE);
+	END_IT
+	tapDestroy(context);
+END_DESCRIBE
+
+DESCRIBE(evaluateBody, "expression* evaluateBody (expression* head)")
+	tap_context* context = tapCreate();
+	expression* result;
+
+	IT("Sets variables where the loop was called")
+		result = tapEvalString(context, "(set \"s\" 0) (for-range \"i\" 1 5 [(set \"s\" (+ s i))]) (set \"n\" 0) (while [(< n 5)] [(set \"n\" (+ n 1))]) (set \"r\" 0) (repeat 4 [(set \"r\" (+ r 2))]) (+ (* s 100) (* n 10) r)");
+		SHOULD_EQUAL(tapResultInt(result), 1058)
+		tapFreeResult(result);
+		result = tapEvalString(context, "(set \"t\" 0) (repeat 3 [(for-range \"i\" 0 3 [(set \"t\" (+ t i))])]) (+ t 0)");
+		SHOULD_EQUAL(tapResultInt(result), 9)
+		tapFreeResult(result);
+	END_IT
+
+	IT("Keeps the loop variable to the loop but lets the body change it")
+		result = tapEvalString(context, "(set \"s\" 0) (for-range \"i\" 0 10 [(set \"s\" (+ s i)) (set \"i\" (+ i 1))]) (+ s 0)");
+		SHOULD_EQUAL(tapResultInt(result), 20)
+		SHOULD_EQUAL(tapFailed(context), 0)
+		tapFreeResult(result);
+		result = tapEvalString(context, "(for-range \"j\" 0 3 [j]) (+ j 0)");
+		SHOULD_EQUAL(tapFailed(context), 1)
+		tapFreeResult(result);
+	END_IT
+	tapDestroy(context);
+END_DESCRIBE
+
 DESCRIBE(numArgs, "int numArgs (expression* head)")
 	IT("Returns the number of arguments in the list of expressions")
 		int numargs = numArgs(NULL);
@@ -452,6 +536,25 @@ DESCRIBE(callPrimFun, "expression* callPrimFun (tap_prim_fun* prim_fun, expressi
 	END_IT
 END_DESCRIBE
 
+DESCRIBE(callPrimKernel, "expression* callPrimKernel (tap_prim_fun* prim_fun, expression* args[], int numargs)")
+	IT("Calls the fast-call kernel only when every argument has its operand type")
+		tap_prim_fun* prim = setIntKernel(newPrimFunction(&prim_iAdd, 1, ARGLEN_INF, newTypelist(TYPE_INT)), &fast_iAdd);
+		expression* args[3];
+		args[0] = newExpressionInt(1);
+		args[1] = newExpressionInt(2);
+		args[2] = newExpressionInt(3);
+		expression* result = callPrimKernel(prim, args, 3);
+		SHOULD_EQUAL(result->type, TYPE_INT)
+		SHOULD_EQUAL(result->ev.intval, 6)
+		freeExpr(result);
+		freeExpr(args[2]);
+		args[2] = newExpressionFlo(3.0);
+		SHOULD_EQUAL(callPrimKernel(prim, args, 3), NULL)
+		freeArgs(args, 3);
+		freePrimFun(prim);
+	END_IT
+END_DESCRIBE
+
 DESCRIBE(validFunCall, "int validFunCall (tap_fun* fun, expression* head, expression* args[], int numargs)")
 	IT("")
 		
@@ -595,6 +698,35 @@ DESCRIBE(freeGlobals, "void freeGlobals ()")
 	END_IT
 END_DESCRIBE
 
+DESCRIBE(setContext, "tap_context* setContext (tap_context* context)")
+	tap_context* context1 = newContext();
+	tap_context* context2 = newContext();
+	expression* parsed;
+	expression* result;
+	
+	IT("Keeps the variables and errors of separate contexts apart")
+		SHOULD_EQUAL(setContext(context1), NULL)
+		parsed = parse("(set \"x\" 5)");
+		freeExpr(evaluate(parsed));
+		freeExpr(parsed);
+		parsed = parse("(");
+		freeExpr(parsed);
+		SHOULD_NOT_EQUAL(context1->errors, NULL)
+		SHOULD_EQUAL(setContext(context2), context1)
+		SHOULD_EQUAL(getContext(), context2)
+		SHOULD_EQUAL(context2->errors, NULL)
+		parsed = parse("(+ 1 2)");
+		result = evaluate(parsed);
+		SHOULD_EQUAL(result->ev.intval, 3)
+		freeExpr(result);
+		freeExpr(parsed);
+		SHOULD_EQUAL(context2->cenvironment, 0)
+		setContext(NULL);
+	END_IT
+	freeContext(context1);
+	freeContext(context2);
+END_DESCRIBE
+
 int main () {
 	/*CSpec_Run(DESCRIPTION(parse), CSpec_NewOutputUnit());
 	CSpec_Run(DESCRIPTION(parsePiece), CSpec_NewOutputUnit());
@@ -608,14 +740,19 @@ int main () {
 	CSpec_Run(DESCRIPTION(evaluateInt), CSpec_NewOutputUnit());
 	CSpec_Run(DESCRIPTION(evaluateFlo), CSpec_NewOutputUnit());*/
 	CSpec_Run(DESCRIPTION(evaluateFun), CSpec_NewOutputUnit());
+	CSpec_Run(DESCRIPTION(specialForm), CSpec_NewOutputUnit());
+	CSpec_Run(DESCRIPTION(evaluateSpecialForm), CSpec_NewOutputUnit());
+	CSpec_Run(DESCRIPTION(evaluateBody), CSpec_NewOutputUnit());
 	CSpec_Run(DESCRIPTION(numArgs), CSpec_NewOutputUnit());
 	CSpec_Run(DESCRIPTION(fillArgs), CSpec_NewOutputUnit());
 	CSpec_Run(DESCRIPTION(freeArgs), CSpec_NewOutputUnit());
 	CSpec_Run(DESCRIPTION(findFunction), CSpec_NewOutputUnit());
 	CSpec_Run(DESCRIPTION(callFun), CSpec_NewOutputUnit());
 	CSpec_Run(DESCRIPTION(callPrimFun), CSpec_NewOutputUnit());
+	CSpec_Run(DESCRIPTION(callPrimKernel), CSpec_NewOutputUnit());
 	CSpec_Run(DESCRIPTION(validFunCall), CSpec_NewOutputUnit());
 	CSpec_Run(DESCRIPTION(callTapFun), CSpec_NewOutputUnit());
+	CSpec_Run(DESCRIPTION(setContext), CSpec_NewOutputUnit());
 	/*CSpec_Run(DESCRIPTION(evaluateArr), CSpec_NewOutputUnit());
 	CSpec_Run(DESCRIPTION(evaluateDat), CSpec_NewOutputUnit());
 	CSpec_Run(DESCRIPTION(evaluateObj), CSpec_NewOutputUnit());
@@ -0,0 +1,145 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   formats_test.c
+    @brief  Tests for formats.c
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../../testing/cspec.h"
+#include "../../testing/cspec_output_unit.h"
+
+#include "../formats.h"
+#include "../constructors.h"
+#include "../memory.h"
+#include "../strings.h"
+#include "../tap.h"
+#include "../constants.h"
+
+#define TEST_FIELDS 100
+
+/*! Compiles the given null terminated template and fills it in with the given arguments
+    @return             the null terminated result, which must be freed, or the error if the template can't be compiled or doesn't suit the arguments
+*/
+static char* apply (char* template, expression* args[], int numargs) {
+    char* error;
+    tap_fmt* fmt = newFormat(template, strlen(template), &error);
+    if (fmt == NULL) {
+        return strdup(error);
+    }
+    string* result = applyFormat(fmt, args, numargs, &error);
+    freeFormat(fmt);
+    if (result == NULL) {
+        return strdup(error);
+    }
+    char* text = strndup(result->content, result->size);
+    freeStr(result);
+    return text;
+}
+
+DESCRIBE(applyFormat, "string* applyFormat (tap_fmt* fmt, expression* args[], int numargs, char** error)")
+	expression* args[TEST_FIELDS];
+	char* str;
+
+	IT("Writes each field as its conversion, width and alignment say")
+		args[0] = newExpressionInt(-42);
+		args[1] = newExpressionFlo(3.14159);
+		args[2] = newExpressionStr(newString(strDup("abcdef")));
+		args[3] = newExpressionInt(255);
+		str = apply("{0}|{0:6}|{0:<6}|{0:06}|{}|{1:.2f}|{1:+>9.3}|{0:+=9}", args, 2);
+		SHOULD_MATCH(str, "-42|   -42|-42   |-00042|3.14159|3.14|++++3.142|-++++++42")
+		free(str);
+		str = apply("{2:.3s}|{2:*^10}|{3:x}|{3:X}|{3:o}|{3:b}|{3:#>5d}|{1:d}", args, 4);
+		SHOULD_MATCH(str, "abc|**abcdef**|ff|FF|377|11111111|##255|3")
+		free(str);
+		freeExpr(args[0]);
+		freeExpr(args[1]);
+		freeExpr(args[2]);
+		freeExpr(args[3]);
+	END_IT
+
+	IT("Writes doubled braces as themselves and numbered fields in any order")
+		args[0] = newExpressionInt(1);
+		args[1] = newExpressionInt(2);
+		str = apply("{{{1}}}{0}{}{{", args, 2);
+		SHOULD_MATCH(str, "{2}12{")
+		free(str);
+		freeExpr(args[0]);
+		freeExpr(args[1]);
+	END_IT
+
+	IT("Fills in more fields and longer numbers than it keeps room for without allocating")
+		int i;
+		char expected[TEST_FIELDS * 32];
+		char* end = expected;
+		for (i = 0; i < TEST_FIELDS; ++i) {
+			args[i] = newExpressionFlo(i * 1e15);
+			end += sprintf(end, "%.2f,", i * 1e15);
+		}
+		char template[TEST_FIELDS * 8];
+		end = template;
+		for (i = 0; i < TEST_FIELDS; ++i) {
+			end += sprintf(end, "{:.2f},");
+		}
+		str = apply(template, args, TEST_FIELDS);
+		SHOULD_MATCH(str, expected)
+		free(str);
+		for (i = 0; i < TEST_FIELDS; ++i) {
+			freeExpr(args[i]);
+		}
+	END_IT
+
+	IT("Rejects templates that don't compile and arguments that don't suit them")
+		args[0] = newExpressionStr(newString(strDup("a")));
+		str = apply("{", args, 1);
+		SHOULD_MATCH(str, "unclosed brace")
+		free(str);
+		str = apply("a}", args, 1);
+		SHOULD_MATCH(str, "unmatched closing brace")
+		free(str);
+		str = apply("{:.}", args, 1);
+		SHOULD_MATCH(str, "missing precision")
+		free(str);
+		str = apply("{:q}", args, 1);
+		SHOULD_MATCH(str, "invalid field")
+		free(str);
+		str = apply("{1}", args, 1);
+		SHOULD_MATCH(str, "too few arguments for its fields")
+		free(str);
+		str = apply("{:d}", args, 1);
+		SHOULD_MATCH(str, "an argument doesn't suit its field's conversion")
+		free(str);
+		freeExpr(args[0]);
+	END_IT
+END_DESCRIBE
+
+DESCRIBE(prim_sFormat, "(format fmt/str ...)")
+	tap_context* context = tapCreate();
+	expression* result;
+	char* str;
+
+	IT("Fills in a template or a compiled format")
+		result = tapEvalString(context, "(set \"line\" (formatter \"{:<5}|{:>4d}|{:.1f}\")) (+ (format line \"ab\" 7 2.25) \"/\" (format \"{} {}\" 1.5 \"x\") \"/\" (str line) \"/\" (str (type line)))");
+		str = tapResultStr(result);
+		SHOULD_MATCH(str, "ab   |   7|2.2/1.5 x/{:<5}|{:>4d}|{:.1f}/::format")
+		free(str);
+		tapFreeResult(result);
+	END_IT
+
+	IT("Reports a template that doesn't compile")
+		result = tapEvalString(context, "(format \"{0\" 1)");
+		SHOULD_EQUAL(tapFailed(context), 1)
+		tapFreeResult(result);
+	END_IT
+	tapDestroy(context);
+END_DESCRIBE
+
+int main () {
+	CSpec_Run(DESCRIPTION(applyFormat), CSpec_NewOutputUnit());
+	CSpec_Run(DESCRIPTION(prim_sFormat), CSpec_NewOutputUnit());
+
+	return 0;
+}
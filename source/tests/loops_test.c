@@ -0,0 +1,93 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   loops_test.c
+    @brief  Tests for loops.c
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "../../testing/cspec.h"
+#include "../../testing/cspec_output_unit.h"
+
+#include "../loops.h"
+#include "../tap.h"
+
+DESCRIBE(runLoopBody, "void runLoopBody (loopbody* loop)")
+	tap_context* context = tapCreate();
+	tap_expression* result;
+
+	IT("Reads and sets the variables where the loop was called")
+		result = tapEvalString(context, "(set \"s\" 0) (for-range \"i\" 0 1000 [(set \"s\" (+ s i))]) (+ s 0)");
+		SHOULD_EQUAL(tapResultInt(result), 499500)
+		tapFreeResult(result);
+		result = tapEvalString(context, "(set \"n\" 0) (set \"m\" 0) (while [(< n 3)] [(set \"n\" (+ n 1)) (set \"m\" (+ m n))]) (+ (* m 10) n)");
+		SHOULD_EQUAL(tapResultInt(result), 63)
+		SHOULD_EQUAL(tapFailed(context), 0)
+		tapFreeResult(result);
+	END_IT
+
+	IT("Chooses the primitive again when the type of a value changes")
+		result = tapEvalString(context, "(set \"x\" 1) (repeat 2 [(set \"x\" (+ 0.5 x))]) (+ x 0.0)");
+		SHOULD_EQUAL(tapResultFlo(result), 2.0)
+		tapFreeResult(result);
+		result = tapEvalString(context, "(set \"x\" 0.0) (while [(< x 2.5)] [(set \"x\" (+ x 1.0))]) (+ x 0.0)");
+		SHOULD_EQUAL(tapResultFlo(result), 3.0)
+		SHOULD_EQUAL(tapFailed(context), 0)
+		tapFreeResult(result);
+	END_IT
+
+	IT("Sees a name the body binds anew on the passes after it's bound")
+		result = tapEvalString(context, "(set \"k\" 0.0) (repeat 2 [(set \"k\" (+ k pi)) (set \"pi\" 1.0)]) (+ k 0.0)");
+		SHOULD_BE_TRUE(fabs(tapResultFlo(result) - 4.141592653589793) < 1e-9)
+		tapFreeResult(result);
+		result = tapEvalString(context, "(set \"n\" 0) (while [(< n 2)] [(set \"n\" (+ n 1)) (set \"late\" n)]) (+ late n)");
+		SHOULD_EQUAL(tapResultInt(result), 4)
+		SHOULD_EQUAL(tapFailed(context), 0)
+		tapFreeResult(result);
+	END_IT
+
+	IT("Reports an undefined variable on every pass")
+		result = tapEvalString(context, "(repeat 2 [nope])");
+		char* errors = tapPrintErrors(context);
+		SHOULD_BE_TRUE(strstr(errors, "Error 1:") != NULL)
+		SHOULD_BE_TRUE(strstr(errors, "Error 2:") == NULL)
+		free(errors);
+		tapFreeResult(result);
+	END_IT
+	tapDestroy(context);
+END_DESCRIBE
+
+DESCRIBE(loopBodyResult, "expression* loopBodyResult (loopbody* loop)")
+	tap_context* context = tapCreate();
+	tap_expression* result;
+
+	IT("Gives way to a user definition of a primitive's name once the body defines it")
+		result = tapEvalString(context, "(set \"r\" 1) (repeat 2 [(set \"r\" (+ r 3)) (set \"+\" (function [(int a) (int b)] [(* a b)]))]) (- r 0)");
+		SHOULD_EQUAL(tapResultInt(result), 12)
+		SHOULD_EQUAL(tapFailed(context), 0)
+		tapFreeResult(result);
+	END_IT
+
+	IT("Returns the result of the body's last pass, or nil if it never ran")
+		result = tapEvalString(context, "(repeat 3 [\"a\" (+ \"b\" \"c\")])");
+		SHOULD_EQUAL(tapResultType(result), TAP_TYPE_STR)
+		char* text = tapResultStr(result);
+		SHOULD_EQUAL(strcmp(text, "bc"), 0)
+		free(text);
+		tapFreeResult(result);
+		result = tapEvalString(context, "(repeat 0 [1])");
+		SHOULD_EQUAL(tapResultType(result), TAP_TYPE_NIL)
+		tapFreeResult(result);
+	END_IT
+	tapDestroy(context);
+END_DESCRIBE
+
+int main () {
+	CSpec_Run(DESCRIPTION(runLoopBody), CSpec_NewOutputUnit());
+	CSpec_Run(DESCRIPTION(loopBodyResult), CSpec_NewOutputUnit());
+
+	return 0;
+}
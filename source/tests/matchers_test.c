@@ -0,0 +1,168 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   matchers_test.c
+    @brief  Tests for matchers.c
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../../testing/cspec.h"
+#include "../../testing/cspec_output_unit.h"
+
+#include "../matchers.h"
+#include "../tap.h"
+#include "../constants.h"
+#include "../constructors.h"
+#include "../memory.h"
+
+#define TEST_CASES 500
+#define TEST_NEEDLES 8
+
+/*! Makes a matcher for the given null terminated needles
+    @return             the new matcher
+*/
+static tap_mat* matcherOf (char* needles[], int numneedles) {
+    string* strings[numneedles > 0 ? numneedles : 1];
+    int i;
+    for (i = 0; i < numneedles; ++i) {
+        strings[i] = newStringCopy(needles[i], strlen(needles[i]));
+    }
+    tap_mat* mat = newMatcher(strings, numneedles);
+    for (i = 0; i < numneedles; ++i) {
+        freeStr(strings[i]);
+    }
+    return mat;
+}
+
+DESCRIBE(matchAll, "int* matchAll (tap_mat* mat, char* text, int size, int* count)")
+	char* needles[] = {"he", "she", "his", "hers"};
+	tap_mat* mat;
+	int* matches;
+	int count;
+
+	IT("Finds every needle, including ones that overlap, in the order they end")
+		mat = matcherOf(needles, 4);
+		matches = matchAll(mat, "ushers", 6, &count);
+		SHOULD_EQUAL(count, 3)
+		SHOULD_EQUAL(matches[0], 1) // she
+		SHOULD_EQUAL(matches[1], 1)
+		SHOULD_EQUAL(matches[2], 2) // he
+		SHOULD_EQUAL(matches[3], 0)
+		SHOULD_EQUAL(matches[4], 2) // hers
+		SHOULD_EQUAL(matches[5], 3)
+		free(matches);
+		SHOULD_EQUAL(matchAny(mat, "ushers", 6), 1)
+		SHOULD_EQUAL(matchAny(mat, "hiss", 2), 0)
+		freeMatcher(mat);
+	END_IT
+
+	IT("Agrees with checking each needle at each position")
+		char alphabet[] = {'a', 'b', 'c', '\0'};
+		char text[400];
+		char words[TEST_NEEDLES][6];
+		char* random[TEST_NEEDLES];
+		int i, j, k;
+		int agreed = 1;
+		for (i = 0; i < TEST_CASES; ++i) {
+			int numneedles = 1 + rand() % TEST_NEEDLES;
+			for (j = 0; j < numneedles; ++j) {
+				int size = 1 + rand() % 5;
+				for (k = 0; k < size; ++k) {
+					words[j][k] = alphabet[rand() % 3]; // needles are null terminated for matcherOf, so they leave out the null character
+				}
+				words[j][size] = '\0';
+				random[j] = words[j];
+			}
+			int size = rand() % 400;
+			for (k = 0; k < size; ++k) {
+				text[k] = alphabet[rand() % 4];
+			}
+			mat = matcherOf(random, numneedles);
+			matches = matchAll(mat, text, size, &count);
+			int expected = 0;
+			int found = 0;
+			for (k = 0; k < size; ++k) { // every needle that ends at k
+				for (j = 0; j < numneedles; ++j) {
+					int nsize = strlen(random[j]);
+					int duplicate = 0;
+					int l;
+					for (l = 0; l < j; ++l) {
+						duplicate |= strcmp(random[l], random[j]) == 0;
+					}
+					if (duplicate || nsize > k + 1 || memcmp(text + k + 1 - nsize, random[j], nsize) != 0) {
+						continue;
+					}
+					++expected;
+					for (l = 0; l < count; ++l) {
+						found += matches[2 * l] == k + 1 - nsize && matches[2 * l + 1] == j;
+					}
+				}
+			}
+			agreed &= count == expected && found == expected && matchAny(mat, text, size) == (expected > 0);
+			free(matches);
+			freeMatcher(mat);
+		}
+		SHOULD_EQUAL(agreed, 1)
+	END_IT
+
+	IT("Matches nowhere without needles or with only empty ones")
+		char* empty[] = {""};
+		mat = matcherOf(NULL, 0);
+		SHOULD_EQUAL(matchAny(mat, "abc", 3), 0)
+		freeMatcher(mat);
+		mat = matcherOf(empty, 1);
+		matches = matchAll(mat, "abc", 3, &count);
+		SHOULD_EQUAL(count, 0)
+		free(matches);
+		freeMatcher(mat);
+	END_IT
+END_DESCRIBE
+
+DESCRIBE(prim_sFindallany, "(find-all-any str mat)")
+	tap_context* context = tapCreate();
+	expression* result;
+
+	IT("Finds any of the needles of a matcher made once")
+		result = tapEvalString(context, "(set \"m\" (matcher {\"he\" \"she\" \"his\" \"hers\"})) (+ (match-any \"ushers\" m) (match-any \"this\" m) (match-any \"shirt\" m))");
+		SHOULD_EQUAL(tapResultInt(result), 2)
+		tapFreeResult(result);
+		result = tapEvalString(context, "(size (matcher {\"a\" \"b\" \"c\"}))");
+		SHOULD_EQUAL(tapResultInt(result), 3)
+		tapFreeResult(result);
+	END_IT
+
+	IT("Reports an empty needle as an invalid argument")
+		result = tapEvalString(context, "(match-any \"abc\" (matcher {\"\" \"x\"}))");
+		SHOULD_EQUAL(tapResultInt(result), 0)
+		SHOULD_EQUAL(tapFailed(context), 1)
+		char* errors = tapPrintErrors(context);
+		SHOULD_NOT_EQUAL(strstr(errors, "invalid argument"), NULL)
+		free(errors);
+		tapFreeResult(result);
+	END_IT
+
+	IT("Returns each occurrence as its index and needle")
+		int expected[] = {0, 0, 1, 1, 2, 0, 3, 1};
+		int matched = 1;
+		int i;
+		result = tapEvalString(context, "(find-all-any \"abab\" (matcher {\"ab\" \"b\"}))");
+		SHOULD_EQUAL(result->type, TYPE_ARR)
+		SHOULD_EQUAL(result->ev.arrval->size, 4)
+		for (i = 0; i < 8; ++i) {
+			matched &= result->ev.arrval->content[i / 2]->ev.arrval->content[i % 2]->ev.intval == expected[i];
+		}
+		SHOULD_EQUAL(matched, 1)
+		tapFreeResult(result);
+	END_IT
+	tapDestroy(context);
+END_DESCRIBE
+
+int main () {
+	CSpec_Run(DESCRIPTION(matchAll), CSpec_NewOutputUnit());
+	CSpec_Run(DESCRIPTION(prim_sFindallany), CSpec_NewOutputUnit());
+
+	return 0;
+}
@@ -0,0 +1,123 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   memo_test.c
+    @brief  Tests for memo.c
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../testing/cspec.h"
+#include "../../testing/cspec_output_unit.h"
+
+#include "../memo.h"
+#include "../constructors.h"
+#include "../constants.h"
+#include "../memory.h"
+#include "../strings.h"
+#include "../tap.h"
+
+DESCRIBE(equalExpressions, "int equalExpressions (expression* expr1, expression* expr2)")
+	expression* int1 = newExpressionInt(7);
+	expression* int2 = newExpressionInt(7);
+	expression* flo1 = newExpressionFlo(7.0);
+	expression* str1 = newExpressionStr(newString(strDup("abc")));
+	expression* str2 = newExpressionStr(newString(strDup("abc")));
+	expression* str3 = newExpressionStr(newString(strDup("abd")));
+
+	IT("compares expressions by type and value")
+		SHOULD_EQUAL(equalExpressions(int1, int2), 1)
+		SHOULD_EQUAL(equalExpressions(int1, flo1), 0)
+		SHOULD_EQUAL(equalExpressions(str1, str2), 1)
+		SHOULD_EQUAL(equalExpressions(str1, str3), 0)
+	END_IT
+
+	IT("gives equal expressions equal hashsums")
+		SHOULD_EQUAL(hashExpression(int1, 0), hashExpression(int2, 0))
+		SHOULD_EQUAL(hashExpression(str1, 0), hashExpression(str2, 0))
+	END_IT
+	freeExpr(int1);
+	freeExpr(int2);
+	freeExpr(flo1);
+	freeExpr(str1);
+	freeExpr(str2);
+	freeExpr(str3);
+END_DESCRIBE
+
+DESCRIBE(lookupMemo, "expression* lookupMemo (tap_memo* memo, expression* args[], int numargs)")
+	tap_memo* memo = newMemo(2);
+	expression* args[1];
+	expression* result;
+
+	IT("counts a miss for arguments it hasn't seen")
+		args[0] = newExpressionInt(1);
+		SHOULD_EQUAL(lookupMemo(memo, args, 1), NULL)
+		SHOULD_EQUAL(memo->misses, 1)
+		storeMemo(memo, args, 1, args[0]);
+		freeExpr(args[0]);
+	END_IT
+
+	IT("returns a copy of the stored result and counts a hit")
+		args[0] = newExpressionInt(1);
+		result = lookupMemo(memo, args, 1);
+		SHOULD_NOT_EQUAL(result, NULL)
+		SHOULD_EQUAL(result->ev.intval, 1)
+		SHOULD_EQUAL(memo->hits, 1)
+		freeExpr(result);
+		freeExpr(args[0]);
+	END_IT
+
+	IT("evicts the least recently used result when full")
+		args[0] = newExpressionInt(2);
+		storeMemo(memo, args, 1, args[0]);
+		freeExpr(args[0]);
+		args[0] = newExpressionInt(1);
+		result = lookupMemo(memo, args, 1); // touch 1 so that 2 is the oldest
+		freeExpr(result);
+		freeExpr(args[0]);
+		args[0] = newExpressionInt(3);
+		storeMemo(memo, args, 1, args[0]);
+		freeExpr(args[0]);
+		SHOULD_EQUAL(memo->count, 2)
+		args[0] = newExpressionInt(2);
+		SHOULD_EQUAL(lookupMemo(memo, args, 1), NULL)
+		freeExpr(args[0]);
+		args[0] = newExpressionInt(1);
+		result = lookupMemo(memo, args, 1);
+		SHOULD_NOT_EQUAL(result, NULL)
+		freeExpr(result);
+		freeExpr(args[0]);
+	END_IT
+	releaseMemo(memo);
+END_DESCRIBE
+
+DESCRIBE(prim_uMemoize, "(memoize fun [int])")
+	tap_context* context = tapCreate();
+	expression* result;
+
+	IT("memoizes functions that recurse far deeper than the initial environments")
+		result = tapEvalString(context, "(set \"fib\" (memoize (function [(int n)] [(if (< n 2) n (+ (fib (- n 1)) (fib (- n 2))))]))) (set \"sum\" (memoize (function [(int n)] [(if (< n 1) 0 (+ n (sum (- n 1))))]))) (- (fib 90) (sum 1000))");
+		SHOULD_EQUAL(tapResultInt(result), 2880067194370816120 - 500500)
+		SHOULD_EQUAL(tapFailed(context), 0)
+		tapFreeResult(result);
+	END_IT
+
+	IT("doesn't cache a call that failed")
+		result = tapEvalString(context, "(set \"check\" (memoize (function [(int n)] [(format (if (< n 0) \"{0\" \"{0}\") n)]))) (+ (check -1) (check -1) (check 4) (check 4))");
+		char* errors = tapPrintErrors(context);
+		SHOULD_NOT_EQUAL(strstr(errors, "Error 1:"), NULL) // both failed calls report the error
+		SHOULD_EQUAL(strstr(errors, "Error 2:"), NULL)
+		free(errors);
+		tapFreeResult(result);
+	END_IT
+	tapDestroy(context);
+END_DESCRIBE
+
+int main () {
+	CSpec_Run(DESCRIPTION(equalExpressions), CSpec_NewOutputUnit());
+	CSpec_Run(DESCRIPTION(lookupMemo), CSpec_NewOutputUnit());
+	CSpec_Run(DESCRIPTION(prim_uMemoize), CSpec_NewOutputUnit());
+
+	return 0;
+}
@@ -0,0 +1,209 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   numbers_test.c
+    @brief  Tests for numbers.c
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+
+#include "../../testing/cspec.h"
+#include "../../testing/cspec_output_unit.h"
+
+#include "../numbers.h"
+#include "../tap.h"
+#include "../constants.h"
+
+#define TEST_CASES 100000
+
+/*! Returns a float made of random bits, so every exponent is about as likely as every other
+    @return             the float, which may be infinite or not a number
+*/
+static double randomFloat () {
+    uint64_t bits = 0;
+    int i;
+    for (i = 0; i < 4; ++i) {
+        bits = (bits << 16) | (rand() & 0xffff);
+    }
+    double floval;
+    memcpy(&floval, &bits, sizeof(floval));
+    return floval;
+}
+
+/*! Returns the number of significant digits in the given formatted float
+    @return             the number of digits before any exponent from the first nonzero digit to the last
+*/
+static int significantDigits (char* text) {
+    int first = -1;
+    int last = -1;
+    int count = 0; // the digits seen so far
+    int i;
+    for (i = 0; text[i] != '\0' && text[i] != 'e'; ++i) {
+        if (text[i] >= '0' && text[i] <= '9') {
+            ++count;
+            if (text[i] != '0') {
+                first = first < 0 ? count : first;
+                last = count;
+            }
+        }
+    }
+    return first < 0 ? 0 : last - first + 1;
+}
+
+DESCRIBE(formatFlo, "int formatFlo (char* dest, tap_flo floval)")
+	char text[NUMBER_MAX_SIZE];
+
+	IT("Writes floats in the shortest form that reads back as the same float")
+		int agreed = 1;
+		int i;
+		for (i = 0; i < TEST_CASES; ++i) {
+			double floval = randomFloat();
+			if (floval != floval || floval - floval != 0) { // skip nan and infinity
+				continue;
+			}
+			int size = formatFlo(text, floval);
+			agreed &= size == (int)strlen(text) && strtod(text, NULL) == floval;
+			int digits = significantDigits(text);
+			if (digits > 1) { // then one fewer digit must name a different float
+				char shorter[NUMBER_MAX_SIZE];
+				snprintf(shorter, NUMBER_MAX_SIZE, "%.*e", digits - 2, floval);
+				agreed &= strtod(shorter, NULL) != floval;
+			}
+		}
+		SHOULD_EQUAL(agreed, 1)
+	END_IT
+
+	IT("Always marks a float as a float")
+		formatFlo(text, 22.0);
+		SHOULD_MATCH(text, "22.0")
+		formatFlo(text, 0.1);
+		SHOULD_MATCH(text, "0.1")
+		formatFlo(text, -0.0);
+		SHOULD_MATCH(text, "-0.0")
+		formatFlo(text, 1e16);
+		SHOULD_MATCH(text, "1e+16")
+		formatFlo(text, 1e-5);
+		SHOULD_MATCH(text, "1e-05")
+		formatFlo(text, 1.0 / 0.0);
+		SHOULD_MATCH(text, "inf")
+	END_IT
+END_DESCRIBE
+
+DESCRIBE(formatInt, "int formatInt (char* dest, tap_int intval, uint base)")
+	char text[NUMBER_MAX_SIZE];
+	char expected[NUMBER_MAX_SIZE];
+
+	IT("Agrees with the standard library in base 10")
+		int agreed = 1;
+		int i;
+		for (i = 0; i < TEST_CASES; ++i) {
+			tap_int intval = (tap_int)randomFloat() >> (rand() % 64);
+			int size = formatInt(text, intval, 10);
+			snprintf(expected, NUMBER_MAX_SIZE, "%ld", intval);
+			agreed &= size == (int)strlen(expected) && strcmp(text, expected) == 0;
+		}
+		SHOULD_EQUAL(agreed, 1)
+		formatInt(text, LONG_MIN, 10);
+		SHOULD_MATCH(text, "-9223372036854775808")
+	END_IT
+
+	IT("Writes integers in any base")
+		formatInt(text, 255, 16);
+		SHOULD_MATCH(text, "FF")
+		formatInt(text, -5, 2);
+		SHOULD_MATCH(text, "-101")
+		formatInt(text, 35, 36);
+		SHOULD_MATCH(text, "Z")
+		formatInt(text, 0, 7);
+		SHOULD_MATCH(text, "0")
+		SHOULD_EQUAL(formatInt(text, LONG_MIN, 2), 65)
+	END_IT
+END_DESCRIBE
+
+DESCRIBE(parseNumber, "datatype parseNumber (char* text, int size, uint base, tap_int* intval, tap_flo* floval)")
+	tap_int intval;
+	tap_flo floval;
+
+	IT("Reads integers exactly and floats as the standard library does")
+		SHOULD_EQUAL(parseNumber(" -9223372036854775808 ", 22, 10, &intval, &floval), TYPE_INT)
+		SHOULD_EQUAL(intval == LONG_MIN, 1)
+		SHOULD_EQUAL(parseNumber("zz", 2, 36, &intval, &floval), TYPE_INT)
+		SHOULD_EQUAL(intval, 1295)
+		int agreed = 1;
+		char text[NUMBER_MAX_SIZE];
+		int i;
+		for (i = 0; i < TEST_CASES; ++i) {
+			double expected = randomFloat();
+			if (expected != expected || expected - expected != 0) {
+				continue;
+			}
+			int size = snprintf(text, NUMBER_MAX_SIZE, "%.*g", 1 + rand() % 17, expected);
+			agreed &= parseNumber(text, size, 10, &intval, &floval) == TYPE_FLO ? floval == strtod(text, NULL) : intval == strtol(text, NULL, 10);
+		}
+		SHOULD_EQUAL(agreed, 1)
+	END_IT
+
+	IT("Reads integers too big to fit as floats")
+		SHOULD_EQUAL(parseNumber("9223372036854775808", 19, 10, &intval, &floval), TYPE_FLO)
+		SHOULD_EQUAL(floval, 9223372036854775808.0)
+	END_IT
+
+	IT("Rejects text that isn't a number in the given base")
+		SHOULD_EQUAL(parseNumber("12a", 3, 10, &intval, &floval), TYPE_NIL)
+		SHOULD_EQUAL(parseNumber("102", 3, 2, &intval, &floval), TYPE_NIL)
+		SHOULD_EQUAL(parseNumber("-", 1, 10, &intval, &floval), TYPE_NIL)
+		SHOULD_EQUAL(parseNumber("", 0, 10, &intval, &floval), TYPE_NIL)
+		SHOULD_EQUAL(parseNumber("1", 1, 37, &intval, &floval), TYPE_NIL)
+	END_IT
+END_DESCRIBE
+
+DESCRIBE(storeExprValue, "expression* storeExprValue (expression* expr, char* text, int start, int end, expression** last, int lazy)")
+	tap_context* context = tapCreate();
+	expression* result;
+	char* str;
+
+	IT("Keeps every bit of 64 bit integer literals")
+		result = tapEvalString(context, "(== 4294967296 0)");
+		SHOULD_EQUAL(tapResultInt(result), 0)
+		tapFreeResult(result);
+		result = tapEvalString(context, "(- 9223372036854775807 9223372036854775806)");
+		SHOULD_EQUAL(tapResultInt(result), 1)
+		tapFreeResult(result);
+	END_IT
+
+	IT("Reads literals with a base after a colon")
+		result = tapEvalString(context, "(+ 11:2 17:8)");
+		SHOULD_EQUAL(tapResultInt(result), 18)
+		tapFreeResult(result);
+	END_IT
+
+	IT("Converts numbers to strings in any base and back")
+		result = tapEvalString(context, "(+ (str 255 16) \"|\" (str 0.1) \"|\" (str (int \"9007199254740993\")) \"|\" (str (int \"ff\" 16)))");
+		str = tapResultStr(result);
+		SHOULD_MATCH(str, "FF|0.1|9007199254740993|255")
+		free(str);
+		tapFreeResult(result);
+	END_IT
+
+	IT("Rounds fractions to integers and gives nil for numbers too big for one")
+		result = tapEvalString(context, "(+ (str (int \"2.5\")) \"|\" (str (int \"-3.5\")) \"|\" (str (int \"3000000000.4\")) \"|\" (str (int \"99999999999999999999\")) \"|\" (str (int \"-9223372036854775808.0\")))");
+		str = tapResultStr(result);
+		SHOULD_MATCH(str, "2|-4|3000000000|[nil]|-9223372036854775808")
+		free(str);
+		tapFreeResult(result);
+	END_IT
+	tapDestroy(context);
+END_DESCRIBE
+
+int main () {
+	CSpec_Run(DESCRIPTION(formatFlo), CSpec_NewOutputUnit());
+	CSpec_Run(DESCRIPTION(formatInt), CSpec_NewOutputUnit());
+	CSpec_Run(DESCRIPTION(parseNumber), CSpec_NewOutputUnit());
+	CSpec_Run(DESCRIPTION(storeExprValue), CSpec_NewOutputUnit());
+
+	return 0;
+}
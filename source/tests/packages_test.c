@@ -0,0 +1,81 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   packages_test.c
+    @brief  Tests for packages.c
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../../testing/cspec.h"
+#include "../../testing/cspec_output_unit.h"
+
+#include "../packages.h"
+#include "../tap.h"
+#include "../engine.h"
+#include "../hashtable.h"
+#include "../constants.h"
+
+#define TEST_PACKAGE "./packages_test_package.tap"
+#define TEST_SNAPSHOT "./packages_test_package.snap"
+
+DESCRIBE(importPackage, "int importPackage (char* name)")
+	tap_context* context = tapCreate();
+	tap_context* previous = setContext(context);
+	FILE* file = fopen(TEST_PACKAGE, "w");
+	fputs("(set \"twice\" (function [(int n)] [(* n 2)]))\n(set \"quad\" (function [(int n)] [(twice (twice n))]))\n(set \"base\" 10)\n(set \"unused\" \"a ) string\")\n(set \"counter\" 0)\n(set \"counter\" (+ counter 1))\n", file);
+	fclose(file);
+
+	IT("Returns the number of definitions without evaluating any of them")
+		SHOULD_EQUAL(importPackage(TEST_PACKAGE), 6)
+		SHOULD_EQUAL(context->environments[0]->numvars, 0)
+	END_IT
+
+	IT("Doesn't import a package into a context twice")
+		SHOULD_EQUAL(importPackage("./packages_test_package"), 6)
+		SHOULD_EQUAL(context->imports->next, NULL)
+	END_IT
+
+	IT("Returns -1 for packages that can't be found")
+		SHOULD_EQUAL(importPackage("./no_such_package"), -1)
+		SHOULD_EQUAL(tapFailed(context), 1)
+	END_IT
+	setContext(previous);
+
+	IT("Evaluates only the definitions that are referenced")
+		expression* result = tapEvalString(context, "(quad base)");
+		SHOULD_EQUAL(tapResultInt(result), 40)
+		tapFreeResult(result);
+		SHOULD_EQUAL(context->environments[0]->numvars, 3)
+		SHOULD_EQUAL(lookupHash(context->environments[0]->variables, "unused"), NULL)
+	END_IT
+
+	IT("Evaluates every definition of a name in order")
+		expression* result = tapEvalString(context, "(+ counter 0)");
+		SHOULD_EQUAL(tapResultInt(result), 1)
+		tapFreeResult(result);
+	END_IT
+
+	IT("Saves the definitions that haven't been referenced yet in snapshots")
+		SHOULD_EQUAL(tapSaveSnapshot(context, TEST_SNAPSHOT), 1)
+		tap_context* restored = tapCreate();
+		SHOULD_EQUAL(tapRestoreSnapshot(restored, TEST_SNAPSHOT), 1)
+		expression* result = tapEvalString(restored, "(+ (str (quad base)) unused)");
+		char* str = tapResultStr(result);
+		SHOULD_MATCH(str, "40a ) string")
+		free(str);
+		tapFreeResult(result);
+		tapDestroy(restored);
+		remove(TEST_SNAPSHOT);
+	END_IT
+	remove(TEST_PACKAGE);
+	tapDestroy(context);
+END_DESCRIBE
+
+int main () {
+	CSpec_Run(DESCRIPTION(importPackage), CSpec_NewOutputUnit());
+
+	return 0;
+}
@@ -0,0 +1,151 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   regexes_test.c
+    @brief  Tests for regexes.c
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../../testing/cspec.h"
+#include "../../testing/cspec_output_unit.h"
+
+#include "../regexes.h"
+#include "../tap.h"
+#include "../constants.h"
+
+#define TEST_TEXT_SIZE 100000
+#define TEST_GROUPS 10
+
+/*! Compiles the given null terminated pattern and searches the given text for it from the start
+    @return             1 if there's a match, 0 if there isn't, or -1 if the pattern doesn't compile
+*/
+static int search (char* pattern, char* text, int* groups) {
+    char* error;
+    tap_reg* reg = newRegex(pattern, strlen(pattern), &error);
+    if (reg == NULL) {
+        return -1;
+    }
+    int found = regexSearch(reg, text, strlen(text), 0, groups);
+    freeRegex(reg);
+    return found;
+}
+
+DESCRIBE(regexSearch, "int regexSearch (tap_reg* reg, char* text, int size, int from, int* groups)")
+	int groups[2 * TEST_GROUPS];
+
+	IT("Finds the match a backtracking matcher would, with its groups")
+		SHOULD_EQUAL(search("(\\w+)@(\\w+)\\.com", "mail bob@example.com now", groups), 1)
+		SHOULD_EQUAL(groups[0], 5)
+		SHOULD_EQUAL(groups[1], 20)
+		SHOULD_EQUAL(groups[2], 5)
+		SHOULD_EQUAL(groups[3], 8)
+		SHOULD_EQUAL(groups[4], 9)
+		SHOULD_EQUAL(groups[5], 16)
+		SHOULD_EQUAL(search("a+?", "caaat", groups), 1)
+		SHOULD_EQUAL(groups[1] - groups[0], 1)
+		SHOULD_EQUAL(search("a|ab", "ab", groups), 1)
+		SHOULD_EQUAL(groups[1], 1)
+		SHOULD_EQUAL(search("(x)?y", "y", groups), 1)
+		SHOULD_EQUAL(groups[2], -1)
+		SHOULD_EQUAL(search("[^0-9a-f]{2,3}", "09fgh-z", groups), 1)
+		SHOULD_EQUAL(groups[0], 3)
+		SHOULD_EQUAL(groups[1], 6)
+	END_IT
+
+	IT("Anchors to the start and end of the text")
+		SHOULD_EQUAL(search("^b", "ab", groups), 0)
+		SHOULD_EQUAL(search("a$", "ab", groups), 0)
+		SHOULD_EQUAL(search("b$", "ab", groups), 1)
+		SHOULD_EQUAL(search("^$", "", groups), 1)
+		SHOULD_EQUAL(search("x*$", "abc", groups), 1)
+		SHOULD_EQUAL(groups[0], 3)
+	END_IT
+
+	IT("Rejects malformed patterns")
+		SHOULD_EQUAL(search("a(b", "ab", groups), -1)
+		SHOULD_EQUAL(search("a)b", "ab", groups), -1)
+		SHOULD_EQUAL(search("[ab", "ab", groups), -1)
+		SHOULD_EQUAL(search("*a", "a", groups), -1)
+		SHOULD_EQUAL(search("a{3,2}", "a", groups), -1)
+		SHOULD_EQUAL(search("a{2000}", "a", groups), -1)
+		SHOULD_EQUAL(search("\\q", "q", groups), -1)
+		SHOULD_EQUAL(search("a{,2}", "a{,2}", groups), 1) // a brace that doesn't start a count is an ordinary character
+	END_IT
+
+	IT("Takes time linear in the text for patterns that make backtracking matchers take exponential time")
+		char* text = malloc(TEST_TEXT_SIZE + 1);
+		memset(text, 'a', TEST_TEXT_SIZE);
+		text[TEST_TEXT_SIZE] = '\0';
+		SHOULD_EQUAL(search("(a*)*b", text, groups), 0)
+		SHOULD_EQUAL(search("(a|aa)+$", text, groups), 1)
+		SHOULD_EQUAL(groups[1], TEST_TEXT_SIZE)
+		free(text);
+	END_IT
+
+	IT("Keeps finding matches once the automaton has more states than it keeps")
+		char* text = malloc(TEST_TEXT_SIZE + 1);
+		int i;
+		for (i = 0; i < TEST_TEXT_SIZE; ++i) {
+			text[i] = rand() % 2 ? 'a' : 'b';
+		}
+		text[TEST_TEXT_SIZE] = '\0';
+		text[TEST_TEXT_SIZE - 14] = 'b';
+		SHOULD_EQUAL(search("a[ab]{13}$", text, groups), 0)
+		text[TEST_TEXT_SIZE - 14] = 'a';
+		SHOULD_EQUAL(search("a[ab]{13}$", text, groups), 1)
+		SHOULD_EQUAL(groups[0], TEST_TEXT_SIZE - 14)
+		free(text);
+	END_IT
+END_DESCRIBE
+
+DESCRIBE(prim_sMatch, "(match str reg/str)")
+	tap_context* context = tapCreate();
+	expression* result;
+	char* str;
+
+	IT("Returns the whole match and each group")
+		result = tapEvalString(context, "(match \"key = value\" (regex \"(\\w+) *= *(\\w+)\"))");
+		SHOULD_EQUAL(result->type, TYPE_ARR)
+		SHOULD_EQUAL(result->ev.arrval->size, 3)
+		SHOULD_EQUAL(strncmp(result->ev.arrval->content[1]->ev.strval->content, "key", 3), 0)
+		SHOULD_EQUAL(strncmp(result->ev.arrval->content[2]->ev.strval->content, "value", 5), 0)
+		tapFreeResult(result);
+		result = tapEvalString(context, "(match \"abc\" \"x\")");
+		SHOULD_EQUAL(result->ev.arrval->size, 0)
+		tapFreeResult(result);
+	END_IT
+
+	IT("Finds every match and replaces them with the groups they captured")
+		result = tapEvalString(context, "(match-all \"a1b22c333\" \"\\d+\")");
+		SHOULD_EQUAL(result->ev.arrval->size, 3)
+		SHOULD_EQUAL(result->ev.arrval->content[2]->ev.arrval->content[0]->ev.strval->size, 3)
+		tapFreeResult(result);
+		result = tapEvalString(context, "(regex-replace \"2024-01-15, 2023-12-31\" (regex \"(\\d+)-(\\d+)-(\\d+)\") \"$3/$2/$1 $$\")");
+		str = tapResultStr(result);
+		SHOULD_MATCH(str, "15/01/2024 $, 31/12/2023 $")
+		free(str);
+		tapFreeResult(result);
+		result = tapEvalString(context, "(regex-replace \"abc\" \"x*\" \"-\")");
+		str = tapResultStr(result);
+		SHOULD_MATCH(str, "-a-b-c-")
+		free(str);
+		tapFreeResult(result);
+	END_IT
+
+	IT("Reports a pattern that doesn't compile")
+		result = tapEvalString(context, "(regex \"(a\")");
+		SHOULD_EQUAL(tapFailed(context), 1)
+		tapFreeResult(result);
+	END_IT
+	tapDestroy(context);
+END_DESCRIBE
+
+int main () {
+	CSpec_Run(DESCRIPTION(regexSearch), CSpec_NewOutputUnit());
+	CSpec_Run(DESCRIPTION(prim_sMatch), CSpec_NewOutputUnit());
+
+	return 0;
+}
@@ -0,0 +1,161 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   scheduler_test.c
+    @brief  Tests for scheduler.c
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../../testing/cspec.h"
+#include "../../testing/cspec_output_unit.h"
+
+#include "../scheduler.h"
+#include "../channels.h"
+#include "../tap.h"
+#include "../constants.h"
+#include "../constructors.h"
+#include "../hashtable.h"
+
+#define TEST_PACKAGE "scheduler_test_package.tap"
+#define TEST_TASKS 200
+
+/*! Returns a new context with the test package loaded
+*/
+static tap_context* loadedContext () {
+	tap_context* context = tapCreate();
+	tapLoadPackage(context, TEST_PACKAGE);
+	return context;
+}
+
+/*! Defines the given channel as the variable c in the root environment of the given context
+*/
+static void defineChannel (tap_context* context, tap_chn* chn) {
+	expression* value = newExpressionNil();
+	value->type = TYPE_CHN;
+	value->ev.chnval = shareChannel(chn);
+	insertUserHash(context->environments[0]->variables, "c", value);
+	++context->environments[0]->numvars;
+}
+
+DESCRIBE(tapSpawnTask, "tap_task* tapSpawnTask (tap_scheduler* scheduler, tap_context* context, char* text)")
+	FILE* package = fopen(TEST_PACKAGE, "w");
+	fputs("(set \"fib\" (function [(int n)] [(if (< n 2) n (+ (fib (- n 1)) (fib (- n 2))))]))\n", package);
+	fputs("(set \"produce\" (function [c (int i) (int n)] [(if (> i n) (close c) (if (send c i) (produce c (+ i 1) n) 0))]))\n", package);
+	fputs("(set \"drainfrom\" (function [c (int total) (int v)] [(if (< v 0) total (drainfrom c (+ total v) (receive c -1)))]))\n", package);
+	fputs("(set \"drain\" (function [c] [(drainfrom c 0 (receive c -1))]))\n", package);
+	fputs("(set \"sum\" (function [(int n)] [(if (< n 1) 0 (+ n (sum (- n 1))))]))\n", package);
+	fclose(package);
+	tap_scheduler* scheduler;
+	tap_context* contexts[TEST_TASKS];
+	tap_task* tasks[TEST_TASKS];
+	expression* result;
+	int i;
+
+	IT("Evaluates every task in its own context")
+		scheduler = tapStartScheduler(2, 50);
+		char text[32];
+		for (i = 0; i < TEST_TASKS; ++i) {
+			contexts[i] = loadedContext();
+			sprintf(text, "(+ (fib 10) %d)", i);
+			tasks[i] = tapSpawnTask(scheduler, contexts[i], text);
+		}
+		int correct = 0;
+		for (i = 0; i < TEST_TASKS; ++i) {
+			result = tapTaskResult(tasks[i]);
+			correct += tapResultInt(result) == 55 + i;
+			tapFreeResult(result);
+			tapDestroy(contexts[i]);
+		}
+		SHOULD_EQUAL(correct, TEST_TASKS)
+		tapStopScheduler(scheduler);
+	END_IT
+
+	IT("Lets a short task finish while a long one on the same thread is still running")
+		scheduler = tapStartScheduler(1, 100);
+		contexts[0] = loadedContext();
+		contexts[1] = loadedContext();
+		tasks[0] = tapSpawnTask(scheduler, contexts[0], "(fib 25)");
+		tasks[1] = tapSpawnTask(scheduler, contexts[1], "(+ 1 2)");
+		result = tapTaskResult(tasks[1]);
+		SHOULD_EQUAL(tapResultInt(result), 3)
+		SHOULD_EQUAL(tapTaskFinished(tasks[0]), 0)
+		tapFreeResult(result);
+		result = tapTaskResult(tasks[0]);
+		SHOULD_EQUAL(tapResultInt(result), 75025)
+		tapFreeResult(result);
+		tapStopScheduler(scheduler);
+		tapDestroy(contexts[0]);
+		tapDestroy(contexts[1]);
+	END_IT
+
+	IT("Gives way in the middle of a loop whose body calls nothing")
+		scheduler = tapStartScheduler(1, 100);
+		contexts[0] = loadedContext();
+		contexts[1] = loadedContext();
+		contexts[2] = loadedContext();
+		tasks[0] = tapSpawnTask(scheduler, contexts[0], "(repeat 2000000 [1])");
+		tasks[1] = tapSpawnTask(scheduler, contexts[1], "(for-range \"i\" 0 2000000 [i])");
+		tasks[2] = tapSpawnTask(scheduler, contexts[2], "(+ 1 2)");
+		result = tapTaskResult(tasks[2]);
+		SHOULD_EQUAL(tapResultInt(result), 3)
+		SHOULD_EQUAL(tapTaskFinished(tasks[0]), 0)
+		SHOULD_EQUAL(tapTaskFinished(tasks[1]), 0)
+		tapFreeResult(result);
+		for (i = 0; i < 2; ++i) {
+			tapFreeResult(tapTaskResult(tasks[i]));
+		}
+		tapStopScheduler(scheduler);
+		for (i = 0; i < 3; ++i) {
+			tapDestroy(contexts[i]);
+		}
+	END_IT
+
+	IT("Runs other tasks while a task waits on a channel")
+		scheduler = tapStartScheduler(1, 0);
+		tap_chn* chn = newChannel(1);
+		contexts[0] = loadedContext();
+		contexts[1] = loadedContext();
+		defineChannel(contexts[0], chn);
+		defineChannel(contexts[1], chn);
+		freeChannel(chn);
+		tasks[0] = tapSpawnTask(scheduler, contexts[0], "(drain c)");
+		tasks[1] = tapSpawnTask(scheduler, contexts[1], "(produce c 1 20)");
+		result = tapTaskResult(tasks[0]);
+		SHOULD_EQUAL(tapResultInt(result), 210)
+		tapFreeResult(result);
+		tapFreeResult(tapTaskResult(tasks[1]));
+		tapStopScheduler(scheduler);
+		tapDestroy(contexts[0]);
+		tapDestroy(contexts[1]);
+	END_IT
+
+	IT("Reports recursion too deep for a task's stack as an error")
+		scheduler = tapStartScheduler(1, 0);
+		contexts[0] = loadedContext();
+		contexts[1] = loadedContext();
+		tasks[0] = tapSpawnTask(scheduler, contexts[0], "(sum 100)");
+		tasks[1] = tapSpawnTask(scheduler, contexts[1], "(sum 1000000)");
+		result = tapTaskResult(tasks[0]);
+		SHOULD_EQUAL(tapResultInt(result), 5050)
+		tapFreeResult(result);
+		tapFreeResult(tapTaskResult(tasks[1]));
+		SHOULD_EQUAL(tapFailed(contexts[1]), 1)
+		char* errors = tapPrintErrors(contexts[1]);
+		SHOULD_NOT_EQUAL(strstr(errors, "recursion too deep"), NULL)
+		free(errors);
+		tapStopScheduler(scheduler);
+		tapDestroy(contexts[0]);
+		tapDestroy(contexts[1]);
+	END_IT
+	unlink(TEST_PACKAGE);
+END_DESCRIBE
+
+int main () {
+	CSpec_Run(DESCRIPTION(tapSpawnTask), CSpec_NewOutputUnit());
+
+	return 0;
+}
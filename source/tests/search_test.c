@@ -0,0 +1,228 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   search_test.c
+    @brief  Tests for search.c
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../../testing/cspec.h"
+#include "../../testing/cspec_output_unit.h"
+
+#include "../search.h"
+#include "../tap.h"
+#include "../constants.h"
+
+#define TEST_CASES 5000
+#define TEST_TEXT_SIZE 200000
+
+/*! Finds the first position of the given needle at or after the given one the slow, obvious way
+    @return             the position or -1
+*/
+static int naiveFirst (char* haystack, int hsize, char* needle, int nsize, int from) {
+    int i;
+    for (i = from; i + nsize <= hsize; ++i) {
+        if (memcmp(haystack + i, needle, nsize) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*! Finds the last position of the given needle the slow, obvious way
+    @return             the position or -1
+*/
+static int naiveLast (char* haystack, int hsize, char* needle, int nsize) {
+    int i;
+    for (i = hsize - nsize; i >= 0; --i) {
+        if (memcmp(haystack + i, needle, nsize) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*! Fills the given buffer with random characters from the given alphabet
+    @return             nothing
+*/
+static void randomText (char* text, int size, char* alphabet, int letters) {
+    int i;
+    for (i = 0; i < size; ++i) {
+        text[i] = alphabet[rand() % letters];
+    }
+}
+
+DESCRIBE(searchFirst, "int searchFirst (char* haystack, int hsize, char* needle, int nsize, int from)")
+	char haystack[300];
+	char needle[12];
+	int i;
+
+	IT("Finds the same positions as comparing at every position")
+		srand(42);
+		int agreed = 1;
+		for (i = 0; i < TEST_CASES; ++i) {
+			int hsize = rand() % 300;
+			int nsize = 1 + rand() % 12;
+			int from = rand() % 10;
+			randomText(haystack, hsize, i % 2 ? "ab" : "ab\0c", i % 2 ? 2 : 4); // null characters are searched like any other
+			randomText(needle, nsize, i % 2 ? "ab" : "ab\0c", i % 2 ? 2 : 4);
+			agreed &= searchFirst(haystack, hsize, needle, nsize, from) == naiveFirst(haystack, hsize, needle, nsize, from);
+			agreed &= searchLast(haystack, hsize, needle, nsize) == naiveLast(haystack, hsize, needle, nsize);
+		}
+		SHOULD_EQUAL(agreed, 1)
+	END_IT
+
+	IT("Stays linear for needles whose first and last bytes match everywhere")
+		char* text = malloc(TEST_TEXT_SIZE);
+		memset(text, 'a', TEST_TEXT_SIZE);
+		char bad[101];
+		memset(bad, 'a', 101);
+		bad[50] = 'b';
+		SHOULD_EQUAL(searchFirst(text, TEST_TEXT_SIZE, bad, 101, 0), -1)
+		memcpy(text + TEST_TEXT_SIZE - 101, bad, 101);
+		SHOULD_EQUAL(searchFirst(text, TEST_TEXT_SIZE, bad, 101, 0), TEST_TEXT_SIZE - 101)
+		SHOULD_EQUAL(searchLast(text, TEST_TEXT_SIZE, bad, 101), TEST_TEXT_SIZE - 101)
+		free(text);
+	END_IT
+
+	IT("Finds the empty string where the search starts")
+		SHOULD_EQUAL(searchFirst("abc", 3, "", 0, 1), 1)
+		SHOULD_EQUAL(searchLast("abc", 3, "", 0), 3)
+	END_IT
+END_DESCRIBE
+
+DESCRIBE(searchAll, "int* searchAll (char* haystack, int hsize, char* needle, int nsize, int* count)")
+	int count;
+	int* positions;
+
+	IT("Leaves out matches that overlap an earlier one")
+		positions = searchAll("aaaaa", 5, "aa", 2, &count);
+		SHOULD_EQUAL(count, 2)
+		SHOULD_EQUAL(positions[0], 0)
+		SHOULD_EQUAL(positions[1], 2)
+		free(positions);
+	END_IT
+
+	IT("Finds every match in a long text")
+		char* text = malloc(TEST_TEXT_SIZE);
+		int i;
+		for (i = 0; i < TEST_TEXT_SIZE; ++i) {
+			text[i] = i % 10 == 9 ? ',' : 'x';
+		}
+		positions = searchAll(text, TEST_TEXT_SIZE, ",", 1, &count);
+		SHOULD_EQUAL(count, TEST_TEXT_SIZE / 10)
+		SHOULD_EQUAL(positions[count - 1], TEST_TEXT_SIZE - 1)
+		free(positions);
+		positions = searchAll(text, TEST_TEXT_SIZE, "x,x", 3, &count);
+		SHOULD_EQUAL(count, TEST_TEXT_SIZE / 10 - 1)
+		free(positions);
+		free(text);
+	END_IT
+
+	IT("Matches nothing for an empty needle")
+		positions = searchAll("abc", 3, "", 0, &count);
+		SHOULD_EQUAL(count, 0)
+		free(positions);
+	END_IT
+END_DESCRIBE
+
+DESCRIBE(prim_sReplace, "(replace str str str)")
+	tap_context* context = tapCreate();
+	expression* result;
+	char* str;
+
+	IT("Replaces every instance, growing or shrinking the string")
+		result = tapEvalString(context, "(replace \"a-b-c-d-e-f-g-h-i-j-k-l-m\" \"-\" \"++\")");
+		str = tapResultStr(result);
+		SHOULD_MATCH(str, "a++b++c++d++e++f++g++h++i++j++k++l++m")
+		free(str);
+		tapFreeResult(result);
+		result = tapEvalString(context, "(replace \"one, two, three\" \", \" \"\")");
+		str = tapResultStr(result);
+		SHOULD_MATCH(str, "onetwothree")
+		free(str);
+		tapFreeResult(result);
+	END_IT
+
+	IT("Inserts after every instance and removes characters by code")
+		result = tapEvalString(context, "(insert \"a-b-c\" \"-\" \"X\")");
+		str = tapResultStr(result);
+		SHOULD_MATCH(str, "a-Xb-Xc")
+		free(str);
+		tapFreeResult(result);
+		result = tapEvalString(context, "(remove \"a-b-c\" 45 \"b\")");
+		str = tapResultStr(result);
+		SHOULD_MATCH(str, "ac")
+		free(str);
+		tapFreeResult(result);
+	END_IT
+	tapDestroy(context);
+END_DESCRIBE
+
+DESCRIBE(prim_sSplit, "(split str [str/int])")
+	tap_context* context = tapCreate();
+	expression* result;
+	char* str;
+
+	IT("Splits by a string, keeping the empty pieces between delimiters")
+		result = tapEvalString(context, "(split \",a,,b,\" \",\")");
+		SHOULD_EQUAL(result->type, TYPE_ARR)
+		SHOULD_EQUAL(result->ev.arrval->size, 5)
+		SHOULD_EQUAL(result->ev.arrval->content[1]->ev.strval->size, 1)
+		SHOULD_EQUAL(result->ev.arrval->content[2]->ev.strval->size, 0)
+		tapFreeResult(result);
+		result = tapEvalString(context, "(size (split \"a::b::c\" \"::\"))");
+		SHOULD_EQUAL(tapResultInt(result), 3)
+		tapFreeResult(result);
+		result = tapEvalString(context, "(size (arr \"abcd\"))");
+		SHOULD_EQUAL(tapResultInt(result), 4)
+		tapFreeResult(result);
+	END_IT
+
+	IT("Splits by runs of whitespace when no delimiter is given")
+		result = tapEvalString(context, "(join (split \"  one two   three \") \"|\")");
+		str = tapResultStr(result);
+		SHOULD_MATCH(str, "one|two|three")
+		free(str);
+		tapFreeResult(result);
+		result = tapEvalString(context, "(size (split \"   \"))");
+		SHOULD_EQUAL(tapResultInt(result), 0)
+		tapFreeResult(result);
+	END_IT
+
+	IT("Joins what it splits back into the same string")
+		result = tapEvalString(context, "(join (split \"a-b--c\" 45) \"-\")");
+		str = tapResultStr(result);
+		SHOULD_MATCH(str, "a-b--c")
+		free(str);
+		tapFreeResult(result);
+		result = tapEvalString(context, "(join (split \"a-b--c\" 45) 45)");
+		str = tapResultStr(result);
+		SHOULD_MATCH(str, "a-b--c")
+		free(str);
+		tapFreeResult(result);
+		result = tapEvalString(context, "(str {1 \"b\" 3})");
+		str = tapResultStr(result);
+		SHOULD_MATCH(str, "{1, b, 3}")
+		free(str);
+		tapFreeResult(result);
+		result = tapEvalString(context, "(join {})");
+		str = tapResultStr(result);
+		SHOULD_MATCH(str, "")
+		free(str);
+		tapFreeResult(result);
+	END_IT
+	tapDestroy(context);
+END_DESCRIBE
+
+int main () {
+	CSpec_Run(DESCRIPTION(searchFirst), CSpec_NewOutputUnit());
+	CSpec_Run(DESCRIPTION(searchAll), CSpec_NewOutputUnit());
+	CSpec_Run(DESCRIPTION(prim_sReplace), CSpec_NewOutputUnit());
+	CSpec_Run(DESCRIPTION(prim_sSplit), CSpec_NewOutputUnit());
+
+	return 0;
+}
@@ -0,0 +1,157 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   server_test.c
+    @brief  Tests for server.c
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <arpa/inet.h>
+#include <stdint.h>
+
+#include "../../testing/cspec.h"
+#include "../../testing/cspec_output_unit.h"
+
+#include "../server.h"
+#include "../constants.h"
+
+#define TEST_SOCKET "server_test.sock"
+#define TEST_PACKAGE "server_test_package.tap"
+#define TEST_FILE "server_test_file.txt"
+#define TEST_STALE_SOCKET "server_test3.sock"
+
+/*! Connects to the test server
+    @return     the connected socket or -1 on failure
+*/
+static int connectToServer () {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, TEST_SOCKET);
+    int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (connect(sock, (struct sockaddr*)&address, sizeof(address)) != 0) {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+DESCRIBE(tapStartServer, "tap_server* tapStartServer (char* path, char* packages[], int numpackages, int numworkers)")
+	FILE* package = fopen(TEST_PACKAGE, "w");
+	fputs("(set \"square\" (function [(int n)] [(* n n)]))", package);
+	fclose(package);
+	char* packages[1] = {TEST_PACKAGE};
+	tap_server* server = tapStartServer(TEST_SOCKET, packages, 1, 2);
+	int sock1 = connectToServer();
+	int sock2 = connectToServer();
+	int failed;
+	char* reply;
+
+	IT("Evaluates requests with the packages already loaded")
+		SHOULD_NOT_EQUAL(server, NULL)
+		reply = tapRequest(sock1, "(square 12)", &failed);
+		SHOULD_EQUAL(strcmp(reply, "144"), 0)
+		SHOULD_EQUAL(failed, 0)
+		free(reply);
+		reply = tapRequest(sock2, "(+ (square 2) 1)", &failed);
+		SHOULD_EQUAL(strcmp(reply, "5"), 0)
+		free(reply);
+	END_IT
+
+	IT("Answers several requests on one connection without leaking state between them")
+		reply = tapRequest(sock1, "(set \"x\" 3) (+ x)", &failed);
+		SHOULD_EQUAL(strcmp(reply, "3"), 0)
+		free(reply);
+		reply = tapRequest(sock1, "(+ x 0)", &failed);
+		SHOULD_EQUAL(failed, 1)
+		SHOULD_NOT_EQUAL(strstr(reply, "undefined variable"), NULL)
+		free(reply);
+		reply = tapRequest(sock1, "(", &failed);
+		SHOULD_EQUAL(failed, 1)
+		SHOULD_NOT_EQUAL(strstr(reply, "unclosed parenthesis"), NULL)
+		free(reply);
+		reply = tapRequest(sock1, "(square 3)", &failed);
+		SHOULD_EQUAL(strcmp(reply, "9"), 0)
+		SHOULD_EQUAL(failed, 0)
+		free(reply);
+	END_IT
+
+	IT("Keeps serving after a client hangs up before its reply")
+		close(sock1);
+		close(sock2);
+		int sock3 = connectToServer();
+		char* text = "(repeat 200000 [(square 3)])";
+		uint32_t header = htonl(strlen(text));
+		SHOULD_EQUAL(write(sock3, &header, sizeof(header)), sizeof(header))
+		SHOULD_EQUAL(write(sock3, text, strlen(text)), strlen(text))
+		close(sock3); // the reply is written to a closed connection, which mustn't raise SIGPIPE
+		sock1 = connectToServer();
+		reply = tapRequest(sock1, "(square 5)", &failed);
+		SHOULD_EQUAL(strcmp(reply, "25"), 0)
+		free(reply);
+		reply = tapRequest(sock1, "(square 6)", &failed);
+		SHOULD_EQUAL(strcmp(reply, "36"), 0)
+		free(reply);
+	END_IT
+
+	IT("Closes an idle connection when every worker is busy and another one is waiting")
+		sock2 = connectToServer();
+		reply = tapRequest(sock2, "(square 7)", &failed);
+		SHOULD_EQUAL(strcmp(reply, "49"), 0)
+		free(reply);
+		int sock3 = connectToServer(); // both workers now hold an idle connection
+		reply = tapRequest(sock3, "(square 8)", &failed);
+		SHOULD_EQUAL(strcmp(reply, "64"), 0)
+		free(reply);
+		char* reply1 = tapRequest(sock1, "(square 9)", &failed);
+		char* reply2 = tapRequest(sock2, "(square 9)", &failed);
+		SHOULD_EQUAL(reply1 == NULL || reply2 == NULL, 1)
+		free(reply1);
+		free(reply2);
+		close(sock1);
+		close(sock2);
+		close(sock3);
+	END_IT
+
+	IT("Replaces a socket nothing answers on but nothing else")
+		SHOULD_EQUAL(tapStartServer(TEST_SOCKET, packages, 1, 1), NULL)
+		sock1 = connectToServer();
+		reply = tapRequest(sock1, "(square 4)", &failed);
+		SHOULD_EQUAL(strcmp(reply, "16"), 0)
+		free(reply);
+		close(sock1);
+		FILE* file = fopen(TEST_FILE, "w");
+		fclose(file);
+		SHOULD_EQUAL(tapStartServer(TEST_FILE, packages, 1, 1), NULL)
+		SHOULD_EQUAL(access(TEST_FILE, F_OK), 0)
+		remove(TEST_FILE);
+		struct sockaddr_un address;
+		memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		strcpy(address.sun_path, TEST_STALE_SOCKET);
+		int stale = socket(AF_UNIX, SOCK_STREAM, 0);
+		bind(stale, (struct sockaddr*)&address, sizeof(address));
+		close(stale); // leaves the socket file behind with nothing listening on it
+		tap_server* restarted = tapStartServer(TEST_STALE_SOCKET, packages, 1, 1);
+		SHOULD_NOT_EQUAL(restarted, NULL)
+		tapStopServer(restarted);
+	END_IT
+
+	IT("Refuses to start when a package can't be loaded")
+		char* missing[1] = {"no such package.tap"};
+		SHOULD_EQUAL(tapStartServer("server_test2.sock", missing, 1, 1), NULL)
+	END_IT
+	tapStopServer(server);
+	remove(TEST_PACKAGE);
+END_DESCRIBE
+
+int main () {
+	CSpec_Run(DESCRIPTION(tapStartServer), CSpec_NewOutputUnit());
+
+	return 0;
+}
@@ -0,0 +1,198 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   strings_test.c
+    @brief  Tests for strings.c
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../../testing/cspec.h"
+#include "../../testing/cspec_output_unit.h"
+
+#include "../strings.h"
+#include "../tap.h"
+#include "../constants.h"
+
+#define TEST_CASES 500
+#define TEST_TEXT_SIZE 200
+
+/*! Fills the given text with random bytes, mostly letters, digits and whitespace but also the odd byte from 128 up
+    @return             nothing
+*/
+static void randomText (char* text, int size) {
+    char alphabet[] = "aZ9 \t\n.@[`{/:_mQ";
+    int i;
+    for (i = 0; i < size; ++i) {
+        text[i] = rand() % 8 == 0 ? (char)(128 + rand() % 128) : alphabet[rand() % (sizeof(alphabet) - 1)];
+    }
+}
+
+/*! Returns whether or not the given character is in the given class, checked without vector instructions
+    @return             1 if it is, 0 if it isn't
+*/
+static int inClassByHand (char c, int class) {
+    int upper = c >= 'A' && c <= 'Z';
+    int lower = c >= 'a' && c <= 'z';
+    int digit = c >= '0' && c <= '9';
+    switch (class) {
+        case CLASS_SPACE: return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+        case CLASS_DIGIT: return digit;
+        case CLASS_UPPER: return upper;
+        case CLASS_LOWER: return lower;
+        case CLASS_ALPHA: return upper || lower;
+        default: return upper || lower || digit;
+    }
+}
+
+DESCRIBE(convertCase, "void convertCase (char* dest, char* src, int size, int flag)")
+	char text[TEST_TEXT_SIZE];
+	char result[TEST_TEXT_SIZE];
+
+	IT("Changes the case of ASCII letters only, whether or not it's written in place")
+		int agreed = 1;
+		int i, j;
+		for (i = 0; i < TEST_CASES; ++i) {
+			int size = rand() % TEST_TEXT_SIZE;
+			int flag = rand() % 2 ? CASE_UPPER : CASE_LOWER;
+			randomText(text, size);
+			convertCase(result, text, size, flag);
+			for (j = 0; j < size; ++j) {
+				char expected = text[j];
+				if (flag == CASE_UPPER && expected >= 'a' && expected <= 'z') {
+					expected -= 'a' - 'A';
+				} else if (flag == CASE_LOWER && expected >= 'A' && expected <= 'Z') {
+					expected += 'a' - 'A';
+				}
+				agreed &= result[j] == expected;
+			}
+			convertCase(text, text, size, flag);
+			agreed &= memcmp(text, result, size) == 0;
+		}
+		SHOULD_EQUAL(agreed, 1)
+	END_IT
+
+	IT("Only changes the first letter of each sentence or word")
+		strcpy(text, "one two. three four");
+		convertCase(result, text, strlen(text), CASE_SENTENCE);
+		SHOULD_EQUAL(strncmp(result, "One two. Three four", strlen(text)), 0)
+		convertCase(result, text, strlen(text), CASE_TITLE);
+		SHOULD_EQUAL(strncmp(result, "One Two. Three Four", strlen(text)), 0)
+	END_IT
+END_DESCRIBE
+
+DESCRIBE(reverseBytes, "void reverseBytes (char* dest, char* src, int size)")
+	char text[TEST_TEXT_SIZE];
+	char result[TEST_TEXT_SIZE];
+
+	IT("Reverses text of every size, whether or not it's written in place")
+		int agreed = 1;
+		int size, j;
+		for (size = 0; size < TEST_TEXT_SIZE; ++size) {
+			randomText(text, size);
+			reverseBytes(result, text, size);
+			for (j = 0; j < size; ++j) {
+				agreed &= result[j] == text[size - j - 1];
+			}
+			reverseBytes(text, text, size);
+			agreed &= memcmp(text, result, size) == 0;
+		}
+		SHOULD_EQUAL(agreed, 1)
+	END_IT
+END_DESCRIBE
+
+DESCRIBE(spanClass, "int spanClass (char* text, int size, int class)")
+	char text[TEST_TEXT_SIZE];
+
+	IT("Agrees with checking each byte from either end")
+		int agreed = 1;
+		int i;
+		for (i = 0; i < TEST_CASES; ++i) {
+			int size = rand() % TEST_TEXT_SIZE;
+			int class = rand() % 6;
+			int span = rand() % (size + 1);
+			int j;
+			randomText(text, size);
+			for (j = 0; j < span; ++j) { // make runs long enough to cross whole blocks
+				text[j] = class == CLASS_SPACE ? ' ' : class == CLASS_DIGIT ? '7' : class == CLASS_UPPER ? 'Q' : 'm';
+			}
+			int front = 0;
+			int back = 0;
+			while (front < size && inClassByHand(text[front], class)) {
+				++front;
+			}
+			while (back < size && inClassByHand(text[size - back - 1], class)) {
+				++back;
+			}
+			agreed &= spanClass(text, size, class) == front && spanClassBack(text, size, class) == back;
+		}
+		SHOULD_EQUAL(agreed, 1)
+	END_IT
+END_DESCRIBE
+
+DESCRIBE(prim_sTrim, "(trim str)")
+	tap_context* context = tapCreate();
+	expression* result;
+	char* str;
+
+	IT("Trims whitespace from either or both ends")
+		result = tapEvalString(context, "(+ \"[\" (trim \" \t a b \n\") \"|\" (trim-left \"  a \") \"|\" (trim-right \"  a \") \"|\" (trim \"   \") \"]\")");
+		str = tapResultStr(result);
+		SHOULD_MATCH(str, "[a b|a |  a|]")
+		free(str);
+		tapFreeResult(result);
+	END_IT
+
+	IT("Writes over an argument no variable holds but leaves a variable's string alone")
+		result = tapEvalString(context, "(set \"s\" \"a string long enough to share its content\") (+ (upper-case s) \"|\" (reverse (lower-case (upper-case s))) \"|\" s)");
+		str = tapResultStr(result);
+		SHOULD_MATCH(str, "A STRING LONG ENOUGH TO SHARE ITS CONTENT|tnetnoc sti erahs ot hguone gnol gnirts a|a string long enough to share its content")
+		free(str);
+		tapFreeResult(result);
+	END_IT
+
+	IT("Tests whether every character is in a class")
+		result = tapEvalString(context, "(+ (digit? \"0123456789012345678901234567890123456789\") (digit? \"12a\") (digit? \"\") (alpha? \"aBc\") (alnum? \"a1\") (space? \" \t\") (upper? \"AB\") (lower? \"aB\"))");
+		SHOULD_EQUAL(tapResultInt(result), 5)
+		tapFreeResult(result);
+	END_IT
+	tapDestroy(context);
+END_DESCRIBE
+
+DESCRIBE(prim_sSubstr, "(substr str int [int])")
+	tap_context* context = tapCreate();
+	expression* result;
+	char* str;
+
+	IT("Returns the characters between the bounds")
+		result = tapEvalString(context, "(+ (substr \"abcdef\" 2) \"|\" (substr \"abcdef\" 1 3) \"|\" (substr \"abcdefghijklmnopqrstuvwxyz\" 3 20))");
+		str = tapResultStr(result);
+		SHOULD_MATCH(str, "cdef|bcd|defghijklmnopqrstu")
+		free(str);
+		tapFreeResult(result);
+	END_IT
+
+	IT("Clamps bounds outside the string and returns nothing for reversed bounds")
+		result = tapEvalString(context, "(+ \"[\" (substr \"abcdef\" 9) \"|\" (substr \"abcdefghijklmnopqrstuvwxyz\" 5 2) \"|\" (substr \"abcdef\" 4 2) \"|\" (substr \"abcdef\" -3 1) \"]\")");
+		str = tapResultStr(result);
+		SHOULD_MATCH(str, "[|||ab]")
+		free(str);
+		tapFreeResult(result);
+		result = tapEvalString(context, "(+ (size (substr \"abcdef\" 2 10)) (size (substr \"abcdefghijklmnopqrstuvwxyz\" 20 100)))");
+		SHOULD_EQUAL(tapResultInt(result), 10)
+		tapFreeResult(result);
+	END_IT
+	tapDestroy(context);
+END_DESCRIBE
+
+int main () {
+	CSpec_Run(DESCRIPTION(convertCase), CSpec_NewOutputUnit());
+	CSpec_Run(DESCRIPTION(reverseBytes), CSpec_NewOutputUnit());
+	CSpec_Run(DESCRIPTION(spanClass), CSpec_NewOutputUnit());
+	CSpec_Run(DESCRIPTION(prim_sTrim), CSpec_NewOutputUnit());
+	CSpec_Run(DESCRIPTION(prim_sSubstr), CSpec_NewOutputUnit());
+
+	return 0;
+}
@@ -0,0 +1,172 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   tap_test.c
+    @brief  Tests for tap.c
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../../testing/cspec.h"
+#include "../../testing/cspec_output_unit.h"
+
+#include "../tap.h"
+#include "../constants.h"
+#include "../constructors.h"
+
+#define TEST_PACKAGE "tap_test_package.tap"
+#define TEST_SNAPSHOT "tap_test_snapshot.img"
+
+DESCRIBE(tapEvalString, "expression* tapEvalString (tap_context* context, char* text)")
+	tap_context* context = tapCreate();
+	expression* result;
+
+	IT("Evaluates the given code and returns a typed result")
+		result = tapEvalString(context, "(+ 1 2)");
+		SHOULD_EQUAL(tapResultType(result), TYPE_INT)
+		SHOULD_EQUAL(tapResultInt(result), 3)
+		SHOULD_EQUAL(tapFailed(context), 0)
+		tapFreeResult(result);
+		result = tapEvalString(context, "(* 1.5 2.0)");
+		SHOULD_EQUAL(tapResultType(result), TYPE_FLO)
+		SHOULD_EQUAL(tapResultFlo(result), 3.0)
+		tapFreeResult(result);
+		result = tapEvalString(context, "(str \"abc\")");
+		char* str = tapResultStr(result);
+		SHOULD_EQUAL(strcmp(str, "abc"), 0)
+		free(str);
+		tapFreeResult(result);
+		result = tapEvalString(context, "(+ [1])");
+		SHOULD_EQUAL(tapResultStr(result), NULL)
+		tapFreeResult(result);
+	END_IT
+
+	IT("Reports errors and returns nil when the code doesn't parse")
+		result = tapEvalString(context, "(+ 1 2");
+		SHOULD_EQUAL(tapResultType(result), TYPE_NIL)
+		SHOULD_EQUAL(tapFailed(context), 1)
+		tapFreeResult(result);
+	END_IT
+
+	IT("Discards the errors of the previous evaluation")
+		result = tapEvalString(context, "(+ 1 2)");
+		SHOULD_EQUAL(tapFailed(context), 0)
+		tapFreeResult(result);
+	END_IT
+	tapDestroy(context);
+END_DESCRIBE
+
+DESCRIBE(tapLoadPackage, "int tapLoadPackage (tap_context* context, char* path)")
+	tap_context* context = tapCreate();
+	expression* result;
+	FILE* package = fopen(TEST_PACKAGE, "w");
+	fputs("(set \"twice\" (function [(int n)] [(* n 2)]))\n(set \"answer\" 42)", package);
+	fclose(package);
+
+	IT("Keeps what the package sets defined for later evaluations")
+		SHOULD_EQUAL(tapLoadPackage(context, TEST_PACKAGE), 1)
+		result = tapEvalString(context, "(twice 21)");
+		SHOULD_EQUAL(tapResultInt(result), 42)
+		tapFreeResult(result);
+		result = tapEvalString(context, "(twice (twice 1))");
+		SHOULD_EQUAL(tapResultInt(result), 4)
+		tapFreeResult(result);
+	END_IT
+
+	IT("Fails when the package can't be read")
+		SHOULD_EQUAL(tapLoadPackage(context, "no such package.tap"), 0)
+		SHOULD_EQUAL(tapFailed(context), 1)
+	END_IT
+
+	IT("Evaluates files without keeping what they set")
+		result = tapEvalFile(context, TEST_PACKAGE);
+		SHOULD_EQUAL(tapFailed(context), 0)
+		tapFreeResult(result);
+		result = tapEvalString(context, "(twice 5)");
+		SHOULD_EQUAL(tapResultInt(result), 10)
+		tapFreeResult(result);
+	END_IT
+	remove(TEST_PACKAGE);
+	tapDestroy(context);
+END_DESCRIBE
+
+DESCRIBE(tapReset, "void tapReset (tap_context* context)")
+	tap_context* context = tapCreate();
+	expression* result;
+
+	IT("Discards errors but keeps the context usable")
+		result = tapEvalString(context, ")");
+		tapFreeResult(result);
+		SHOULD_EQUAL(tapFailed(context), 1)
+		tapReset(context);
+		SHOULD_EQUAL(tapFailed(context), 0)
+		SHOULD_EQUAL(context->cenvironment, 0)
+		result = tapEvalString(context, "(- 10 4)");
+		SHOULD_EQUAL(tapResultInt(result), 6)
+		tapFreeResult(result);
+	END_IT
+	tapDestroy(context);
+END_DESCRIBE
+
+DESCRIBE(tapRestoreSnapshot, "int tapRestoreSnapshot (tap_context* context, char* path)")
+	tap_context* context = tapCreate();
+	tap_context* restored;
+	expression* result;
+	FILE* file = fopen(TEST_PACKAGE, "w");
+	fputs("(set \"twice\" (function [(int n)] [(* n 2)]))\n(set \"answer\" 42)\n(set \"greeting\" (str \"hi\"))", file);
+	fclose(file);
+	tapLoadPackage(context, TEST_PACKAGE);
+	context->environments[0]->types = newTypedefs(newType(context->ctypeid++, "point", NULL, NULL, newProperty("x", newTypelist(TYPE_INT), PROP_PRIVACY_PUBLIC, PROP_RANGE_LOCAL, NULL)));
+
+	IT("Restores what the packages defined into a new context")
+		SHOULD_EQUAL(tapSaveSnapshot(context, TEST_SNAPSHOT), 1)
+		restored = tapCreate();
+		SHOULD_EQUAL(tapRestoreSnapshot(restored, TEST_SNAPSHOT), 1)
+		result = tapEvalString(restored, "(twice answer)");
+		SHOULD_EQUAL(tapResultInt(result), 84)
+		tapFreeResult(result);
+		result = tapEvalString(restored, "(str greeting)");
+		char* str = tapResultStr(result);
+		SHOULD_EQUAL(strcmp(str, "hi"), 0)
+		free(str);
+		tapFreeResult(result);
+		SHOULD_EQUAL(restored->ctypeid, TYPE_COMP_START + 1)
+		SHOULD_EQUAL(strcmp(restored->environments[0]->types->type->name, "point"), 0)
+		SHOULD_EQUAL(restored->environments[0]->types->type->properties->types->type, TYPE_INT)
+	END_IT
+
+	IT("Refuses to restore into a context that already defined something")
+		SHOULD_EQUAL(tapRestoreSnapshot(restored, TEST_SNAPSHOT), 0)
+		SHOULD_EQUAL(tapFailed(restored), 1)
+		tapDestroy(restored);
+	END_IT
+
+	IT("Rejects truncated snapshots and leaves the context empty")
+		file = fopen(TEST_SNAPSHOT, "r+");
+		fseek(file, 0, SEEK_END);
+		long size = ftell(file);
+		fclose(file);
+		truncate(TEST_SNAPSHOT, size - 3);
+		restored = tapCreate();
+		SHOULD_EQUAL(tapRestoreSnapshot(restored, TEST_SNAPSHOT), 0)
+		SHOULD_EQUAL(restored->environments[0]->numvars, 0)
+		SHOULD_EQUAL(restored->environments[0]->types, NULL)
+		SHOULD_EQUAL(restored->ctypeid, TYPE_COMP_START)
+		tapDestroy(restored);
+	END_IT
+	remove(TEST_PACKAGE);
+	remove(TEST_SNAPSHOT);
+	tapDestroy(context);
+END_DESCRIBE
+
+int main () {
+	CSpec_Run(DESCRIPTION(tapEvalString), CSpec_NewOutputUnit());
+	CSpec_Run(DESCRIPTION(tapLoadPackage), CSpec_NewOutputUnit());
+	CSpec_Run(DESCRIPTION(tapReset), CSpec_NewOutputUnit());
+	CSpec_Run(DESCRIPTION(tapRestoreSnapshot), CSpec_NewOutputUnit());
+
+	return 0;
+}
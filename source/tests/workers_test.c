@@ -0,0 +1,209 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   workers_test.c
+    @brief  Tests for workers.c
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../../testing/cspec.h"
+#include "../../testing/cspec_output_unit.h"
+
+#include "../workers.h"
+#include "../tap.h"
+#include "../engine.h"
+#include "../constants.h"
+#include "../constructors.h"
+#include "../strings.h"
+
+#define TEST_TASKS 200
+#define TEST_ELEMENTS 1000
+
+static int calls[TEST_TASKS];
+static int parallelcalls;
+
+/*! Counts its call and, for every tenth index, adds an error naming the index (a workertask)
+*/
+static void countTask (void* data, int index, int parallel) {
+	__sync_fetch_and_add(&calls[index], 1);
+	__sync_fetch_and_add(&parallelcalls, parallel);
+	if (index % 10 == 0) {
+		char* text = allocate(12);
+		sprintf(text, "%d", index);
+		addError(newErrorlist(ERR_GENERAL, newString(text), 0, 0));
+	}
+}
+
+/*! Returns the code of an array literal of the integers counting down from the given number
+*/
+static char* countdown (char* format, int size) {
+	char* elements = allocate(size * 12 + 1);
+	int length = 0;
+	int i;
+	for (i = size - 1; i >= 0; --i) {
+		length += sprintf(elements + length, "%d ", i);
+	}
+	elements[length - 1] = '\0';
+	char* code = allocate(length + strlen(format));
+	sprintf(code, format, elements);
+	free(elements);
+	return code;
+}
+
+DESCRIBE(runParallel, "void runParallel (workertask task, void* data, int numtasks)")
+	tap_context* context = tapCreate();
+	tap_context* previous = setContext(context);
+
+	IT("Calls the task once for each index on the workers")
+		runParallel(&countTask, NULL, TEST_TASKS);
+		int i, once = 1;
+		for (i = 0; i < TEST_TASKS; ++i) {
+			once = once && calls[i] == 1;
+		}
+		SHOULD_EQUAL(once, 1)
+		SHOULD_EQUAL(parallelWorkers(), 4)
+		SHOULD_EQUAL(parallelcalls, TEST_TASKS)
+	END_IT
+
+	IT("Adds the tasks' errors in index order")
+		errorlist* error = context->errors;
+		int i, ordered = 1;
+		for (i = 0; i < TEST_TASKS; i += 10) {
+			ordered = ordered && error != NULL && atoi(error->message->content) == i;
+			error = error == NULL ? NULL : error->next;
+		}
+		SHOULD_EQUAL(ordered, 1)
+		SHOULD_EQUAL(error, NULL)
+	END_IT
+	setContext(previous);
+	tapDestroy(context);
+END_DESCRIBE
+
+DESCRIBE(parallelSafe, "int parallelSafe (tap_fun* fun)")
+	tap_context* context = tapCreate();
+	tap_context* previous = setContext(context);
+	expression* fun;
+
+	IT("Accepts functions that only use their arguments and built-ins")
+		fun = tapEvalString(context, "(function [(int n)] [(if (> n 0) (* n pi) (here 1))])");
+		SHOULD_EQUAL(parallelSafe(fun->ev.funval), 1)
+		freeExpr(fun);
+	END_IT
+
+	IT("Rejects functions that use impure built-ins")
+		fun = tapEvalString(context, "(function [(int n)] [(print (str n))])");
+		SHOULD_EQUAL(parallelSafe(fun->ev.funval), 0)
+		freeExpr(fun);
+	END_IT
+
+	IT("Rejects functions that use variables of the calling context")
+		tapLoadPackage(context, "/dev/null");
+		expression* value = newExpressionInt(2);
+		insertUserHash(context->environments[0]->variables, "scale", value);
+		++context->environments[0]->numvars;
+		fun = tapEvalString(context, "(function [(int n)] [(* n scale)])");
+		SHOULD_EQUAL(parallelSafe(fun->ev.funval), 0)
+		freeExpr(fun);
+	END_IT
+	setContext(previous);
+	tapDestroy(context);
+END_DESCRIBE
+
+DESCRIBE(prim_aMap, "(map arr fun)")
+	tap_context* context = tapCreate();
+	expression* result;
+	char* code;
+
+	IT("Keeps the results in the order of the elements")
+		code = countdown("(map {%s} (function [(int n)] [(* n 2)]))", TEST_ELEMENTS);
+		result = tapEvalString(context, code);
+		free(code);
+		SHOULD_EQUAL(result->type, TYPE_ARR)
+		SHOULD_EQUAL(result->ev.arrval->end, TEST_ELEMENTS - 1)
+		SHOULD_EQUAL(result->ev.arrval->content[0]->ev.intval, (TEST_ELEMENTS - 1) * 2)
+		SHOULD_EQUAL(result->ev.arrval->content[TEST_ELEMENTS - 1]->ev.intval, 0)
+		tapFreeResult(result);
+	END_IT
+
+	IT("Keeps the elements the function accepts, in order")
+		code = countdown("(filter {%s} (function [(int n)] [(== (%% n 4) 0)]))", TEST_ELEMENTS);
+		result = tapEvalString(context, code);
+		free(code);
+		SHOULD_EQUAL(result->ev.arrval->end, TEST_ELEMENTS / 4 - 1)
+		SHOULD_EQUAL(result->ev.arrval->content[0]->ev.intval, TEST_ELEMENTS - 4)
+		SHOULD_EQUAL(result->ev.arrval->content[1]->ev.intval, TEST_ELEMENTS - 8)
+		tapFreeResult(result);
+	END_IT
+
+	IT("Sorts by value or with the given function")
+		code = countdown("(sort {%s})", TEST_ELEMENTS);
+		result = tapEvalString(context, code);
+		free(code);
+		int i, sorted = 1;
+		for (i = 0; i < TEST_ELEMENTS; ++i) {
+			sorted = sorted && result->ev.arrval->content[i]->ev.intval == i;
+		}
+		SHOULD_EQUAL(sorted, 1)
+		tapFreeResult(result);
+		code = countdown("(sort {%s} (function [(int p) (int q)] [(> (%% p 10) (%% q 10))]))", TEST_ELEMENTS);
+		result = tapEvalString(context, code);
+		free(code);
+		SHOULD_EQUAL(result->ev.arrval->content[0]->ev.intval, TEST_ELEMENTS - 1) // equal keys keep their order
+		SHOULD_EQUAL(result->ev.arrval->content[1]->ev.intval, TEST_ELEMENTS - 11)
+		SHOULD_EQUAL(result->ev.arrval->content[TEST_ELEMENTS - 1]->ev.intval, 0)
+		tapFreeResult(result);
+	END_IT
+
+	IT("Folds the elements in order")
+		result = tapEvalString(context, "(accum {1 2 3} (function [(int total) (int n)] [(+ (* total 10) n)]) 0)");
+		SHOULD_EQUAL(tapResultInt(result), 123)
+		tapFreeResult(result);
+	END_IT
+	tapDestroy(context);
+END_DESCRIBE
+
+DESCRIBE(spawnLazy, "expression* spawnLazy (expression* lazy)")
+	tap_context* context = tapCreate();
+	expression* result;
+
+	IT("Returns a lazy expression that waits for the result when it's forced")
+		result = tapEvalString(context, "(set \"f\" (spawn [(* 6 7)])) (+ (await f) (await f))");
+		SHOULD_EQUAL(tapResultInt(result), 84)
+		tapFreeResult(result);
+	END_IT
+
+	IT("Evaluates the expression with copies of the variables it refers to")
+		result = tapEvalString(context, "(set \"sq\" (function [(int n)] [(* n n)])) (set \"base\" 7) (set \"f\" (spawn [(set \"base\" (sq base)) base])) (+ (await f) base)");
+		SHOULD_EQUAL(tapResultInt(result), 56)
+		tapFreeResult(result);
+	END_IT
+
+	IT("Collects the results of several spawned expressions in order")
+		result = tapEvalString(context, "(set \"a\" (spawn [(* 2 3)])) (set \"b\" (spawn [(+ 2 3)])) (await-all {a b 4})");
+		SHOULD_EQUAL(result->type, TYPE_ARR)
+		SHOULD_EQUAL(result->ev.arrval->content[0]->ev.intval, 6)
+		SHOULD_EQUAL(result->ev.arrval->content[1]->ev.intval, 5)
+		SHOULD_EQUAL(result->ev.arrval->content[2]->ev.intval, 4)
+		tapFreeResult(result);
+	END_IT
+
+	IT("Adds the expression's errors to the context that awaits it")
+		result = tapEvalString(context, "(set \"f\" (spawn [(+ missing 1)])) (await f)");
+		SHOULD_EQUAL(tapFailed(context), 1)
+		tapFreeResult(result);
+	END_IT
+	tapDestroy(context);
+END_DESCRIBE
+
+int main () {
+	setenv(WORKER_COUNT_VARIABLE, "4", 1); // use the pool however many processors the machine running the tests has
+	CSpec_Run(DESCRIPTION(runParallel), CSpec_NewOutputUnit());
+	CSpec_Run(DESCRIPTION(parallelSafe), CSpec_NewOutputUnit());
+	CSpec_Run(DESCRIPTION(prim_aMap), CSpec_NewOutputUnit());
+	CSpec_Run(DESCRIPTION(spawnLazy), CSpec_NewOutputUnit());
+
+	return 0;
+}
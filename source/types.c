@@ -8,6 +8,7 @@
 #include <string.h>
 
 #include "types.h"
+#include "strings.h"
 
 /*! Returns whether or not the given list of required properties are satisfied by the given list of extant properties
     @param required     the list of strings indicating the required properties
@@ -17,7 +18,7 @@
 int propReqsValid (stringlist* required, property* properties) {
     stringlist* sl = required;
     while (sl != NULL) {
-        char* reqstr = sl->str->content;
+        char* reqstr = stringContent(sl->str);
         int found = 0;
         property* prop = properties;
         while (prop != NULL) {
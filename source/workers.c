@@ -0,0 +1,646 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   workers.c
+    @brief  A process-wide pool of worker threads that share batches of tasks by work stealing, each worker evaluating in a context of its own
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "workers.h"
+#include "engine.h"
+#include "externs.h"
+#include "constants.h"
+#include "constructors.h"
+#include "memory.h"
+#include "builtins.h"
+#include "packages.h"
+#include "hashtable.h"
+#include "strings.h"
+
+/* A batch's tasks are dealt out to the workers' deques in contiguous runs. Each worker works through its own deque from the
+   bottom and, once it runs dry, steals from the top of the others', so a worker whose tasks happen to be slow doesn't hold up the
+   batch. A worker reserves a task (by decrementing the count of queued tasks) before taking one, so every reservation is backed
+   by a task in some deque. Tasks running on a worker never submit to the pool themselves but run nested batches in place, since
+   a worker waiting on a batch could end up waiting on itself. A worker can still wait, though, on a channel or a spawned
+   expression; when every worker is waiting and tasks are queued, the pool starts another worker so that whatever they're waiting
+   for gets a chance to run.
+
+   A spawned lazy expression is a batch of one task. Since the worker evaluating it has a context of its own, spawning copies the
+   value of every variable the expression (or any function it calls) refers to, and the expression is evaluated in an environment
+   holding just those copies; whatever it sets stays there. The lazy expression spawn returns carries the future, and forcing it
+   waits for the result. */
+
+static poolworker* workers = NULL;
+static int numworkers = 0; // the number of threads started, which other threads read without the lock
+static int poolsize = 0; // the number of workers the pool was sized for
+static int blocked = 0; // the number of workers waiting on a channel or a spawned expression
+static int queued = 0; // the number of tasks in the deques that no worker has reserved yet
+static int pending = 0; // the number of spawned expressions queued or running on the workers
+static int nextworker = 0; // which worker's deque the next batch starts at
+static pthread_mutex_t poollock = PTHREAD_MUTEX_INITIALIZER; // guards the count of queued tasks
+static pthread_cond_t poolready = PTHREAD_COND_INITIALIZER; // signaled when tasks are queued
+static pthread_once_t poolonce = PTHREAD_ONCE_INIT;
+static __thread int inbatch = 0; // set in the worker threads, so nested parallel calls run in place
+
+static void startPool();
+static void addWorker();
+static void startBatch(workerbatch*, workertask, void*, int);
+static void finishBatch(workerbatch*, int);
+static void* runPoolWorker(void*);
+static void pushJob(workerdeque*, workerjob);
+static int takeJob(poolworker*, workerjob*);
+static void runJob(workerjob*);
+static int safeExpression(expression*, tap_fun*);
+static int safeName(char*, tap_fun*);
+static int captureNames(tap_future*, expression*, tap_fun*);
+static int captureName(tap_future*, char*, tap_fun*);
+static expression* callerVariable(char*);
+static int reserveFuture();
+static void runFuture(void*, int, int);
+static void freeFuture(tap_future*);
+
+/*! Calls the given task once for each index from 0 to the given number of tasks, spreading the calls across the worker pool, and returns once every call has finished; the errors each call generates are added to the current context in index order
+    @param task         the task, called with the given data, the index and 1 if it's running on a worker concurrently with the batch's other tasks (0 if the tasks are being run one after another in the calling thread)
+    @param data         the data passed to every call
+    @param numtasks     the number of calls
+    @return             nothing
+*/
+void runParallel (workertask task, void* data, int numtasks) {
+    int i;
+    if (numtasks < 2 || inbatch || parallelWorkers() < 2) { // not worth handing out, or already running on a worker
+        for (i = 0; i < numtasks; ++i) {
+            task(data, i, 0);
+        }
+        return;
+    }
+    workerbatch batch;
+    startBatch(&batch, task, data, numtasks);
+    finishBatch(&batch, 1);
+}
+
+/*! Returns the number of workers the pool was sized for, starting the pool if it isn't running yet
+    @return             the number of workers (1 on a single processor, where array functions never use the pool)
+*/
+int parallelWorkers () {
+    pthread_once(&poolonce, &startPool);
+    return poolsize;
+}
+
+/*! Tells the pool that the current thread is about to wait on something another task may have to do, starting another worker if every worker would then be waiting while tasks are queued; does nothing outside the worker threads
+    @return             nothing
+*/
+void blockWorker () {
+    if (!inbatch) {
+        return;
+    }
+    pthread_mutex_lock(&poollock);
+    ++blocked;
+    if (queued > 0 && blocked >= numworkers && numworkers < WORKER_MAX_THREADS) {
+        addWorker();
+    }
+    pthread_mutex_unlock(&poollock);
+}
+
+/*! Tells the pool that the current thread, which called blockWorker, is done waiting
+    @return             nothing
+*/
+void unblockWorker () {
+    if (!inbatch) {
+        return;
+    }
+    pthread_mutex_lock(&poollock);
+    --blocked;
+    pthread_mutex_unlock(&poollock);
+}
+
+/*! Returns a copy of the given value that shares nothing with it, so that it can be handed to another context; a spawned lazy expression is waited for first, and the copy of a forced lazy expression keeps its result
+    @param value        the value
+    @return             the copy
+*/
+expression* detachedCopy (expression* value) {
+    if (value->type == TYPE_LAZ && value->ev.lazval->future != NULL) {
+        awaitFuture(value->ev.lazval);
+    }
+    expression* copy = copyExpressionUnsharedNR(value);
+    if (value->type == TYPE_LAZ && value->ev.lazval->value != NULL) {
+        copy->ev.lazval->value = copyExpressionUnsharedNR(value->ev.lazval->value);
+    }
+    return copy;
+}
+
+/*! Returns whether or not the given function can be evaluated by the workers, which is the case when it only refers to its arguments, itself, and built-ins that aren't impure and that the calling context doesn't redefine
+    @param fun          the function
+    @return             1 if the function can be evaluated in another context, 0 otherwise
+*/
+int parallelSafe (tap_fun* fun) {
+    if (fun->memo != NULL) { // its cache belongs to the calling context
+        return 0;
+    }
+    int numargs = fun->maxargs == ARGLEN_INF ? fun->minargs : fun->maxargs;
+    int i;
+    for (i = 0; i < numargs; ++i) {
+        if (fun->args[i] != NULL && !safeExpression(fun->args[i]->initial, fun)) {
+            return 0;
+        }
+    }
+    return safeExpression(fun->body, fun);
+}
+
+/*! Starts evaluating the given lazy expression on the worker pool and returns a lazy expression that, when forced, waits for and returns the result; the expression is evaluated in the calling thread instead when it refers to objects or the pool already has as many spawned expressions as it queues
+    @param lazy         the lazy expression
+    @return             the lazy expression standing for the result
+*/
+expression* spawnLazy (expression* lazy) {
+    tap_future* future = allocate(sizeof(tap_future));
+    future->body = newExpressionLaz(copyExpressionUnshared(lazy->ev.lazval->expval));
+    future->names = allocate(sizeof(char*) * INITIAL_FUTURE_CAPTURES);
+    future->values = allocate(sizeof(expression*) * INITIAL_FUTURE_CAPTURES);
+    future->numcaptures = 0;
+    future->capacity = INITIAL_FUTURE_CAPTURES;
+    future->result = NULL;
+    int movable = captureNames(future, future->body->ev.lazval->expval, NULL);
+    expression* result = newExpressionLaz(copyExpression(lazy->ev.lazval->expval));
+    pthread_once(&poolonce, &startPool);
+    if (movable && reserveFuture()) {
+        result->ev.lazval->future = future;
+        startBatch(&future->batch, &runFuture, future, 1);
+    } else {
+        runFuture(future, 0, 0);
+        result->ev.lazval->value = future->result;
+        future->result = NULL;
+        freeFuture(future);
+    }
+    return result;
+}
+
+/*! Waits for the given lazy expression's spawned evaluation to finish, caching its result in the lazy expression and adding its errors to the current context
+    @param lazy         the lazy expression, whose future is set
+    @return             nothing
+*/
+void awaitFuture (tap_laz* lazy) {
+    tap_future* future = lazy->future;
+    finishBatch(&future->batch, 1);
+    lazy->future = NULL;
+    lazy->value = future->result;
+    future->result = NULL;
+    freeFuture(future);
+}
+
+/*! Waits for the given spawned evaluation to finish and frees it along with its result, which nothing refers to anymore
+    @param future       the future
+    @return             nothing
+*/
+void discardFuture (tap_future* future) {
+    finishBatch(&future->batch, 0);
+    freeFuture(future);
+}
+
+/*! Starts the worker threads, one per online processor unless TAP_WORKERS says otherwise (but always at least one, so spawned expressions have somewhere to run)
+    @return             nothing
+*/
+static void startPool () {
+    char* setting = getenv(WORKER_COUNT_VARIABLE);
+    long cores = setting != NULL ? strtol(setting, NULL, 10) : sysconf(_SC_NPROCESSORS_ONLN);
+    poolsize = cores < 1 ? 1 : (cores > WORKER_MAX_THREADS ? WORKER_MAX_THREADS : cores);
+    workers = allocate(sizeof(poolworker) * WORKER_MAX_THREADS); // room for the workers started while others are blocked
+    pthread_mutex_lock(&poollock);
+    int i;
+    for (i = 0; i < poolsize; ++i) {
+        addWorker();
+    }
+    pthread_mutex_unlock(&poollock);
+}
+
+/*! Starts another worker thread, which lives as long as the process; the pool must be locked
+    @return             nothing
+*/
+static void addWorker () {
+    int index = numworkers;
+    poolworker* worker = &workers[index];
+    worker->index = index;
+    worker->context = newContext();
+    worker->deque.jobs = allocate(sizeof(workerjob) * WORKER_INITIAL_DEQUE_SIZE);
+    worker->deque.top = 0;
+    worker->deque.bottom = 0;
+    worker->deque.capacity = WORKER_INITIAL_DEQUE_SIZE;
+    pthread_mutex_init(&worker->deque.lock, NULL);
+    __atomic_store_n(&numworkers, index + 1, __ATOMIC_RELEASE); // only counted once its deque is ready
+    pthread_create(&worker->thread, NULL, &runPoolWorker, worker);
+    pthread_detach(worker->thread);
+}
+
+/*! Hands the given batch's tasks out to the workers' deques, each worker getting a contiguous run of them
+    @param batch        the batch, which must stay in memory until it's finished
+    @param task         the task
+    @param data         the data passed to every call
+    @param numtasks     the number of calls
+    @return             nothing
+*/
+static void startBatch (workerbatch* batch, workertask task, void* data, int numtasks) {
+    batch->task = task;
+    batch->data = data;
+    batch->errors = allocate(sizeof(errorlist*) * numtasks);
+    batch->numtasks = numtasks;
+    batch->remaining = numtasks;
+    pthread_mutex_init(&batch->lock, NULL);
+    pthread_cond_init(&batch->done, NULL);
+    batch->parked.first = NULL;
+    int i;
+    for (i = 0; i < numtasks; ++i) {
+        batch->errors[i] = NULL;
+    }
+    int offset = __sync_fetch_and_add(&nextworker, 1); // rotate which worker gets the first run, so batches of a single task don't all land on one deque
+    int count = __atomic_load_n(&numworkers, __ATOMIC_ACQUIRE);
+    int w;
+    for (w = 0; w < count; ++w) { // pushed last first so that each worker takes its run in order
+        int first = (int)((long)numtasks * w / count);
+        int last = (int)((long)numtasks * (w + 1) / count);
+        workerdeque* deque = &workers[(w + offset) % count].deque;
+        pthread_mutex_lock(&deque->lock);
+        for (i = last - 1; i >= first; --i) {
+            workerjob job = {batch, i};
+            pushJob(deque, job);
+        }
+        pthread_mutex_unlock(&deque->lock);
+    }
+    pthread_mutex_lock(&poollock);
+    queued += numtasks;
+    if (blocked >= numworkers && numworkers < WORKER_MAX_THREADS) { // nobody is free to take the tasks
+        addWorker();
+    }
+    pthread_cond_broadcast(&poolready);
+    pthread_mutex_unlock(&poollock);
+}
+
+/*! Waits for every task of the given batch to finish and releases what the batch holds
+    @param batch        the batch
+    @param report       1 to add the tasks' errors to the current context in index order, 0 to discard them
+    @return             nothing
+*/
+static void finishBatch (workerbatch* batch, int report) {
+    pthread_mutex_lock(&batch->lock);
+    if (batch->remaining > 0) {
+        blockWorker();
+        while (batch->remaining > 0) {
+            parkTask(&batch->parked, &batch->done, &batch->lock);
+        }
+        unblockWorker();
+    }
+    pthread_mutex_unlock(&batch->lock);
+    int i;
+    for (i = 0; i < batch->numtasks; ++i) { // the errors are reported in the order they would have been generated by running the tasks in turn
+        errorlist* error = batch->errors[i];
+        if (!report) {
+            freeErrors(error);
+            continue;
+        }
+        while (error != NULL) {
+            errorlist* next = error->next;
+            error->next = NULL;
+            addError(error);
+            error = next;
+        }
+    }
+    free(batch->errors);
+    pthread_mutex_destroy(&batch->lock);
+    pthread_cond_destroy(&batch->done);
+}
+
+/*! Reserves and runs tasks for as long as the process runs
+    @param arg          the worker
+    @return             never returns
+*/
+static void* runPoolWorker (void* arg) {
+    poolworker* worker = arg;
+    setContext(worker->context);
+    inbatch = 1;
+    while (1) {
+        pthread_mutex_lock(&poollock);
+        while (queued == 0) {
+            pthread_cond_wait(&poolready, &poollock);
+        }
+        --queued; // reserve one of the queued tasks
+        pthread_mutex_unlock(&poollock);
+        workerjob job;
+        while (!takeJob(worker, &job)); // the reservation guarantees a task is in some deque
+        runJob(&job);
+    }
+    return NULL;
+}
+
+/*! Pushes the given job onto the bottom of the given deque, growing it if needed; the deque must be locked
+    @param deque        the deque
+    @param job          the job
+    @return             nothing
+*/
+static void pushJob (workerdeque* deque, workerjob job) {
+    if (deque->bottom - deque->top == deque->capacity) {
+        workerjob* jobs = allocate(sizeof(workerjob) * deque->capacity * 2);
+        int i;
+        for (i = deque->top; i < deque->bottom; ++i) {
+            jobs[i - deque->top] = deque->jobs[i % deque->capacity];
+        }
+        free(deque->jobs);
+        deque->jobs = jobs;
+        deque->bottom -= deque->top;
+        deque->top = 0;
+        deque->capacity *= 2;
+    }
+    deque->jobs[deque->bottom % deque->capacity] = job;
+    ++deque->bottom;
+}
+
+/*! Takes a job from the bottom of the given worker's deque or, failing that, steals one from the top of another worker's
+    @param worker       the worker
+    @param job          set to the job taken
+    @return             1 if a job was taken, 0 if every deque was empty
+*/
+static int takeJob (poolworker* worker, workerjob* job) {
+    int count = __atomic_load_n(&numworkers, __ATOMIC_ACQUIRE);
+    int i;
+    for (i = 0; i < count; ++i) {
+        workerdeque* deque = &workers[(worker->index + i) % count].deque;
+        pthread_mutex_lock(&deque->lock);
+        if (deque->bottom > deque->top) {
+            if (i == 0) { // the worker's own deque
+                --deque->bottom;
+                *job = deque->jobs[deque->bottom % deque->capacity];
+            } else {
+                *job = deque->jobs[deque->top % deque->capacity];
+                ++deque->top;
+            }
+            pthread_mutex_unlock(&deque->lock);
+            return 1;
+        }
+        pthread_mutex_unlock(&deque->lock);
+    }
+    return 0;
+}
+
+/*! Runs the given job in the current worker's context, keeping the errors it generates for the batch, and wakes the thread waiting on the batch if it was the last one
+    @param job          the job
+    @return             nothing
+*/
+static void runJob (workerjob* job) {
+    workerbatch* batch = job->batch;
+    batch->task(batch->data, job->index, 1);
+    batch->errors[job->index] = ccontext->errors; // each task has its own slot so this needs no lock
+    ccontext->errors = NULL;
+    ccontext->cerror = NULL;
+    pthread_mutex_lock(&batch->lock);
+    if (--batch->remaining == 0) {
+        unparkTasks(&batch->parked, &batch->done);
+    }
+    pthread_mutex_unlock(&batch->lock);
+}
+
+/*! Returns whether or not every name the given list of expressions refers to can be resolved the same way in another context
+    @param expr         the list of expressions
+    @param fun          the function the expressions belong to
+    @return             1 if they can be evaluated in another context, 0 otherwise
+*/
+static int safeExpression (expression* expr, tap_fun* fun) {
+    for (; expr != NULL; expr = expr->next) {
+        int i;
+        switch (expr->type) {
+            case TYPE_EXP:
+                if (!safeExpression(expr->ev.expval, fun)) {
+                    return 0;
+                }
+                break;
+            case TYPE_LAZ:
+                if (!safeExpression(expr->ev.lazval->expval, fun)) {
+                    return 0;
+                }
+                break;
+            case TYPE_ARR:
+                for (i = expr->ev.arrval->start; i <= expr->ev.arrval->end; ++i) {
+                    if (!safeExpression(expr->ev.arrval->content[i], fun)) {
+                        return 0;
+                    }
+                }
+                break;
+            case TYPE_STR:
+                if (expr->flag == EFLAG_VAR && !safeName(expr->ev.strval->content, fun)) {
+                    return 0;
+                }
+                break;
+            case TYPE_FUN:
+            case TYPE_OBJ: // nested functions and objects may refer to anything
+                return 0;
+        }
+    }
+    return 1;
+}
+
+/*! Returns whether or not the given name, referred to by the given function, means the same thing in every context
+    @param name         the name
+    @param fun          the function that refers to it
+    @return             1 if the name is one of the function's arguments or a built-in nothing in the calling context shadows, 0 otherwise
+*/
+static int safeName (char* name, tap_fun* fun) {
+    int numargs = fun->maxargs == ARGLEN_INF ? fun->minargs : fun->maxargs;
+    int i;
+    for (i = 0; i < numargs; ++i) {
+        if (fun->args[i] != NULL && strcmp(fun->args[i]->name->content, name) == 0) {
+            return 1;
+        }
+    }
+    if (strcmp(name, "here") == 0) {
+        return 1;
+    }
+    if (primitiveImpure(name) || importsDefine(name)) {
+        return 0;
+    }
+    int cenv;
+    for (cenv = ccontext->cenvironment; cenv >= 0; cenv = ccontext->environments[cenv]->parent) { // anything the caller defined is out of reach of the workers
+        hashelement* list;
+        for (list = lookupHashList(ccontext->environments[cenv]->variables, name); list != NULL; list = list->next) {
+            if (strcmp(name, list->key) == 0) {
+                return 0;
+            }
+        }
+    }
+    int count;
+    if (lookupPrimitives(name, &count) != NULL) {
+        return 1;
+    }
+    expression* constant = builtinConstant(name);
+    if (constant == NULL) {
+        return 0;
+    }
+    freeExpr(constant);
+    return 1;
+}
+
+/*! Copies the value of every variable the given list of expressions refers to that the future doesn't have yet, along with the variables their values refer to in turn
+    @param future       the future to add the copies to
+    @param expr         the list of expressions
+    @param fun          the function the expressions belong to, whose arguments aren't looked up, or null
+    @return             1 if every copy can be handed to another thread, 0 otherwise
+*/
+static int captureNames (tap_future* future, expression* expr, tap_fun* fun) {
+    int movable = 1;
+    for (; expr != NULL; expr = expr->next) {
+        int i, numargs;
+        switch (expr->type) {
+            case TYPE_EXP:
+                movable &= captureNames(future, expr->ev.expval, fun);
+                break;
+            case TYPE_LAZ:
+                movable &= captureNames(future, expr->ev.lazval->expval, fun);
+                break;
+            case TYPE_ARR:
+                for (i = expr->ev.arrval->start; i <= expr->ev.arrval->end; ++i) {
+                    movable &= captureNames(future, expr->ev.arrval->content[i], fun);
+                }
+                break;
+            case TYPE_FUN: // the function's body is evaluated in whatever environment calls it
+                numargs = expr->ev.funval->maxargs == ARGLEN_INF ? expr->ev.funval->minargs : expr->ev.funval->maxargs;
+                for (i = 0; i < numargs; ++i) {
+                    if (expr->ev.funval->args[i] != NULL) {
+                        movable &= captureNames(future, expr->ev.funval->args[i]->initial, expr->ev.funval);
+                    }
+                }
+                movable &= captureNames(future, expr->ev.funval->body, expr->ev.funval);
+                break;
+            case TYPE_OBJ: // copies of objects share their properties
+                movable = 0;
+                break;
+            case TYPE_STR:
+                if (expr->flag == EFLAG_VAR) {
+                    movable &= captureName(future, expr->ev.strval->content, fun);
+                }
+                break;
+        }
+    }
+    return movable;
+}
+
+/*! Copies the value the given name has in the calling context into the future, unless it's an argument of the given function, a built-in or already copied
+    @param future       the future to add the copy to
+    @param name         the name
+    @param fun          the function that refers to the name, or null
+    @return             1 if the copy can be handed to another thread, 0 otherwise
+*/
+static int captureName (tap_future* future, char* name, tap_fun* fun) {
+    int i;
+    if (fun != NULL) {
+        int numargs = fun->maxargs == ARGLEN_INF ? fun->minargs : fun->maxargs;
+        for (i = 0; i < numargs; ++i) {
+            if (fun->args[i] != NULL && strcmp(fun->args[i]->name->content, name) == 0) {
+                return 1;
+            }
+        }
+        if (strcmp(name, "here") == 0) {
+            return 1;
+        }
+    }
+    for (i = 0; i < future->numcaptures; ++i) {
+        if (strcmp(future->names[i], name) == 0) {
+            return 1;
+        }
+    }
+    expression* value = callerVariable(name);
+    if (value == NULL) { // built-ins mean the same thing in every context
+        return 1;
+    }
+    expression* copy = detachedCopy(value);
+    if (future->numcaptures == future->capacity) {
+        future->capacity *= 2;
+        future->names = realloc(future->names, sizeof(char*) * future->capacity);
+        future->values = realloc(future->values, sizeof(expression*) * future->capacity);
+    }
+    future->names[future->numcaptures] = strDup(name);
+    future->values[future->numcaptures] = copy;
+    ++future->numcaptures; // added before following the copy so that recursive functions are only copied once
+    if (value->type == TYPE_OBJ) {
+        return 0;
+    }
+    return captureNames(future, copy, NULL);
+}
+
+/*! Returns the value the given name is bound to in the calling context, defining it from the imported packages if need be
+    @param name         the name
+    @return             the value itself (not a copy), or null if the name isn't a variable
+*/
+static expression* callerVariable (char* name) {
+    int cenv;
+    for (cenv = ccontext->cenvironment; cenv >= 0; cenv = ccontext->environments[cenv]->parent) {
+        hashelement* list;
+        for (list = lookupHashList(ccontext->environments[cenv]->variables, name); list != NULL; list = list->next) {
+            if (strcmp(name, list->key) == 0) {
+                return list->flag == HFLAG_USER || list->flag == HFLAG_DIRECT ? list->value : NULL;
+            }
+        }
+    }
+    if (defineImported(name)) {
+        return callerVariable(name);
+    }
+    return NULL;
+}
+
+/*! Reserves room for one more spawned expression on the worker pool
+    @return             1 if there was room, 0 if the pool already has as many as it queues
+*/
+static int reserveFuture () {
+    int reserved = 0;
+    pthread_mutex_lock(&poollock);
+    if (pending < FUTURE_MAX_PENDING) {
+        ++pending;
+        reserved = 1;
+    }
+    pthread_mutex_unlock(&poollock);
+    return reserved;
+}
+
+/*! Evaluates the given future's expression in a new environment holding only the variables it captured (a workertask)
+    @param data         the future
+    @param index        unused since a future is a batch of one
+    @param parallel     1 if running on a worker, which releases the future's reservation once it's done
+    @return             nothing
+*/
+static void runFuture (void* data, int index, int parallel) {
+    tap_future* future = data;
+    tap_context* context = ccontext;
+    int previous = context->cenvironment;
+    reserveEnvironment();
+    environment* env = context->environments[previous + 1];
+    env->parent = -1; // nothing but the captured variables is visible to the expression, wherever it runs
+    ++context->cenvironment;
+    int i;
+    for (i = 0; i < future->numcaptures; ++i) { // the environment takes over the copies
+        insertUserHash(env->variables, future->names[i], future->values[i]);
+        future->values[i] = NULL;
+    }
+    env->numvars = future->numcaptures;
+    future->result = evaluateBody(future->body);
+    resetEnvironment();
+    context->cenvironment = previous; // resetEnvironment returns to the environment's parent, which it doesn't have
+    if (parallel) {
+        pthread_mutex_lock(&poollock);
+        --pending;
+        pthread_mutex_unlock(&poollock);
+    }
+}
+
+/*! Frees the given future along with its expression, captured variables and result
+    @param future       the future
+    @return             nothing
+*/
+static void freeFuture (tap_future* future) {
+    int i;
+    for (i = 0; i < future->numcaptures; ++i) {
+        free(future->names[i]);
+        freeExpr(future->values[i]);
+    }
+    free(future->names);
+    free(future->values);
+    freeExpr(future->body);
+    freeExprNR(future->result);
+    free(future);
+}
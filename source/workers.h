@@ -0,0 +1,75 @@
+/*! AppTap.org Tap Processor
+    @author Jack Holland <jack@apptap.org>
+    @file   workers.h
+    @brief  The header file for workers.c
+    (C) 2011 Jack Holland. All rights reserved.
+*/
+
+#ifndef WORKERS_H
+#define WORKERS_H
+
+#include <pthread.h>
+
+#include "structs.h"
+#include "dep_structs.h"
+#include "scheduler.h"
+
+typedef void (*workertask)(void*, int, int);
+
+typedef struct workerbatch_ workerbatch;
+typedef struct workerjob_ workerjob;
+typedef struct workerdeque_ workerdeque;
+typedef struct poolworker_ poolworker;
+
+struct workerbatch_ {
+    workertask task;
+    void* data; // passed to every task of the batch
+    errorlist** errors; // the errors each task generated, appended to the caller's errors in order once the batch is finished
+    int numtasks;
+    int remaining; // the number of tasks that haven't finished yet
+    pthread_mutex_t lock;
+    pthread_cond_t done;
+    tasklist parked; // the green task waiting on the batch, if a task is the caller
+};
+
+struct workerjob_ {
+    workerbatch* batch;
+    int index; // which of the batch's tasks this is
+};
+
+struct workerdeque_ {
+    workerjob* jobs; // a ring buffer; the owner takes from the bottom and other workers steal from the top
+    int top;
+    int bottom;
+    int capacity;
+    pthread_mutex_t lock;
+};
+
+struct tap_future_ {
+    workerbatch batch; // the single task evaluating the expression on a worker
+    expression* body; // an unshared copy of the spawned lazy expression
+    char** names; // the names of the variables the expression refers to
+    expression** values; // unshared copies of their values in the spawning context, bound in the environment the expression is evaluated in
+    int numcaptures;
+    int capacity;
+    expression* result; // set once the expression is evaluated
+};
+
+struct poolworker_ {
+    pthread_t thread;
+    tap_context* context; // the context this worker evaluates every task in
+    workerdeque deque;
+    int index;
+};
+
+void runParallel(workertask, void*, int);
+int parallelWorkers();
+int parallelSafe(tap_fun*);
+void blockWorker();
+void unblockWorker();
+expression* detachedCopy(expression*);
+expression* spawnLazy(expression*);
+void awaitFuture(tap_laz*);
+void discardFuture(tap_future*);
+
+#endif